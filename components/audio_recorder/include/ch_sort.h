@@ -27,6 +27,7 @@
 
 #include <string.h>
 #include "esp_err.h"
+#include "audio_channel.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -82,19 +83,15 @@ static __attribute__((always_inline)) inline int8_t ch_get_idx(int8_t *order, si
  * @param len           length of `i_buf`, length of `o_buf` should not less than `i_buf`'s
  * @param src_order     order of the channels
  * @return ESP_OK
+ *         ESP_ERR_INVALID_ARG
  */
 static __attribute__((always_inline)) inline esp_err_t ch_sort_16bit_2ch(int16_t *i_buf, int16_t *o_buf, size_t len, int8_t *src_order)
 {
-    if (src_order[0] == DAT_CH_0 && src_order[1] == DAT_CH_1) {
-        memcpy(o_buf, i_buf, len);
-        return ESP_OK;
-    }
-    for (int i = 0; i < (len >> 2); i++) {
-        size_t cur_idx = i << 1;
-        o_buf[cur_idx] = i_buf[cur_idx + 1];
-        o_buf[cur_idx + 1] = i_buf[cur_idx];
+    int8_t map[2];
+    if (audio_channel_map_from_order(src_order, 2, map, 2) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_OK;
+    return audio_channel_reorder_16bit(o_buf, 2, i_buf, 2, map, len >> 2);
 }
 
 /**
@@ -111,19 +108,11 @@ static __attribute__((always_inline)) inline esp_err_t ch_sort_16bit_2ch(int16_t
  */
 static __attribute__((always_inline)) inline esp_err_t ch_sort_16bit_4ch(int16_t *i_buf, int16_t *o_buf, size_t len, int8_t *src_order)
 {
-    int8_t ch0_idx = ch_get_idx(src_order, 4, DAT_CH_0);
-    int8_t ch1_idx = ch_get_idx(src_order, 4, DAT_CH_1);
-    int8_t ref_idx = ch_get_idx(src_order, 4, DAT_CH_2);
-
-    if (ch0_idx == -1 || ch1_idx == -1 || ref_idx == -1) {
+    int8_t map[3];
+    if (audio_channel_map_from_order(src_order, 4, map, 3) != ESP_OK) {
         return ESP_ERR_INVALID_ARG;
     }
-    for (int i = 0; i < (len >> 3); i++) {
-        o_buf[3 * i + 0] = i_buf[(i << 2) + ch0_idx];
-        o_buf[3 * i + 1] = i_buf[(i << 2) + ch1_idx];
-        o_buf[3 * i + 2] = i_buf[(i << 2) + ref_idx];
-    }
-    return ESP_OK;
+    return audio_channel_reorder_16bit(o_buf, 3, i_buf, 4, map, len >> 3);
 }
 
 #ifdef __cplusplus
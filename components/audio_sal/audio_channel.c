@@ -0,0 +1,261 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "audio_error.h"
+#include "audio_channel.h"
+
+/*
+ * All kernels are written as an always inline body taking the channel number as a parameter,
+ * the public entries instantiate them with 2, 4 and 8 channels so the frame loop has a fixed shape
+ * the compiler can unroll and vectorize. Even channel counts move two samples per 32-bit word
+ * when the interleaved side is word aligned, samples are packed little endian as stored in memory.
+ */
+
+static const char *TAG = "AUDIO_CHANNEL";
+
+#define CHANNEL_KERNEL          static inline __attribute__((always_inline))
+#define CHANNEL_WORD_ALIGNED(p) ((((uintptr_t)(p)) & 3) == 0)
+#define CHANNEL_VALID(ch)       ((ch) > 0 && (ch) <= AUDIO_CHANNEL_MAX)
+#define CHANNEL_GAIN_MAX        (32768)
+
+#define CHANNEL_DISPATCH(ch, kernel, ...) do {      \
+    switch (ch) {                                   \
+        case 2: kernel(2, __VA_ARGS__); break;      \
+        case 4: kernel(4, __VA_ARGS__); break;      \
+        case 8: kernel(8, __VA_ARGS__); break;      \
+        default: kernel(ch, __VA_ARGS__); break;    \
+    }                                               \
+} while (0)
+
+CHANNEL_KERNEL uint32_t channel_pack(int16_t lo, int16_t hi)
+{
+    return (uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
+
+CHANNEL_KERNEL int16_t channel_sat16(int32_t v)
+{
+    return v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v);
+}
+
+CHANNEL_KERNEL void interleave_run(const int ch, int16_t *out, const int16_t *const *in, int frames)
+{
+    const int16_t *src[AUDIO_CHANNEL_MAX];
+    memcpy(src, in, ch * sizeof(src[0]));
+    if ((ch & 1) == 0 && CHANNEL_WORD_ALIGNED(out)) {
+        uint32_t *o = (uint32_t *)out;
+        for (int i = 0; i < frames; i++) {
+            for (int c = 0; c < ch; c += 2) {
+                *o++ = channel_pack(src[c][i], src[c + 1][i]);
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < ch; c++) {
+            *out++ = src[c][i];
+        }
+    }
+}
+
+CHANNEL_KERNEL void deinterleave_run(const int ch, int16_t *const *out, const int16_t *in, int frames)
+{
+    int16_t *dst[AUDIO_CHANNEL_MAX];
+    memcpy(dst, out, ch * sizeof(dst[0]));
+    if ((ch & 1) == 0 && CHANNEL_WORD_ALIGNED(in)) {
+        const uint32_t *w = (const uint32_t *)in;
+        for (int i = 0; i < frames; i++) {
+            for (int c = 0; c < ch; c += 2) {
+                uint32_t v = *w++;
+                dst[c][i] = (int16_t)v;
+                dst[c + 1][i] = (int16_t)(v >> 16);
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < ch; c++) {
+            dst[c][i] = *in++;
+        }
+    }
+}
+
+/*
+ * A silent output channel reads input channel 0 under a zero mask, which keeps the loop free of branches
+ */
+CHANNEL_KERNEL void reorder_run(const int in_ch, int16_t *out, int out_ch, const int16_t *in,
+                                const uint8_t *idx, const int16_t *mask, int frames)
+{
+    if ((out_ch & 1) == 0 && CHANNEL_WORD_ALIGNED(out)) {
+        uint32_t *o = (uint32_t *)out;
+        for (int i = 0; i < frames; i++) {
+            for (int c = 0; c < out_ch; c += 2) {
+                *o++ = channel_pack(in[idx[c]] & mask[c], in[idx[c + 1]] & mask[c + 1]);
+            }
+            in += in_ch;
+        }
+        return;
+    }
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < out_ch; c++) {
+            *out++ = in[idx[c]] & mask[c];
+        }
+        in += in_ch;
+    }
+}
+
+CHANNEL_KERNEL void gain_run(const int ch, int16_t *buf, const int32_t *factor, int frames)
+{
+    int32_t f[AUDIO_CHANNEL_MAX];
+    memcpy(f, factor, ch * sizeof(f[0]));
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < ch; c++) {
+            buf[c] = channel_sat16(buf[c] * f[c]);
+        }
+        buf += ch;
+    }
+}
+
+esp_err_t audio_channel_interleave_16bit(int16_t *out, const int16_t *const in[], int channels, int frames)
+{
+    AUDIO_CHECK(TAG, out && in && CHANNEL_VALID(channels) && frames >= 0, return ESP_ERR_INVALID_ARG, "Invalid parameter");
+    for (int c = 0; c < channels; c++) {
+        AUDIO_CHECK(TAG, in[c], return ESP_ERR_INVALID_ARG, "Invalid input channel");
+    }
+    if (channels == 1) {
+        memmove(out, in[0], frames * sizeof(int16_t));
+        return ESP_OK;
+    }
+    CHANNEL_DISPATCH(channels, interleave_run, out, in, frames);
+    return ESP_OK;
+}
+
+esp_err_t audio_channel_deinterleave_16bit(int16_t *const out[], const int16_t *in, int channels, int frames)
+{
+    AUDIO_CHECK(TAG, out && in && CHANNEL_VALID(channels) && frames >= 0, return ESP_ERR_INVALID_ARG, "Invalid parameter");
+    int8_t map[1];
+    for (int c = 0; c < channels; c++) {
+        if (out[c] == NULL) {
+            /* Dropped channels are rare, pick the others one by one */
+            for (int k = 0; k < channels; k++) {
+                if (out[k]) {
+                    map[0] = k;
+                    audio_channel_reorder_16bit(out[k], 1, in, channels, map, frames);
+                }
+            }
+            return ESP_OK;
+        }
+    }
+    if (channels == 1) {
+        memmove(out[0], in, frames * sizeof(int16_t));
+        return ESP_OK;
+    }
+    CHANNEL_DISPATCH(channels, deinterleave_run, out, in, frames);
+    return ESP_OK;
+}
+
+esp_err_t audio_channel_reorder_16bit(int16_t *out, int out_ch, const int16_t *in, int in_ch, const int8_t *map, int frames)
+{
+    AUDIO_CHECK(TAG, out && in && map && CHANNEL_VALID(out_ch) && CHANNEL_VALID(in_ch) && frames >= 0,
+                return ESP_ERR_INVALID_ARG, "Invalid parameter");
+    uint8_t idx[AUDIO_CHANNEL_MAX];
+    int16_t mask[AUDIO_CHANNEL_MAX];
+    bool identity = (in_ch == out_ch);
+    for (int c = 0; c < out_ch; c++) {
+        AUDIO_CHECK(TAG, map[c] < in_ch, return ESP_ERR_INVALID_ARG, "Invalid channel map");
+        idx[c] = map[c] < 0 ? 0 : map[c];
+        mask[c] = map[c] < 0 ? 0 : (int16_t)0xFFFF;
+        identity &= (map[c] == c);
+    }
+    if (identity) {
+        if (out != in) {
+            memmove(out, in, frames * in_ch * sizeof(int16_t));
+        }
+        return ESP_OK;
+    }
+    if (in_ch == 2 && out_ch == 2 && idx[0] == 1 && idx[1] == 0 && mask[0] && mask[1]) {
+        if (out != in) {
+            memcpy(out, in, frames * 2 * sizeof(int16_t));
+        }
+        return audio_channel_swap_pair_16bit(out, frames);
+    }
+    CHANNEL_DISPATCH(in_ch, reorder_run, out, out_ch, in, idx, mask, frames);
+    return ESP_OK;
+}
+
+esp_err_t audio_channel_map_from_order(const int8_t *src_order, int in_ch, int8_t *map, int out_ch)
+{
+    AUDIO_CHECK(TAG, src_order && map && CHANNEL_VALID(in_ch) && CHANNEL_VALID(out_ch), return ESP_ERR_INVALID_ARG, "Invalid parameter");
+    for (int c = 0; c < out_ch; c++) {
+        map[c] = AUDIO_CHANNEL_NONE;
+        for (int i = 0; i < in_ch; i++) {
+            if (src_order[i] == c) {
+                map[c] = i;
+                break;
+            }
+        }
+        if (map[c] == AUDIO_CHANNEL_NONE) {
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t audio_channel_gain_16bit(int16_t *buf, int channels, int frames, const int *factor)
+{
+    AUDIO_CHECK(TAG, buf && factor && CHANNEL_VALID(channels) && frames >= 0, return ESP_ERR_INVALID_ARG, "Invalid parameter");
+    int32_t f[AUDIO_CHANNEL_MAX];
+    bool unity = true;
+    for (int c = 0; c < channels; c++) {
+        AUDIO_CHECK(TAG, factor[c] >= 0, return ESP_ERR_INVALID_ARG, "Invalid gain factor");
+        /* Any factor above full scale saturates every non zero sample, so clamping keeps the product in 32 bits */
+        f[c] = factor[c] > CHANNEL_GAIN_MAX ? CHANNEL_GAIN_MAX : factor[c];
+        unity &= (f[c] == 1);
+    }
+    if (unity) {
+        return ESP_OK;
+    }
+    CHANNEL_DISPATCH(channels, gain_run, buf, f, frames);
+    return ESP_OK;
+}
+
+esp_err_t audio_channel_swap_pair_16bit(int16_t *buf, int pairs)
+{
+    AUDIO_CHECK(TAG, buf && pairs >= 0, return ESP_ERR_INVALID_ARG, "Invalid parameter");
+    if (CHANNEL_WORD_ALIGNED(buf)) {
+        uint32_t *w = (uint32_t *)buf;
+        for (int i = 0; i < pairs; i++) {
+            w[i] = (w[i] >> 16) | (w[i] << 16);
+        }
+        return ESP_OK;
+    }
+    for (int i = 0; i < pairs; i++) {
+        int16_t t = buf[2 * i];
+        buf[2 * i] = buf[2 * i + 1];
+        buf[2 * i + 1] = t;
+    }
+    return ESP_OK;
+}
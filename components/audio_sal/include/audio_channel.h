@@ -0,0 +1,136 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __AUDIO_CHANNEL_H__
+#define __AUDIO_CHANNEL_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_CHANNEL_MAX   (8)     /*!< Maximum channel number handled by the channel kernels */
+#define AUDIO_CHANNEL_NONE  (-1)    /*!< Map entry producing a silent output channel */
+
+/**
+ * @brief       Interleave planar 16-bit channels into one frame ordered buffer
+ *
+ * @note        2, 4 and 8 channels run specialized kernels that move whole 32-bit words,
+ *              buffers aligned to 4 bytes get the fastest path
+ *
+ * @param       out         Interleaved output, `channels * frames` samples
+ * @param       in          Array of `channels` planar inputs, each holding `frames` samples
+ * @param       channels    Number of channels, 1 ~ AUDIO_CHANNEL_MAX
+ * @param       frames      Number of samples per channel
+ *
+ * @return      - ESP_OK
+ *              - ESP_ERR_INVALID_ARG
+ */
+esp_err_t audio_channel_interleave_16bit(int16_t *out, const int16_t *const in[], int channels, int frames);
+
+/**
+ * @brief       Split a frame ordered 16-bit buffer into planar channels
+ *
+ * @param       out         Array of `channels` planar outputs, each with room for `frames` samples,
+ *                          a NULL entry drops that channel
+ * @param       in          Interleaved input, `channels * frames` samples
+ * @param       channels    Number of channels, 1 ~ AUDIO_CHANNEL_MAX
+ * @param       frames      Number of frames
+ *
+ * @return      - ESP_OK
+ *              - ESP_ERR_INVALID_ARG
+ */
+esp_err_t audio_channel_deinterleave_16bit(int16_t *const out[], const int16_t *in, int channels, int frames);
+
+/**
+ * @brief       Pick and reorder the channels of an interleaved 16-bit buffer
+ *
+ *              Output channel `i` of every frame is taken from input channel `map[i]`,
+ *              or is zero when `map[i]` is AUDIO_CHANNEL_NONE.
+ *
+ * @note        `out` and `in` must not overlap unless the map is the identity
+ *
+ * @param       out         Interleaved output, `out_ch * frames` samples
+ * @param       out_ch      Number of output channels, 1 ~ AUDIO_CHANNEL_MAX
+ * @param       in          Interleaved input, `in_ch * frames` samples
+ * @param       in_ch       Number of input channels, 1 ~ AUDIO_CHANNEL_MAX
+ * @param       map         Source channel of every output channel, `out_ch` items
+ * @param       frames      Number of frames
+ *
+ * @return      - ESP_OK
+ *              - ESP_ERR_INVALID_ARG
+ */
+esp_err_t audio_channel_reorder_16bit(int16_t *out, int out_ch, const int16_t *in, int in_ch, const int8_t *map, int frames);
+
+/**
+ * @brief       Build a reorder map from a source order description
+ *
+ *              `src_order[i]` tells which output channel the input channel `i` feeds,
+ *              a negative value means the input channel is unused. This is the layout used by `ch_sort.h`.
+ *
+ * @param       src_order   Destination channel of every input channel, `in_ch` items
+ * @param       in_ch       Number of input channels, 1 ~ AUDIO_CHANNEL_MAX
+ * @param       map         Map for `audio_channel_reorder_16bit`, `out_ch` items
+ * @param       out_ch      Number of output channels, 1 ~ AUDIO_CHANNEL_MAX
+ *
+ * @return      - ESP_OK
+ *              - ESP_ERR_NOT_FOUND     Some output channel has no source
+ *              - ESP_ERR_INVALID_ARG
+ */
+esp_err_t audio_channel_map_from_order(const int8_t *src_order, int in_ch, int8_t *map, int out_ch);
+
+/**
+ * @brief       Apply a per channel linear gain to an interleaved 16-bit buffer in place,
+ *              results are saturated to the int16 range
+ *
+ * @param       buf         Interleaved buffer, `channels * frames` samples
+ * @param       channels    Number of channels, 1 ~ AUDIO_CHANNEL_MAX
+ * @param       frames      Number of frames
+ * @param       factor      Linear gain of every channel, `channels` items, must not be negative
+ *
+ * @return      - ESP_OK
+ *              - ESP_ERR_INVALID_ARG
+ */
+esp_err_t audio_channel_gain_16bit(int16_t *buf, int channels, int frames, const int *factor);
+
+/**
+ * @brief       Swap every two adjacent 16-bit samples in place
+ *
+ * @note        This is the ESP32 I2S 16-bit mono fix, which puts the samples of a slot pair in the right order
+ *
+ * @param       buf         Sample buffer
+ * @param       pairs       Number of sample pairs
+ *
+ * @return      - ESP_OK
+ *              - ESP_ERR_INVALID_ARG
+ */
+esp_err_t audio_channel_swap_pair_16bit(int16_t *buf, int pairs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_CHANNEL_H__ */
@@ -0,0 +1,176 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_mem.h"
+#include "audio_channel.h"
+
+static const char *TAG = "AUDIO_CHANNEL_TEST";
+
+#define TEST_CHANNEL_FRAMES   (512)
+#define TEST_CHANNEL_LOOPS    (100)
+
+static int16_t *test_channel_alloc(int channels, int frames)
+{
+    int16_t *buf = audio_malloc(channels * frames * sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(buf);
+    for (int i = 0; i < channels * frames; i++) {
+        buf[i] = (int16_t)(i * 131 + channels);
+    }
+    return buf;
+}
+
+TEST_CASE("audio_channel kernels", "esp-adf")
+{
+    const int layouts[] = {2, 4, 8};
+    for (int l = 0; l < (int)(sizeof(layouts) / sizeof(layouts[0])); l++) {
+        int ch = layouts[l];
+        int16_t *planes[AUDIO_CHANNEL_MAX] = {0};
+        for (int c = 0; c < ch; c++) {
+            planes[c] = test_channel_alloc(1, TEST_CHANNEL_FRAMES);
+            planes[c][0] = c;
+        }
+        int16_t *inter = test_channel_alloc(ch, TEST_CHANNEL_FRAMES);
+        int16_t *out = test_channel_alloc(ch, TEST_CHANNEL_FRAMES);
+
+        TEST_ASSERT_EQUAL(ESP_OK, audio_channel_interleave_16bit(inter, (const int16_t *const *)planes, ch, TEST_CHANNEL_FRAMES));
+        for (int i = 0; i < TEST_CHANNEL_FRAMES; i++) {
+            for (int c = 0; c < ch; c++) {
+                TEST_ASSERT_EQUAL_INT16(planes[c][i], inter[i * ch + c]);
+            }
+        }
+
+        int8_t map[AUDIO_CHANNEL_MAX];
+        for (int c = 0; c < ch; c++) {
+            map[c] = (c == 1) ? AUDIO_CHANNEL_NONE : ch - 1 - c;
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, audio_channel_reorder_16bit(out, ch, inter, ch, map, TEST_CHANNEL_FRAMES));
+        for (int i = 0; i < TEST_CHANNEL_FRAMES; i++) {
+            for (int c = 0; c < ch; c++) {
+                TEST_ASSERT_EQUAL_INT16(map[c] < 0 ? 0 : inter[i * ch + map[c]], out[i * ch + c]);
+            }
+        }
+
+        int factor[AUDIO_CHANNEL_MAX];
+        for (int c = 0; c < ch; c++) {
+            factor[c] = 1000;
+        }
+        memcpy(out, inter, ch * TEST_CHANNEL_FRAMES * sizeof(int16_t));
+        TEST_ASSERT_EQUAL(ESP_OK, audio_channel_gain_16bit(out, ch, TEST_CHANNEL_FRAMES, factor));
+        for (int i = 0; i < ch * TEST_CHANNEL_FRAMES; i++) {
+            int32_t v = inter[i] * 1000;
+            v = v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v);
+            TEST_ASSERT_EQUAL_INT16(v, out[i]);
+        }
+
+        TEST_ASSERT_EQUAL(ESP_OK, audio_channel_deinterleave_16bit(planes, inter, ch, TEST_CHANNEL_FRAMES));
+        for (int c = 0; c < ch; c++) {
+            TEST_ASSERT_EQUAL_INT16(c, planes[c][0]);
+            audio_free(planes[c]);
+        }
+        audio_free(inter);
+        audio_free(out);
+    }
+
+    int16_t pair[4] = {1, 2, 3, 4};
+    TEST_ASSERT_EQUAL(ESP_OK, audio_channel_swap_pair_16bit(pair, 2));
+    TEST_ASSERT_EQUAL_INT16(2, pair[0]);
+    TEST_ASSERT_EQUAL_INT16(3, pair[3]);
+
+    int8_t order[4] = {2, 0, -1, 1};
+    int8_t map[3];
+    TEST_ASSERT_EQUAL(ESP_OK, audio_channel_map_from_order(order, 4, map, 3));
+    TEST_ASSERT_EQUAL_INT8(1, map[0]);
+    TEST_ASSERT_EQUAL_INT8(3, map[1]);
+    TEST_ASSERT_EQUAL_INT8(0, map[2]);
+    order[3] = -1;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, audio_channel_map_from_order(order, 4, map, 3));
+}
+
+TEST_CASE("audio_channel kernels benchmark", "esp-adf")
+{
+    const int layouts[] = {2, 4, 8};
+    for (int l = 0; l < (int)(sizeof(layouts) / sizeof(layouts[0])); l++) {
+        int ch = layouts[l];
+        int16_t *planes[AUDIO_CHANNEL_MAX] = {0};
+        for (int c = 0; c < ch; c++) {
+            planes[c] = test_channel_alloc(1, TEST_CHANNEL_FRAMES);
+        }
+        int16_t *inter = test_channel_alloc(ch, TEST_CHANNEL_FRAMES);
+        int16_t *out = test_channel_alloc(ch, TEST_CHANNEL_FRAMES);
+        int8_t map[AUDIO_CHANNEL_MAX];
+        int factor[AUDIO_CHANNEL_MAX];
+        for (int c = 0; c < ch; c++) {
+            map[c] = ch - 1 - c;
+            factor[c] = 2;
+        }
+
+        int64_t start = esp_timer_get_time();
+        for (int n = 0; n < TEST_CHANNEL_LOOPS; n++) {
+            for (int i = 0; i < TEST_CHANNEL_FRAMES; i++) {
+                for (int c = 0; c < ch; c++) {
+                    out[i * ch + c] = planes[c][i];
+                }
+            }
+        }
+        int64_t scalar_us = esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (int n = 0; n < TEST_CHANNEL_LOOPS; n++) {
+            audio_channel_interleave_16bit(inter, (const int16_t *const *)planes, ch, TEST_CHANNEL_FRAMES);
+        }
+        int64_t interleave_us = esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (int n = 0; n < TEST_CHANNEL_LOOPS; n++) {
+            audio_channel_deinterleave_16bit(planes, inter, ch, TEST_CHANNEL_FRAMES);
+        }
+        int64_t deinterleave_us = esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (int n = 0; n < TEST_CHANNEL_LOOPS; n++) {
+            audio_channel_reorder_16bit(out, ch, inter, ch, map, TEST_CHANNEL_FRAMES);
+        }
+        int64_t reorder_us = esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (int n = 0; n < TEST_CHANNEL_LOOPS; n++) {
+            audio_channel_gain_16bit(out, ch, TEST_CHANNEL_FRAMES, factor);
+        }
+        int64_t gain_us = esp_timer_get_time() - start;
+
+        ESP_LOGI(TAG, "%d ch x %d frames x %d loops: scalar interleave %lld us, interleave %lld us, "
+                 "deinterleave %lld us, reorder %lld us, gain %lld us", ch, TEST_CHANNEL_FRAMES, TEST_CHANNEL_LOOPS,
+                 scalar_us, interleave_us, deinterleave_us, reorder_us, gain_us);
+
+        for (int c = 0; c < ch; c++) {
+            audio_free(planes[c]);
+        }
+        audio_free(inter);
+        audio_free(out);
+    }
+}
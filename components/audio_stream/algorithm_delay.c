@@ -0,0 +1,279 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "algorithm_delay.h"
+
+static const char *TAG = "ALGORITHM_DELAY";
+
+#define DELAY_ENV_RATE      (500)       /* Envelope samples per second, 2 ms resolution */
+#define DELAY_WINDOW        (512)       /* Envelope samples correlated per estimate, about 1 s */
+#define DELAY_HOP           (256)       /* Envelope samples between two estimates */
+#define DELAY_MIN_CORR      (0.4f)      /* Correlation peak below this is treated as no echo */
+#define DELAY_REF_LEVEL     (16)        /* Mean reference amplitude below this means nothing is played */
+#define DELAY_AGREE         (2)         /* Consecutive matching estimates needed before applying one */
+#define DELAY_GUARD_MS      (4)         /* AEC wants the echo slightly behind the reference */
+
+struct algorithm_delay {
+    int             max_delay_ms;
+    int             sample_rate;
+    int             channels;
+    int             mic_idx;
+    int             ref_idx;
+    int             decim;          /*!< Audio samples per envelope sample */
+    int             lag_max;        /*!< Searched lags in envelope samples */
+    int             ref_len;        /*!< Reference history, window plus lags */
+    float          *mic_env;        /*!< Twice stored ring, so the last window is always contiguous */
+    float          *ref_env;
+    float          *centered;
+    int             mic_pos;
+    int             ref_pos;
+    int             filled;
+    int             since_estimate;
+    int             env_cnt;
+    int32_t         mic_acc;
+    int32_t         ref_acc;
+    int             pending_lag;
+    int             agree;
+    int16_t        *line;           /*!< Reference delay line */
+    uint32_t        line_mask;
+    uint32_t        line_wr;
+    uint32_t        line_delay;
+    volatile int    delay_ms;
+};
+
+static inline void delay_env_push(float *env, int *pos, int len, float v)
+{
+    env[*pos] = v;
+    env[*pos + len] = v;
+    if (++*pos == len) {
+        *pos = 0;
+    }
+}
+
+static void delay_apply(struct algorithm_delay *d, int lag)
+{
+    int samples = lag * d->decim;
+    d->delay_ms = samples * 1000 / d->sample_rate;
+    samples -= DELAY_GUARD_MS * d->sample_rate / 1000;
+    if (samples < 0) {
+        samples = 0;
+    } else if (samples > (int)d->line_mask) {
+        samples = d->line_mask;
+    }
+    if (abs(samples - (int)d->line_delay) > d->decim) {
+        ESP_LOGI(TAG, "Reference delay %d ms, aligned by %d samples", d->delay_ms, samples);
+        d->line_delay = samples;
+    }
+}
+
+static void delay_estimate(struct algorithm_delay *d)
+{
+    const int n = DELAY_WINDOW;
+    const int lags = d->lag_max;
+    const float *mic = d->mic_env + d->mic_pos;
+    const float *ref = d->ref_env + d->ref_pos;  /* Oldest first, ref[lags + k] lines up with mic[k] at lag 0 */
+
+    float mean = 0;
+    for (int k = 0; k < n; k++) {
+        mean += mic[k];
+    }
+    mean /= n;
+    float mic_var = 0;
+    for (int k = 0; k < n; k++) {
+        d->centered[k] = mic[k] - mean;
+        mic_var += d->centered[k] * d->centered[k];
+    }
+    /* The window sums slide by one sample per lag, kept in double to stop the drift */
+    double sum = 0;
+    double sq = 0;
+    for (int k = 0; k < n; k++) {
+        sum += ref[lags + k];
+        sq += (double)ref[lags + k] * ref[lags + k];
+    }
+    if (mic_var <= 0 || sum < (double)n * DELAY_REF_LEVEL) {
+        return;
+    }
+
+    float best_corr = DELAY_MIN_CORR;
+    int best_lag = -1;
+    for (int l = 0; l <= lags; l++) {
+        const float *r = ref + lags - l;
+        float acc = 0;
+        for (int k = 0; k < n; k++) {
+            acc += d->centered[k] * r[k];
+        }
+        double var = sq - sum * sum / n;
+        if (var > 0) {
+            float corr = acc / sqrtf(mic_var * (float)var);
+            if (corr > best_corr) {
+                best_corr = corr;
+                best_lag = l;
+            }
+        }
+        if (l < lags) {
+            double out = r[n - 1];
+            double in = r[-1];
+            sum += in - out;
+            sq += in * in - out * out;
+        }
+    }
+    if (best_lag < 0) {
+        return;
+    }
+    if (d->agree > 0 && abs(best_lag - d->pending_lag) <= 1) {
+        d->agree++;
+    } else {
+        d->pending_lag = best_lag;
+        d->agree = 1;
+    }
+    ESP_LOGD(TAG, "Lag %d, corr %.2f, agree %d", best_lag, best_corr, d->agree);
+    if (d->agree >= DELAY_AGREE) {
+        delay_apply(d, best_lag);
+    }
+}
+
+algorithm_delay_handle_t algorithm_delay_create(int max_delay_ms)
+{
+    AUDIO_CHECK(TAG, max_delay_ms > 0, return NULL, "Invalid max delay");
+    struct algorithm_delay *d = audio_calloc(1, sizeof(struct algorithm_delay));
+    AUDIO_MEM_CHECK(TAG, d, return NULL);
+    d->max_delay_ms = max_delay_ms;
+    d->lag_max = max_delay_ms * DELAY_ENV_RATE / 1000;
+    d->ref_len = DELAY_WINDOW + d->lag_max;
+    d->mic_env = audio_calloc(2 * DELAY_WINDOW, sizeof(float));
+    d->ref_env = audio_calloc(2 * d->ref_len, sizeof(float));
+    d->centered = audio_calloc(DELAY_WINDOW, sizeof(float));
+    AUDIO_MEM_CHECK(TAG, d->mic_env && d->ref_env && d->centered, {
+        algorithm_delay_destroy(d);
+        return NULL;
+    });
+    algorithm_delay_reset(d);
+    return d;
+}
+
+esp_err_t algorithm_delay_set_format(algorithm_delay_handle_t d, int sample_rate, int channels, int mic_idx, int ref_idx)
+{
+    AUDIO_NULL_CHECK(TAG, d, return ESP_ERR_INVALID_ARG);
+    if (sample_rate < DELAY_ENV_RATE || channels <= 0 || mic_idx < 0 || mic_idx >= channels
+        || ref_idx < 0 || ref_idx >= channels || mic_idx == ref_idx) {
+        ESP_LOGE(TAG, "Invalid format, rate %d, channels %d, mic %d, ref %d", sample_rate, channels, mic_idx, ref_idx);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (d->line && d->sample_rate == sample_rate && d->channels == channels
+        && d->mic_idx == mic_idx && d->ref_idx == ref_idx) {
+        return ESP_OK;
+    }
+    uint32_t size = 1;
+    uint32_t need = (uint32_t)d->max_delay_ms * sample_rate / 1000 + 1;
+    while (size < need) {
+        size <<= 1;
+    }
+    AUDIO_SAFE_FREE(d->line, audio_free);
+    d->line = audio_calloc(size, sizeof(int16_t));
+    AUDIO_MEM_CHECK(TAG, d->line, return ESP_ERR_NO_MEM);
+    d->line_mask = size - 1;
+    d->sample_rate = sample_rate;
+    d->channels = channels;
+    d->mic_idx = mic_idx;
+    d->ref_idx = ref_idx;
+    d->decim = sample_rate / DELAY_ENV_RATE;
+    algorithm_delay_reset(d);
+    return ESP_OK;
+}
+
+void algorithm_delay_process(algorithm_delay_handle_t d, int16_t *buf, int frames)
+{
+    if (d == NULL || d->line == NULL) {
+        return;
+    }
+    for (int i = 0; i < frames; i++, buf += d->channels) {
+        int16_t ref = buf[d->ref_idx];
+        d->mic_acc += abs(buf[d->mic_idx]);
+        d->ref_acc += abs(ref);
+        if (++d->env_cnt == d->decim) {
+            delay_env_push(d->mic_env, &d->mic_pos, DELAY_WINDOW, (float)d->mic_acc / d->decim);
+            delay_env_push(d->ref_env, &d->ref_pos, d->ref_len, (float)d->ref_acc / d->decim);
+            d->env_cnt = 0;
+            d->mic_acc = 0;
+            d->ref_acc = 0;
+            if (d->filled < d->ref_len) {
+                d->filled++;
+            }
+            if (++d->since_estimate >= DELAY_HOP && d->filled == d->ref_len) {
+                d->since_estimate = 0;
+                delay_estimate(d);
+            }
+        }
+        d->line[d->line_wr & d->line_mask] = ref;
+        buf[d->ref_idx] = d->line[(d->line_wr - d->line_delay) & d->line_mask];
+        d->line_wr++;
+    }
+}
+
+int algorithm_delay_get_ms(algorithm_delay_handle_t d)
+{
+    AUDIO_NULL_CHECK(TAG, d, return -1);
+    return d->delay_ms;
+}
+
+void algorithm_delay_reset(algorithm_delay_handle_t d)
+{
+    if (d == NULL) {
+        return;
+    }
+    d->mic_pos = 0;
+    d->ref_pos = 0;
+    d->filled = 0;
+    d->since_estimate = 0;
+    d->env_cnt = 0;
+    d->mic_acc = 0;
+    d->ref_acc = 0;
+    d->agree = 0;
+    d->pending_lag = -1;
+    d->line_wr = 0;
+    d->line_delay = 0;
+    d->delay_ms = -1;
+    if (d->line) {
+        memset(d->line, 0, (d->line_mask + 1) * sizeof(int16_t));
+    }
+}
+
+void algorithm_delay_destroy(algorithm_delay_handle_t d)
+{
+    if (d == NULL) {
+        return;
+    }
+    AUDIO_SAFE_FREE(d->line, audio_free);
+    AUDIO_SAFE_FREE(d->mic_env, audio_free);
+    AUDIO_SAFE_FREE(d->ref_env, audio_free);
+    AUDIO_SAFE_FREE(d->centered, audio_free);
+    audio_free(d);
+}
@@ -0,0 +1,110 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _ALGORITHM_DELAY_H_
+#define _ALGORITHM_DELAY_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Reference delay estimator used by the algorithm stream
+ *
+ *         The microphone and reference channels are reduced to 2 ms amplitude envelopes, and twice a second
+ *         their normalized cross-correlation is searched for the playback to microphone delay.
+ *         A stable estimate is then used to delay the reference channel in place before the AFE feed,
+ *         so the AEC always sees the reference slightly ahead of the echo.
+ */
+typedef struct algorithm_delay *algorithm_delay_handle_t;
+
+/**
+ * @brief      Create the estimator
+ *
+ * @param[in]  max_delay_ms  Largest playback to microphone delay to search for
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  Estimator handle
+ */
+algorithm_delay_handle_t algorithm_delay_create(int max_delay_ms);
+
+/**
+ * @brief      Set the layout of the interleaved feed data, the estimator starts over when it changes
+ *
+ * @param[in]  delay        The estimator handle
+ * @param[in]  sample_rate  Sample rate in Hz
+ * @param[in]  channels     Number of interleaved 16-bit channels
+ * @param[in]  mic_idx      Channel used as the microphone signal
+ * @param[in]  ref_idx      Channel carrying the reference signal
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_NO_MEM
+ */
+esp_err_t algorithm_delay_set_format(algorithm_delay_handle_t delay, int sample_rate, int channels, int mic_idx, int ref_idx);
+
+/**
+ * @brief      Track the delay on a block of feed data and delay its reference channel in place
+ *
+ * @param[in]  delay   The estimator handle
+ * @param      buf     Interleaved 16-bit data in the layout given by `algorithm_delay_set_format`
+ * @param[in]  frames  Number of frames in `buf`
+ */
+void algorithm_delay_process(algorithm_delay_handle_t delay, int16_t *buf, int frames);
+
+/**
+ * @brief      Get the estimated playback to microphone delay
+ *
+ * @param[in]  delay  The estimator handle
+ *
+ * @return
+ *     - -1    No stable estimate yet
+ *     - >= 0  Delay in ms
+ */
+int algorithm_delay_get_ms(algorithm_delay_handle_t delay);
+
+/**
+ * @brief      Drop the history and the current estimate, e.g. after the audio route changed
+ *
+ * @param[in]  delay  The estimator handle
+ */
+void algorithm_delay_reset(algorithm_delay_handle_t delay);
+
+/**
+ * @brief      Destroy the estimator
+ *
+ * @param[in]  delay  The estimator handle
+ */
+void algorithm_delay_destroy(algorithm_delay_handle_t delay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ALGORITHM_DELAY_H_ */
@@ -30,9 +30,11 @@
 #include "audio_error.h"
 #include "audio_mem.h"
 #include "audio_thread.h"
+#include "audio_channel.h"
 #include "esp_log.h"
 
 #include "algorithm_stream.h"
+#include "algorithm_delay.h"
 #include "esp_afe_sr_iface.h"
 #include "esp_afe_sr_models.h"
 
@@ -67,19 +69,14 @@ typedef struct {
     afe_agc_mode_t                agc_mode;
     int                           agc_compression_gain_db;
     int                           agc_target_level_dbfs;
+    algorithm_delay_handle_t      delay;
+    bool                          delay_ready;
+    int                           feed_channels;
 } algo_stream_t;
 
 esp_err_t algorithm_mono_fix(uint8_t *sbuff, uint32_t len)
 {
-    int16_t *temp_buf = (int16_t *)sbuff;
-    int16_t temp_box;
-    int k = len >> 1;
-    for (int i = 0; i < k; i += 2) {
-        temp_box = temp_buf[i];
-        temp_buf[i] = temp_buf[i + 1];
-        temp_buf[i + 1] = temp_box;
-    }
-    return ESP_OK;
+    return audio_channel_swap_pair_16bit((int16_t *)sbuff, len >> 2);
 }
 
 static esp_err_t _algo_close(audio_element_handle_t self)
@@ -94,6 +91,7 @@ static esp_err_t _algo_close(audio_element_handle_t self)
     }
     AUDIO_SAFE_FREE(algo->afe_data, algo->afe_handle->destroy);
     AUDIO_SAFE_FREE(algo->aec_buff, audio_free);
+    algorithm_delay_reset(algo->delay);
     return ESP_OK;
 }
 
@@ -104,6 +102,7 @@ static esp_err_t _algo_destroy(audio_element_handle_t self)
     AUDIO_SAFE_FREE(algo->afe_data, algo->afe_handle->destroy);
     AUDIO_SAFE_FREE(algo->record, audio_free);
     AUDIO_SAFE_FREE(algo->reference, audio_free);
+    AUDIO_SAFE_FREE(algo->delay, algorithm_delay_destroy);
     AUDIO_SAFE_FREE(algo->state, vEventGroupDelete);
     AUDIO_SAFE_FREE(algo->models, esp_srmodel_deinit);
     AUDIO_SAFE_FREE(algo, audio_free);
@@ -182,6 +181,7 @@ static esp_err_t _algo_open(audio_element_handle_t self)
     if (algo->sample_rate) {
         afe_config->pcm_config.sample_rate = algo->sample_rate;
     }
+    int feed_rate = afe_config->pcm_config.sample_rate;
     algo->afe_handle = esp_afe_handle_from_config(afe_config);
     algo->afe_data = algo->afe_handle->create_from_config(afe_config);
     afe_config_free(afe_config);
@@ -212,16 +212,30 @@ static esp_err_t _algo_open(audio_element_handle_t self)
         _algo_close(self);
         return ESP_FAIL;
     });
+    algo->feed_channels = nch;
+    if (algo->delay) {
+        const char *mic = strchr(algo->input_format, 'M');
+        const char *ref = strchr(algo->input_format, 'R');
+        algo->delay_ready = mic && ref && algorithm_delay_set_format(algo->delay, feed_rate, nch,
+                            mic - algo->input_format, ref - algo->input_format) == ESP_OK;
+        if (!algo->delay_ready) {
+            ESP_LOGW(TAG, "Reference delay estimation is off for input format %s", algo->input_format);
+        }
+    }
     return ESP_OK;
 }
 
 static inline esp_err_t algorithm_data_gain(int16_t *raw_buff, int len, int linear_lfac, int linear_rfac)
 {
-    for (int i = 0; i < len / 4; i++) {
-        raw_buff[i << 1] = raw_buff[i << 1] * linear_lfac;
-        raw_buff[(i << 1) + 1] = raw_buff[(i << 1) + 1] * linear_rfac;
+    int factor[2] = { linear_lfac, linear_rfac };
+    return audio_channel_gain_16bit(raw_buff, 2, len >> 2, factor);
+}
+
+static inline void algorithm_data_align(algo_stream_t *algo, int16_t *raw_buff, int len)
+{
+    if (algo->delay_ready) {
+        algorithm_delay_process(algo->delay, raw_buff, len / (algo->feed_channels * sizeof(int16_t)));
     }
-    return ESP_OK;
 }
 
 
@@ -236,6 +250,7 @@ static int algorithm_data_process_for_type1(audio_element_handle_t self)
             audio_element_output(self, (char *)algo->aec_buff, algo->aec_buff_size);
         } else {
             algorithm_data_gain(algo->aec_buff, algo->aec_buff_size, algo->rec_linear_factor, algo->ref_linear_factor);
+            algorithm_data_align(algo, algo->aec_buff, algo->aec_buff_size);
             algo->afe_handle->feed(algo->afe_data, algo->aec_buff);
         }
     }
@@ -260,15 +275,13 @@ static int algorithm_data_process_for_type2(audio_element_handle_t self)
 
     bytes_read = audio_element_input(self, (char *)algo->record, size);
     if (bytes_read > 0) {
-        int16_t *temp = algo->aec_buff;
-        for (int i = 0; i < (size / 2); i++) {
-            temp[i << 1] = algo->record[i];
-            temp[(i << 1) + 1] = algo->reference[i];
-        }
+        const int16_t *planes[2] = { algo->record, algo->reference };
+        audio_channel_interleave_16bit(algo->aec_buff, planes, 2, audio_chunksize);
 
         if (algo->debug_input) {
             audio_element_output(self, (char *)algo->aec_buff, 2 * size);
         } else {
+            algorithm_data_align(algo, algo->aec_buff, 2 * size);
             algo->afe_handle->feed(algo->afe_data, algo->aec_buff);
         }
     }
@@ -330,6 +343,11 @@ audio_element_handle_t algo_stream_init(algorithm_stream_cfg_t *config)
     algo->state = xEventGroupCreate();
     AUDIO_NULL_CHECK(TAG, algo->state, goto _exit);
 
+    if (config->auto_delay) {
+        algo->delay = algorithm_delay_create(config->max_delay_ms);
+        AUDIO_MEM_CHECK(TAG, algo->delay, goto _exit);
+    }
+
     el = audio_element_init(&cfg);
     AUDIO_NULL_CHECK(TAG, el, goto _exit);
 
@@ -353,6 +371,7 @@ audio_element_handle_t algo_stream_init(algorithm_stream_cfg_t *config)
 _exit:
     AUDIO_SAFE_FREE(algo->record, audio_free);
     AUDIO_SAFE_FREE(algo->reference, audio_free);
+    AUDIO_SAFE_FREE(algo->delay, algorithm_delay_destroy);
     AUDIO_SAFE_FREE(algo->state, vEventGroupDelete);
     AUDIO_SAFE_FREE(el, audio_element_deinit);
     AUDIO_SAFE_FREE(algo, audio_free);
@@ -379,3 +398,16 @@ audio_element_err_t algo_stream_set_delay(audio_element_handle_t el, ringbuf_han
 
     return ESP_OK;
 }
+
+esp_err_t algo_stream_get_delay(audio_element_handle_t el, int *delay_ms)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, delay_ms, return ESP_ERR_INVALID_ARG);
+    algo_stream_t *algo = (algo_stream_t *)audio_element_getdata(el);
+    if (algo->delay == NULL) {
+        ESP_LOGE(TAG, "Reference delay estimation is not enabled");
+        return ESP_ERR_INVALID_STATE;
+    }
+    *delay_ms = algorithm_delay_get_ms(algo->delay);
+    return ESP_OK;
+}
@@ -101,12 +101,23 @@ static int _embed_read(audio_element_handle_t self, char *buffer, int len, TickT
 
 static int _embed_process(audio_element_handle_t self, char *in_buffer, int in_len)
 {
-    int r_size = audio_element_input(self, in_buffer, in_len);
-    int w_size = 0;
-    if (r_size > 0) {
-        w_size = audio_element_output(self, in_buffer, r_size);
-    } else {
-        w_size = r_size;
+    audio_element_info_t info = { 0 };
+    embed_flash_stream_t *stream = (embed_flash_stream_t *)audio_element_getdata(self);
+    audio_element_getinfo(self, &info);
+
+    // The embedded data is already mapped, so it goes to the output without a copy to the element buffer
+    int len = in_len;
+    if (info.byte_pos + len > info.total_bytes) {
+        len = info.total_bytes - info.byte_pos;
+    }
+    if (len <= 0) {
+        ESP_LOGW(TAG, "No more data,ret:%d ,info.byte_pos:%llu", len, info.byte_pos);
+        return ESP_OK;
+    }
+    int w_size = audio_element_output(self, (char *)stream->info[stream->cur_index].address + info.byte_pos, len);
+    if (w_size > 0) {
+        audio_element_update_byte_pos(self, w_size);
+        ESP_LOGD(TAG, "req lengh=%d, pos=%d/%d", len, (int)info.byte_pos, (int)info.total_bytes);
     }
     return w_size;
 }
@@ -0,0 +1,429 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include "unistd.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "audio_mutex.h"
+#include "audio_thread.h"
+#include "fatfs_read_ahead.h"
+
+static const char *TAG = "FATFS_READ_AHEAD";
+
+#define FATFS_READ_AHEAD_CLUSTER_SIZE       (4096)          /* Used when the file system does not tell its cluster size */
+#define FATFS_READ_AHEAD_MAX_CLUSTER        (64 * 1024)
+#define FATFS_READ_AHEAD_BLOCKS             (2)
+#define FATFS_READ_AHEAD_LATENCY_BUCKETS    (100)           /* 4 buckets per power of two, up to 2^26 us */
+
+#define READ_AHEAD_DATA_BIT                 BIT0            /* A block got free, or the position moved */
+#define READ_AHEAD_READY_BIT                BIT1            /* A block got ready, or the task stopped */
+#define READ_AHEAD_STOP_BIT                 BIT2
+#define READ_AHEAD_EXIT_BIT                 BIT3
+
+typedef enum {
+    READ_AHEAD_BLOCK_FREE,
+    READ_AHEAD_BLOCK_FILLING,
+    READ_AHEAD_BLOCK_READY,
+} read_ahead_block_state_t;
+
+typedef struct {
+    char                       *data;
+    int64_t                     pos;            /* File offset of the first byte, on a cluster boundary */
+    int                         len;
+    uint32_t                    gen;            /* Seek generation the block was read for */
+    read_ahead_block_state_t    state;
+} read_ahead_block_t;
+
+struct fatfs_read_ahead {
+    fatfs_read_ahead_cfg_t      cfg;
+    void                       *lock;
+    EventGroupHandle_t          state;
+    int                         fd;
+    int                         cluster;
+    int                         block_size;     /* Whole clusters */
+    read_ahead_block_t          block[FATFS_READ_AHEAD_BLOCKS];
+    uint32_t                    gen;
+    int64_t                     read_pos;       /* Next byte returned to the reader */
+    int64_t                     next_pos;       /* Next block the task reads */
+    int64_t                     end;            /* File size, lowered on a short read */
+    int64_t                     file_pos;       /* Offset of the file descriptor, task only */
+    uint32_t                    latency[FATFS_READ_AHEAD_LATENCY_BUCKETS];
+    fatfs_stream_read_stats_t   stats;
+    volatile bool               running;
+    bool                        failed;
+};
+
+static inline int latency_bucket(uint32_t us)
+{
+    if (us < 4) {
+        return us;
+    }
+    int msb = 31 - __builtin_clz(us);
+    int idx = (msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+    return idx < FATFS_READ_AHEAD_LATENCY_BUCKETS ? idx : FATFS_READ_AHEAD_LATENCY_BUCKETS - 1;
+}
+
+static inline uint32_t latency_bucket_top(int idx)
+{
+    if (idx < 4) {
+        return idx;
+    }
+    int shift = idx / 4 - 1;
+    return ((uint32_t)(4 + idx % 4) << shift) + (1 << shift) - 1;
+}
+
+static uint32_t latency_percentile(struct fatfs_read_ahead *ra, int percent)
+{
+    uint32_t rank = ((uint64_t)ra->stats.reads * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < FATFS_READ_AHEAD_LATENCY_BUCKETS; i++) {
+        seen += ra->latency[i];
+        if (seen >= rank && seen > 0) {
+            uint32_t top = latency_bucket_top(i);
+            return top < ra->stats.max_us ? top : ra->stats.max_us;
+        }
+    }
+    return ra->stats.max_us;
+}
+
+static read_ahead_block_t *read_ahead_find(struct fatfs_read_ahead *ra, int64_t pos)
+{
+    for (int i = 0; i < FATFS_READ_AHEAD_BLOCKS; i++) {
+        read_ahead_block_t *b = &ra->block[i];
+        if (b->state == READ_AHEAD_BLOCK_READY && b->gen == ra->gen && pos >= b->pos && pos < b->pos + b->len) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Fill one block from the file, the lock is not held
+ */
+static int read_ahead_fill(struct fatfs_read_ahead *ra, read_ahead_block_t *b, int len)
+{
+    if (ra->file_pos != b->pos) {
+        if (lseek(ra->fd, b->pos, SEEK_SET) < 0) {
+            ESP_LOGE(TAG, "Error seek file to %lld, %s", b->pos, strerror(errno));
+            ra->file_pos = -1;
+            return ESP_FAIL;
+        }
+        ra->file_pos = b->pos;
+    }
+    int done = 0;
+    while (done < len) {
+        int64_t start = esp_timer_get_time();
+        int rlen = read(ra->fd, b->data + done, len - done);
+        uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+        if (rlen < 0) {
+            ESP_LOGE(TAG, "The error is happened in reading data. Error message: %s", strerror(errno));
+            ra->file_pos = -1;
+            return ESP_FAIL;
+        }
+        mutex_lock(ra->lock);
+        ra->latency[latency_bucket(us)]++;
+        ra->stats.reads++;
+        ra->stats.bytes += rlen;
+        if (us > ra->stats.max_us) {
+            ra->stats.max_us = us;
+        }
+        mutex_unlock(ra->lock);
+        if (rlen == 0) {
+            break;
+        }
+        done += rlen;
+        ra->file_pos += rlen;
+    }
+    return done;
+}
+
+static void read_ahead_task(void *arg)
+{
+    struct fatfs_read_ahead *ra = (struct fatfs_read_ahead *)arg;
+    while (1) {
+        read_ahead_block_t *b = NULL;
+        mutex_lock(ra->lock);
+        if (ra->running == false) {
+            mutex_unlock(ra->lock);
+            break;
+        }
+        if (ra->failed == false && ra->next_pos < ra->end) {
+            for (int i = 0; i < FATFS_READ_AHEAD_BLOCKS; i++) {
+                if (ra->block[i].state == READ_AHEAD_BLOCK_FREE) {
+                    b = &ra->block[i];
+                    break;
+                }
+            }
+        }
+        if (b == NULL) {
+            xEventGroupClearBits(ra->state, READ_AHEAD_DATA_BIT);
+            mutex_unlock(ra->lock);
+            xEventGroupWaitBits(ra->state, READ_AHEAD_DATA_BIT | READ_AHEAD_STOP_BIT, false, false, portMAX_DELAY);
+            continue;
+        }
+        b->state = READ_AHEAD_BLOCK_FILLING;
+        b->pos = ra->next_pos;
+        b->gen = ra->gen;
+        int64_t left = ra->end - b->pos;
+        int len = left < ra->block_size ? (int)left : ra->block_size;
+        ra->next_pos += ra->block_size;
+        mutex_unlock(ra->lock);
+
+        int rlen = read_ahead_fill(ra, b, len);
+
+        mutex_lock(ra->lock);
+        if (b->gen != ra->gen) {
+            // The reader moved away while the block was read
+            b->state = READ_AHEAD_BLOCK_FREE;
+        } else if (rlen < 0) {
+            ra->failed = true;
+            b->state = READ_AHEAD_BLOCK_FREE;
+        } else {
+            if (rlen < len) {
+                ESP_LOGW(TAG, "File ends at %lld instead of %lld", b->pos + rlen, ra->end);
+                ra->end = b->pos + rlen;
+            }
+            b->len = rlen;
+            b->state = rlen > 0 ? READ_AHEAD_BLOCK_READY : READ_AHEAD_BLOCK_FREE;
+        }
+        mutex_unlock(ra->lock);
+        xEventGroupSetBits(ra->state, READ_AHEAD_READY_BIT);
+    }
+    xEventGroupSetBits(ra->state, READ_AHEAD_EXIT_BIT);
+    vTaskDelete(NULL);
+}
+
+fatfs_read_ahead_handle_t fatfs_read_ahead_create(fatfs_read_ahead_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, cfg, return NULL);
+    AUDIO_CHECK(TAG, cfg->buffer_size > 0, return NULL, "Invalid read-ahead configuration");
+    struct fatfs_read_ahead *ra = audio_calloc(1, sizeof(struct fatfs_read_ahead));
+    AUDIO_MEM_CHECK(TAG, ra, return NULL);
+    memcpy(&ra->cfg, cfg, sizeof(fatfs_read_ahead_cfg_t));
+    ra->lock = mutex_create();
+    ra->state = xEventGroupCreate();
+    AUDIO_MEM_CHECK(TAG, ra->lock && ra->state, {
+        fatfs_read_ahead_destroy(ra);
+        return NULL;
+    });
+    xEventGroupSetBits(ra->state, READ_AHEAD_EXIT_BIT);
+    return ra;
+}
+
+esp_err_t fatfs_read_ahead_start(fatfs_read_ahead_handle_t ra, int fd, int64_t pos, int64_t size)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return ESP_FAIL);
+    if (ra->running) {
+        ESP_LOGE(TAG, "Already started");
+        return ESP_FAIL;
+    }
+    struct stat st = { 0 };
+    int cluster = FATFS_READ_AHEAD_CLUSTER_SIZE;
+    if (fstat(fd, &st) == 0 && st.st_blksize > 0 && st.st_blksize <= FATFS_READ_AHEAD_MAX_CLUSTER) {
+        cluster = st.st_blksize;
+    }
+    int block_size = (ra->cfg.buffer_size / FATFS_READ_AHEAD_BLOCKS + cluster - 1) / cluster * cluster;
+    if (block_size != ra->block_size) {
+        // Internal memory, so that the card driver can transfer into the blocks without a bounce buffer
+        for (int i = 0; i < FATFS_READ_AHEAD_BLOCKS; i++) {
+            audio_free(ra->block[i].data);
+            ra->block[i].data = audio_calloc_inner(1, block_size);
+        }
+        ra->block_size = block_size;
+        AUDIO_MEM_CHECK(TAG, ra->block[0].data && ra->block[1].data, {
+            ra->block_size = 0;
+            return ESP_ERR_NO_MEM;
+        });
+    }
+    for (int i = 0; i < FATFS_READ_AHEAD_BLOCKS; i++) {
+        ra->block[i].state = READ_AHEAD_BLOCK_FREE;
+    }
+    ra->cluster = cluster;
+    ra->fd = fd;
+    ra->read_pos = pos;
+    ra->next_pos = pos / cluster * cluster;
+    ra->end = size;
+    ra->file_pos = -1;
+    ra->failed = false;
+    memset(ra->latency, 0, sizeof(ra->latency));
+    memset(&ra->stats, 0, sizeof(ra->stats));
+    ra->running = true;
+    xEventGroupClearBits(ra->state, READ_AHEAD_DATA_BIT | READ_AHEAD_READY_BIT | READ_AHEAD_STOP_BIT | READ_AHEAD_EXIT_BIT);
+    if (audio_thread_create(NULL, "fatfs_read", read_ahead_task, ra, ra->cfg.task_stack,
+                            ra->cfg.task_prio, ra->cfg.stack_in_ext, ra->cfg.task_core) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create read-ahead task");
+        ra->running = false;
+        xEventGroupSetBits(ra->state, READ_AHEAD_EXIT_BIT);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Read-ahead from %lld/%lld, 2 x %d bytes, cluster %d", pos, size, block_size, cluster);
+    return ESP_OK;
+}
+
+int fatfs_read_ahead_read(fatfs_read_ahead_handle_t ra, char *buf, int len, TickType_t ticks)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return ESP_FAIL);
+    int done = 0;
+    while (done < len) {
+        mutex_lock(ra->lock);
+        if (ra->failed || ra->running == false) {
+            mutex_unlock(ra->lock);
+            return done ? done : ESP_FAIL;
+        }
+        read_ahead_block_t *b = read_ahead_find(ra, ra->read_pos);
+        if (b) {
+            int off = (int)(ra->read_pos - b->pos);
+            int n = b->len - off < len - done ? b->len - off : len - done;
+            memcpy(buf + done, b->data + off, n);
+            done += n;
+            ra->read_pos += n;
+            bool drained = (off + n == b->len);
+            if (drained) {
+                b->state = READ_AHEAD_BLOCK_FREE;
+            }
+            mutex_unlock(ra->lock);
+            if (drained) {
+                xEventGroupSetBits(ra->state, READ_AHEAD_DATA_BIT);
+            }
+            continue;
+        }
+        if (ra->read_pos >= ra->end || done > 0) {
+            // End of file, or return what is there rather than wait for the card
+            mutex_unlock(ra->lock);
+            break;
+        }
+        ra->stats.stalls++;
+        xEventGroupClearBits(ra->state, READ_AHEAD_READY_BIT);
+        mutex_unlock(ra->lock);
+        EventBits_t bits = xEventGroupWaitBits(ra->state, READ_AHEAD_READY_BIT, false, true, ticks);
+        if ((bits & READ_AHEAD_READY_BIT) == 0) {
+            ESP_LOGE(TAG, "Timeout waiting for the card");
+            return ESP_FAIL;
+        }
+    }
+    return done;
+}
+
+esp_err_t fatfs_read_ahead_seek(fatfs_read_ahead_handle_t ra, int64_t pos)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return ESP_FAIL);
+    mutex_lock(ra->lock);
+    if (ra->running == false) {
+        mutex_unlock(ra->lock);
+        return ESP_FAIL;
+    }
+    if (pos == ra->read_pos) {
+        mutex_unlock(ra->lock);
+        return ESP_OK;
+    }
+    bool freed = false;
+    read_ahead_block_t *b = read_ahead_find(ra, pos);
+    if (b == NULL) {
+        // Drop every block, the one being filled is freed by the task when its read completes
+        ra->gen++;
+        for (int i = 0; i < FATFS_READ_AHEAD_BLOCKS; i++) {
+            if (ra->block[i].state == READ_AHEAD_BLOCK_READY) {
+                ra->block[i].state = READ_AHEAD_BLOCK_FREE;
+            }
+        }
+        ra->next_pos = pos / ra->cluster * ra->cluster;
+        ra->failed = false;
+        freed = true;
+    } else {
+        // Moved forward into a later block, the ones left behind are never drained by the reader
+        for (int i = 0; i < FATFS_READ_AHEAD_BLOCKS; i++) {
+            read_ahead_block_t *r = &ra->block[i];
+            if (r->state == READ_AHEAD_BLOCK_READY && r->pos + r->len <= pos) {
+                r->state = READ_AHEAD_BLOCK_FREE;
+                freed = true;
+            }
+        }
+    }
+    ra->read_pos = pos;
+    mutex_unlock(ra->lock);
+    if (freed) {
+        xEventGroupSetBits(ra->state, READ_AHEAD_DATA_BIT);
+    }
+    return ESP_OK;
+}
+
+int64_t fatfs_read_ahead_tell(fatfs_read_ahead_handle_t ra)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return 0);
+    return ra->read_pos;
+}
+
+esp_err_t fatfs_read_ahead_get_stats(fatfs_read_ahead_handle_t ra, fatfs_stream_read_stats_t *stats)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, stats, return ESP_ERR_INVALID_ARG);
+    mutex_lock(ra->lock);
+    memcpy(stats, &ra->stats, sizeof(fatfs_stream_read_stats_t));
+    stats->p50_us = latency_percentile(ra, 50);
+    stats->p90_us = latency_percentile(ra, 90);
+    stats->p99_us = latency_percentile(ra, 99);
+    mutex_unlock(ra->lock);
+    return ESP_OK;
+}
+
+void fatfs_read_ahead_stop(fatfs_read_ahead_handle_t ra)
+{
+    if (ra == NULL || ra->running == false) {
+        return;
+    }
+    mutex_lock(ra->lock);
+    ra->running = false;
+    mutex_unlock(ra->lock);
+    xEventGroupSetBits(ra->state, READ_AHEAD_STOP_BIT | READ_AHEAD_READY_BIT);
+    xEventGroupWaitBits(ra->state, READ_AHEAD_EXIT_BIT, false, true, portMAX_DELAY);
+    ESP_LOGI(TAG, "Read %llu bytes in %u reads, latency p50 %u us, p99 %u us, max %u us, %u stalls",
+             ra->stats.bytes, (unsigned)ra->stats.reads, (unsigned)latency_percentile(ra, 50),
+             (unsigned)latency_percentile(ra, 99), (unsigned)ra->stats.max_us, (unsigned)ra->stats.stalls);
+}
+
+void fatfs_read_ahead_destroy(fatfs_read_ahead_handle_t ra)
+{
+    if (ra == NULL) {
+        return;
+    }
+    if (ra->state && ra->lock) {
+        fatfs_read_ahead_stop(ra);
+    }
+    for (int i = 0; i < FATFS_READ_AHEAD_BLOCKS; i++) {
+        audio_free(ra->block[i].data);
+    }
+    AUDIO_SAFE_FREE(ra->lock, mutex_destroy);
+    AUDIO_SAFE_FREE(ra->state, vEventGroupDelete);
+    audio_free(ra);
+}
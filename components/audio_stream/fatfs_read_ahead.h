@@ -0,0 +1,150 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _FATFS_READ_AHEAD_H_
+#define _FATFS_READ_AHEAD_H_
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "fatfs_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Read-ahead used by the fatfs_stream reader
+ *
+ *         A background task reads the file in cluster-aligned blocks of whole clusters into two buffers, while
+ *         the reader copies out of the other one. Large aligned reads let FatFs transfer whole sectors straight
+ *         into the block instead of going through its one-sector window, and the latency of a slow read (FAT
+ *         lookup, card garbage collection, a shared SPI bus) is hidden as long as one block is ready.
+ *         A seek inside the block being read costs nothing, otherwise the blocks are dropped and the task restarts
+ *         from the cluster holding the new position. The block being read then is discarded when it completes.
+ */
+typedef struct fatfs_read_ahead *fatfs_read_ahead_handle_t;
+
+/**
+ * @brief  Read-ahead configuration
+ */
+typedef struct {
+    int     buffer_size;        /*!< Size of both blocks together, each half is rounded up to whole clusters */
+    int     task_stack;         /*!< Reader task stack size */
+    int     task_prio;          /*!< Reader task priority */
+    int     task_core;          /*!< Reader task core */
+    bool    stack_in_ext;       /*!< Try to allocate the task stack in external memory */
+} fatfs_read_ahead_cfg_t;
+
+/**
+ * @brief      Create a read-ahead, the blocks are allocated on start once the cluster size is known
+ *
+ * @param[in]  cfg  The configuration
+ *
+ * @return
+ *     - NULL    Out of memory or invalid configuration
+ *     - Others  Read-ahead handle
+ */
+fatfs_read_ahead_handle_t fatfs_read_ahead_create(fatfs_read_ahead_cfg_t *cfg);
+
+/**
+ * @brief      Start reading ahead an open file, the statistics are cleared
+ *
+ * @param[in]  ra    The read-ahead handle
+ * @param[in]  fd    File descriptor opened for reading
+ * @param[in]  pos   First byte to read
+ * @param[in]  size  Size of the file
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t fatfs_read_ahead_start(fatfs_read_ahead_handle_t ra, int fd, int64_t pos, int64_t size);
+
+/**
+ * @brief      Read the file in order, the call only waits when no byte at the read position is ready
+ *
+ * @param[in]  ra     The read-ahead handle
+ * @param[out] buf    Output buffer
+ * @param[in]  len    Bytes to read
+ * @param[in]  ticks  Ticks to wait for data
+ *
+ * @return
+ *     - > 0       Bytes read
+ *     - 0         The file is read to its end
+ *     - ESP_FAIL  Reading the file failed, or no data came in time
+ */
+int fatfs_read_ahead_read(fatfs_read_ahead_handle_t ra, char *buf, int len, TickType_t ticks);
+
+/**
+ * @brief      Move the read position, the blocks which do not hold it are dropped
+ *
+ * @param[in]  ra   The read-ahead handle
+ * @param[in]  pos  New read position
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL  Not started
+ */
+esp_err_t fatfs_read_ahead_seek(fatfs_read_ahead_handle_t ra, int64_t pos);
+
+/**
+ * @brief      Get the read position, the offset of the next byte `fatfs_read_ahead_read` returns
+ *
+ * @param[in]  ra  The read-ahead handle
+ *
+ * @return     The read position
+ */
+int64_t fatfs_read_ahead_tell(fatfs_read_ahead_handle_t ra);
+
+/**
+ * @brief      Get the read statistics since start
+ *
+ * @param[in]  ra     The read-ahead handle
+ * @param[out] stats  The statistics
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t fatfs_read_ahead_get_stats(fatfs_read_ahead_handle_t ra, fatfs_stream_read_stats_t *stats);
+
+/**
+ * @brief      Stop the reader task and drop the blocks
+ *
+ * @param[in]  ra  The read-ahead handle
+ */
+void fatfs_read_ahead_stop(fatfs_read_ahead_handle_t ra);
+
+/**
+ * @brief      Stop and destroy the read-ahead
+ *
+ * @param[in]  ra  The read-ahead handle
+ */
+void fatfs_read_ahead_destroy(fatfs_read_ahead_handle_t ra);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FATFS_READ_AHEAD_H_ */
@@ -37,6 +37,8 @@
 #include "audio_mem.h"
 #include "audio_element.h"
 #include "wav_head.h"
+#include "fatfs_write_behind.h"
+#include "fatfs_read_ahead.h"
 #include "esp_log.h"
 #include "unistd.h"
 #include "fcntl.h"
@@ -63,6 +65,10 @@ typedef struct fatfs_stream {
     int file;
     wr_stream_type_t w_type;
     bool write_header;
+    fatfs_write_behind_handle_t write_behind;
+    bool write_behind_active;
+    fatfs_read_ahead_handle_t read_ahead;
+    bool read_ahead_active;
 } fatfs_stream_t;
 
 
@@ -144,6 +150,12 @@ static esp_err_t _fatfs_open(audio_element_handle_t self)
                 return ESP_FAIL;
             }
         }
+        if (fatfs->read_ahead) {
+            fatfs->read_ahead_active = (fatfs_read_ahead_start(fatfs->read_ahead, fatfs->file, info.byte_pos, siz.st_size) == ESP_OK);
+            if (fatfs->read_ahead_active == false) {
+                ESP_LOGW(TAG, "Read-ahead not started, read synchronously");
+            }
+        }
     } else if (fatfs->type == AUDIO_STREAM_WRITER) {
         fatfs->file = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
         if (fatfs->file == -1) {
@@ -162,6 +174,12 @@ static esp_err_t _fatfs_open(audio_element_handle_t self)
             write(fatfs->file, "#!AMR-WB\n", 9);
             fsync(fatfs->file);
         }
+        if (fatfs->write_behind) {
+            fatfs->write_behind_active = (fatfs_write_behind_start(fatfs->write_behind, fatfs->file, lseek(fatfs->file, 0, SEEK_CUR)) == ESP_OK);
+            if (fatfs->write_behind_active == false) {
+                ESP_LOGW(TAG, "Write-behind not started, write synchronously");
+            }
+        }
     } else {
         ESP_LOGE(TAG, "FATFS must be Reader or Writer");
         return ESP_FAIL;
@@ -178,8 +196,17 @@ static int _fatfs_read(audio_element_handle_t self, char *buffer, int len, TickT
     audio_element_getinfo(self, &info);
 
     ESP_LOGD(TAG, "read len=%d, pos=%d/%d", len, (int)info.byte_pos, (int)info.total_bytes);
-    /* use file descriptors to access files */
-    int rlen = read(fatfs->file, buffer, len);
+    int rlen;
+    if (fatfs->read_ahead_active) {
+        if (info.byte_pos != fatfs_read_ahead_tell(fatfs->read_ahead)) {
+            // The position was set while paused
+            fatfs_read_ahead_seek(fatfs->read_ahead, info.byte_pos);
+        }
+        rlen = fatfs_read_ahead_read(fatfs->read_ahead, buffer, len, ticks_to_wait);
+    } else {
+        /* use file descriptors to access files */
+        rlen = read(fatfs->file, buffer, len);
+    }
     if (rlen == 0) {
         ESP_LOGW(TAG, "No more data, ret:%d", rlen);
     } else if (rlen == -1) {
@@ -195,6 +222,15 @@ static int _fatfs_write(audio_element_handle_t self, char *buffer, int len, Tick
     fatfs_stream_t *fatfs = (fatfs_stream_t *)audio_element_getdata(self);
     audio_element_info_t info;
     audio_element_getinfo(self, &info);
+    if (fatfs->write_behind_active) {
+        int wlen = fatfs_write_behind_write(fatfs->write_behind, buffer, len, ticks_to_wait);
+        if (wlen > 0) {
+            audio_element_update_byte_pos(self, wlen);
+        } else {
+            ESP_LOGE(TAG, "The error is happened in writing data behind");
+        }
+        return wlen;
+    }
     int wlen =  write(fatfs->file, buffer, len);
     fsync(fatfs->file);
     if (wlen > 0) {
@@ -221,6 +257,21 @@ static int _fatfs_process(audio_element_handle_t self, char *in_buffer, int in_l
 static esp_err_t _fatfs_close(audio_element_handle_t self)
 {
     fatfs_stream_t *fatfs = (fatfs_stream_t *)audio_element_getdata(self);
+    int64_t data_end = -1;
+
+    if (fatfs->write_behind_active) {
+        if (fatfs_write_behind_finish(fatfs->write_behind, &data_end) != ESP_OK) {
+            ESP_LOGE(TAG, "Some data could not be written");
+        }
+        if (fatfs_write_behind_is_preallocated(fatfs->write_behind) == false) {
+            data_end = -1;
+        }
+        fatfs->write_behind_active = false;
+    }
+    if (fatfs->read_ahead_active) {
+        fatfs_read_ahead_stop(fatfs->read_ahead);
+        fatfs->read_ahead_active = false;
+    }
 
     if (AUDIO_STREAM_WRITER == fatfs->type
         && (-1 != fatfs->file)
@@ -246,6 +297,13 @@ static esp_err_t _fatfs_close(audio_element_handle_t self)
         close(fatfs->file);
         fatfs->is_open = false;
     }
+    if (data_end >= 0) {
+        // Cut the space reserved ahead of the data
+        char *path = get_mount_path(audio_element_get_uri(self));
+        if (path == NULL || truncate(path, data_end) != 0) {
+            ESP_LOGE(TAG, "Failed to cut the file to %lld bytes", data_end);
+        }
+    }
     if (AEL_STATE_PAUSED != audio_element_get_state(self)) {
         audio_element_report_info(self);
         audio_element_set_byte_pos(self, 0);
@@ -256,6 +314,8 @@ static esp_err_t _fatfs_close(audio_element_handle_t self)
 static esp_err_t _fatfs_destroy(audio_element_handle_t self)
 {
     fatfs_stream_t *fatfs = (fatfs_stream_t *)audio_element_getdata(self);
+    AUDIO_SAFE_FREE(fatfs->write_behind, fatfs_write_behind_destroy);
+    AUDIO_SAFE_FREE(fatfs->read_ahead, fatfs_read_ahead_destroy);
     audio_free(fatfs);
     return ESP_OK;
 }
@@ -288,8 +348,33 @@ audio_element_handle_t fatfs_stream_init(fatfs_stream_cfg_t *config)
 
     if (config->type == AUDIO_STREAM_WRITER) {
         cfg.write = _fatfs_write;
+        if (config->write_behind_size > 0) {
+            fatfs_write_behind_cfg_t wb_cfg = {
+                .buffer_size = config->write_behind_size,
+                .sync_interval_ms = config->sync_interval_ms ? config->sync_interval_ms : FATFS_STREAM_SYNC_INTERVAL_MS,
+                .sync_bytes = config->sync_bytes ? config->sync_bytes : FATFS_STREAM_SYNC_BYTES,
+                .prealloc_size = config->prealloc_size,
+                .task_stack = FATFS_STREAM_TASK_STACK,
+                .task_prio = config->task_prio,
+                .task_core = config->task_core,
+                .stack_in_ext = config->ext_stack,
+            };
+            fatfs->write_behind = fatfs_write_behind_create(&wb_cfg);
+            AUDIO_MEM_CHECK(TAG, fatfs->write_behind, goto _fatfs_init_exit);
+        }
     } else {
         cfg.read = _fatfs_read;
+        if (config->read_ahead_size > 0) {
+            fatfs_read_ahead_cfg_t ra_cfg = {
+                .buffer_size = config->read_ahead_size,
+                .task_stack = FATFS_STREAM_TASK_STACK,
+                .task_prio = config->task_prio,
+                .task_core = config->task_core,
+                .stack_in_ext = config->ext_stack,
+            };
+            fatfs->read_ahead = fatfs_read_ahead_create(&ra_cfg);
+            AUDIO_MEM_CHECK(TAG, fatfs->read_ahead, goto _fatfs_init_exit);
+        }
     }
     el = audio_element_init(&cfg);
 
@@ -297,7 +382,20 @@ audio_element_handle_t fatfs_stream_init(fatfs_stream_cfg_t *config)
     audio_element_setdata(el, fatfs);
     return el;
 _fatfs_init_exit:
+    AUDIO_SAFE_FREE(fatfs->write_behind, fatfs_write_behind_destroy);
+    AUDIO_SAFE_FREE(fatfs->read_ahead, fatfs_read_ahead_destroy);
     audio_free(fatfs);
     return NULL;
 }
-// Example of using an audio element - END
\ No newline at end of file
+// Example of using an audio element - END
+
+esp_err_t fatfs_stream_get_read_stats(audio_element_handle_t el, fatfs_stream_read_stats_t *stats)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, stats, return ESP_ERR_INVALID_ARG);
+    fatfs_stream_t *fatfs = (fatfs_stream_t *)audio_element_getdata(el);
+    if (fatfs->read_ahead_active == false) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return fatfs_read_ahead_get_stats(fatfs->read_ahead, stats);
+}
\ No newline at end of file
@@ -0,0 +1,362 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include "unistd.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "audio_mutex.h"
+#include "audio_thread.h"
+#include "fatfs_write_behind.h"
+
+static const char *TAG = "FATFS_WRITE_BEHIND";
+
+#define FATFS_WRITE_BEHIND_CLUSTER_SIZE     (4096)          /* Used when the file system does not tell its cluster size */
+#define FATFS_WRITE_BEHIND_MAX_CLUSTER      (64 * 1024)
+
+#define WRITE_BEHIND_DATA_BIT               BIT0
+#define WRITE_BEHIND_FREE_BIT               BIT1
+#define WRITE_BEHIND_STOP_BIT               BIT2
+#define WRITE_BEHIND_EXIT_BIT               BIT3
+
+struct fatfs_write_behind {
+    fatfs_write_behind_cfg_t    cfg;
+    void                       *lock;
+    EventGroupHandle_t          state;
+    int                         fd;
+    int                         cluster;
+    int                         half;           /* Size of one staging buffer, whole clusters */
+    char                       *buf[2];
+    int                         fill[2];
+    int                         active;         /* Buffer filled by `fatfs_write_behind_write` */
+    bool                        pending;        /* The other buffer belongs to the writer task */
+    int64_t                     active_pos;     /* File offset of the first byte of the active buffer */
+    int64_t                     pending_pos;
+    int64_t                     staged_us;      /* Time the first byte entered the active buffer */
+    int64_t                     pending_us;     /* Same for the buffer handed to the task */
+    int64_t                     written;        /* File offset after the last written byte */
+    int64_t                     file_pos;       /* Offset of the file descriptor */
+    int64_t                     reserved;       /* End of the reserved file space */
+    int                         unsynced;       /* Bytes written since the last fsync */
+    int64_t                     unsynced_us;    /* Time the oldest data written since the last fsync was staged */
+    volatile bool               running;
+    bool                        failed;
+};
+
+/*
+ * Hand the active buffer to the writer task, the next buffer continues at the following file offset
+ */
+static void write_behind_swap(struct fatfs_write_behind *wb)
+{
+    wb->pending = true;
+    wb->pending_pos = wb->active_pos;
+    wb->pending_us = wb->staged_us;
+    wb->active_pos += wb->fill[wb->active];
+    wb->active ^= 1;
+    wb->fill[wb->active] = 0;
+}
+
+/*
+ * Room of the active buffer, so that it ends on a cluster boundary of the file
+ */
+static inline int write_behind_room(struct fatfs_write_behind *wb)
+{
+    return wb->half - (int)(wb->active_pos % wb->cluster) - wb->fill[wb->active];
+}
+
+static esp_err_t write_behind_reserve(struct fatfs_write_behind *wb, int64_t end)
+{
+    // Writing the last byte makes FAT allocate the cluster chain at once, mostly contiguous
+    char zero = 0;
+    if (lseek(wb->fd, end - 1, SEEK_SET) < 0 || write(wb->fd, &zero, 1) != 1) {
+        ESP_LOGW(TAG, "Failed to reserve file space up to %lld, %s", end, strerror(errno));
+        wb->file_pos = -1;
+        return ESP_FAIL;
+    }
+    wb->file_pos = end;
+    wb->reserved = end;
+    return ESP_OK;
+}
+
+static esp_err_t write_behind_output(struct fatfs_write_behind *wb, const char *data, int len, int64_t pos)
+{
+    if (wb->cfg.prealloc_size > 0 && pos + len > wb->reserved) {
+        write_behind_reserve(wb, pos + len + wb->cfg.prealloc_size);
+    }
+    if (wb->file_pos != pos) {
+        if (lseek(wb->fd, pos, SEEK_SET) < 0) {
+            ESP_LOGE(TAG, "Error seek file to %lld, %s", pos, strerror(errno));
+            return ESP_FAIL;
+        }
+        wb->file_pos = pos;
+    }
+    while (len > 0) {
+        int wlen = write(wb->fd, data, len);
+        if (wlen <= 0) {
+            ESP_LOGE(TAG, "The error is happened in writing data. Error message: %s", strerror(errno));
+            wb->file_pos = -1;
+            return ESP_FAIL;
+        }
+        data += wlen;
+        len -= wlen;
+        wb->file_pos += wlen;
+        wb->unsynced += wlen;
+    }
+    wb->written = wb->file_pos;
+    if (wb->unsynced >= wb->cfg.sync_bytes) {
+        fsync(wb->fd);
+        wb->unsynced = 0;
+    }
+    return ESP_OK;
+}
+
+static void write_behind_task(void *arg)
+{
+    struct fatfs_write_behind *wb = (struct fatfs_write_behind *)arg;
+    int64_t interval_us = (int64_t)wb->cfg.sync_interval_ms * 1000;
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        int64_t deadline = INT64_MAX;
+        int idx = -1;
+        int64_t staged_us = 0;
+        mutex_lock(wb->lock);
+        bool stop = (wb->running == false);
+        if (wb->pending) {
+            idx = wb->active ^ 1;
+        } else if (wb->fill[wb->active] && (stop || now - wb->staged_us >= interval_us)) {
+            // Staged for too long, write it out although its buffer is not full
+            write_behind_swap(wb);
+            idx = wb->active ^ 1;
+        } else if (wb->fill[wb->active]) {
+            deadline = wb->staged_us + interval_us;
+        }
+        if (idx >= 0) {
+            staged_us = wb->pending_us;
+        }
+        mutex_unlock(wb->lock);
+
+        if (idx >= 0) {
+            if (wb->unsynced == 0) {
+                wb->unsynced_us = staged_us;
+            }
+            esp_err_t ret = write_behind_output(wb, wb->buf[idx], wb->fill[idx], wb->pending_pos);
+            mutex_lock(wb->lock);
+            wb->failed |= (ret != ESP_OK);
+            wb->fill[idx] = 0;
+            wb->pending = false;
+            mutex_unlock(wb->lock);
+            xEventGroupSetBits(wb->state, WRITE_BEHIND_FREE_BIT);
+            now = esp_timer_get_time();
+        }
+        // The age counts from staging, so data written for being staged too long is synced right away
+        if (wb->unsynced && ((stop && idx < 0) || now - wb->unsynced_us >= interval_us)) {
+            fsync(wb->fd);
+            wb->unsynced = 0;
+        }
+        if (idx >= 0) {
+            continue;
+        }
+        if (stop) {
+            break;
+        }
+        if (wb->unsynced && wb->unsynced_us + interval_us < deadline) {
+            deadline = wb->unsynced_us + interval_us;
+        }
+        TickType_t ticks = portMAX_DELAY;
+        if (deadline != INT64_MAX) {
+            ticks = (deadline - now) / 1000 / portTICK_PERIOD_MS + 1;
+        }
+        xEventGroupWaitBits(wb->state, WRITE_BEHIND_DATA_BIT | WRITE_BEHIND_STOP_BIT, false, false, ticks);
+        xEventGroupClearBits(wb->state, WRITE_BEHIND_DATA_BIT);
+    }
+    xEventGroupSetBits(wb->state, WRITE_BEHIND_EXIT_BIT);
+    vTaskDelete(NULL);
+}
+
+fatfs_write_behind_handle_t fatfs_write_behind_create(fatfs_write_behind_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, cfg, return NULL);
+    AUDIO_CHECK(TAG, cfg->buffer_size > 0 && cfg->sync_interval_ms > 0 && cfg->sync_bytes > 0,
+                return NULL, "Invalid write-behind configuration");
+    struct fatfs_write_behind *wb = audio_calloc(1, sizeof(struct fatfs_write_behind));
+    AUDIO_MEM_CHECK(TAG, wb, return NULL);
+    memcpy(&wb->cfg, cfg, sizeof(fatfs_write_behind_cfg_t));
+    wb->lock = mutex_create();
+    wb->state = xEventGroupCreate();
+    AUDIO_MEM_CHECK(TAG, wb->lock && wb->state, {
+        fatfs_write_behind_destroy(wb);
+        return NULL;
+    });
+    xEventGroupSetBits(wb->state, WRITE_BEHIND_EXIT_BIT);
+    return wb;
+}
+
+esp_err_t fatfs_write_behind_start(fatfs_write_behind_handle_t wb, int fd, int64_t pos)
+{
+    AUDIO_NULL_CHECK(TAG, wb, return ESP_FAIL);
+    if (wb->running) {
+        ESP_LOGE(TAG, "Already started");
+        return ESP_FAIL;
+    }
+    struct stat st = { 0 };
+    int cluster = FATFS_WRITE_BEHIND_CLUSTER_SIZE;
+    if (fstat(fd, &st) == 0 && st.st_blksize > 0 && st.st_blksize <= FATFS_WRITE_BEHIND_MAX_CLUSTER) {
+        cluster = st.st_blksize;
+    }
+    int half = (wb->cfg.buffer_size / 2 + cluster - 1) / cluster * cluster;
+    if (half != wb->half) {
+        for (int i = 0; i < 2; i++) {
+            audio_free(wb->buf[i]);
+            wb->buf[i] = audio_malloc(half);
+        }
+        wb->half = half;
+        AUDIO_MEM_CHECK(TAG, wb->buf[0] && wb->buf[1], {
+            wb->half = 0;
+            return ESP_ERR_NO_MEM;
+        });
+    }
+    wb->cluster = cluster;
+    wb->fd = fd;
+    wb->fill[0] = wb->fill[1] = 0;
+    wb->active = 0;
+    wb->pending = false;
+    wb->active_pos = pos;
+    wb->written = pos;
+    wb->file_pos = pos;
+    wb->reserved = pos;
+    wb->unsynced = 0;
+    wb->failed = false;
+    if (wb->cfg.prealloc_size > 0 && write_behind_reserve(wb, pos + wb->cfg.prealloc_size) != ESP_OK) {
+        // Keep going, the file grows with the writes then
+        wb->reserved = pos;
+    }
+    wb->running = true;
+    xEventGroupClearBits(wb->state, WRITE_BEHIND_DATA_BIT | WRITE_BEHIND_FREE_BIT | WRITE_BEHIND_STOP_BIT | WRITE_BEHIND_EXIT_BIT);
+    if (audio_thread_create(NULL, "fatfs_write", write_behind_task, wb, wb->cfg.task_stack,
+                            wb->cfg.task_prio, wb->cfg.stack_in_ext, wb->cfg.task_core) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create write-behind task");
+        wb->running = false;
+        xEventGroupSetBits(wb->state, WRITE_BEHIND_EXIT_BIT);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Write-behind from %lld, 2 x %d bytes, cluster %d, sync every %d bytes or %d ms",
+             pos, half, cluster, wb->cfg.sync_bytes, wb->cfg.sync_interval_ms);
+    return ESP_OK;
+}
+
+int fatfs_write_behind_write(fatfs_write_behind_handle_t wb, const char *buf, int len, TickType_t ticks)
+{
+    AUDIO_NULL_CHECK(TAG, wb, return ESP_FAIL);
+    int done = 0;
+    while (done < len) {
+        bool wake = false;
+        bool wait = false;
+        mutex_lock(wb->lock);
+        if (wb->failed || wb->running == false) {
+            mutex_unlock(wb->lock);
+            return ESP_FAIL;
+        }
+        int room = write_behind_room(wb);
+        if (room > 0) {
+            int n = len - done < room ? len - done : room;
+            if (wb->fill[wb->active] == 0) {
+                // Let the task time the staged data from now
+                wb->staged_us = esp_timer_get_time();
+                wake = true;
+            }
+            memcpy(wb->buf[wb->active] + wb->fill[wb->active], buf + done, n);
+            wb->fill[wb->active] += n;
+            done += n;
+            room -= n;
+        }
+        if (room == 0) {
+            if (wb->pending == false) {
+                write_behind_swap(wb);
+                wake = true;
+            } else {
+                // Both buffers are full, the card is slower than the data for now
+                wait = true;
+                xEventGroupClearBits(wb->state, WRITE_BEHIND_FREE_BIT);
+            }
+        }
+        mutex_unlock(wb->lock);
+        if (wake) {
+            xEventGroupSetBits(wb->state, WRITE_BEHIND_DATA_BIT);
+        }
+        if (wait) {
+            EventBits_t bits = xEventGroupWaitBits(wb->state, WRITE_BEHIND_FREE_BIT, false, true, ticks);
+            if ((bits & WRITE_BEHIND_FREE_BIT) == 0) {
+                ESP_LOGE(TAG, "Timeout waiting for the card");
+                return done ? done : ESP_FAIL;
+            }
+        }
+    }
+    return len;
+}
+
+esp_err_t fatfs_write_behind_finish(fatfs_write_behind_handle_t wb, int64_t *size)
+{
+    AUDIO_NULL_CHECK(TAG, wb, return ESP_FAIL);
+    if (wb->running) {
+        // The task writes the staged data and syncs before it exits
+        mutex_lock(wb->lock);
+        wb->running = false;
+        mutex_unlock(wb->lock);
+        xEventGroupSetBits(wb->state, WRITE_BEHIND_STOP_BIT);
+        xEventGroupWaitBits(wb->state, WRITE_BEHIND_EXIT_BIT, false, true, portMAX_DELAY);
+    }
+    if (size) {
+        *size = wb->written;
+    }
+    return wb->failed ? ESP_FAIL : ESP_OK;
+}
+
+bool fatfs_write_behind_is_preallocated(fatfs_write_behind_handle_t wb)
+{
+    return wb && wb->reserved > wb->written;
+}
+
+void fatfs_write_behind_destroy(fatfs_write_behind_handle_t wb)
+{
+    if (wb == NULL) {
+        return;
+    }
+    if (wb->state && wb->lock) {
+        fatfs_write_behind_finish(wb, NULL);
+    }
+    audio_free(wb->buf[0]);
+    audio_free(wb->buf[1]);
+    AUDIO_SAFE_FREE(wb->lock, mutex_destroy);
+    AUDIO_SAFE_FREE(wb->state, vEventGroupDelete);
+    audio_free(wb);
+}
@@ -0,0 +1,135 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _FATFS_WRITE_BEHIND_H_
+#define _FATFS_WRITE_BEHIND_H_
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Write-behind buffering used by the fatfs_stream writer
+ *
+ *         The writer copies data into one of two staging buffers, a background task writes the other one to the
+ *         file in whole clusters. fsync runs once `sync_bytes` are written, once the oldest unsynced data was
+ *         staged `sync_interval_ms` ago, and on finish. Data staged for longer than `sync_interval_ms` is written
+ *         even if its buffer is not full and synced right after, so after a power loss at most the last
+ *         `sync_interval_ms` of data plus the duration of one buffer write, and never more than
+ *         `buffer_size + sync_bytes` bytes, are missing.
+ */
+typedef struct fatfs_write_behind *fatfs_write_behind_handle_t;
+
+/**
+ * @brief  Write-behind configuration
+ */
+typedef struct {
+    int     buffer_size;        /*!< Staging size, split in two buffers and rounded up to whole clusters */
+    int     sync_interval_ms;   /*!< Longest time from staging data to its fsync */
+    int     sync_bytes;         /*!< Bytes written between two fsync */
+    int     prealloc_size;      /*!< File space reserved ahead of the data at once, 0 to let the file grow per write.
+                                     The clusters are not cleared, stale card data follows the synced data until the file is cut */
+    int     task_stack;         /*!< Writer task stack size */
+    int     task_prio;          /*!< Writer task priority */
+    int     task_core;          /*!< Writer task core */
+    bool    stack_in_ext;       /*!< Try to allocate the task stack in external memory */
+} fatfs_write_behind_cfg_t;
+
+/**
+ * @brief      Create a write-behind, the staging buffers are allocated on start once the cluster size is known
+ *
+ * @param[in]  cfg  The configuration
+ *
+ * @return
+ *     - NULL    Out of memory or invalid configuration
+ *     - Others  Write-behind handle
+ */
+fatfs_write_behind_handle_t fatfs_write_behind_create(fatfs_write_behind_cfg_t *cfg);
+
+/**
+ * @brief      Start staging the writes to an open file
+ *
+ *             The file space is reserved up to `pos + prealloc_size`, the file must be cut to the returned size
+ *             of `fatfs_write_behind_finish` once closed.
+ *
+ * @param[in]  wb   The write-behind handle
+ * @param[in]  fd   File descriptor opened for writing
+ * @param[in]  pos  Current offset in the file, where the first write goes
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t fatfs_write_behind_start(fatfs_write_behind_handle_t wb, int fd, int64_t pos);
+
+/**
+ * @brief      Stage data, the call only waits when both buffers are full
+ *
+ * @param[in]  wb     The write-behind handle
+ * @param[in]  buf    Data to write
+ * @param[in]  len    Bytes to write
+ * @param[in]  ticks  Ticks to wait for a free buffer
+ *
+ * @return
+ *     - > 0       Bytes staged
+ *     - ESP_FAIL  Writing to the file failed, or no buffer got free in time
+ */
+int fatfs_write_behind_write(fatfs_write_behind_handle_t wb, const char *buf, int len, TickType_t ticks);
+
+/**
+ * @brief      Write the staged data, sync the file and stop the writer task
+ *
+ * @param[in]  wb    The write-behind handle
+ * @param[out] size  Offset after the last written byte, the size the file must have
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL  Some data could not be written
+ */
+esp_err_t fatfs_write_behind_finish(fatfs_write_behind_handle_t wb, int64_t *size);
+
+/**
+ * @brief      Check whether the file space is reserved beyond the data
+ *
+ * @param[in]  wb  The write-behind handle
+ *
+ * @return     true if the file must be cut to its data after finish
+ */
+bool fatfs_write_behind_is_preallocated(fatfs_write_behind_handle_t wb);
+
+/**
+ * @brief      Finish and destroy the write-behind
+ *
+ * @param[in]  wb  The write-behind handle
+ */
+void fatfs_write_behind_destroy(fatfs_write_behind_handle_t wb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FATFS_WRITE_BEHIND_H_ */
@@ -0,0 +1,147 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "hls_decrypt.h"
+
+static const char *TAG = "HLS_DECRYPT";
+
+esp_err_t hls_decrypt_init(hls_decrypt_t *dec, const uint8_t *key, const uint8_t *iv)
+{
+    hls_decrypt_deinit(dec);
+    esp_aes_init(&dec->ctx);
+    dec->inited = true;
+    if (esp_aes_setkey(&dec->ctx, key, 128) != 0) {
+        ESP_LOGE(TAG, "Failed to set AES key");
+        hls_decrypt_deinit(dec);
+        return ESP_FAIL;
+    }
+    memcpy(dec->iv, iv, HLS_DECRYPT_BLOCK_SIZE);
+    dec->pending_len = 0;
+    dec->plain_pos = 0;
+    dec->plain_len = 0;
+    return ESP_OK;
+}
+
+int hls_decrypt_get_pending(hls_decrypt_t *dec, uint8_t *buf)
+{
+    memcpy(buf, dec->pending, dec->pending_len);
+    return dec->pending_len;
+}
+
+int hls_decrypt_update(hls_decrypt_t *dec, uint8_t *buf, int len, bool eos)
+{
+    if (dec->inited == false) {
+        return ESP_FAIL;
+    }
+    int keep = len % HLS_DECRYPT_BLOCK_SIZE;
+    if (eos) {
+        if (keep) {
+            ESP_LOGW(TAG, "Segment truncated, drop %d bytes", keep);
+        }
+    } else if (keep == 0 && len) {
+        // Hold the last block back, it carries the padding when the segment ends here
+        keep = HLS_DECRYPT_BLOCK_SIZE;
+    }
+    int out = len - keep;
+    if (eos == false) {
+        memcpy(dec->pending, buf + out, keep);
+        dec->pending_len = keep;
+    } else {
+        dec->pending_len = 0;
+    }
+    if (out == 0) {
+        return 0;
+    }
+    // One call for the whole aligned part, so the driver can use its DMA mode on large reads
+    if (esp_aes_crypt_cbc(&dec->ctx, ESP_AES_DECRYPT, out, dec->iv, buf, buf) != 0) {
+        ESP_LOGE(TAG, "Failed to decrypt %d bytes", out);
+        return ESP_FAIL;
+    }
+    if (eos) {
+        // Remove padding according PKCS#7
+        uint8_t padding = buf[out - 1];
+        bool valid = (padding > 0 && padding <= HLS_DECRYPT_BLOCK_SIZE);
+        for (int i = 2; valid && i <= padding; i++) {
+            valid = (buf[out - i] == padding);
+        }
+        if (valid) {
+            out -= padding;
+        } else {
+            ESP_LOGW(TAG, "Invalid padding %d", padding);
+        }
+    }
+    return out;
+}
+
+static int hls_decrypt_fill(hls_decrypt_t *dec, uint8_t *buf, int len, hls_decrypt_read_cb read_cb, void *ctx)
+{
+    int out = 0;
+    int rlen = 0;
+    do {
+        int pending = hls_decrypt_get_pending(dec, buf);
+        rlen = read_cb(ctx, buf + pending, len - pending);
+        if (rlen < 0) {
+            return rlen;
+        }
+        out = hls_decrypt_update(dec, buf, pending + rlen, rlen == 0);
+    } while (out == 0 && rlen > 0);
+    return out;
+}
+
+int hls_decrypt_read(hls_decrypt_t *dec, uint8_t *buf, int len, hls_decrypt_read_cb read_cb, void *ctx)
+{
+    if (dec->plain_len > dec->plain_pos) {
+        int n = dec->plain_len - dec->plain_pos;
+        n = n < len ? n : len;
+        memcpy(buf, dec->plain + dec->plain_pos, n);
+        dec->plain_pos += n;
+        return n;
+    }
+    if (len >= (int)sizeof(dec->plain)) {
+        return hls_decrypt_fill(dec, buf, len, read_cb, ctx);
+    }
+    int out = hls_decrypt_fill(dec, dec->plain, sizeof(dec->plain), read_cb, ctx);
+    if (out <= 0) {
+        return out;
+    }
+    int n = out < len ? out : len;
+    memcpy(buf, dec->plain, n);
+    dec->plain_pos = n;
+    dec->plain_len = out;
+    return n;
+}
+
+void hls_decrypt_deinit(hls_decrypt_t *dec)
+{
+    if (dec->inited) {
+        esp_aes_free(&dec->ctx);
+        dec->inited = false;
+    }
+    dec->pending_len = 0;
+    dec->plain_pos = 0;
+    dec->plain_len = 0;
+}
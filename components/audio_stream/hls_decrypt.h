@@ -0,0 +1,152 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _HLS_DECRYPT_H_
+#define _HLS_DECRYPT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "audio_idf_version.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0))
+#include "aes/esp_aes.h"
+#elif (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0))
+#if CONFIG_IDF_TARGET_ESP32
+#include "esp32/aes.h"
+#elif CONFIG_IDF_TARGET_ESP32S2
+#include "esp32s2/aes.h"
+#endif
+#else
+#include "hwcrypto/aes.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HLS_DECRYPT_BLOCK_SIZE  (16)
+
+/**
+ * @brief  Streaming AES-128-CBC decryptor of one HLS segment
+ *
+ *         Reads of any size are decrypted in place. The bytes that do not fill a whole block are kept
+ *         for the next read, as is the last complete block, so the PKCS#7 padding is removed only
+ *         once the end of the segment is known.
+ *
+ *         `hls_decrypt_read` does the whole sequence on top of a read function. Used directly,
+ *         for every read into `buf` of `len` bytes:
+ *         - `n = hls_decrypt_get_pending(dec, buf)` puts the kept ciphertext at the head of `buf`
+ *         - Up to `len - n` new bytes are read to `buf + n`
+ *         - `hls_decrypt_update(dec, buf, n + rlen, rlen == 0)` returns the plaintext length at the head of `buf`
+ */
+typedef struct {
+    esp_aes_context     ctx;
+    uint8_t             iv[HLS_DECRYPT_BLOCK_SIZE];
+    uint8_t             pending[HLS_DECRYPT_BLOCK_SIZE];        /*!< Ciphertext kept from the previous read */
+    int                 pending_len;
+    uint8_t             plain[2 * HLS_DECRYPT_BLOCK_SIZE];      /*!< Plaintext of a small read not returned yet */
+    int                 plain_pos;
+    int                 plain_len;
+    bool                inited;
+} hls_decrypt_t;
+
+/**
+ * @brief      Start the decryption of a segment
+ *
+ * @param[in]  dec  The decryptor, released first if it was used
+ * @param[in]  key  AES-128 key
+ * @param[in]  iv   Initialization vector of the segment
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL  The key was refused
+ */
+esp_err_t hls_decrypt_init(hls_decrypt_t *dec, const uint8_t *key, const uint8_t *iv);
+
+/**
+ * @brief      Copy the ciphertext kept from the previous read to the head of a buffer
+ *
+ * @param[in]  dec  The decryptor
+ * @param[out] buf  Read buffer, at least `HLS_DECRYPT_BLOCK_SIZE` bytes
+ *
+ * @return     Number of bytes copied, new data goes after them
+ */
+int hls_decrypt_get_pending(hls_decrypt_t *dec, uint8_t *buf);
+
+/**
+ * @brief      Decrypt a buffer in place
+ *
+ * @param[in]  dec  The decryptor
+ * @param      buf  Pending bytes followed by the new ciphertext, plaintext on return
+ * @param[in]  len  Total length in `buf`
+ * @param[in]  eos  The segment ends with this data, the padding is removed
+ *
+ * @return
+ *     - >= 0      Plaintext length at the head of `buf`
+ *     - ESP_FAIL  Decryption failed
+ */
+int hls_decrypt_update(hls_decrypt_t *dec, uint8_t *buf, int len, bool eos);
+
+/**
+ * @brief      Function reading the ciphertext of a segment
+ *
+ * @return
+ *     - > 0  Bytes read
+ *     - 0    End of the segment
+ *     - < 0  Error
+ */
+typedef int (*hls_decrypt_read_cb)(void *ctx, uint8_t *buf, int len);
+
+/**
+ * @brief      Read plaintext of the segment
+ *
+ *             Ciphertext is read until some plaintext is available or the segment ends, so a short read
+ *             that only fills the kept block does not look like the end of the segment.
+ *             Reads shorter than two blocks go through an internal buffer.
+ *
+ * @param[in]  dec      The decryptor
+ * @param[out] buf      Plaintext
+ * @param[in]  len      Size of `buf`
+ * @param[in]  read_cb  Function reading the ciphertext
+ * @param[in]  ctx      Context of `read_cb`
+ *
+ * @return
+ *     - > 0   Plaintext length
+ *     - 0     End of the segment
+ *     - < 0   Read or decryption error
+ */
+int hls_decrypt_read(hls_decrypt_t *dec, uint8_t *buf, int len, hls_decrypt_read_cb read_cb, void *ctx);
+
+/**
+ * @brief      Release the decryptor
+ *
+ * @param[in]  dec  The decryptor
+ */
+void hls_decrypt_deinit(hls_decrypt_t *dec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HLS_DECRYPT_H_ */
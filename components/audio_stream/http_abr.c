@@ -0,0 +1,284 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "audio_mutex.h"
+#include "http_abr.h"
+
+static const char *TAG = "HTTP_ABR";
+
+#define HTTP_ABR_MIN_SAMPLE_BYTES   (8 * 1024)
+#define HTTP_ABR_MIN_SAMPLE_US      (1000)
+#define HTTP_ABR_FAST_WEIGHT        (2)     /* Moving average over about 2 segments */
+#define HTTP_ABR_SLOW_WEIGHT        (5)     /* Moving average over about 5 segments */
+#define HTTP_ABR_SAFETY_PERCENT     (80)    /* Part of the estimate a variant may use */
+#define HTTP_ABR_UP_LEVEL           (50)    /* Buffer level in percent needed to switch up */
+#define HTTP_ABR_PANIC_LEVEL        (15)    /* Buffer level in percent to switch down without hold */
+#define HTTP_ABR_UP_COUNT           (2)     /* Boundaries agreeing before a switch up */
+#define HTTP_ABR_MIN_SAMPLES        (2)     /* Measured segments before the first switch */
+#define HTTP_ABR_HOLD_SEGMENTS      (2)     /* Segments played after a switch before the next one */
+
+typedef struct {
+    uint32_t    bandwidth;
+    char       *uri;
+} http_abr_variant_t;
+
+struct http_abr {
+    void                   *lock;
+    http_abr_variant_t     *variant;
+    int                     variant_num;
+    int                     current;
+    uint32_t                fast;           /*!< Fast moving average of the throughput in bits per second */
+    uint32_t                slow;           /*!< Slow moving average of the throughput in bits per second */
+    int                     level;          /*!< Buffer level in percent */
+    int                     up_cnt;
+    int                     segments;       /*!< Segment boundaries since the last switch */
+    uint32_t                samples;
+    uint32_t                switches;
+};
+
+static uint32_t abr_estimate(struct http_abr *abr)
+{
+    return abr->fast < abr->slow ? abr->fast : abr->slow;
+}
+
+static uint32_t abr_average(uint32_t avg, uint32_t sample, int weight)
+{
+    return (uint32_t)((int64_t)avg + ((int64_t)sample - (int64_t)avg) / weight);
+}
+
+http_abr_handle_t http_abr_create(void)
+{
+    struct http_abr *abr = audio_calloc(1, sizeof(struct http_abr));
+    AUDIO_MEM_CHECK(TAG, abr, return NULL);
+    abr->lock = mutex_create();
+    AUDIO_MEM_CHECK(TAG, abr->lock, {
+        audio_free(abr);
+        return NULL;
+    });
+    return abr;
+}
+
+esp_err_t http_abr_add_variant(http_abr_handle_t abr, uint32_t bandwidth, const char *uri)
+{
+    AUDIO_NULL_CHECK(TAG, abr, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, uri, return ESP_ERR_INVALID_ARG);
+    esp_err_t ret = ESP_OK;
+    mutex_lock(abr->lock);
+    int i;
+    for (i = 0; i < abr->variant_num; i++) {
+        if (strcmp(abr->variant[i].uri, uri) == 0) {
+            break;
+        }
+    }
+    if (i < abr->variant_num) {
+        // Variants sharing the same rendition, e.g. an audio group used by several video streams
+        if (bandwidth < abr->variant[i].bandwidth) {
+            abr->variant[i].bandwidth = bandwidth;
+            while (i > 0 && abr->variant[i - 1].bandwidth > bandwidth) {
+                http_abr_variant_t tmp = abr->variant[i - 1];
+                abr->variant[i - 1] = abr->variant[i];
+                abr->variant[i--] = tmp;
+            }
+        }
+        mutex_unlock(abr->lock);
+        return ESP_OK;
+    }
+    char *dup = audio_strdup(uri);
+    http_abr_variant_t *variant = audio_realloc(abr->variant, sizeof(http_abr_variant_t) * (abr->variant_num + 1));
+    if (dup == NULL || variant == NULL) {
+        audio_free(dup);
+        if (variant) {
+            abr->variant = variant;
+        }
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        abr->variant = variant;
+        for (i = abr->variant_num; i > 0 && variant[i - 1].bandwidth > bandwidth; i--) {
+            variant[i] = variant[i - 1];
+        }
+        variant[i].bandwidth = bandwidth;
+        variant[i].uri = dup;
+        abr->variant_num++;
+    }
+    mutex_unlock(abr->lock);
+    return ret;
+}
+
+void http_abr_clear(http_abr_handle_t abr)
+{
+    AUDIO_NULL_CHECK(TAG, abr, return);
+    mutex_lock(abr->lock);
+    for (int i = 0; i < abr->variant_num; i++) {
+        audio_free(abr->variant[i].uri);
+    }
+    AUDIO_SAFE_FREE(abr->variant, audio_free);
+    abr->variant_num = 0;
+    abr->current = 0;
+    abr->up_cnt = 0;
+    abr->segments = 0;
+    mutex_unlock(abr->lock);
+}
+
+bool http_abr_has_variant(http_abr_handle_t abr, const char *uri)
+{
+    AUDIO_NULL_CHECK(TAG, abr, return false);
+    AUDIO_NULL_CHECK(TAG, uri, return false);
+    bool found = false;
+    mutex_lock(abr->lock);
+    for (int i = 0; i < abr->variant_num && found == false; i++) {
+        found = (strcmp(abr->variant[i].uri, uri) == 0);
+    }
+    mutex_unlock(abr->lock);
+    return found;
+}
+
+char *http_abr_select(http_abr_handle_t abr, uint32_t prefer_bitrate)
+{
+    AUDIO_NULL_CHECK(TAG, abr, return NULL);
+    char *uri = NULL;
+    mutex_lock(abr->lock);
+    if (abr->variant_num) {
+        abr->current = 0;
+        for (int i = 1; i < abr->variant_num && abr->variant[i].bandwidth <= prefer_bitrate; i++) {
+            abr->current = i;
+        }
+        abr->up_cnt = 0;
+        abr->segments = 0;
+        // Copied under the lock, the variants may be cleared by another task
+        uri = audio_strdup(abr->variant[abr->current].uri);
+    }
+    mutex_unlock(abr->lock);
+    return uri;
+}
+
+void http_abr_set_buffer_level(http_abr_handle_t abr, int filled, int size)
+{
+    if (abr && size > 0) {
+        abr->level = (int)((int64_t)filled * 100 / size);
+    }
+}
+
+void http_abr_add_sample(http_abr_handle_t abr, int bytes, int64_t time_us)
+{
+    AUDIO_NULL_CHECK(TAG, abr, return);
+    if (bytes < HTTP_ABR_MIN_SAMPLE_BYTES) {
+        return;
+    }
+    if (time_us < HTTP_ABR_MIN_SAMPLE_US) {
+        time_us = HTTP_ABR_MIN_SAMPLE_US;
+    }
+    int64_t bps = (int64_t)bytes * 8 * 1000000 / time_us;
+    uint32_t sample = bps > UINT32_MAX ? UINT32_MAX : (uint32_t)bps;
+    mutex_lock(abr->lock);
+    if (abr->samples == 0) {
+        abr->fast = sample;
+        abr->slow = sample;
+    } else {
+        abr->fast = abr_average(abr->fast, sample, HTTP_ABR_FAST_WEIGHT);
+        abr->slow = abr_average(abr->slow, sample, HTTP_ABR_SLOW_WEIGHT);
+    }
+    abr->samples++;
+    mutex_unlock(abr->lock);
+    ESP_LOGD(TAG, "Segment %d bytes at %" PRIu32 " bps, estimate %" PRIu32 " bps", bytes, sample, abr_estimate(abr));
+}
+
+char *http_abr_check_switch(http_abr_handle_t abr)
+{
+    AUDIO_NULL_CHECK(TAG, abr, return NULL);
+    char *uri = NULL;
+    mutex_lock(abr->lock);
+    abr->segments++;
+    if (abr->variant_num > 1 && abr->samples >= HTTP_ABR_MIN_SAMPLES) {
+        uint32_t estimate = abr_estimate(abr);
+        uint64_t budget = (uint64_t)estimate * HTTP_ABR_SAFETY_PERCENT / 100;
+        int target = 0;
+        for (int i = 1; i < abr->variant_num && abr->variant[i].bandwidth <= budget; i++) {
+            target = i;
+        }
+        bool hold = abr->segments < HTTP_ABR_HOLD_SEGMENTS;
+        int next = abr->current;
+        if (target > abr->current) {
+            if (abr->level >= HTTP_ABR_UP_LEVEL && ++abr->up_cnt >= HTTP_ABR_UP_COUNT && hold == false) {
+                next = abr->current + 1;
+            }
+        } else {
+            abr->up_cnt = 0;
+            if (target < abr->current && estimate < abr->variant[abr->current].bandwidth
+                && (hold == false || abr->level < HTTP_ABR_PANIC_LEVEL)) {
+                next = target;
+            }
+        }
+        if (next != abr->current && (uri = audio_strdup(abr->variant[next].uri)) != NULL) {
+            ESP_LOGI(TAG, "Switch from %" PRIu32 " to %" PRIu32 " bps, estimate %" PRIu32 " bps, buffer %d%%",
+                     abr->variant[abr->current].bandwidth, abr->variant[next].bandwidth, estimate, abr->level);
+            abr->current = next;
+            abr->up_cnt = 0;
+            abr->segments = 0;
+            abr->switches++;
+        }
+    }
+    mutex_unlock(abr->lock);
+    return uri;
+}
+
+esp_err_t http_abr_get_info(http_abr_handle_t abr, http_stream_abr_info_t *info, uint32_t *samples, uint32_t *switches)
+{
+    AUDIO_NULL_CHECK(TAG, abr, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_ERR_INVALID_ARG);
+    esp_err_t ret = ESP_OK;
+    mutex_lock(abr->lock);
+    if (abr->variant_num == 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        info->bandwidth = abr_estimate(abr);
+        info->bitrate = abr->variant[abr->current].bandwidth;
+        info->variant = abr->current;
+        info->variant_num = abr->variant_num;
+        info->buffer_level = abr->level;
+        if (samples) {
+            *samples = abr->samples;
+        }
+        if (switches) {
+            *switches = abr->switches;
+        }
+    }
+    mutex_unlock(abr->lock);
+    return ret;
+}
+
+void http_abr_destroy(http_abr_handle_t abr)
+{
+    if (abr == NULL) {
+        return;
+    }
+    http_abr_clear(abr);
+    mutex_destroy(abr->lock);
+    audio_free(abr);
+}
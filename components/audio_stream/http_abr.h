@@ -0,0 +1,154 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _HTTP_ABR_H_
+#define _HTTP_ABR_H_
+
+#include "esp_err.h"
+#include "http_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Adaptive bitrate control for HLS master playlists
+ *
+ *         The download throughput of every segment is folded into a fast and a slow moving average,
+ *         the lower one is used as estimate. At a segment boundary a lower variant is chosen as soon as
+ *         the estimate can not sustain the current one, a higher variant only after the estimate allowed it
+ *         on consecutive boundaries and the buffer is half full, one step at a time.
+ *
+ * @note   The handle can be shared by the element task and the prefetch task
+ */
+typedef struct http_abr *http_abr_handle_t;
+
+/**
+ * @brief      Create an adaptive bitrate control
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  ABR handle
+ */
+http_abr_handle_t http_abr_create(void);
+
+/**
+ * @brief      Add a variant stream, variants are kept sorted by bandwidth
+ *
+ * @param[in]  abr        The ABR handle
+ * @param[in]  bandwidth  Declared bandwidth in bits per second
+ * @param[in]  uri        URI of the media playlist, a variant with the same URI keeps the lower bandwidth
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_NO_MEM
+ */
+esp_err_t http_abr_add_variant(http_abr_handle_t abr, uint32_t bandwidth, const char *uri);
+
+/**
+ * @brief      Remove all variants, the throughput estimate is kept
+ *
+ * @param[in]  abr  The ABR handle
+ */
+void http_abr_clear(http_abr_handle_t abr);
+
+/**
+ * @brief      Check whether a URI is the media playlist of one of the variants
+ *
+ * @param[in]  abr  The ABR handle
+ * @param[in]  uri  The URI
+ *
+ * @return
+ *     - true   The URI is a variant
+ *     - false  Unknown URI
+ */
+bool http_abr_has_variant(http_abr_handle_t abr, const char *uri);
+
+/**
+ * @brief      Select the start variant, the highest one not above `prefer_bitrate` or the lowest one
+ *
+ * @param[in]  abr             The ABR handle
+ * @param[in]  prefer_bitrate  Bitrate used before any throughput is measured
+ *
+ * @return
+ *     - NULL    No variant or out of memory
+ *     - Others  Copy of the URI of the selected media playlist, freed by the caller
+ */
+char *http_abr_select(http_abr_handle_t abr, uint32_t prefer_bitrate);
+
+/**
+ * @brief      Update the amount of buffered data
+ *
+ * @param[in]  abr     The ABR handle
+ * @param[in]  filled  Buffered bytes
+ * @param[in]  size    Total buffer size
+ */
+void http_abr_set_buffer_level(http_abr_handle_t abr, int filled, int size);
+
+/**
+ * @brief      Add the measure of one downloaded segment
+ *
+ * @param[in]  abr      The ABR handle
+ * @param[in]  bytes    Downloaded bytes, small segments are ignored
+ * @param[in]  time_us  Time spent waiting for the network
+ */
+void http_abr_add_sample(http_abr_handle_t abr, int bytes, int64_t time_us);
+
+/**
+ * @brief      Decide at a segment boundary whether to switch the variant
+ *
+ * @param[in]  abr  The ABR handle
+ *
+ * @return
+ *     - NULL    Keep the current variant
+ *     - Others  Copy of the URI of the media playlist to continue with, freed by the caller
+ */
+char *http_abr_check_switch(http_abr_handle_t abr);
+
+/**
+ * @brief      Get the current state
+ *
+ * @param[in]  abr       The ABR handle
+ * @param[out] info      The state
+ * @param[out] samples   Number of measured segments, can be NULL
+ * @param[out] switches  Number of variant switches, can be NULL
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_STATE  No variant
+ */
+esp_err_t http_abr_get_info(http_abr_handle_t abr, http_stream_abr_info_t *info, uint32_t *samples, uint32_t *switches);
+
+/**
+ * @brief      Destroy the adaptive bitrate control
+ *
+ * @param[in]  abr  The ABR handle
+ */
+void http_abr_destroy(http_abr_handle_t abr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HTTP_ABR_H_ */
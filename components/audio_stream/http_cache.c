@@ -0,0 +1,500 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "http_cache.h"
+
+static const char *TAG = "HTTP_CACHE";
+
+#define HTTP_CACHE_MAGIC        "HCI1"
+#define HTTP_CACHE_CHUNK_SIZE   (64 * 1024)
+#define HTTP_CACHE_MAX_CHUNKS   (0xFFFF)
+#define HTTP_CACHE_PATH_SIZE    (128)
+
+typedef struct {
+    char        magic[4];
+    uint32_t    chunk_size;
+    int64_t     total_size;
+    int32_t     codec_fmt;
+    uint32_t    stamp;          /*!< Last use, higher is newer */
+    uint16_t    uri_len;
+    uint16_t    chunk_num;
+} http_cache_idx_t;
+
+typedef struct {
+    uint32_t    key;
+    uint32_t    stamp;
+    int64_t     bytes;          /*!< Size of the data file, a write past its end fills the gap on FAT */
+} http_cache_item_t;
+
+struct http_cache {
+    char               *dir;
+    int64_t             budget;
+    int64_t             used;
+    uint32_t            stamp;
+    http_cache_item_t  *items;
+    int                 item_num;
+    int                 item_cap;
+};
+
+struct http_cache_entry {
+    struct http_cache  *cache;
+    char               *uri;
+    uint32_t            key;
+    http_cache_idx_t    idx;
+    uint8_t            *bitmap;
+    FILE               *fp;
+    int64_t             run_start;  /*!< Range written without gap since the last seek */
+    int64_t             run_end;
+    bool                valid;      /*!< The index matches the URI */
+};
+
+static uint32_t cache_hash(const char *uri)
+{
+    uint32_t h = 2166136261u;
+    while (*uri) {
+        h ^= (uint8_t) * uri++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void cache_path(struct http_cache *cache, uint32_t key, const char *ext, char *path)
+{
+    snprintf(path, HTTP_CACHE_PATH_SIZE, "%s/%08X.%s", cache->dir, (unsigned int)key, ext);
+}
+
+static int64_t cache_chunk_len(http_cache_idx_t *idx, int chunk)
+{
+    int64_t start = (int64_t)chunk * idx->chunk_size;
+    int64_t left = idx->total_size - start;
+    return left < idx->chunk_size ? left : idx->chunk_size;
+}
+
+static bool cache_chunk_done(const uint8_t *bitmap, int chunk)
+{
+    return bitmap[chunk >> 3] & (1 << (chunk & 7));
+}
+
+static http_cache_item_t *cache_find_item(struct http_cache *cache, uint32_t key)
+{
+    for (int i = 0; i < cache->item_num; i++) {
+        if (cache->items[i].key == key) {
+            return &cache->items[i];
+        }
+    }
+    return NULL;
+}
+
+static http_cache_item_t *cache_add_item(struct http_cache *cache, uint32_t key)
+{
+    http_cache_item_t *item = cache_find_item(cache, key);
+    if (item) {
+        return item;
+    }
+    if (cache->item_num == cache->item_cap) {
+        int cap = cache->item_cap ? cache->item_cap * 2 : 8;
+        http_cache_item_t *items = audio_realloc(cache->items, cap * sizeof(http_cache_item_t));
+        AUDIO_MEM_CHECK(TAG, items, return NULL);
+        cache->items = items;
+        cache->item_cap = cap;
+    }
+    item = &cache->items[cache->item_num++];
+    memset(item, 0, sizeof(http_cache_item_t));
+    item->key = key;
+    return item;
+}
+
+static void cache_remove_item(struct http_cache *cache, http_cache_item_t *item)
+{
+    char path[HTTP_CACHE_PATH_SIZE];
+    cache_path(cache, item->key, "idx", path);
+    remove(path);
+    cache_path(cache, item->key, "dat", path);
+    remove(path);
+    ESP_LOGD(TAG, "Evict %08X, %lld bytes", (unsigned int)item->key, (long long)item->bytes);
+    cache->used -= item->bytes;
+    *item = cache->items[--cache->item_num];
+}
+
+/* Remove the least recently used resources except `keep` until `need` more bytes fit in the budget */
+static bool cache_evict(struct http_cache *cache, uint32_t keep, int64_t need)
+{
+    while (cache->used + need > cache->budget) {
+        http_cache_item_t *victim = NULL;
+        for (int i = 0; i < cache->item_num; i++) {
+            http_cache_item_t *item = &cache->items[i];
+            if (item->key != keep && (victim == NULL || item->stamp < victim->stamp)) {
+                victim = item;
+            }
+        }
+        if (victim == NULL) {
+            return false;
+        }
+        cache_remove_item(cache, victim);
+    }
+    return true;
+}
+
+static esp_err_t cache_load_idx(struct http_cache *cache, uint32_t key, http_cache_idx_t *idx, char **uri, uint8_t **bitmap)
+{
+    char path[HTTP_CACHE_PATH_SIZE];
+    cache_path(cache, key, "idx", path);
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return ESP_FAIL;
+    }
+    esp_err_t ret = ESP_FAIL;
+    char *u = NULL;
+    uint8_t *map = NULL;
+    if (fread(idx, sizeof(http_cache_idx_t), 1, fp) != 1
+        || memcmp(idx->magic, HTTP_CACHE_MAGIC, sizeof(idx->magic))
+        || idx->chunk_size != HTTP_CACHE_CHUNK_SIZE
+        || idx->total_size <= 0
+        || idx->chunk_num != (idx->total_size + HTTP_CACHE_CHUNK_SIZE - 1) / HTTP_CACHE_CHUNK_SIZE) {
+        goto _exit;
+    }
+    u = audio_calloc(1, idx->uri_len + 1);
+    map = audio_calloc(1, (idx->chunk_num + 7) / 8);
+    AUDIO_MEM_CHECK(TAG, u && map, goto _exit);
+    size_t map_size = (idx->chunk_num + 7) / 8;
+    if (fread(u, 1, idx->uri_len, fp) != idx->uri_len || fread(map, 1, map_size, fp) != map_size) {
+        goto _exit;
+    }
+    ret = ESP_OK;
+_exit:
+    fclose(fp);
+    if (ret == ESP_OK && uri) {
+        *uri = u;
+        u = NULL;
+    }
+    if (ret == ESP_OK && bitmap) {
+        *bitmap = map;
+        map = NULL;
+    }
+    audio_free(u);
+    audio_free(map);
+    return ret;
+}
+
+static esp_err_t cache_save_idx(struct http_cache_entry *entry)
+{
+    char path[HTTP_CACHE_PATH_SIZE];
+    cache_path(entry->cache, entry->key, "idx", path);
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return ESP_FAIL;
+    }
+    size_t map_size = (entry->idx.chunk_num + 7) / 8;
+    bool ok = fwrite(&entry->idx, sizeof(http_cache_idx_t), 1, fp) == 1
+              && fwrite(entry->uri, 1, entry->idx.uri_len, fp) == entry->idx.uri_len
+              && fwrite(entry->bitmap, 1, map_size, fp) == map_size;
+    ok = (fclose(fp) == 0) && ok;
+    if (ok == false) {
+        ESP_LOGE(TAG, "Failed to write %s", path);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void cache_scan(struct http_cache *cache)
+{
+    DIR *dir = opendir(cache->dir);
+    if (dir == NULL) {
+        return;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        const char *ext = strrchr(ent->d_name, '.');
+        if (ext == NULL || strcasecmp(ext, ".idx") || ext - ent->d_name != 8) {
+            continue;
+        }
+        char *end = NULL;
+        uint32_t key = strtoul(ent->d_name, &end, 16);
+        if (end != ext) {
+            continue;
+        }
+        http_cache_idx_t idx;
+        if (cache_load_idx(cache, key, &idx, NULL, NULL) != ESP_OK) {
+            continue;
+        }
+        char path[HTTP_CACHE_PATH_SIZE];
+        struct stat st;
+        cache_path(cache, key, "dat", path);
+        http_cache_item_t *item = cache_add_item(cache, key);
+        if (item) {
+            item->stamp = idx.stamp;
+            item->bytes = stat(path, &st) == 0 ? st.st_size : 0;
+            cache->used += item->bytes;
+            if (idx.stamp > cache->stamp) {
+                cache->stamp = idx.stamp;
+            }
+        }
+    }
+    closedir(dir);
+}
+
+http_cache_handle_t http_cache_create(const char *dir, int64_t budget)
+{
+    AUDIO_NULL_CHECK(TAG, dir, return NULL);
+    AUDIO_CHECK(TAG, budget > 0, return NULL, "Invalid cache size");
+    struct stat st;
+    if (stat(dir, &st) != 0 && mkdir(dir, 0777) != 0) {
+        ESP_LOGE(TAG, "Failed to create %s", dir);
+        return NULL;
+    }
+    struct http_cache *cache = audio_calloc(1, sizeof(struct http_cache));
+    AUDIO_MEM_CHECK(TAG, cache, return NULL);
+    cache->dir = audio_strdup(dir);
+    AUDIO_MEM_CHECK(TAG, cache->dir, {
+        audio_free(cache);
+        return NULL;
+    });
+    cache->budget = budget;
+    cache_scan(cache);
+    cache_evict(cache, 0, 0);
+    ESP_LOGI(TAG, "%d cached streams, %lld/%lld bytes used", cache->item_num, (long long)cache->used, (long long)budget);
+    return cache;
+}
+
+http_cache_entry_t http_cache_open(http_cache_handle_t cache, const char *uri)
+{
+    AUDIO_NULL_CHECK(TAG, cache, return NULL);
+    AUDIO_NULL_CHECK(TAG, uri, return NULL);
+    struct http_cache_entry *entry = audio_calloc(1, sizeof(struct http_cache_entry));
+    AUDIO_MEM_CHECK(TAG, entry, return NULL);
+    entry->uri = audio_strdup(uri);
+    AUDIO_MEM_CHECK(TAG, entry->uri, {
+        audio_free(entry);
+        return NULL;
+    });
+    entry->cache = cache;
+    entry->key = cache_hash(uri);
+    entry->run_start = entry->run_end = -1;
+
+    char *saved_uri = NULL;
+    if (cache_find_item(cache, entry->key)
+        && cache_load_idx(cache, entry->key, &entry->idx, &saved_uri, &entry->bitmap) == ESP_OK) {
+        char path[HTTP_CACHE_PATH_SIZE];
+        cache_path(cache, entry->key, "dat", path);
+        if (strcmp(saved_uri, uri) == 0) {
+            entry->fp = fopen(path, "rb+");
+        }
+        if (entry->fp) {
+            entry->valid = true;
+        } else {
+            AUDIO_SAFE_FREE(entry->bitmap, audio_free);
+            memset(&entry->idx, 0, sizeof(http_cache_idx_t));
+        }
+        audio_free(saved_uri);
+    }
+    ESP_LOGD(TAG, "Open %08X %s, %s", (unsigned int)entry->key, uri, entry->valid ? "cached" : "new");
+    return entry;
+}
+
+const char *http_cache_get_uri(http_cache_entry_t entry)
+{
+    AUDIO_NULL_CHECK(TAG, entry, return NULL);
+    return entry->uri;
+}
+
+int64_t http_cache_get_size(http_cache_entry_t entry)
+{
+    AUDIO_NULL_CHECK(TAG, entry, return 0);
+    return entry->valid ? entry->idx.total_size : 0;
+}
+
+int http_cache_get_codec(http_cache_entry_t entry)
+{
+    AUDIO_NULL_CHECK(TAG, entry, return 0);
+    return entry->idx.codec_fmt;
+}
+
+esp_err_t http_cache_set_info(http_cache_entry_t entry, int64_t size, int codec_fmt)
+{
+    AUDIO_NULL_CHECK(TAG, entry, return ESP_ERR_INVALID_ARG);
+    struct http_cache *cache = entry->cache;
+    int64_t chunk_num = (size + HTTP_CACHE_CHUNK_SIZE - 1) / HTTP_CACHE_CHUNK_SIZE;
+    if (size <= 0 || chunk_num > HTTP_CACHE_MAX_CHUNKS || size > cache->budget) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    http_cache_item_t *item = cache_add_item(cache, entry->key);
+    AUDIO_MEM_CHECK(TAG, item, return ESP_ERR_NO_MEM);
+    item->stamp = ++cache->stamp;
+    if (entry->valid == false || entry->idx.total_size != size) {
+        cache->used -= item->bytes;
+        item->bytes = 0;
+        audio_free(entry->bitmap);
+        entry->bitmap = audio_calloc(1, (chunk_num + 7) / 8);
+        AUDIO_MEM_CHECK(TAG, entry->bitmap, return ESP_ERR_NO_MEM);
+        if (entry->fp) {
+            fclose(entry->fp);
+        }
+        char path[HTTP_CACHE_PATH_SIZE];
+        cache_path(cache, entry->key, "dat", path);
+        entry->fp = fopen(path, "wb+");
+        if (entry->fp == NULL) {
+            ESP_LOGE(TAG, "Failed to create %s", path);
+            entry->valid = false;
+            return ESP_FAIL;
+        }
+        memcpy(entry->idx.magic, HTTP_CACHE_MAGIC, sizeof(entry->idx.magic));
+        entry->idx.chunk_size = HTTP_CACHE_CHUNK_SIZE;
+        entry->idx.total_size = size;
+        entry->idx.uri_len = strlen(entry->uri);
+        entry->idx.chunk_num = chunk_num;
+        entry->valid = true;
+    }
+    entry->idx.codec_fmt = codec_fmt;
+    entry->idx.stamp = item->stamp;
+    entry->run_start = entry->run_end = -1;
+    return cache_save_idx(entry);
+}
+
+bool http_cache_contains(http_cache_entry_t entry, int64_t pos)
+{
+    if (entry == NULL || entry->valid == false || pos < 0 || pos >= entry->idx.total_size) {
+        return false;
+    }
+    return cache_chunk_done(entry->bitmap, pos / HTTP_CACHE_CHUNK_SIZE);
+}
+
+int http_cache_read(http_cache_entry_t entry, int64_t pos, char *buf, int len)
+{
+    if (http_cache_contains(entry, pos) == false) {
+        return 0;
+    }
+    int64_t chunk_end = (pos / HTTP_CACHE_CHUNK_SIZE + 1) * HTTP_CACHE_CHUNK_SIZE;
+    if (chunk_end > entry->idx.total_size) {
+        chunk_end = entry->idx.total_size;
+    }
+    if (len > chunk_end - pos) {
+        len = chunk_end - pos;
+    }
+    if (fseek(entry->fp, pos, SEEK_SET) != 0) {
+        return ESP_FAIL;
+    }
+    int rlen = fread(buf, 1, len, entry->fp);
+    if (rlen <= 0) {
+        ESP_LOGE(TAG, "Failed to read %s at %lld", entry->uri, (long long)pos);
+        return ESP_FAIL;
+    }
+    return rlen;
+}
+
+esp_err_t http_cache_write(http_cache_entry_t entry, int64_t pos, const char *buf, int len)
+{
+    AUDIO_NULL_CHECK(TAG, entry, return ESP_ERR_INVALID_ARG);
+    if (entry->valid == false || entry->fp == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len <= 0 || pos < 0 || pos + len > entry->idx.total_size) {
+        return ESP_OK;
+    }
+    struct http_cache *cache = entry->cache;
+    http_cache_item_t *item = cache_find_item(cache, entry->key);
+    int64_t end = pos + len;
+    if (item && end > item->bytes) {
+        /* The file grows to `end`, zeros included up to `pos`, make room for it before writing */
+        if (cache_evict(cache, entry->key, end - item->bytes) == false) {
+            item = NULL;
+        } else {
+            /* Eviction moves the items of the table */
+            item = cache_find_item(cache, entry->key);
+            cache->used += end - item->bytes;
+            item->bytes = end;
+        }
+    }
+    if (item == NULL) {
+        /* Over budget with nothing else to drop, or removed by another entry, the data stays uncached */
+        entry->run_start = entry->run_end = -1;
+        return ESP_OK;
+    }
+    if (pos != entry->run_end) {
+        entry->run_start = pos;
+    }
+    if (fseek(entry->fp, pos, SEEK_SET) != 0 || fwrite(buf, 1, len, entry->fp) != (size_t)len) {
+        ESP_LOGE(TAG, "Failed to write %s at %lld", entry->uri, (long long)pos);
+        entry->run_start = entry->run_end = -1;
+        return ESP_FAIL;
+    }
+    entry->run_end = end;
+
+    int64_t done = 0;
+    for (int i = pos / HTTP_CACHE_CHUNK_SIZE; i <= (entry->run_end - 1) / HTTP_CACHE_CHUNK_SIZE; i++) {
+        int64_t start = (int64_t)i * HTTP_CACHE_CHUNK_SIZE;
+        int64_t chunk_len = cache_chunk_len(&entry->idx, i);
+        if (cache_chunk_done(entry->bitmap, i) || entry->run_start > start || entry->run_end < start + chunk_len) {
+            continue;
+        }
+        entry->bitmap[i >> 3] |= 1 << (i & 7);
+        done += chunk_len;
+    }
+    if (done == 0) {
+        return ESP_OK;
+    }
+    /* Data first so that the index never covers bytes still in the stdio buffer */
+    fflush(entry->fp);
+    return cache_save_idx(entry);
+}
+
+void http_cache_close(http_cache_entry_t entry)
+{
+    if (entry == NULL) {
+        return;
+    }
+    if (entry->valid && entry->bitmap) {
+        http_cache_item_t *item = cache_find_item(entry->cache, entry->key);
+        if (item) {
+            item->stamp = ++entry->cache->stamp;
+            entry->idx.stamp = item->stamp;
+            cache_save_idx(entry);
+        }
+    }
+    if (entry->fp) {
+        fclose(entry->fp);
+    }
+    audio_free(entry->bitmap);
+    audio_free(entry->uri);
+    audio_free(entry);
+}
+
+void http_cache_destroy(http_cache_handle_t cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+    audio_free(cache->items);
+    audio_free(cache->dir);
+    audio_free(cache);
+}
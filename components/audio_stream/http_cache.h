@@ -0,0 +1,181 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _HTTP_CACHE_H_
+#define _HTTP_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  On-disk cache of HTTP resources
+ *
+ *         Every URI has a data file holding the bytes at their own offsets and an index file with
+ *         the content size, the codec and a bitmap of the complete chunks. Chunks are filled while the
+ *         stream plays, in any order, so replays and seeks inside cached chunks are read from the disk.
+ *         The least recently used resources are removed when the data files exceed the size budget,
+ *         a data file counts up to its highest written byte as the gaps before it take card space too.
+ *
+ * @note   A cache handle is used by one task, two handles should not share a directory
+ */
+typedef struct http_cache *http_cache_handle_t;
+
+/**
+ * @brief  A cached resource
+ */
+typedef struct http_cache_entry *http_cache_entry_t;
+
+/**
+ * @brief      Create a cache in a directory, the directory is created if needed
+ *
+ * @param[in]  dir     Directory path, e.g. "/sdcard/cache"
+ * @param[in]  budget  Maximum cached bytes
+ *
+ * @return
+ *     - NULL    Out of memory or the directory is not usable
+ *     - Others  Cache handle
+ */
+http_cache_handle_t http_cache_create(const char *dir, int64_t budget);
+
+/**
+ * @brief      Open the entry of a URI, nothing is written before `http_cache_set_info`
+ *
+ * @param[in]  cache  The cache handle
+ * @param[in]  uri    The URI
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  Entry handle
+ */
+http_cache_entry_t http_cache_open(http_cache_handle_t cache, const char *uri);
+
+/**
+ * @brief      Get the URI of an entry
+ *
+ * @param[in]  entry  The entry handle
+ *
+ * @return     The URI
+ */
+const char *http_cache_get_uri(http_cache_entry_t entry);
+
+/**
+ * @brief      Get the content size of an entry
+ *
+ * @param[in]  entry  The entry handle
+ *
+ * @return     Content size in bytes, 0 when unknown
+ */
+int64_t http_cache_get_size(http_cache_entry_t entry);
+
+/**
+ * @brief      Get the codec format of an entry
+ *
+ * @param[in]  entry  The entry handle
+ *
+ * @return     The `esp_codec_type_t` stored by `http_cache_set_info`
+ */
+int http_cache_get_codec(http_cache_entry_t entry);
+
+/**
+ * @brief      Set the content size and codec, the cached data is dropped when the size changed
+ *
+ * @param[in]  entry      The entry handle
+ * @param[in]  size       Content size in bytes
+ * @param[in]  codec_fmt  The `esp_codec_type_t` of the content
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_NOT_SUPPORTED  Size unknown or too large
+ *     - ESP_FAIL               Failed to write the index
+ */
+esp_err_t http_cache_set_info(http_cache_entry_t entry, int64_t size, int codec_fmt);
+
+/**
+ * @brief      Check whether the byte at `pos` is cached
+ *
+ * @param[in]  entry  The entry handle
+ * @param[in]  pos    Byte position
+ *
+ * @return
+ *     - true   Cached
+ *     - false  Not cached
+ */
+bool http_cache_contains(http_cache_entry_t entry, int64_t pos);
+
+/**
+ * @brief      Read cached data, at most up to the end of the chunk holding `pos`
+ *
+ * @param[in]  entry  The entry handle
+ * @param[in]  pos    Byte position
+ * @param[out] buf    Output buffer
+ * @param[in]  len    Buffer size
+ *
+ * @return
+ *     - > 0       Bytes read
+ *     - 0         Not cached
+ *     - ESP_FAIL  Failed to read the data file
+ */
+int http_cache_read(http_cache_entry_t entry, int64_t pos, char *buf, int len);
+
+/**
+ * @brief      Write data received from the network
+ *
+ *             A chunk is complete once it was written from its start to its end without gap.
+ *
+ * @param[in]  entry  The entry handle
+ * @param[in]  pos    Byte position of `buf`
+ * @param[in]  buf    Data
+ * @param[in]  len    Data length
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_STATE  The content size is not set
+ *     - ESP_FAIL               Failed to write the data file
+ */
+esp_err_t http_cache_write(http_cache_entry_t entry, int64_t pos, const char *buf, int len);
+
+/**
+ * @brief      Save the index and close an entry
+ *
+ * @param[in]  entry  The entry handle
+ */
+void http_cache_close(http_cache_entry_t entry);
+
+/**
+ * @brief      Destroy the cache handle, the files are kept
+ *
+ * @param[in]  cache  The cache handle
+ */
+void http_cache_destroy(http_cache_handle_t cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HTTP_CACHE_H_ */
@@ -0,0 +1,211 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "audio_idf_version.h"
+#include "http_conn_pool.h"
+
+static const char *TAG = "HTTP_CONN_POOL";
+
+#define HTTP_CONN_KEY_SIZE  (96)
+
+typedef struct {
+    esp_http_client_handle_t    client;
+    char                        key[HTTP_CONN_KEY_SIZE];    /*!< Scheme, host and port */
+    uint32_t                    last_used;
+    bool                        connected;                  /*!< The socket is open */
+    bool                        must_close;                 /*!< The server answered `Connection: close` */
+} http_conn_t;
+
+struct http_conn_pool {
+    esp_http_client_config_t    cfg;
+    http_event_handle_cb        event_handler;  /*!< Handler of the user, called behind the pool one */
+    void                       *user_data;
+    uint32_t                    use_cnt;
+    int                         size;
+    http_conn_t                 conn[];
+};
+
+static void conn_pool_key(const char *url, char *key)
+{
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    p += strcspn(p, "/?#");
+    int len = p - url;
+    if (len >= HTTP_CONN_KEY_SIZE) {
+        len = HTTP_CONN_KEY_SIZE - 1;
+    }
+    memcpy(key, url, len);
+    key[len] = '\0';
+}
+
+static http_conn_t *conn_pool_find(struct http_conn_pool *pool, esp_http_client_handle_t client)
+{
+    for (int i = 0; i < pool->size; i++) {
+        if (pool->conn[i].client == client) {
+            return &pool->conn[i];
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t conn_pool_event(esp_http_client_event_t *evt)
+{
+    struct http_conn_pool *pool = (struct http_conn_pool *)evt->user_data;
+    http_conn_t *conn = conn_pool_find(pool, evt->client);
+    if (conn) {
+        if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+            conn->connected = true;
+        } else if (evt->event_id == HTTP_EVENT_DISCONNECTED) {
+            conn->connected = false;
+        } else if (evt->event_id == HTTP_EVENT_ON_HEADER
+                   && strcasecmp(evt->header_key, "Connection") == 0
+                   && strcasecmp(evt->header_value, "close") == 0) {
+            conn->must_close = true;
+        }
+    }
+    if (pool->event_handler == NULL) {
+        return ESP_OK;
+    }
+    evt->user_data = pool->user_data;
+    esp_err_t ret = pool->event_handler(evt);
+    evt->user_data = pool;
+    return ret;
+}
+
+http_conn_pool_handle_t http_conn_pool_create(const esp_http_client_config_t *config, int size)
+{
+    AUDIO_NULL_CHECK(TAG, config, return NULL);
+    AUDIO_CHECK(TAG, size > 0, return NULL, "Invalid pool size");
+    struct http_conn_pool *pool = audio_calloc(1, sizeof(struct http_conn_pool) + size * sizeof(http_conn_t));
+    AUDIO_MEM_CHECK(TAG, pool, return NULL);
+    memcpy(&pool->cfg, config, sizeof(esp_http_client_config_t));
+    pool->event_handler = config->event_handler;
+    pool->user_data = config->user_data;
+    pool->cfg.event_handler = conn_pool_event;
+    pool->cfg.user_data = pool;
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)) && defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+    pool->cfg.save_client_session = true;
+#endif
+    pool->size = size;
+    return pool;
+}
+
+esp_http_client_handle_t http_conn_pool_get(http_conn_pool_handle_t pool, const char *url, bool *reused)
+{
+    AUDIO_NULL_CHECK(TAG, pool, return NULL);
+    AUDIO_NULL_CHECK(TAG, url, return NULL);
+    char key[HTTP_CONN_KEY_SIZE];
+    conn_pool_key(url, key);
+
+    http_conn_t *conn = NULL;
+    http_conn_t *victim = &pool->conn[0];
+    for (int i = 0; i < pool->size; i++) {
+        http_conn_t *c = &pool->conn[i];
+        if (c->client && strcasecmp(c->key, key) == 0) {
+            conn = c;
+            break;
+        }
+        if (victim->client && (c->client == NULL || c->last_used < victim->last_used)) {
+            victim = c;
+        }
+    }
+    bool keep = false;
+    if (conn) {
+        keep = http_conn_pool_finish(pool, conn->client);
+        esp_http_client_set_url(conn->client, url);
+    } else {
+        conn = victim;
+        if (conn->client) {
+            ESP_LOGD(TAG, "Drop connection to %s", conn->key);
+            esp_http_client_cleanup(conn->client);
+        }
+        pool->cfg.url = url;
+        conn->client = esp_http_client_init(&pool->cfg);
+        pool->cfg.url = NULL;
+        AUDIO_MEM_CHECK(TAG, conn->client, return NULL);
+        esp_http_client_set_header(conn->client, "Connection", "keep-alive");
+        strcpy(conn->key, key);
+        conn->connected = false;
+    }
+    ESP_LOGD(TAG, "%s %s", keep ? "Reuse connection to" : "Connect to", key);
+    conn->last_used = ++pool->use_cnt;
+    conn->must_close = false;
+    if (reused) {
+        *reused = keep;
+    }
+    return conn->client;
+}
+
+bool http_conn_pool_finish(http_conn_pool_handle_t pool, esp_http_client_handle_t client)
+{
+    AUDIO_NULL_CHECK(TAG, pool, return false);
+    http_conn_t *conn = conn_pool_find(pool, client);
+    if (conn == NULL) {
+        if (client) {
+            esp_http_client_close(client);
+        }
+        return false;
+    }
+    bool keep = conn->connected && conn->must_close == false;
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0))
+    keep = keep && esp_http_client_is_complete_data_received(client);
+#else
+    keep = false;
+#endif
+    if (keep == false) {
+        esp_http_client_close(client);
+    }
+    return keep;
+}
+
+void http_conn_pool_close_all(http_conn_pool_handle_t pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    for (int i = 0; i < pool->size; i++) {
+        if (pool->conn[i].client) {
+            esp_http_client_close(pool->conn[i].client);
+        }
+    }
+}
+
+void http_conn_pool_destroy(http_conn_pool_handle_t pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    for (int i = 0; i < pool->size; i++) {
+        if (pool->conn[i].client) {
+            esp_http_client_cleanup(pool->conn[i].client);
+        }
+    }
+    audio_free(pool);
+}
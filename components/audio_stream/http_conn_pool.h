@@ -0,0 +1,110 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _HTTP_CONN_POOL_H_
+#define _HTTP_CONN_POOL_H_
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Persistent HTTP connections keyed by scheme, host and port
+ *
+ *         Every host keeps its own client, so switching between the playlist, key and segment servers
+ *         does not tear the other connections down. A connection is left open after a response whose body
+ *         was read completely, and the next request to the same host is sent on it without a new TCP or
+ *         TLS handshake. When a reconnect is needed, the client handle is kept so TLS session tickets can
+ *         be used for resumption when they are enabled.
+ *
+ * @note   A pool is not thread safe, each task uses its own
+ */
+typedef struct http_conn_pool *http_conn_pool_handle_t;
+
+/**
+ * @brief      Create a connection pool
+ *
+ * @param[in]  config  Template used to create the clients, `url` is replaced by the requested one
+ * @param[in]  size    Number of hosts kept connected at the same time
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  Pool handle
+ */
+http_conn_pool_handle_t http_conn_pool_create(const esp_http_client_config_t *config, int size);
+
+/**
+ * @brief      Get the client for `url` and point it to `url`
+ *
+ *             The previous response of that client is finished with `http_conn_pool_finish`,
+ *             and the least recently used host is dropped when the pool is full.
+ *
+ * @param[in]  pool    The pool handle
+ * @param[in]  url     The URL to request
+ * @param[out] reused  Set to true when the request goes out on a kept connection, can be NULL
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  Client handle, owned by the pool
+ */
+esp_http_client_handle_t http_conn_pool_get(http_conn_pool_handle_t pool, const char *url, bool *reused);
+
+/**
+ * @brief      Finish the current response of a client before its next request
+ *
+ *             The connection is kept when the body was fully read and the server did not ask to close it,
+ *             otherwise it is closed. A kept connection may still have been dropped by the server meanwhile,
+ *             so a failed request on it should be retried once on a new connection.
+ *
+ * @param[in]  pool    The pool handle
+ * @param[in]  client  Client returned by `http_conn_pool_get`
+ *
+ * @return
+ *     - true   The next request reuses the open connection
+ *     - false  The next request opens a new connection
+ */
+bool http_conn_pool_finish(http_conn_pool_handle_t pool, esp_http_client_handle_t client);
+
+/**
+ * @brief      Close all connections, the clients are kept for later requests
+ *
+ * @param[in]  pool  The pool handle
+ */
+void http_conn_pool_close_all(http_conn_pool_handle_t pool);
+
+/**
+ * @brief      Close the connections and destroy the pool
+ *
+ * @param[in]  pool  The pool handle
+ */
+void http_conn_pool_destroy(http_conn_pool_handle_t pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HTTP_CONN_POOL_H_ */
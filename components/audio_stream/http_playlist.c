@@ -27,6 +27,7 @@
 #include <string.h>
 #include "join_path.h"
 #include "audio_mem.h"
+#include "audio_mutex.h"
 
 #include "http_playlist.h"
 #include "esp_log.h"
@@ -34,118 +35,408 @@
 
 static const char *TAG = "HLS_PLAYLIST";
 
-#define MAX_PLAYLIST_TRACKS (128)
-#define MAX_PLAYLIST_KEEP_TRACKS (18)
+#define MAX_PLAYLIST_TRACKS         (128)
+#define MAX_PLAYLIST_KEEP_TRACKS    (18)
+#define PLAYLIST_TRACK_RING         (MAX_PLAYLIST_TRACKS + 2)
+#define PLAYLIST_INDEX_SIZE         (256)   /* Power of two, twice the track ring at least */
+#define PLAYLIST_INDEX_EMPTY        (0xFF)
+#define PLAYLIST_ARENA_SIZE         (4 * 1024)
+#define PLAYLIST_RELATIVE_SEED      (0x9E3779B9)
 
 typedef struct track_ {
-    char *uri;
-    bool is_played;
-    STAILQ_ENTRY(track_) next;
+    uint32_t    hash;           /* Hash of the key, the track URI without the shared base */
+    uint32_t    offset;         /* Position of the key in the arena */
+    uint16_t    len;            /* Key length */
+    bool        is_relative;    /* The key follows the shared base */
+    bool        is_played;
 } track_t;
 
+/*
+ * The tracks are a ring in playing order, they are only removed from the head, so their keys
+ * are stored in the same order in the arena. Refreshing a live playlist looks up the index
+ * and appends the new segments, without any allocation once the arena has grown to the window.
+ */
+struct http_playlist_store {
+    track_t     tracks[PLAYLIST_TRACK_RING];
+    int         head;                           /* Ring position of the first track */
+    uint8_t     index[PLAYLIST_INDEX_SIZE];     /* Linear probing table of ring positions */
+    char        *arena;
+    int         arena_size;
+    int         arena_used;
+    char        *base;                          /* Directory of `host_uri` shared by relative tracks */
+    int         base_len;
+    int         base_size;
+};
+
+static inline track_t *_track_at(struct http_playlist_store *store, int i)
+{
+    return &store->tracks[(store->head + i) % PLAYLIST_TRACK_RING];
+}
+
+static uint32_t _key_hash(const char *key, int len, bool is_relative)
+{
+    uint32_t hash = is_relative ? 2166136261u ^ PLAYLIST_RELATIVE_SEED : 2166136261u;
+    for (int i = 0; i < len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int _base_len(const char *host_uri)
+{
+    const char *slash = host_uri ? strrchr(host_uri, '/') : NULL;
+    return slash ? slash - host_uri + 1 : 0;
+}
+
+static bool _grow(char **buf, int *size, int need)
+{
+    if (need <= *size) {
+        return true;
+    }
+    int new_size = *size ? *size : 64;
+    while (new_size < need) {
+        new_size *= 2;
+    }
+    char *p = audio_realloc(*buf, new_size);
+    if (p == NULL) {
+        return false;
+    }
+    *buf = p;
+    *size = new_size;
+    return true;
+}
+
+static int _index_find(struct http_playlist_store *store, uint32_t hash, const char *key, int len, bool is_relative)
+{
+    for (int i = hash & (PLAYLIST_INDEX_SIZE - 1);; i = (i + 1) & (PLAYLIST_INDEX_SIZE - 1)) {
+        uint8_t pos = store->index[i];
+        if (pos == PLAYLIST_INDEX_EMPTY) {
+            return -1;
+        }
+        track_t *track = &store->tracks[pos];
+        if (track->hash == hash && track->len == len && track->is_relative == is_relative
+            && memcmp(store->arena + track->offset, key, len) == 0) {
+            return pos;
+        }
+    }
+}
+
+static void _index_add(struct http_playlist_store *store, uint8_t pos)
+{
+    int i = store->tracks[pos].hash & (PLAYLIST_INDEX_SIZE - 1);
+    while (store->index[i] != PLAYLIST_INDEX_EMPTY) {
+        i = (i + 1) & (PLAYLIST_INDEX_SIZE - 1);
+    }
+    store->index[i] = pos;
+}
+
+static void _index_remove(struct http_playlist_store *store, uint8_t pos)
+{
+    int i = store->tracks[pos].hash & (PLAYLIST_INDEX_SIZE - 1);
+    while (store->index[i] != pos) {
+        i = (i + 1) & (PLAYLIST_INDEX_SIZE - 1);
+    }
+    store->index[i] = PLAYLIST_INDEX_EMPTY;
+    // Shift back the following entries of the cluster which can no longer be reached
+    for (int j = (i + 1) & (PLAYLIST_INDEX_SIZE - 1); store->index[j] != PLAYLIST_INDEX_EMPTY; j = (j + 1) & (PLAYLIST_INDEX_SIZE - 1)) {
+        int home = store->tracks[store->index[j]].hash & (PLAYLIST_INDEX_SIZE - 1);
+        if (((j - home) & (PLAYLIST_INDEX_SIZE - 1)) >= ((j - i) & (PLAYLIST_INDEX_SIZE - 1))) {
+            store->index[i] = store->index[j];
+            store->index[j] = PLAYLIST_INDEX_EMPTY;
+            i = j;
+        }
+    }
+}
+
+static void _remove_head(http_playlist_t *playlist)
+{
+    struct http_playlist_store *store = playlist->store;
+    ESP_LOGD(TAG, "Remove track %llu", playlist->sequence);
+    _index_remove(store, store->head);
+    store->head = (store->head + 1) % PLAYLIST_TRACK_RING;
+    playlist->total_tracks--;
+    playlist->sequence++;
+    if (playlist->total_tracks == 0) {
+        store->arena_used = 0;
+    }
+}
+
+static bool _arena_append(struct http_playlist_store *store, int total_tracks, const char *key, int len, uint32_t *offset)
+{
+    if (store->arena_used + len > store->arena_size) {
+        // Drop the keys of the removed head tracks
+        int first = total_tracks ? (int)_track_at(store, 0)->offset : store->arena_used;
+        memmove(store->arena, store->arena + first, store->arena_used - first);
+        store->arena_used -= first;
+        for (int i = 0; i < total_tracks; i++) {
+            _track_at(store, i)->offset -= first;
+        }
+        if (_grow(&store->arena, &store->arena_size, store->arena_used + len) == false) {
+            return false;
+        }
+    }
+    memcpy(store->arena + store->arena_used, key, len);
+    *offset = store->arena_used;
+    store->arena_used += len;
+    return true;
+}
+
+/* The joined URI is a copy owned by the caller, the arena moves on the next insert */
+static char *_track_uri(struct http_playlist_store *store, track_t *track)
+{
+    int base_len = track->is_relative ? store->base_len : 0;
+    char *uri = audio_malloc(base_len + track->len + 1);
+    if (uri == NULL) {
+        ESP_LOGE(TAG, "Error join URI of track");
+        return NULL;
+    }
+    memcpy(uri, store->base, base_len);
+    memcpy(uri + base_len, store->arena + track->offset, track->len);
+    uri[base_len + track->len] = 0;
+    return uri;
+}
+
+static struct http_playlist_store *_store_get(http_playlist_t *playlist)
+{
+    if (playlist->store == NULL) {
+        struct http_playlist_store *store = audio_calloc(1, sizeof(struct http_playlist_store));
+        if (store == NULL) {
+            return NULL;
+        }
+        store->arena = audio_malloc(PLAYLIST_ARENA_SIZE);
+        if (store->arena == NULL) {
+            audio_free(store);
+            return NULL;
+        }
+        store->arena_size = PLAYLIST_ARENA_SIZE;
+        memset(store->index, PLAYLIST_INDEX_EMPTY, sizeof(store->index));
+        playlist->store = store;
+    }
+    return playlist->store;
+}
+
 static void hls_remove_played_entry(http_playlist_t *playlist)
 {
-    track_t *track;
     /* Remove head entry if total_entries are > MAX_PLAYLIST_KEEP_TRACKS */
     if (playlist->total_tracks > MAX_PLAYLIST_KEEP_TRACKS) {
-        track = STAILQ_FIRST(&playlist->tracks);
-        if (track->is_played) {
-            STAILQ_REMOVE_HEAD(&playlist->tracks, next);
-            audio_free(track->uri);
-            audio_free(track);
-            playlist->total_tracks--;
+        if (_track_at(playlist->store, 0)->is_played) {
+            _remove_head(playlist);
         }
     }
 }
 
-void http_playlist_insert(http_playlist_t *playlist, char *track_uri)
+void http_playlist_lock(http_playlist_t *playlist)
+{
+    if (playlist->lock) {
+        mutex_lock(playlist->lock);
+    }
+}
+
+void http_playlist_unlock(http_playlist_t *playlist)
+{
+    if (playlist->lock) {
+        mutex_unlock(playlist->lock);
+    }
+}
+
+static bool _playlist_insert(http_playlist_t *playlist, char *track_uri)
 {
-    track_t *track;
     const char *host_uri = (const char *) playlist->host_uri;
+    bool added = false;
     ESP_LOGD(TAG, "Insert url %s\n", track_uri);
+    struct http_playlist_store *store = _store_get(playlist);
+    if (store == NULL) {
+        ESP_LOGE(TAG, "Error insert URI to playlist");
+        return false;
+    }
     while (playlist->total_tracks > MAX_PLAYLIST_TRACKS) {
-        track = STAILQ_FIRST(&playlist->tracks);
-        if (track == NULL) {
-            break;
+        _remove_head(playlist);
+    }
+    if (playlist->total_tracks == 0) {
+        // The tracks are stored after the directory of the playlist they come from
+        int base_len = _base_len(host_uri);
+        if (_grow(&store->base, &store->base_size, base_len + 1) == false) {
+            base_len = 0;
+        } else if (base_len) {
+            memcpy(store->base, host_uri, base_len);
+        }
+        store->base_len = base_len;
+    }
+
+    // Relative names in the playlist directory are the key as they are, any other form is joined first
+    const char *key = track_uri;
+    char *joined = NULL;
+    bool is_relative = false;
+    if (strncmp(track_uri, "http", 4)) {
+        bool plain_name = strchr("/.#?", track_uri[0]) == NULL
+                          && (strncmp(host_uri ? host_uri : "", "http", 4) == 0 || strchr(track_uri, '?') == NULL);
+        int base_len = _base_len(host_uri);
+        if (plain_name && base_len && base_len == store->base_len && memcmp(host_uri, store->base, base_len) == 0) {
+            is_relative = true;
+        } else if (host_uri) {
+            key = joined = join_url((char *)host_uri, track_uri);
+        } else {
+            key = NULL;
         }
-        STAILQ_REMOVE(&playlist->tracks, track, track_, next);
-        ESP_LOGD(TAG, "Remove %s", track->uri);
-        audio_free(track->uri);
-        audio_free(track);
-        playlist->total_tracks --;
-    }
-    track = audio_calloc(1, sizeof(track_t));
-    if (track == NULL) {
-        return;
-    }
-    if (strstr(track_uri, "http") == track_uri) { // Full URI
-        track->uri = audio_strdup(track_uri);
-    } else {
-        track->uri = join_url((char*)host_uri, track_uri);
     }
-    if (track->uri == NULL) {
+    if (key == NULL) {
         ESP_LOGE(TAG, "Error insert URI to playlist");
-        audio_free(track);
-        return;
+        return false;
     }
-
-    track_t *find = NULL;
-    STAILQ_FOREACH(find, &playlist->tracks, next) {
-        if (strcmp(find->uri, track->uri) == 0) {
-            ESP_LOGD(TAG, "URI exist");
-            audio_free(track->uri);
-            audio_free(track);
-            return;
+    if (is_relative == false && store->base_len && strncmp(key, store->base, store->base_len) == 0) {
+        key += store->base_len;
+        is_relative = true;
+    }
+    int len = strlen(key);
+    uint32_t hash = _key_hash(key, len, is_relative);
+    if (len > UINT16_MAX) {
+        ESP_LOGE(TAG, "Error insert URI to playlist, too long");
+    } else if (_index_find(store, hash, key, len, is_relative) >= 0) {
+        ESP_LOGD(TAG, "URI exist");
+    } else {
+        int pos = (store->head + playlist->total_tracks) % PLAYLIST_TRACK_RING;
+        track_t *track = &store->tracks[pos];
+        if (_arena_append(store, playlist->total_tracks, key, len, &track->offset)) {
+            track->hash = hash;
+            track->len = len;
+            track->is_relative = is_relative;
+            track->is_played = false;
+            _index_add(store, pos);
+            playlist->total_tracks++;
+            added = true;
+            ESP_LOGD(TAG, "INSERT %s", track_uri);
+            hls_remove_played_entry(playlist);
+        } else {
+            ESP_LOGE(TAG, "Error insert URI to playlist");
         }
     }
+    audio_free(joined);
+    return added;
+}
 
-    ESP_LOGD(TAG, "INSERT %s", track->uri);
-    STAILQ_INSERT_TAIL(&playlist->tracks, track, next);
-    playlist->total_tracks++;
-    hls_remove_played_entry(playlist);
+bool http_playlist_insert(http_playlist_t *playlist, char *track_uri)
+{
+    http_playlist_lock(playlist);
+    bool added = _playlist_insert(playlist, track_uri);
+    http_playlist_unlock(playlist);
+    return added;
 }
 
 char* http_playlist_get_next_track(http_playlist_t *playlist)
 {
-    track_t *track;
-    hls_remove_played_entry(playlist);
+    char *uri = NULL;
+    http_playlist_lock(playlist);
+    if (playlist->total_tracks) {
+        hls_remove_played_entry(playlist);
+    }
     /* Find not played entry. */
-    STAILQ_FOREACH(track, &playlist->tracks, next) {
+    for (int i = 0; i < playlist->total_tracks; i++) {
+        track_t *track = _track_at(playlist->store, i);
         if (!track->is_played) {
             track->is_played = true;
-            return track->uri;
+            uri = _track_uri(playlist->store, track);
+            break;
         }
     }
-    return NULL;
+    http_playlist_unlock(playlist);
+    return uri;
 }
 
 char* http_playlist_get_last_track(http_playlist_t *playlist)
 {
-    track_t *track;
-    char* uri = NULL;
-    STAILQ_FOREACH(track, &playlist->tracks, next) {
+    track_t *last = NULL;
+    http_playlist_lock(playlist);
+    for (int i = 0; i < playlist->total_tracks; i++) {
+        track_t *track = _track_at(playlist->store, i);
         if (!track->is_played) {
             break;
-        } else {
-            uri = track->uri;
         }
+        last = track;
     }
+    char *uri = last ? _track_uri(playlist->store, last) : NULL;
+    http_playlist_unlock(playlist);
     return uri;
 }
 
-void http_playlist_clear(http_playlist_t *playlist)
+void http_playlist_set_sequence(http_playlist_t *playlist, uint64_t sequence)
 {
-    track_t *track, *tmp;
-    STAILQ_FOREACH_SAFE(track, &playlist->tracks, next, tmp) {
-        STAILQ_REMOVE(&playlist->tracks, track, track_, next);
-        audio_free(track->uri);
-        audio_free(track);
+    http_playlist_lock(playlist);
+    playlist->sequence = sequence;
+    http_playlist_unlock(playlist);
+}
+
+uint64_t http_playlist_get_next_sequence(http_playlist_t *playlist)
+{
+    http_playlist_lock(playlist);
+    uint64_t sequence = playlist->sequence;
+    for (int i = 0; i < playlist->total_tracks; i++) {
+        if (!_track_at(playlist->store, i)->is_played) {
+            break;
+        }
+        sequence++;
+    }
+    http_playlist_unlock(playlist);
+    return sequence;
+}
+
+void http_playlist_skip_to(http_playlist_t *playlist, uint64_t sequence)
+{
+    http_playlist_lock(playlist);
+    uint64_t cur = playlist->sequence;
+    for (int i = 0; i < playlist->total_tracks; i++) {
+        if (cur++ >= sequence) {
+            break;
+        }
+        _track_at(playlist->store, i)->is_played = true;
+    }
+    http_playlist_unlock(playlist);
+}
+
+static void _playlist_clear_tracks(http_playlist_t *playlist)
+{
+    struct http_playlist_store *store = playlist->store;
+    if (store) {
+        // The storage is kept for the next playlist
+        memset(store->index, PLAYLIST_INDEX_EMPTY, sizeof(store->index));
+        store->head = 0;
+        store->arena_used = 0;
     }
+    playlist->total_tracks = 0;
+    playlist->sequence = 0;
+}
+
+void http_playlist_set_host_uri(http_playlist_t *playlist, char *host_uri, bool clear)
+{
+    http_playlist_lock(playlist);
+    if (clear) {
+        _playlist_clear_tracks(playlist);
+    }
+    audio_free(playlist->host_uri);
+    playlist->host_uri = host_uri;
+    http_playlist_unlock(playlist);
+}
 
+void http_playlist_clear(http_playlist_t *playlist)
+{
+    http_playlist_lock(playlist);
+    _playlist_clear_tracks(playlist);
     if (playlist->host_uri) {
         audio_free(playlist->host_uri);
         playlist->host_uri = NULL;
     }
     playlist->is_incomplete = false;
-    playlist->total_tracks = 0;
+    http_playlist_unlock(playlist);
+}
+
+void http_playlist_deinit(http_playlist_t *playlist)
+{
+    http_playlist_clear(playlist);
+    struct http_playlist_store *store = playlist->store;
+    if (store) {
+        audio_free(store->arena);
+        audio_free(store->base);
+        audio_free(store);
+        playlist->store = NULL;
+    }
 }
@@ -31,28 +31,46 @@ extern "C" {
 
 #include "esp_err.h"
 #include "stdbool.h"
-#include "sys/queue.h"
+#include "stdint.h"
 
-struct track_; // Forward declaration
-typedef STAILQ_HEAD(track_list, track_) track_list_t;
+struct http_playlist_store; // Forward declaration
 
 typedef struct {
     char            *host_uri;
     char            *data;
     int             index;
-    track_list_t    tracks;
+    struct http_playlist_store *store;   /*!< Tracks, their URIs and the lookup index, created on first insert */
     int             total_tracks;
     bool            is_incomplete;       /*!< Indicates if playlist is live stream and must be fetched again */
+    uint64_t        sequence;            /*!< Media sequence number of the first track */
+    void            *lock;               /*!< Taken by the functions below, can be NULL when the playlist is used by one task */
 } http_playlist_t;
 
+/**
+ * @brief       Lock the playlist, around direct accesses to its fields from a task sharing it
+ *
+ * @note        The functions below must not be called with the lock held
+ *
+ * @param       playlist: Playlist handle
+ */
+void http_playlist_lock(http_playlist_t *playlist);
+
+/**
+ * @brief       Unlock the playlist
+ *
+ * @param       playlist: Playlist handle
+ */
+void http_playlist_unlock(http_playlist_t *playlist);
+
 /**
  * @brief       Insert a track into hls_playlist
  *
  * @param       playlist: Playlist handle
  * @param       track_uri: Track URI to be inserted in playlist
  *
+ * @return      true if the track was added, false if it was already in the playlist or on error
  */
-void http_playlist_insert(http_playlist_t *playlist, char *track_uri);
+bool http_playlist_insert(http_playlist_t *playlist, char *track_uri);
 
 /**
  * @brief       Get next not-played track from playlist
@@ -63,7 +81,7 @@ void http_playlist_insert(http_playlist_t *playlist, char *track_uri);
  *      - NULL: If no playable track
  *      - Others: Playable track
  *
- * @note        returned track must `not` be freed by application
+ * @note        returned track is a copy, it must be freed with `audio_free` by the caller
  */
 char *http_playlist_get_next_track(http_playlist_t *playlist);
 
@@ -76,10 +94,46 @@ char *http_playlist_get_next_track(http_playlist_t *playlist);
  *      - NULL: If no playable track
  *      - Others: Playable track
  *
- * @note        returned track must `not` be freed by application
+ * @note        returned track is a copy, it must be freed with `audio_free` by the caller
  */
 char *http_playlist_get_last_track(http_playlist_t *playlist);
 
+/**
+ * @brief       Set media sequence number of the first track in playlist
+ *
+ * @param       playlist: Playlist handle
+ * @param       sequence: Media sequence number
+ */
+void http_playlist_set_sequence(http_playlist_t *playlist, uint64_t sequence);
+
+/**
+ * @brief       Get media sequence number of the next not-played track
+ *
+ * @param       playlist: Playlist handle
+ *
+ * @return      Media sequence number, one after the last track if all tracks are played
+ */
+uint64_t http_playlist_get_next_sequence(http_playlist_t *playlist);
+
+/**
+ * @brief       Mark the tracks before a media sequence number as played
+ *
+ *              Used to continue at the same position in another variant of the stream.
+ *
+ * @param       playlist: Playlist handle
+ * @param       sequence: Media sequence number of the next track to play
+ */
+void http_playlist_skip_to(http_playlist_t *playlist, uint64_t sequence);
+
+/**
+ * @brief       Replace the URI the tracks are relative to
+ *
+ * @param       playlist: Playlist handle
+ * @param       host_uri: New playlist URI, allocated with `audio_malloc`, owned by the playlist afterwards
+ * @param       clear: Also clear the tracks, the live state of the playlist is kept
+ */
+void http_playlist_set_host_uri(http_playlist_t *playlist, char *host_uri, bool clear);
+
 /**
  * @brief       Clear all the tracks from playlist
  *
@@ -88,6 +142,14 @@ char *http_playlist_get_last_track(http_playlist_t *playlist);
  */
 void http_playlist_clear(http_playlist_t *playlist);
 
+/**
+ * @brief       Clear the playlist and release the storage of its tracks
+ *
+ * @param       playlist: Playlist handle
+ *
+ */
+void http_playlist_deinit(http_playlist_t *playlist);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,388 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "audio_thread.h"
+#include "audio_idf_version.h"
+#include "ringbuf.h"
+#include "hls_playlist.h"
+#include "http_prefetch.h"
+#include "http_conn_pool.h"
+
+static const char *TAG = "HTTP_PREFETCH";
+
+#define HTTP_PREFETCH_CHUNK_SIZE    (1024)
+#define HTTP_PREFETCH_BUFFER_SIZE   (2048)
+#define HTTP_PREFETCH_TIMEOUT_MS    (10 * 1000)
+#define HTTP_PREFETCH_RETRY_TIMES   (3)
+#define HTTP_PREFETCH_RETRY_WAIT_MS (500)
+#define HTTP_PREFETCH_POOL_SIZE     (2)     /* Segment and playlist hosts */
+#define HTTP_PREFETCH_MAX_REDIRECT  (5)
+
+#define PREFETCH_STOP_BIT           BIT0
+#define PREFETCH_EXIT_BIT           BIT1
+
+struct http_prefetch {
+    http_prefetch_cfg_t         cfg;
+    ringbuf_handle_t            rb;
+    EventGroupHandle_t          state;
+    http_conn_pool_handle_t     pool;
+    esp_http_client_handle_t    client;         /*!< Client of the current request */
+    http_playlist_t            *playlist;
+    int                         target_ms;      /*!< Live reload period, 0 for VOD */
+    int                         new_tracks;     /*!< Tracks added by the last reload */
+    char                       *chunk;
+    volatile bool               running;
+    volatile bool               failed;
+};
+
+static http_conn_pool_handle_t http_prefetch_pool(struct http_prefetch *pf)
+{
+    esp_http_client_config_t http_cfg = {
+        .timeout_ms = HTTP_PREFETCH_TIMEOUT_MS,
+        .buffer_size = HTTP_PREFETCH_BUFFER_SIZE,
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0)
+        .buffer_size_tx = 1024,
+#endif
+        .cert_pem = pf->cfg.cert_pem,
+#if  (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)) && defined CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        .crt_bundle_attach = pf->cfg.crt_bundle_attach,
+#endif
+        .user_agent = pf->cfg.user_agent,
+    };
+    return http_conn_pool_create(&http_cfg, HTTP_PREFETCH_POOL_SIZE);
+}
+
+/*
+ * Open `uri` from `offset` and return the status code, redirections are followed
+ */
+static int http_prefetch_request(struct http_prefetch *pf, const char *uri, int64_t offset)
+{
+    bool reused = false;
+    esp_http_client_handle_t client = http_conn_pool_get(pf->pool, uri, &reused);
+    AUDIO_MEM_CHECK(TAG, client, return ESP_FAIL);
+    pf->client = client;
+    if (offset > 0) {
+        char range_header[32];
+        snprintf(range_header, sizeof(range_header), "bytes=%lld-", offset);
+        esp_http_client_set_header(client, "Range", range_header);
+    } else {
+        esp_http_client_delete_header(client, "Range");
+    }
+    if (pf->cfg.on_request && pf->cfg.on_request(client, pf->cfg.on_request_ctx) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to process user callback");
+        return ESP_FAIL;
+    }
+    int status_code;
+    int redirects = 0;
+    while (1) {
+        if (esp_http_client_open(client, 0) != ESP_OK) {
+            status_code = ESP_FAIL;
+        } else {
+            esp_http_client_fetch_headers(client);
+            status_code = esp_http_client_get_status_code(client);
+        }
+        if (status_code <= 0 && reused) {
+            // The server dropped the kept connection meanwhile, retry on a new one
+            reused = false;
+            esp_http_client_close(client);
+            continue;
+        }
+        reused = false;
+        if (status_code != 301 && status_code != 302) {
+            break;
+        }
+        if (++redirects > HTTP_PREFETCH_MAX_REDIRECT) {
+            ESP_LOGE(TAG, "Too many redirections for %s", uri);
+            break;
+        }
+        esp_http_client_set_redirection(client);
+    }
+    return status_code;
+}
+
+static esp_err_t http_prefetch_segment(struct http_prefetch *pf, const char *uri)
+{
+    int64_t offset = 0;
+    int64_t read_time = 0;
+    int retry = 0;
+    while (pf->running) {
+        int status_code = http_prefetch_request(pf, uri, offset);
+        int rlen = -1;
+        if (status_code == 200 || status_code == 206) {
+            if (offset > 0 && status_code == 200) {
+                ESP_LOGW(TAG, "Range not supported, restart %s", uri);
+                return ESP_FAIL;
+            }
+            while (pf->running) {
+                // Only the time spent waiting for the network counts for the throughput, not the one blocked on a full buffer
+                int64_t start = esp_timer_get_time();
+                rlen = esp_http_client_read(pf->client, pf->chunk, HTTP_PREFETCH_CHUNK_SIZE);
+                read_time += esp_timer_get_time() - start;
+                if (rlen <= 0 || rb_write(pf->rb, pf->chunk, rlen, portMAX_DELAY) < 0) {
+                    break;
+                }
+                offset += rlen;
+                retry = 0;
+            }
+        } else {
+            ESP_LOGE(TAG, "Invalid HTTP stream, status code = %d", status_code);
+        }
+        http_conn_pool_finish(pf->pool, pf->client);
+        if (rlen == 0 && pf->cfg.abr) {
+            http_abr_add_sample(pf->cfg.abr, (int)offset, read_time);
+        }
+        if (rlen == 0 || pf->running == false) {
+            return ESP_OK;
+        }
+        if (++retry > HTTP_PREFETCH_RETRY_TIMES) {
+            return ESP_FAIL;
+        }
+        ESP_LOGW(TAG, "Retry %s at %lld", uri, offset);
+        xEventGroupWaitBits(pf->state, PREFETCH_STOP_BIT, false, true, HTTP_PREFETCH_RETRY_WAIT_MS / portTICK_PERIOD_MS);
+    }
+    return ESP_OK;
+}
+
+static int http_prefetch_uri_cb(char *uri, void *ctx)
+{
+    struct http_prefetch *pf = (struct http_prefetch *)ctx;
+    if (uri && http_playlist_insert(pf->playlist, uri)) {
+        pf->new_tracks++;
+    }
+    return 0;
+}
+
+static esp_err_t http_prefetch_reload(struct http_prefetch *pf)
+{
+    // The reader may replace the host URI meanwhile, the request uses a copy of it
+    http_playlist_lock(pf->playlist);
+    char *host_uri = pf->playlist->host_uri ? audio_strdup(pf->playlist->host_uri) : NULL;
+    bool fresh = (pf->playlist->total_tracks == 0);
+    http_playlist_unlock(pf->playlist);
+    AUDIO_MEM_CHECK(TAG, host_uri, return ESP_FAIL);
+    hls_playlist_cfg_t cfg = {
+        .cb = http_prefetch_uri_cb,
+        .ctx = pf,
+        .uri = host_uri,
+    };
+    pf->new_tracks = 0;
+    if (http_prefetch_request(pf, host_uri, 0) != 200) {
+        ESP_LOGW(TAG, "Reload live playlist failed");
+        http_conn_pool_finish(pf->pool, pf->client);
+        audio_free(host_uri);
+        return ESP_FAIL;
+    }
+    hls_handle_t hls = hls_playlist_open(&cfg);
+    if (hls) {
+        int rlen;
+        // A read may return less than asked before the end, the playlist ends when nothing more comes
+        do {
+            rlen = esp_http_client_read(pf->client, pf->chunk, HTTP_PREFETCH_CHUNK_SIZE);
+            hls_playlist_parse_data(hls, (uint8_t *)pf->chunk, rlen > 0 ? rlen : 0, rlen <= 0);
+        } while (rlen > 0);
+        if (hls_playlist_is_media_end(hls)) {
+            http_playlist_lock(pf->playlist);
+            pf->playlist->is_incomplete = false;
+            http_playlist_unlock(pf->playlist);
+            pf->target_ms = 0;
+        }
+        if (fresh) {
+            http_playlist_set_sequence(pf->playlist, hls_playlist_get_sequence_no(hls));
+        }
+        hls_playlist_close(hls);
+    }
+    http_conn_pool_finish(pf->pool, pf->client);
+    audio_free(host_uri);
+    ESP_LOGD(TAG, "Reload live playlist, %d new tracks", pf->new_tracks);
+    http_playlist_lock(pf->playlist);
+    int total_tracks = pf->playlist->total_tracks;
+    http_playlist_unlock(pf->playlist);
+    return total_tracks ? ESP_OK : ESP_FAIL;
+}
+
+/*
+ * Continue with the media playlist of another variant, at the same media sequence number
+ */
+static esp_err_t http_prefetch_switch(struct http_prefetch *pf, const char *uri)
+{
+    uint64_t sequence = http_playlist_get_next_sequence(pf->playlist);
+    char *host_uri = audio_strdup(uri);
+    AUDIO_MEM_CHECK(TAG, host_uri, return ESP_ERR_NO_MEM);
+    http_playlist_set_host_uri(pf->playlist, host_uri, true);
+    if (http_prefetch_reload(pf) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to load variant %s", uri);
+        return ESP_FAIL;
+    }
+    http_playlist_skip_to(pf->playlist, sequence);
+    return ESP_OK;
+}
+
+static void http_prefetch_task(void *arg)
+{
+    struct http_prefetch *pf = (struct http_prefetch *)arg;
+    TickType_t reload_at = xTaskGetTickCount() + pf->target_ms / portTICK_PERIOD_MS;
+
+    while (pf->running) {
+        if (pf->target_ms && (int32_t)(xTaskGetTickCount() - reload_at) >= 0) {
+            http_prefetch_reload(pf);
+            /* An unchanged playlist is checked again after half the target duration */
+            int wait_ms = pf->new_tracks ? pf->target_ms : pf->target_ms / 2;
+            reload_at = xTaskGetTickCount() + wait_ms / portTICK_PERIOD_MS;
+        }
+        char *uri = http_playlist_get_next_track(pf->playlist);
+        if (uri == NULL) {
+            if (pf->target_ms == 0) {
+                break;
+            }
+            TickType_t now = xTaskGetTickCount();
+            if ((int32_t)(reload_at - now) > 0) {
+                xEventGroupWaitBits(pf->state, PREFETCH_STOP_BIT, false, true, reload_at - now);
+            }
+            continue;
+        }
+        ESP_LOGD(TAG, "Prefetch %s", uri);
+        esp_err_t err = http_prefetch_segment(pf, uri);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to prefetch %s", uri);
+        }
+        audio_free(uri);
+        if (err != ESP_OK) {
+            pf->failed = true;
+            break;
+        }
+        char *variant = pf->cfg.abr ? http_abr_check_switch(pf->cfg.abr) : NULL;
+        esp_err_t ret = (variant && pf->running) ? http_prefetch_switch(pf, variant) : ESP_OK;
+        audio_free(variant);
+        if (ret != ESP_OK) {
+            pf->failed = true;
+            break;
+        }
+    }
+    rb_done_write(pf->rb);
+    http_conn_pool_close_all(pf->pool);
+    pf->client = NULL;
+    xEventGroupSetBits(pf->state, PREFETCH_EXIT_BIT);
+    vTaskDelete(NULL);
+}
+
+http_prefetch_handle_t http_prefetch_create(http_prefetch_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, cfg, return NULL);
+    struct http_prefetch *pf = audio_calloc(1, sizeof(struct http_prefetch));
+    AUDIO_MEM_CHECK(TAG, pf, return NULL);
+    memcpy(&pf->cfg, cfg, sizeof(http_prefetch_cfg_t));
+    pf->rb = rb_create(cfg->buffer_size, 1);
+    pf->state = xEventGroupCreate();
+    pf->chunk = audio_malloc(HTTP_PREFETCH_CHUNK_SIZE);
+    pf->pool = http_prefetch_pool(pf);
+    AUDIO_MEM_CHECK(TAG, pf->rb && pf->state && pf->chunk && pf->pool, {
+        http_prefetch_destroy(pf);
+        return NULL;
+    });
+    xEventGroupSetBits(pf->state, PREFETCH_EXIT_BIT);
+    return pf;
+}
+
+esp_err_t http_prefetch_start(http_prefetch_handle_t pf, http_playlist_t *playlist, int target_duration)
+{
+    AUDIO_NULL_CHECK(TAG, pf, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    http_prefetch_stop(pf);
+    pf->playlist = playlist;
+    pf->target_ms = playlist->is_incomplete ? target_duration * 1000 : 0;
+    pf->failed = false;
+    pf->running = true;
+    xEventGroupClearBits(pf->state, PREFETCH_STOP_BIT | PREFETCH_EXIT_BIT);
+    if (audio_thread_create(NULL, "http_prefetch", http_prefetch_task, pf, pf->cfg.task_stack,
+                            pf->cfg.task_prio, pf->cfg.stack_in_ext, pf->cfg.task_core) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create prefetch task");
+        pf->running = false;
+        xEventGroupSetBits(pf->state, PREFETCH_EXIT_BIT);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+int http_prefetch_read(http_prefetch_handle_t pf, char *buf, int len, TickType_t ticks)
+{
+    AUDIO_NULL_CHECK(TAG, pf, return ESP_FAIL);
+    int rlen = rb_read(pf->rb, buf, len, ticks);
+    if (rlen > 0) {
+        return rlen;
+    }
+    if (rlen == RB_DONE && pf->failed == false) {
+        return 0;
+    }
+    return ESP_FAIL;
+}
+
+void http_prefetch_get_level(http_prefetch_handle_t pf, int *filled, int *size)
+{
+    AUDIO_NULL_CHECK(TAG, pf, return);
+    *filled = rb_bytes_filled(pf->rb);
+    *size = rb_get_size(pf->rb);
+}
+
+bool http_prefetch_is_running(http_prefetch_handle_t pf)
+{
+    return pf && pf->running;
+}
+
+esp_err_t http_prefetch_stop(http_prefetch_handle_t pf)
+{
+    AUDIO_NULL_CHECK(TAG, pf, return ESP_ERR_INVALID_ARG);
+    pf->running = false;
+    xEventGroupSetBits(pf->state, PREFETCH_STOP_BIT);
+    rb_abort(pf->rb);
+    xEventGroupWaitBits(pf->state, PREFETCH_EXIT_BIT, false, true, portMAX_DELAY);
+    rb_reset(pf->rb);
+    pf->playlist = NULL;
+    return ESP_OK;
+}
+
+void http_prefetch_destroy(http_prefetch_handle_t pf)
+{
+    if (pf == NULL) {
+        return;
+    }
+    if (pf->rb && pf->state) {
+        http_prefetch_stop(pf);
+    }
+    AUDIO_SAFE_FREE(pf->rb, rb_destroy);
+    AUDIO_SAFE_FREE(pf->state, vEventGroupDelete);
+    AUDIO_SAFE_FREE(pf->chunk, audio_free);
+    AUDIO_SAFE_FREE(pf->pool, http_conn_pool_destroy);
+    audio_free(pf);
+}
@@ -0,0 +1,146 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _HTTP_PREFETCH_H_
+#define _HTTP_PREFETCH_H_
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "http_playlist.h"
+#include "http_abr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  HLS segment prefetcher used by the http_stream reader
+ *
+ *         A background task walks the media playlist, downloads every segment with its own HTTP client
+ *         and appends the bodies to a bounded ringbuffer. The reader drains the ringbuffer as one continuous
+ *         byte stream, so the connection setup of segment N+1 overlaps with the playback of segment N.
+ *         Live playlists are reloaded by the same task on the `#EXT-X-TARGETDURATION` cadence.
+ *
+ * @note   The playlist is shared with the reader, it is accessed under its lock
+ */
+typedef struct http_prefetch *http_prefetch_handle_t;
+
+/**
+ * @brief  Prefetcher configuration
+ */
+typedef struct {
+    int           buffer_size;                      /*!< Size of the side buffer in bytes */
+    int           task_stack;                       /*!< Download task stack size */
+    int           task_prio;                        /*!< Download task priority */
+    int           task_core;                        /*!< Download task core */
+    bool          stack_in_ext;                     /*!< Try to allocate the task stack in external memory */
+    const char   *cert_pem;                         /*!< SSL server certification, PEM format */
+    esp_err_t   (*crt_bundle_attach)(void *conf);   /*!< Function pointer to esp_crt_bundle_attach */
+    const char   *user_agent;                       /*!< User Agent string */
+    http_abr_handle_t abr;                          /*!< Adaptive bitrate control fed with the segment downloads, can be NULL */
+    esp_err_t   (*on_request)(esp_http_client_handle_t client, void *ctx);  /*!< Called before each request, e.g. to set the headers, can be NULL */
+    void         *on_request_ctx;                   /*!< Context of `on_request` */
+} http_prefetch_cfg_t;
+
+/**
+ * @brief      Create a prefetcher, the buffer is allocated here and the task is created on start
+ *
+ * @param[in]  cfg  The configuration
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  Prefetcher handle
+ */
+http_prefetch_handle_t http_prefetch_create(http_prefetch_cfg_t *cfg);
+
+/**
+ * @brief      Start downloading the not played tracks of the playlist
+ *
+ * @param[in]  pf               The prefetcher handle
+ * @param[in]  playlist         The resolved media playlist
+ * @param[in]  target_duration  `#EXT-X-TARGETDURATION` in seconds, used to reload live playlists
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t http_prefetch_start(http_prefetch_handle_t pf, http_playlist_t *playlist, int target_duration);
+
+/**
+ * @brief      Read the prefetched stream
+ *
+ * @param[in]  pf     The prefetcher handle
+ * @param[out] buf    Output buffer
+ * @param[in]  len    Bytes to read
+ * @param[in]  ticks  Ticks to wait for data
+ *
+ * @return
+ *     - > 0       Bytes read
+ *     - 0         All tracks are downloaded and read
+ *     - ESP_FAIL  The download failed and the buffer is drained
+ */
+int http_prefetch_read(http_prefetch_handle_t pf, char *buf, int len, TickType_t ticks);
+
+/**
+ * @brief      Check whether the prefetcher has been started and not stopped
+ *
+ * @param[in]  pf  The prefetcher handle
+ *
+ * @return     true if running
+ */
+bool http_prefetch_is_running(http_prefetch_handle_t pf);
+
+/**
+ * @brief      Get the amount of prefetched data
+ *
+ * @param[in]  pf      The prefetcher handle
+ * @param[out] filled  Buffered bytes
+ * @param[out] size    Size of the side buffer
+ */
+void http_prefetch_get_level(http_prefetch_handle_t pf, int *filled, int *size);
+
+/**
+ * @brief      Stop the download task and drop the buffered data
+ *
+ * @param[in]  pf  The prefetcher handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t http_prefetch_stop(http_prefetch_handle_t pf);
+
+/**
+ * @brief      Stop and destroy the prefetcher
+ *
+ * @param[in]  pf  The prefetcher handle
+ */
+void http_prefetch_destroy(http_prefetch_handle_t pf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HTTP_PREFETCH_H_ */
@@ -0,0 +1,446 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "audio_mutex.h"
+#include "audio_thread.h"
+#include "audio_idf_version.h"
+#include "http_readahead.h"
+#include "http_conn_pool.h"
+
+static const char *TAG = "HTTP_READAHEAD";
+
+#define HTTP_READAHEAD_MIN_WINDOW       (2)     /* The range being read and the next one */
+#define HTTP_READAHEAD_MAX_WINDOW       (8)
+#define HTTP_READAHEAD_READ_SIZE        (4096)  /* Progress is published to the reader at this granularity */
+#define HTTP_READAHEAD_BUFFER_SIZE      (2048)
+#define HTTP_READAHEAD_TIMEOUT_MS       (10 * 1000)
+#define HTTP_READAHEAD_RETRY_TIMES      (3)
+#define HTTP_READAHEAD_RETRY_WAIT_MS    (500)
+#define HTTP_READAHEAD_MAX_REDIRECT     (5)
+
+#define READAHEAD_DATA_BIT              BIT0
+#define READAHEAD_SLOT_BIT              BIT1
+#define READAHEAD_STOP_BIT              BIT2
+#define READAHEAD_EXIT_BIT              BIT3
+
+typedef enum {
+    RANGE_FETCHING,
+    RANGE_DONE,
+    RANGE_FAILED,
+} range_state_t;
+
+typedef struct {
+    char           *buf;
+    int64_t         start;
+    int             len;
+    int             filled;         /*!< Bytes downloaded, only grows while the slot is fetched */
+    int             read;           /*!< Bytes consumed by the reader */
+    range_state_t   state;
+} range_slot_t;
+
+typedef struct {
+    struct http_readahead  *ra;
+    http_conn_pool_handle_t pool;   /*!< The kept connection of this worker */
+} range_worker_t;
+
+struct http_readahead {
+    http_readahead_cfg_t    cfg;
+    void                   *lock;
+    EventGroupHandle_t      state;
+    char                   *uri;
+    int64_t                 total;
+    int64_t                 next_pos;   /*!< Start of the next range to assign */
+    range_slot_t           *slots;      /*!< Ring in range order, the head slot is being read and released once read and done */
+    int                     head;
+    int                     count;      /*!< Slots in use */
+    int                     window;     /*!< Slots allowed in use */
+    int64_t                 rtt_us;     /*!< Smoothed time from request to response headers */
+    int64_t                 bandwidth;  /*!< Smoothed throughput of one connection, in bytes per second */
+    int                     active;     /*!< Running workers */
+    range_worker_t         *workers;
+    volatile bool           running;
+    bool                    failed;
+};
+
+static http_conn_pool_handle_t readahead_pool(struct http_readahead *ra)
+{
+    esp_http_client_config_t http_cfg = {
+        .timeout_ms = HTTP_READAHEAD_TIMEOUT_MS,
+        .buffer_size = HTTP_READAHEAD_BUFFER_SIZE,
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0)
+        .buffer_size_tx = 1024,
+#endif
+        .cert_pem = ra->cfg.cert_pem,
+#if  (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)) && defined CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        .crt_bundle_attach = ra->cfg.crt_bundle_attach,
+#endif
+        .user_agent = ra->cfg.user_agent,
+    };
+    return http_conn_pool_create(&http_cfg, 1);
+}
+
+/*
+ * Request bytes `start` to `end` of the resource and return the status code, redirections are followed
+ */
+static int readahead_request(struct http_readahead *ra, esp_http_client_handle_t client, bool reused, int64_t start, int64_t end)
+{
+    char range_header[64];
+    snprintf(range_header, sizeof(range_header), "bytes=%lld-%lld", start, end);
+    esp_http_client_set_header(client, "Range", range_header);
+    if (ra->cfg.on_request && ra->cfg.on_request(client, ra->cfg.on_request_ctx) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to process user callback");
+        return ESP_FAIL;
+    }
+    int status_code;
+    int redirects = 0;
+    while (1) {
+        if (esp_http_client_open(client, 0) != ESP_OK) {
+            status_code = ESP_FAIL;
+        } else {
+            esp_http_client_fetch_headers(client);
+            status_code = esp_http_client_get_status_code(client);
+        }
+        if (status_code <= 0 && reused) {
+            // The server dropped the kept connection meanwhile, retry on a new one
+            reused = false;
+            esp_http_client_close(client);
+            continue;
+        }
+        reused = false;
+        if (status_code != 301 && status_code != 302) {
+            break;
+        }
+        if (++redirects > HTTP_READAHEAD_MAX_REDIRECT) {
+            ESP_LOGE(TAG, "Too many redirections for %s", ra->uri);
+            break;
+        }
+        esp_http_client_set_redirection(client);
+    }
+    return status_code;
+}
+
+/*
+ * Fold the measures of a range into the estimates and size the window to the bandwidth-delay product
+ */
+static void readahead_measure(struct http_readahead *ra, int64_t rtt_us, int bytes, int64_t body_us)
+{
+    mutex_lock(ra->lock);
+    ra->rtt_us = ra->rtt_us ? (ra->rtt_us * 3 + rtt_us) / 4 : rtt_us;
+    if (body_us > 0) {
+        int64_t bandwidth = (int64_t)bytes * 1000000 / body_us;
+        ra->bandwidth = ra->bandwidth ? (ra->bandwidth * 3 + bandwidth) / 4 : bandwidth;
+    }
+    // Ranges arriving during one request latency must already be requested, beside the one being read
+    int64_t in_flight = ra->bandwidth * ra->rtt_us / 1000000;
+    int target = HTTP_READAHEAD_MIN_WINDOW + (in_flight + ra->cfg.range_size - 1) / ra->cfg.range_size;
+    if (target > ra->cfg.max_window) {
+        target = ra->cfg.max_window;
+    }
+    // Grow at once, shrink one step per range so that a single fast range does not starve the reader
+    if (target > ra->window) {
+        ra->window = target;
+    } else if (target < ra->window) {
+        ra->window--;
+    }
+    ESP_LOGD(TAG, "rtt %d us, %d B/s per connection, window %d", (int)ra->rtt_us, (int)ra->bandwidth, ra->window);
+    mutex_unlock(ra->lock);
+}
+
+static esp_err_t readahead_fetch(range_worker_t *worker, range_slot_t *slot)
+{
+    struct http_readahead *ra = worker->ra;
+    int filled = 0;
+    int retry = 0;
+    while (ra->running) {
+        bool reused = false;
+        esp_http_client_handle_t client = http_conn_pool_get(worker->pool, ra->uri, &reused);
+        AUDIO_MEM_CHECK(TAG, client, return ESP_ERR_NO_MEM);
+        int64_t begin = esp_timer_get_time();
+        int status_code = readahead_request(ra, client, reused, slot->start + filled, slot->start + slot->len - 1);
+        int64_t headers = esp_timer_get_time();
+        int first = filled;
+        if (status_code == 206) {
+            while (ra->running && filled < slot->len) {
+                int size = slot->len - filled;
+                if (size > HTTP_READAHEAD_READ_SIZE) {
+                    size = HTTP_READAHEAD_READ_SIZE;
+                }
+                int rlen = esp_http_client_read(client, slot->buf + filled, size);
+                if (rlen <= 0) {
+                    break;
+                }
+                filled += rlen;
+                mutex_lock(ra->lock);
+                slot->filled = filled;
+                mutex_unlock(ra->lock);
+                xEventGroupSetBits(ra->state, READAHEAD_DATA_BIT);
+                retry = 0;
+            }
+        } else {
+            ESP_LOGE(TAG, "Invalid range response, status code = %d", status_code);
+        }
+        http_conn_pool_finish(worker->pool, client);
+        if (filled == slot->len) {
+            if (first == 0) {
+                readahead_measure(ra, headers - begin, slot->len, esp_timer_get_time() - headers);
+            }
+            return ESP_OK;
+        }
+        if (ra->running == false) {
+            return ESP_OK;
+        }
+        if (status_code == 200 || ++retry > HTTP_READAHEAD_RETRY_TIMES) {
+            return ESP_FAIL;
+        }
+        ESP_LOGW(TAG, "Retry range at %lld", slot->start + filled);
+        xEventGroupWaitBits(ra->state, READAHEAD_STOP_BIT, false, true, HTTP_READAHEAD_RETRY_WAIT_MS / portTICK_PERIOD_MS);
+    }
+    return ESP_OK;
+}
+
+static void readahead_task(void *arg)
+{
+    range_worker_t *worker = (range_worker_t *)arg;
+    struct http_readahead *ra = worker->ra;
+
+    while (ra->running) {
+        range_slot_t *slot = NULL;
+        mutex_lock(ra->lock);
+        if (ra->next_pos >= ra->total || ra->failed) {
+            mutex_unlock(ra->lock);
+            break;
+        }
+        if (ra->count < ra->window) {
+            slot = &ra->slots[(ra->head + ra->count) % ra->cfg.max_window];
+            ra->count++;
+            slot->start = ra->next_pos;
+            slot->len = ra->total - ra->next_pos < ra->cfg.range_size ? ra->total - ra->next_pos : ra->cfg.range_size;
+            slot->filled = 0;
+            slot->read = 0;
+            slot->state = RANGE_FETCHING;
+            ra->next_pos += slot->len;
+        } else {
+            xEventGroupClearBits(ra->state, READAHEAD_SLOT_BIT);
+        }
+        mutex_unlock(ra->lock);
+        if (slot == NULL) {
+            xEventGroupWaitBits(ra->state, READAHEAD_SLOT_BIT | READAHEAD_STOP_BIT, false, false, portMAX_DELAY);
+            continue;
+        }
+        esp_err_t ret = readahead_fetch(worker, slot);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to download range at %lld", slot->start);
+        }
+        mutex_lock(ra->lock);
+        slot->state = (ret == ESP_OK) ? RANGE_DONE : RANGE_FAILED;
+        ra->failed |= (ret != ESP_OK);
+        mutex_unlock(ra->lock);
+        xEventGroupSetBits(ra->state, READAHEAD_DATA_BIT);
+    }
+    http_conn_pool_close_all(worker->pool);
+    mutex_lock(ra->lock);
+    bool last = (--ra->active == 0);
+    mutex_unlock(ra->lock);
+    if (last) {
+        xEventGroupSetBits(ra->state, READAHEAD_EXIT_BIT);
+    }
+    vTaskDelete(NULL);
+}
+
+http_readahead_handle_t http_readahead_create(http_readahead_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, cfg, return NULL);
+    AUDIO_CHECK(TAG, cfg->range_size > 0, return NULL, "Invalid range size");
+    AUDIO_CHECK(TAG, cfg->max_window >= HTTP_READAHEAD_MIN_WINDOW && cfg->max_window <= HTTP_READAHEAD_MAX_WINDOW,
+                return NULL, "Invalid readahead window");
+    struct http_readahead *ra = audio_calloc(1, sizeof(struct http_readahead));
+    AUDIO_MEM_CHECK(TAG, ra, return NULL);
+    memcpy(&ra->cfg, cfg, sizeof(http_readahead_cfg_t));
+    ra->lock = mutex_create();
+    ra->state = xEventGroupCreate();
+    ra->slots = audio_calloc(cfg->max_window, sizeof(range_slot_t));
+    ra->workers = audio_calloc(cfg->max_window, sizeof(range_worker_t));
+    AUDIO_MEM_CHECK(TAG, ra->lock && ra->state && ra->slots && ra->workers, {
+        http_readahead_destroy(ra);
+        return NULL;
+    });
+    xEventGroupSetBits(ra->state, READAHEAD_EXIT_BIT);
+    for (int i = 0; i < cfg->max_window; i++) {
+        ra->slots[i].buf = audio_malloc(cfg->range_size);
+        ra->workers[i].ra = ra;
+        ra->workers[i].pool = readahead_pool(ra);
+        AUDIO_MEM_CHECK(TAG, ra->slots[i].buf && ra->workers[i].pool, {
+            http_readahead_destroy(ra);
+            return NULL;
+        });
+    }
+    return ra;
+}
+
+esp_err_t http_readahead_start(http_readahead_handle_t ra, const char *uri, int64_t pos, int64_t total)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, uri, return ESP_FAIL);
+    http_readahead_stop(ra);
+    char *dup = audio_strdup(uri);
+    AUDIO_MEM_CHECK(TAG, dup, return ESP_ERR_NO_MEM);
+    audio_free(ra->uri);
+    ra->uri = dup;
+    ra->total = total;
+    ra->next_pos = pos;
+    ra->head = 0;
+    ra->count = 0;
+    // Every connection is opened at once for a fast start, the measures shrink the window afterwards
+    ra->window = ra->cfg.max_window;
+    ra->failed = false;
+    ra->running = true;
+    ra->active = ra->cfg.max_window;
+    xEventGroupClearBits(ra->state, READAHEAD_DATA_BIT | READAHEAD_SLOT_BIT | READAHEAD_STOP_BIT | READAHEAD_EXIT_BIT);
+    for (int i = 0; i < ra->cfg.max_window; i++) {
+        if (audio_thread_create(NULL, "http_readahead", readahead_task, &ra->workers[i], ra->cfg.task_stack,
+                                ra->cfg.task_prio, ra->cfg.stack_in_ext, ra->cfg.task_core) == ESP_OK) {
+            continue;
+        }
+        ESP_LOGE(TAG, "Failed to create readahead task");
+        mutex_lock(ra->lock);
+        ra->active -= ra->cfg.max_window - i;
+        bool none = (ra->active == 0);
+        mutex_unlock(ra->lock);
+        if (none) {
+            ra->running = false;
+            xEventGroupSetBits(ra->state, READAHEAD_EXIT_BIT);
+            return ESP_FAIL;
+        }
+        break;
+    }
+    ESP_LOGI(TAG, "Readahead from %lld/%lld, %d ranges of %d bytes", pos, total, ra->cfg.max_window, ra->cfg.range_size);
+    return ESP_OK;
+}
+
+int http_readahead_read(http_readahead_handle_t ra, char *buf, int len, TickType_t ticks)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return ESP_FAIL);
+    bool starved = false;
+    while (1) {
+        int rlen = 0;
+        bool release = false;
+        bool wait = false;
+        mutex_lock(ra->lock);
+        range_slot_t *slot = ra->count ? &ra->slots[ra->head] : NULL;
+        if (slot && slot->read == slot->len && slot->state == RANGE_DONE) {
+            // The worker is done with the slot, it can be reused for the next range
+            ra->head = (ra->head + 1) % ra->cfg.max_window;
+            ra->count--;
+            release = true;
+            slot = ra->count ? &ra->slots[ra->head] : NULL;
+        }
+        if (slot && slot->filled > slot->read) {
+            rlen = slot->filled - slot->read;
+            if (rlen > len) {
+                rlen = len;
+            }
+            memcpy(buf, slot->buf + slot->read, rlen);
+            slot->read += rlen;
+        } else if ((slot && slot->state == RANGE_FAILED) || ra->running == false) {
+            rlen = ESP_FAIL;
+        } else if (slot == NULL && ra->next_pos >= ra->total) {
+            rlen = 0;
+        } else {
+            if (starved == false && ra->count >= ra->window && ra->window < ra->cfg.max_window) {
+                // Every allowed range is taken and the reader still waits, ask for one more in parallel
+                ra->window++;
+                release = true;
+            }
+            starved = true;
+            wait = true;
+            xEventGroupClearBits(ra->state, READAHEAD_DATA_BIT);
+        }
+        mutex_unlock(ra->lock);
+        if (release) {
+            xEventGroupSetBits(ra->state, READAHEAD_SLOT_BIT);
+        }
+        if (wait == false) {
+            return rlen;
+        }
+        EventBits_t bits = xEventGroupWaitBits(ra->state, READAHEAD_DATA_BIT | READAHEAD_STOP_BIT, false, false, ticks);
+        if ((bits & (READAHEAD_DATA_BIT | READAHEAD_STOP_BIT)) == 0) {
+            ESP_LOGW(TAG, "Timeout waiting for range at %lld", slot ? slot->start + slot->read : ra->next_pos);
+            return ESP_FAIL;
+        }
+    }
+}
+
+bool http_readahead_is_running(http_readahead_handle_t ra)
+{
+    return ra && ra->running;
+}
+
+int http_readahead_get_window(http_readahead_handle_t ra)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return 0);
+    return ra->window;
+}
+
+esp_err_t http_readahead_stop(http_readahead_handle_t ra)
+{
+    AUDIO_NULL_CHECK(TAG, ra, return ESP_ERR_INVALID_ARG);
+    ra->running = false;
+    xEventGroupSetBits(ra->state, READAHEAD_STOP_BIT);
+    xEventGroupWaitBits(ra->state, READAHEAD_EXIT_BIT, false, true, portMAX_DELAY);
+    ra->count = 0;
+    return ESP_OK;
+}
+
+void http_readahead_destroy(http_readahead_handle_t ra)
+{
+    if (ra == NULL) {
+        return;
+    }
+    if (ra->state && ra->lock) {
+        http_readahead_stop(ra);
+    }
+    for (int i = 0; ra->slots && i < ra->cfg.max_window; i++) {
+        audio_free(ra->slots[i].buf);
+    }
+    for (int i = 0; ra->workers && i < ra->cfg.max_window; i++) {
+        AUDIO_SAFE_FREE(ra->workers[i].pool, http_conn_pool_destroy);
+    }
+    AUDIO_SAFE_FREE(ra->slots, audio_free);
+    AUDIO_SAFE_FREE(ra->workers, audio_free);
+    AUDIO_SAFE_FREE(ra->lock, mutex_destroy);
+    AUDIO_SAFE_FREE(ra->state, vEventGroupDelete);
+    AUDIO_SAFE_FREE(ra->uri, audio_free);
+    audio_free(ra);
+}
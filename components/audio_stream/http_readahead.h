@@ -0,0 +1,143 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _HTTP_READAHEAD_H_
+#define _HTTP_READAHEAD_H_
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Parallel Range readahead used by the http_stream reader
+ *
+ *         Worker tasks download the following ranges of a resource, each on its own connection, into a ring
+ *         of range buffers. The reader drains the buffers in order, so the request latency of a range overlaps
+ *         with the download of the previous ones. The number of ranges in flight follows the bandwidth-delay
+ *         product measured on the workers and grows when the reader has to wait.
+ */
+typedef struct http_readahead *http_readahead_handle_t;
+
+/**
+ * @brief  Readahead configuration
+ */
+typedef struct {
+    int           range_size;                       /*!< Size of one Range request in bytes, a buffer of this size is allocated per window slot */
+    int           max_window;                       /*!< Maximum number of ranges downloaded ahead, also the number of connections */
+    int           task_stack;                       /*!< Worker task stack size */
+    int           task_prio;                        /*!< Worker task priority */
+    int           task_core;                        /*!< Worker task core */
+    bool          stack_in_ext;                     /*!< Try to allocate the task stacks in external memory */
+    const char   *cert_pem;                         /*!< SSL server certification, PEM format */
+    esp_err_t   (*crt_bundle_attach)(void *conf);   /*!< Function pointer to esp_crt_bundle_attach */
+    const char   *user_agent;                       /*!< User Agent string */
+    esp_err_t   (*on_request)(esp_http_client_handle_t client, void *ctx);  /*!< Called before each request, e.g. to set the headers, can be NULL */
+    void         *on_request_ctx;                   /*!< Context of `on_request` */
+} http_readahead_cfg_t;
+
+/**
+ * @brief      Create a readahead, the range buffers are allocated here and the workers are created on start
+ *
+ * @param[in]  cfg  The configuration
+ *
+ * @return
+ *     - NULL    Out of memory or invalid configuration
+ *     - Others  Readahead handle
+ */
+http_readahead_handle_t http_readahead_create(http_readahead_cfg_t *cfg);
+
+/**
+ * @brief      Start downloading `uri` from `pos` to its end
+ *
+ * @param[in]  ra     The readahead handle
+ * @param[in]  uri    The resource, it must answer Range requests with `206 Partial Content`
+ * @param[in]  pos    First byte to download
+ * @param[in]  total  Size of the resource
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t http_readahead_start(http_readahead_handle_t ra, const char *uri, int64_t pos, int64_t total);
+
+/**
+ * @brief      Read the downloaded data in order
+ *
+ * @param[in]  ra     The readahead handle
+ * @param[out] buf    Output buffer
+ * @param[in]  len    Bytes to read
+ * @param[in]  ticks  Ticks to wait for data
+ *
+ * @return
+ *     - > 0       Bytes read
+ *     - 0         The resource is read to its end
+ *     - ESP_FAIL  A range failed to download, or no data came in time
+ */
+int http_readahead_read(http_readahead_handle_t ra, char *buf, int len, TickType_t ticks);
+
+/**
+ * @brief      Check whether the readahead has been started and not stopped
+ *
+ * @param[in]  ra  The readahead handle
+ *
+ * @return     true if running
+ */
+bool http_readahead_is_running(http_readahead_handle_t ra);
+
+/**
+ * @brief      Get the current number of ranges allowed ahead
+ *
+ * @param[in]  ra  The readahead handle
+ *
+ * @return     The window size
+ */
+int http_readahead_get_window(http_readahead_handle_t ra);
+
+/**
+ * @brief      Stop the workers and drop the downloaded data
+ *
+ * @param[in]  ra  The readahead handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t http_readahead_stop(http_readahead_handle_t ra);
+
+/**
+ * @brief      Stop and destroy the readahead
+ *
+ * @param[in]  ra  The readahead handle
+ */
+void http_readahead_destroy(http_readahead_handle_t ra);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HTTP_READAHEAD_H_ */
@@ -34,9 +34,16 @@
 #include "freertos/task.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "http_stream.h"
 #include "http_playlist.h"
+#include "http_prefetch.h"
+#include "http_conn_pool.h"
+#include "http_abr.h"
+#include "http_cache.h"
+#include "http_readahead.h"
 #include "audio_mem.h"
+#include "audio_mutex.h"
 #include "audio_element.h"
 #include "esp_system.h"
 #include "esp_http_client.h"
@@ -44,22 +51,13 @@
 #include "hls_playlist.h"
 #include "audio_idf_version.h"
 #include "gzip_miniz.h"
-#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0))
-#include "aes/esp_aes.h"
-#elif (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0))
-#if CONFIG_IDF_TARGET_ESP32
-#include "esp32/aes.h"
-#elif CONFIG_IDF_TARGET_ESP32S2
-#include "esp32s2/aes.h"
-#endif
-#else
-#include "hwcrypto/aes.h"
-#endif
+#include "hls_decrypt.h"
 
 static const char *TAG = "HTTP_STREAM";
 #define MAX_PLAYLIST_LINE_SIZE (512)
 #define HTTP_STREAM_BUFFER_SIZE (2048)
 #define HTTP_MAX_CONNECT_TIMES  (5)
+#define HTTP_CONN_POOL_SIZE     (3)
 
 #define HLS_PREFER_BITRATE      (200*1024)
 #define HLS_KEY_CACHE_SIZE      (32)
@@ -70,8 +68,7 @@ typedef struct {
     uint8_t          key_size;
     hls_stream_key_t key;
     uint64_t         sequence_no;
-    esp_aes_context  aes_ctx;
-    bool             aes_used;
+    hls_decrypt_t    decrypt;
 } http_stream_hls_key_t;
 
 typedef struct http_stream {
@@ -99,8 +96,27 @@ typedef struct http_stream {
     hls_handle_t                    *hls_media;
     int                             request_range_size;
     int64_t                         request_range_end;
+    int64_t                         request_range_total; /* Resource size from `Content-Range`, -1 if unknown */
     bool                            is_last_range;
+    http_readahead_handle_t         readahead;         /* Downloads the following ranges in parallel */
+    bool                            readahead_active;  /* Data is read from the readahead */
     const char                      *user_agent;
+    http_prefetch_handle_t          prefetch;          /* Downloads the following HLS segments in background */
+    bool                            prefetch_active;   /* Data is read from the prefetcher */
+    int                             hls_target_duration;
+    http_conn_pool_handle_t         pool;              /* Kept connections, one per host */
+    http_abr_handle_t               abr;               /* Variant selection of HLS master playlists */
+    int                             abr_bytes;         /* Bytes read from the current segment */
+    int64_t                         abr_time;          /* Time spent in reading the current segment, in microseconds */
+    uint32_t                        abr_samples;       /* Measures already reported by event */
+    uint32_t                        abr_switches;      /* Switches already reported by event */
+    const char                     *cache_dir;         /* Directory of the disk cache, NULL if disabled */
+    int                             cache_size;
+    http_cache_handle_t             cache;             /* Created at the first open, the file system may be mounted late */
+    http_cache_entry_t              cache_entry;       /* Opened resource, NULL if it is not cached */
+    int64_t                         cache_net_pos;     /* Byte position of the network response, -1 if there is none */
+    audio_element_handle_t          el;                /* Element of the stream, for the hooks of the download tasks */
+    char                           *track_uri;         /* Copy of the playlist track being opened */
 } http_stream_t;
 
 static esp_err_t http_stream_auto_connect_next_track(audio_element_handle_t el);
@@ -192,18 +208,20 @@ static esp_err_t _http_event_handle(esp_http_client_event_t *evt)
                 // Update total bytes to range end
                 audio_element_set_total_bytes(el, range_end+1);
             }
+            char *total = strchr(evt->header_value, '/');
+            http->request_range_total = (total && total[1] != '*') ? atoll(total + 1) : -1;
         }
     }
     return ESP_OK;
 }
 
-static int dispatch_hook(audio_element_handle_t self, http_stream_event_id_t type, void *buffer, int buffer_len)
+static int dispatch_client_hook(audio_element_handle_t self, void *client, http_stream_event_id_t type, void *buffer, int buffer_len)
 {
     http_stream_t *http_stream = (http_stream_t *)audio_element_getdata(self);
 
     http_stream_event_msg_t msg;
     msg.event_id = type;
-    msg.http_client = http_stream->client;
+    msg.http_client = client;
     msg.user_data = http_stream->user_data;
     msg.buffer = buffer;
     msg.buffer_len = buffer_len;
@@ -214,6 +232,21 @@ static int dispatch_hook(audio_element_handle_t self, http_stream_event_id_t typ
     return ESP_OK;
 }
 
+static int dispatch_hook(audio_element_handle_t self, http_stream_event_id_t type, void *buffer, int buffer_len)
+{
+    http_stream_t *http_stream = (http_stream_t *)audio_element_getdata(self);
+    return dispatch_client_hook(self, http_stream->client, type, buffer, buffer_len);
+}
+
+/*
+ * Requests of the background download tasks get the same user headers as the ones of the reader
+ */
+static esp_err_t _http_worker_request(esp_http_client_handle_t client, void *ctx)
+{
+    http_stream_t *http = (http_stream_t *)ctx;
+    return dispatch_client_hook(http->el, client, HTTP_STREAM_PRE_REQUEST, NULL, 0) == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
 static bool _is_playlist(audio_element_info_t *info, const char *uri)
 {
     if (info->codec_fmt == ESP_AUDIO_TYPE_M3U8 || info->codec_fmt == ESP_AUDIO_TYPE_PLS) {
@@ -250,6 +283,38 @@ static int _http_read_data(http_stream_t *http, char *buffer, int len)
     return gzip_miniz_read(http->gzip, (uint8_t*) buffer, len);
 }
 
+static int _http_read_segment(http_stream_t *http, char *buffer, int len)
+{
+    if (http->abr == NULL) {
+        return _http_read_data(http, buffer, len);
+    }
+    // Only the time spent waiting for the network counts for the throughput
+    int64_t start = esp_timer_get_time();
+    int rlen = _http_read_data(http, buffer, len);
+    http->abr_time += esp_timer_get_time() - start;
+    if (rlen > 0) {
+        http->abr_bytes += rlen;
+    }
+    return rlen;
+}
+
+static int _http_read_cipher(void *ctx, uint8_t *buf, int len)
+{
+    return _http_read_segment((http_stream_t *)ctx, (char *)buf, len);
+}
+
+/*
+ * Read segment data, decrypted when the playlist is encrypted.
+ * A return of 0 is the end of the segment, the decryptor keeps reading while it only holds ciphertext back.
+ */
+static int _http_read_payload(http_stream_t *http, char *buffer, int len)
+{
+    if (http->hls_key == NULL) {
+        return _http_read_segment(http, buffer, len);
+    }
+    return hls_decrypt_read(&http->hls_key->decrypt, (uint8_t *)buffer, len, _http_read_cipher, http);
+}
+
 static esp_err_t _resolve_hls_key(http_stream_t *http)
 {
     int ret = _http_read_data(http, (char*)http->hls_key->key_cache, sizeof(http->hls_key->key_cache));
@@ -264,10 +329,7 @@ static esp_err_t _resolve_hls_key(http_stream_t *http)
 static esp_err_t _prepare_crypt(http_stream_t *http)
 {
     http_stream_hls_key_t* hls_key = http->hls_key;
-    if (hls_key->aes_used) {
-        esp_aes_free(&hls_key->aes_ctx);
-        hls_key->aes_used = false;
-    }
+    hls_decrypt_deinit(&hls_key->decrypt);
     int ret = hls_playlist_parse_key(http->hls_media, http->hls_key->key_cache, http->hls_key->key_size);
     if (ret < 0) {
         return ESP_FAIL;
@@ -276,9 +338,9 @@ static esp_err_t _prepare_crypt(http_stream_t *http)
     if (ret != 0) {
         return ESP_FAIL;
     }
-    esp_aes_init(&hls_key->aes_ctx);
-    esp_aes_setkey(&hls_key->aes_ctx, (unsigned char*)hls_key->key.key, 128);
-    hls_key->aes_used = true;
+    if (hls_decrypt_init(&hls_key->decrypt, (uint8_t *)hls_key->key.key, (uint8_t *)hls_key->key.iv) != ESP_OK) {
+        return ESP_FAIL;
+    }
     http->hls_key->sequence_no++;
     return ESP_OK;
 }
@@ -288,10 +350,7 @@ static void _free_hls_key(http_stream_t *http)
     if (http->hls_key == NULL) {
         return;
     }
-    if (http->hls_key->aes_used) {
-        esp_aes_free(&http->hls_key->aes_ctx);
-        http->hls_key->aes_used = false;
-    }
+    hls_decrypt_deinit(&http->hls_key->decrypt);
     if (http->hls_key->key_url) {
         audio_free(http->hls_key->key_url);
     }
@@ -299,6 +358,24 @@ static void _free_hls_key(http_stream_t *http)
     http->hls_key = NULL;
 }
 
+static char *_hls_select_variant(http_stream_t *http, hls_handle_t hls)
+{
+    if (http->abr == NULL) {
+        return hls_playlist_get_prefer_url(hls, HLS_STREAM_TYPE_AUDIO);
+    }
+    http_abr_clear(http->abr);
+    int variant_num = hls_playlist_get_variant_num(hls);
+    for (int i = 0; i < variant_num; i++) {
+        uint32_t bandwidth = 0;
+        char *url = hls_playlist_get_variant_url(hls, i, HLS_STREAM_TYPE_AUDIO, &bandwidth);
+        if (url) {
+            http_abr_add_variant(http->abr, bandwidth, url);
+            audio_free(url);
+        }
+    }
+    return http_abr_select(http->abr, HLS_PREFER_BITRATE);
+}
+
 static esp_err_t _resolve_playlist(audio_element_handle_t self, const char *uri)
 {
     audio_element_info_t info;
@@ -316,11 +393,9 @@ static esp_err_t _resolve_playlist(audio_element_handle_t self, const char *uri)
     if (http->is_main_playlist) {
         http_playlist_clear(http->playlist);
     }
-    if (http->playlist->host_uri) {
-        audio_free(http->playlist->host_uri);
-    }
-    http->playlist->host_uri = new_uri;
+    http_playlist_set_host_uri(http->playlist, new_uri, false);
     http->is_valid_playlist = false;
+    http->hls_target_duration = 0;
 
     // handle PLS playlist
     if (info.codec_fmt == ESP_AUDIO_TYPE_PLS) {
@@ -357,6 +432,7 @@ static esp_err_t _resolve_playlist(audio_element_handle_t self, const char *uri)
         .uri = (char *)new_uri,
     };
     hls_handle_t hls = hls_playlist_open(&cfg);
+    bool fresh = (http->playlist->total_tracks == 0);
     do {
         if (hls == NULL) {
             break;
@@ -371,7 +447,7 @@ static esp_err_t _resolve_playlist(audio_element_handle_t self, const char *uri)
             hls_playlist_parse_data(hls, (uint8_t *)http->playlist->data, rlen, (rlen < need_read));
         }
         if (hls_playlist_is_master(hls)) {
-            char *url = hls_playlist_get_prefer_url(hls, HLS_STREAM_TYPE_AUDIO);
+            char *url = _hls_select_variant(http, hls);
             if (url) {
                 http_playlist_insert(http->playlist, url);
                 ESP_LOGI(TAG, "Add media uri %s\n", url);
@@ -380,7 +456,13 @@ static esp_err_t _resolve_playlist(audio_element_handle_t self, const char *uri)
                 audio_free(url);
             }
         } else {
+            http->hls_target_duration = hls_playlist_get_target_duration(hls);
+            if (fresh) {
+                http_playlist_set_sequence(http->playlist, hls_playlist_get_sequence_no(hls));
+            }
+            http_playlist_lock(http->playlist);
             http->playlist->is_incomplete = !hls_playlist_is_media_end(hls);
+            http_playlist_unlock(http->playlist);
             if (http->playlist->is_incomplete) {
                 ESP_LOGI(TAG, "Live stream URI. Need to be fetched again!");
             }
@@ -424,11 +506,21 @@ static esp_err_t _resolve_playlist(audio_element_handle_t self, const char *uri)
     return http->is_valid_playlist ? ESP_OK : ESP_FAIL;
 }
 
+/*
+ * Keep the copy of a track got from the playlist, the previous one is released
+ */
+static char *_http_set_track(http_stream_t *http, char *track)
+{
+    audio_free(http->track_uri);
+    http->track_uri = track;
+    return track;
+}
+
 static char *_playlist_get_next_track(audio_element_handle_t self)
 {
     http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
     if (http->enable_playlist_parser && http->is_playlist_resolved) {
-        return http_playlist_get_next_track(http->playlist);
+        return _http_set_track(http, http_playlist_get_next_track(http->playlist));
     }
     return NULL;
 }
@@ -458,7 +550,7 @@ static esp_err_t _http_load_uri(audio_element_handle_t self, audio_element_info_
     esp_err_t err;
     http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
 
-    esp_http_client_close(http->client);
+    bool reused = http_conn_pool_finish(http->pool, http->client);
 
     if (dispatch_hook(self, HTTP_STREAM_PRE_REQUEST, NULL, 0) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to process user callback");
@@ -484,6 +576,12 @@ _stream_redirect:
         http->gzip_encoding = false;
     }
     if ((err = esp_http_client_open(http->client, post_len)) != ESP_OK) {
+        if (reused) {
+            // The server dropped the kept connection meanwhile, retry on a new one
+            reused = false;
+            esp_http_client_close(http->client);
+            goto _stream_redirect;
+        }
         ESP_LOGE(TAG, "Failed to open http stream");
         return err;
     }
@@ -510,6 +608,12 @@ _stream_redirect:
     * Due to the total byte of content has been changed after seek, set info.total_bytes at beginning only.
     */
     int64_t cur_pos = esp_http_client_fetch_headers(http->client);
+    if (cur_pos < 0 && reused && esp_http_client_get_status_code(http->client) <= 0) {
+        reused = false;
+        esp_http_client_close(http->client);
+        goto _stream_redirect;
+    }
+    reused = false;
     audio_element_getinfo(self, info);
     if (info->byte_pos <= 0) {
         info->total_bytes = cur_pos;
@@ -534,6 +638,168 @@ _stream_redirect:
     return err;
 }
 
+/*
+ * Report the measures and decisions of the adaptive bitrate control, they may come from the prefetch task
+ */
+static void _hls_abr_update(audio_element_handle_t self)
+{
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
+    int filled = 0;
+    int size = 0;
+    ringbuf_handle_t rb = audio_element_get_output_ringbuf(self);
+    if (rb) {
+        filled = rb_bytes_filled(rb);
+        size = rb_get_size(rb);
+    }
+    if (http->prefetch_active) {
+        int prefetch_filled = 0;
+        int prefetch_size = 0;
+        http_prefetch_get_level(http->prefetch, &prefetch_filled, &prefetch_size);
+        filled += prefetch_filled;
+        size += prefetch_size;
+    }
+    http_abr_set_buffer_level(http->abr, filled, size);
+
+    http_stream_abr_info_t abr_info;
+    uint32_t samples = 0;
+    uint32_t switches = 0;
+    if (http_abr_get_info(http->abr, &abr_info, &samples, &switches) != ESP_OK) {
+        return;
+    }
+    if (samples != http->abr_samples) {
+        http->abr_samples = samples;
+        dispatch_hook(self, HTTP_STREAM_ABR_BANDWIDTH, &abr_info, sizeof(abr_info));
+    }
+    if (switches != http->abr_switches) {
+        http->abr_switches = switches;
+        dispatch_hook(self, HTTP_STREAM_ABR_SWITCH, &abr_info, sizeof(abr_info));
+    }
+}
+
+/*
+ * At a segment boundary, continue with the media playlist of another variant when the
+ * adaptive bitrate control asks for it. The new playlist is resumed at the same media sequence number.
+ */
+static esp_err_t _hls_abr_switch(audio_element_handle_t self)
+{
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
+    if (http->abr == NULL || http->pool == NULL || http->hls_key || http->is_playlist_resolved == false) {
+        return ESP_OK;
+    }
+    http_abr_add_sample(http->abr, http->abr_bytes, http->abr_time);
+    http->abr_bytes = 0;
+    http->abr_time = 0;
+    char *uri = http_abr_check_switch(http->abr);
+    if (uri == NULL) {
+        return ESP_OK;
+    }
+    uint64_t sequence = http_playlist_get_next_sequence(http->playlist);
+    http_playlist_clear(http->playlist);
+
+    esp_err_t ret = ESP_FAIL;
+    audio_element_info_t info;
+    audio_element_getinfo(self, &info);
+    info.byte_pos = 0;
+    http->client = http_conn_pool_get(http->pool, uri, NULL);
+    if (http->client && _http_load_uri(self, &info) == ESP_OK && _resolve_playlist(self, uri) == ESP_OK) {
+        http_playlist_skip_to(http->playlist, sequence);
+        ret = ESP_OK;
+    } else {
+        ESP_LOGE(TAG, "Failed to switch to variant %s", uri);
+    }
+    audio_free(uri);
+    _hls_abr_update(self);
+    return ret;
+}
+
+/*
+ * Open the cache entry of a plain resource, return true when the data at the current position is cached,
+ * the stream is then opened without any request
+ */
+static bool _http_cache_begin(audio_element_handle_t self, const char *uri, audio_element_info_t *info)
+{
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
+    AUDIO_SAFE_FREE(http->cache_entry, http_cache_close);
+    http->cache_net_pos = -1;
+    if (http->cache_dir == NULL || http->is_playlist_resolved || http->hls_key || _is_playlist(info, uri)) {
+        return false;
+    }
+    if (http->cache == NULL) {
+        http->cache = http_cache_create(http->cache_dir, http->cache_size);
+        if (http->cache == NULL) {
+            ESP_LOGW(TAG, "Cache directory %s is not usable", http->cache_dir);
+            return false;
+        }
+    }
+    http->cache_entry = http_cache_open(http->cache, uri);
+    int64_t size = http_cache_get_size(http->cache_entry);
+    if (size <= 0 || http_cache_contains(http->cache_entry, info->byte_pos) == false) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Read from cache, pos=%lld/%lld", info->byte_pos, size);
+    audio_element_set_total_bytes(self, size);
+    audio_element_set_codec_fmt(self, http_cache_get_codec(http->cache_entry));
+    return true;
+}
+
+/*
+ * Keep the cache entry after a response of the whole resource, or of its rest when the size is already known
+ */
+static void _http_cache_loaded(audio_element_handle_t self)
+{
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
+    if (http->cache_entry == NULL) {
+        return;
+    }
+    audio_element_info_t info;
+    audio_element_getinfo(self, &info);
+    int64_t size = info.byte_pos > 0 ? http_cache_get_size(http->cache_entry) : info.total_bytes;
+    int status_code = esp_http_client_get_status_code(http->client);
+    // Offsets of an encoded body or of a response without the asked range can not be mapped to the resource
+    if (http->is_playlist_resolved || http->hls_key || http->gzip_encoding
+        || status_code != (info.byte_pos > 0 ? 206 : 200)
+        || size <= 0 || size != info.total_bytes
+        || http_cache_set_info(http->cache_entry, size, info.codec_fmt) != ESP_OK) {
+        AUDIO_SAFE_FREE(http->cache_entry, http_cache_close);
+        return;
+    }
+    http->cache_net_pos = info.byte_pos;
+}
+
+/*
+ * Read a cached resource, data missing on disk is downloaded from its position and written to the cache
+ */
+static int _http_read_cached(audio_element_handle_t self, char *buffer, int len)
+{
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
+    audio_element_info_t info;
+    audio_element_getinfo(self, &info);
+    int rlen = http_cache_read(http->cache_entry, info.byte_pos, buffer, len);
+    if (rlen > 0) {
+        return rlen;
+    }
+    if (info.byte_pos >= http_cache_get_size(http->cache_entry)) {
+        return 0;
+    }
+    if (http->cache_net_pos != info.byte_pos) {
+        if (_http_load_uri(self, &info) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        int status_code = esp_http_client_get_status_code(http->client);
+        if (http->gzip_encoding || status_code != (info.byte_pos > 0 ? 206 : 200)) {
+            ESP_LOGE(TAG, "Unexpected response for cached stream, status code = %d", status_code);
+            return ESP_FAIL;
+        }
+        http->cache_net_pos = info.byte_pos;
+    }
+    rlen = _http_read_data(http, buffer, len);
+    if (rlen > 0) {
+        http_cache_write(http->cache_entry, http->cache_net_pos, buffer, rlen);
+        http->cache_net_pos += rlen;
+    }
+    return rlen;
+}
+
 static esp_err_t _http_open(audio_element_handle_t self)
 {
     http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
@@ -545,15 +811,30 @@ static esp_err_t _http_open(audio_element_handle_t self)
         ESP_LOGE(TAG, "already opened");
         return ESP_OK;
     }
+    if (http_prefetch_is_running(http->prefetch)) {
+        http_prefetch_stop(http->prefetch);
+    }
+    http->prefetch_active = false;
+    if (http_readahead_is_running(http->readahead)) {
+        http_readahead_stop(http->readahead);
+    }
+    http->readahead_active = false;
+    http->request_range_total = -1;
     http->_errno = 0;
     audio_element_getinfo(self, &info);
+    if (info.byte_pos == 0 && http->enable_playlist_parser && http->auto_connect_next_track == false) {
+        // Tracks of a resolved playlist are opened one by one, the open is a segment boundary
+        _hls_abr_switch(self);
+    }
+    http->abr_bytes = 0;
+    http->abr_time = 0;
 _stream_open_begin:
     if (http->hls_key && http->hls_key->key_loaded == false) {
         uri = http->hls_key->key_url;
     } else if (info.byte_pos == 0) {
         uri = _playlist_get_next_track(self);
     } else if (http->is_playlist_resolved) {
-        uri = http_playlist_get_last_track(http->playlist);
+        uri = _http_set_track(http, http_playlist_get_last_track(http->playlist));
     }
     if (uri == NULL) {
         if (http->is_playlist_resolved && http->enable_playlist_parser) {
@@ -564,6 +845,9 @@ _stream_open_begin:
             goto _stream_open_begin;
         }
         uri = audio_element_get_uri(self);
+        if (http->abr && uri && http_abr_has_variant(http->abr, uri) == false) {
+            http_abr_clear(http->abr);
+        }
     }
 
     if (uri == NULL) {
@@ -572,10 +856,9 @@ _stream_open_begin:
     }
     
     ESP_LOGD(TAG, "URI=%s", uri);
-    // if not initialize http client, initial it
-    if (http->client == NULL) {
+    // Clients are created per host by the pool, a kept connection to the same host is reused
+    if (http->pool == NULL) {
         esp_http_client_config_t http_cfg = {
-            .url = uri,
             .event_handler = _http_event_handle,
             .user_data = self,
             .timeout_ms = 30 * 1000,
@@ -589,13 +872,18 @@ _stream_open_begin:
 #endif //  (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)) && defined CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
             .user_agent = http->user_agent,
         };
-        http->client = esp_http_client_init(&http_cfg);
-        AUDIO_MEM_CHECK(TAG, http->client, return ESP_ERR_NO_MEM);
-    } else {
-        esp_http_client_set_url(http->client, uri);
+        http->pool = http_conn_pool_create(&http_cfg, HTTP_CONN_POOL_SIZE);
+        AUDIO_MEM_CHECK(TAG, http->pool, return ESP_ERR_NO_MEM);
     }
+    http->client = http_conn_pool_get(http->pool, uri, NULL);
+    AUDIO_MEM_CHECK(TAG, http->client, return ESP_ERR_NO_MEM);
     audio_element_getinfo(self, &info);
 
+    if (_http_cache_begin(self, uri, &info)) {
+        http->is_open = true;
+        audio_element_report_codec_fmt(self);
+        return ESP_OK;
+    }
     if (_http_load_uri(self, &info) != ESP_OK) {
         return ESP_FAIL;
     }
@@ -629,8 +917,19 @@ _stream_open_begin:
             }
         }
     }
+    _http_cache_loaded(self);
     http->is_open = true;
     audio_element_report_codec_fmt(self);
+    // Segments after the first one are downloaded ahead while this one plays
+    if (http->prefetch && http->is_playlist_resolved && http->hls_target_duration && http->hls_key == NULL) {
+        http_prefetch_start(http->prefetch, http->playlist, http->hls_target_duration);
+    }
+    // The following ranges are downloaded in parallel while the first one is read from this connection
+    if (http->readahead && http->is_last_range == false && http->request_range_total > 0
+        && http->gzip_encoding == false && http->hls_key == NULL && http->is_playlist_resolved == false) {
+        audio_element_set_total_bytes(self, http->request_range_total);
+        http_readahead_start(http->readahead, uri, http->request_range_end + 1, http->request_range_total);
+    }
     return ESP_OK;
 }
 
@@ -638,6 +937,14 @@ static esp_err_t _http_close(audio_element_handle_t self)
 {
     http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
     ESP_LOGD(TAG, "_http_close");
+    if (http->prefetch) {
+        http_prefetch_stop(http->prefetch);
+    }
+    http->prefetch_active = false;
+    if (http->readahead) {
+        http_readahead_stop(http->readahead);
+    }
+    http->readahead_active = false;
     if (http->is_open) {
         http->is_open = false;
         do {
@@ -671,11 +978,11 @@ static esp_err_t _http_close(audio_element_handle_t self)
         gzip_miniz_deinit(http->gzip);
         http->gzip = NULL;
     }
-    if (http->client) {
-        esp_http_client_close(http->client);
-        esp_http_client_cleanup(http->client);
-        http->client = NULL;
-    }
+    AUDIO_SAFE_FREE(http->cache_entry, http_cache_close);
+    _http_set_track(http, NULL);
+    // Keep the clients, so a later open to the same hosts can resume their TLS sessions
+    http_conn_pool_close_all(http->pool);
+    http->client = NULL;
     return ESP_OK;
 }
 
@@ -704,6 +1011,27 @@ static bool _check_range_done(audio_element_handle_t self)
     return last_range;
 }
 
+/*
+ * Request the rest of the range of this connection when it ended early, the parallel ranges start after it
+ */
+static esp_err_t _http_resume_range(audio_element_handle_t self, audio_element_info_t *info)
+{
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
+    int range_size = http->request_range_size;
+    int64_t range_end = http->request_range_end;
+    ESP_LOGW(TAG, "Range ended at %lld before %lld, request the rest", (long long)info->byte_pos, (long long)range_end);
+    http->request_range_size = (int)(range_end + 1 - info->byte_pos);
+    esp_err_t ret = _http_load_uri(self, info);
+    http->request_range_size = range_size;
+    // The Content-Range of the rest set the total to the end of this range
+    audio_element_set_total_bytes(self, http->request_range_total);
+    if (ret == ESP_OK && esp_http_client_get_status_code(http->client) != 206) {
+        ESP_LOGE(TAG, "Invalid range response, status code = %d", esp_http_client_get_status_code(http->client));
+        ret = ESP_FAIL;
+    }
+    return ret;
+}
+
 static int _http_read(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
 {
     http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
@@ -712,20 +1040,54 @@ static int _http_read(audio_element_handle_t self, char *buffer, int len, TickTy
     int wrlen = dispatch_hook(self, HTTP_STREAM_ON_RESPONSE, buffer, len);
     int rlen = wrlen;
     if (rlen == 0) {
-        rlen = _http_read_data(http, buffer, len);
+        if (http->prefetch_active) {
+            rlen = http_prefetch_read(http->prefetch, buffer, len, portMAX_DELAY);
+        } else if (http->readahead_active) {
+            rlen = http_readahead_read(http->readahead, buffer, len, portMAX_DELAY);
+        } else if (http->cache_entry) {
+            rlen = _http_read_cached(self, buffer, len);
+        } else {
+            rlen = _http_read_payload(http, buffer, len);
+        }
     }
-    if (rlen <= 0 && http->request_range_size) {
-        if (_check_range_done(self) == false) {
-            rlen = _http_read_data(http, buffer, len);
+    if (rlen <= 0 && http->request_range_size && http->prefetch_active == false && http->readahead_active == false) {
+        if (http_readahead_is_running(http->readahead)) {
+            if (rlen == 0 && info.byte_pos <= http->request_range_end && _http_resume_range(self, &info) == ESP_OK) {
+                rlen = _http_read_payload(http, buffer, len);
+            }
+            // Continue with the parallel ranges once the range of this connection is read completely
+            if (rlen == 0 && info.byte_pos == http->request_range_end + 1) {
+                http_conn_pool_finish(http->pool, http->client);
+                http->readahead_active = true;
+                rlen = http_readahead_read(http->readahead, buffer, len, portMAX_DELAY);
+            }
+        } else if (_check_range_done(self) == false) {
+            rlen = _http_read_payload(http, buffer, len);
         }
     }
-    if (rlen <= 0 && http->auto_connect_next_track) {
-        if (http_stream_auto_connect_next_track(self) == ESP_OK) {
-            rlen = _http_read_data(http, buffer, len);
+    if (rlen <= 0 && http->auto_connect_next_track && http->prefetch_active == false) {
+        if (http_prefetch_is_running(http->prefetch)) {
+            // The next segment is already on its way, continue with the prefetched stream
+            http_conn_pool_finish(http->pool, http->client);
+            http->prefetch_active = true;
+            rlen = http_prefetch_read(http->prefetch, buffer, len, portMAX_DELAY);
+        } else if (http_stream_auto_connect_next_track(self) == ESP_OK) {
+            rlen = _http_read_payload(http, buffer, len);
         }
     }
+    if (http->abr) {
+        _hls_abr_update(self);
+    }
+    if (rlen < 0 && http->prefetch_active) {
+        ESP_LOGE(TAG, "Failed to read prefetched segments");
+        return ESP_FAIL;
+    }
+    if (rlen < 0 && http->readahead_active) {
+        ESP_LOGE(TAG, "Failed to read parallel ranges");
+        return ESP_FAIL;
+    }
     if (rlen <= 0) {
-        http->_errno = esp_http_client_get_errno(http->client);
+        http->_errno = (http->prefetch_active || http->readahead_active) ? 0 : esp_http_client_get_errno(http->client);
         ESP_LOGW(TAG, "No more data,errno:%d, total_bytes:%llu, rlen = %d", http->_errno, info.byte_pos, rlen);
         if (http->_errno != 0) {  // Error occuered, reset connection
             ESP_LOGW(TAG, "Got %d errno(%s)", http->_errno, strerror(http->_errno));
@@ -744,36 +1106,6 @@ static int _http_read(audio_element_handle_t self, char *buffer, int len, TickTy
         }
         return ESP_OK;
     } else {
-        if (http->hls_key) {
-            int ret = esp_aes_crypt_cbc(&http->hls_key->aes_ctx, ESP_AES_DECRYPT, 
-                 rlen, (unsigned char*)http->hls_key->key.iv, 
-                 (unsigned char*)buffer, (unsigned char*)buffer);
-            if (rlen % 16 != 0) {
-                ESP_LOGE(TAG, "Data length %d not aligned", rlen);
-            }
-            if (ret != 0) {
-                ESP_LOGE(TAG, "Fail to decrypt aes ret %d", ret);
-                return ESP_FAIL;
-            }
-            if ((info.total_bytes && rlen + info.byte_pos >= info.total_bytes) ||
-                rlen < len) {
-                // Remove padding according PKCS#7
-                uint8_t padding = buffer[rlen-1];
-                if (padding && padding <= rlen) {
-                    int idx = rlen - padding;
-                    int paddin_n = padding -1;
-                    while (paddin_n) {
-                        if (buffer[idx++] != padding) {
-                            break;
-                        }
-                        paddin_n--;
-                    }
-                    if (paddin_n == 0) {
-                        rlen -= padding;
-                    }
-                }
-            }
-        }
         audio_element_update_byte_pos(self, rlen);
     }
     ESP_LOGD(TAG, "req lengh=%d, read=%d, pos=%d/%d", len, rlen, (int)info.byte_pos, (int)info.total_bytes);
@@ -834,13 +1166,29 @@ static int _http_process(audio_element_handle_t self, char *in_buffer, int in_le
     return w_size;
 }
 
-static esp_err_t _http_destroy(audio_element_handle_t self)
+static void _http_playlist_free(http_stream_t *http)
 {
-    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
     if (http->playlist) {
+        http_playlist_deinit(http->playlist);
+        AUDIO_SAFE_FREE(http->playlist->lock, mutex_destroy);
         audio_free(http->playlist->data);
         audio_free(http->playlist);
+        http->playlist = NULL;
     }
+}
+
+static esp_err_t _http_destroy(audio_element_handle_t self)
+{
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
+    // The prefetch task is stopped before the playlist it walks is freed
+    AUDIO_SAFE_FREE(http->prefetch, http_prefetch_destroy);
+    _http_playlist_free(http);
+    AUDIO_SAFE_FREE(http->readahead, http_readahead_destroy);
+    AUDIO_SAFE_FREE(http->pool, http_conn_pool_destroy);
+    AUDIO_SAFE_FREE(http->abr, http_abr_destroy);
+    AUDIO_SAFE_FREE(http->cache_entry, http_cache_close);
+    AUDIO_SAFE_FREE(http->cache, http_cache_destroy);
+    audio_free(http->track_uri);
     audio_free(http);
     return ESP_OK;
 }
@@ -893,12 +1241,77 @@ audio_element_handle_t http_stream_init(http_stream_cfg_t *config)
             return NULL;
         });
         http->playlist->data = audio_calloc(1, MAX_PLAYLIST_LINE_SIZE + 1);
-        AUDIO_MEM_CHECK(TAG, http->playlist->data, {
-            audio_free(http->playlist);
+        // The prefetch task walks the playlist while the reader and the application may use it
+        http->playlist->lock = mutex_create();
+        AUDIO_MEM_CHECK(TAG, http->playlist->data && http->playlist->lock, {
+            _http_playlist_free(http);
+            audio_free(http);
+            return NULL;
+        });
+    }
+
+    if (config->enable_abr && config->type == AUDIO_STREAM_READER) {
+        if (http->enable_playlist_parser) {
+            http->abr = http_abr_create();
+            AUDIO_MEM_CHECK(TAG, http->abr, {
+                _http_playlist_free(http);
+                audio_free(http);
+                return NULL;
+            });
+        } else {
+            ESP_LOGW(TAG, "Adaptive bitrate needs enable_playlist_parser");
+        }
+    }
+
+    if (config->prefetch_size > 0 && config->type == AUDIO_STREAM_READER) {
+        if (http->enable_playlist_parser && http->auto_connect_next_track) {
+            http_prefetch_cfg_t prefetch_cfg = {
+                .buffer_size = config->prefetch_size,
+                .task_stack = config->task_stack,
+                .task_prio = config->task_prio,
+                .task_core = config->task_core,
+                .stack_in_ext = config->stack_in_ext,
+                .cert_pem = config->cert_pem,
+                .crt_bundle_attach = config->crt_bundle_attach,
+                .user_agent = config->user_agent,
+                .abr = http->abr,
+                .on_request = _http_worker_request,
+                .on_request_ctx = http,
+            };
+            http->prefetch = http_prefetch_create(&prefetch_cfg);
+            AUDIO_MEM_CHECK(TAG, http->prefetch, {
+                AUDIO_SAFE_FREE(http->abr, http_abr_destroy);
+                _http_playlist_free(http);
+                audio_free(http);
+                return NULL;
+            });
+        } else {
+            ESP_LOGW(TAG, "Prefetch needs enable_playlist_parser and auto_connect_next_track");
+        }
+    }
+
+    if (config->range_window > 1 && config->request_range_size > 0 && config->type == AUDIO_STREAM_READER) {
+        http_readahead_cfg_t readahead_cfg = {
+            .range_size = config->request_range_size,
+            .max_window = config->range_window,
+            .task_stack = config->task_stack,
+            .task_prio = config->task_prio,
+            .task_core = config->task_core,
+            .stack_in_ext = config->stack_in_ext,
+            .cert_pem = config->cert_pem,
+            .crt_bundle_attach = config->crt_bundle_attach,
+            .user_agent = config->user_agent,
+            .on_request = _http_worker_request,
+            .on_request_ctx = http,
+        };
+        http->readahead = http_readahead_create(&readahead_cfg);
+        AUDIO_MEM_CHECK(TAG, http->readahead, {
+            AUDIO_SAFE_FREE(http->prefetch, http_prefetch_destroy);
+            AUDIO_SAFE_FREE(http->abr, http_abr_destroy);
+            _http_playlist_free(http);
             audio_free(http);
             return NULL;
         });
-        STAILQ_INIT(&http->playlist->tracks);
     }
 
     if (config->type == AUDIO_STREAM_READER) {
@@ -907,17 +1320,29 @@ audio_element_handle_t http_stream_init(http_stream_cfg_t *config)
         cfg.write = _http_write;
     }
     http->request_range_size = config->request_range_size;
+    if (config->cache_dir && config->type == AUDIO_STREAM_READER) {
+        if (config->request_range_size == 0) {
+            http->cache_dir = config->cache_dir;
+            http->cache_size = config->cache_size > 0 ? config->cache_size : HTTP_STREAM_CACHE_SIZE;
+        } else {
+            ESP_LOGW(TAG, "Cache does not work with request_range_size");
+        }
+    }
     if (config->request_size) {
         cfg.buffer_len = config->request_size;
     }
 
     el = audio_element_init(&cfg);
     AUDIO_MEM_CHECK(TAG, el, {
-        audio_free(http->playlist);
+        AUDIO_SAFE_FREE(http->prefetch, http_prefetch_destroy);
+        AUDIO_SAFE_FREE(http->readahead, http_readahead_destroy);
+        AUDIO_SAFE_FREE(http->abr, http_abr_destroy);
+        _http_playlist_free(http);
         audio_free(http);
         return NULL;
     });
     audio_element_setdata(el, http);
+    http->el = el;
     return el;
 }
 
@@ -945,13 +1370,23 @@ esp_err_t http_stream_auto_connect_next_track(audio_element_handle_t el)
     audio_element_info_t info;
     audio_element_getinfo(el, &info);
     http_stream_t *http = (http_stream_t *)audio_element_getdata(el);
+    if (_hls_abr_switch(el) != ESP_OK) {
+        return ESP_FAIL;
+    }
     char *track = _playlist_get_next_track(el);
     if (track) {
-        esp_http_client_set_url(http->client, track);
+        bool reused = false;
+        http->client = http_conn_pool_get(http->pool, track, &reused);
+        AUDIO_MEM_CHECK(TAG, http->client, return ESP_ERR_NO_MEM);
         char *buffer = NULL;
         int post_len = esp_http_client_get_post_field(http->client, &buffer);
 redirection:
         if ((esp_http_client_open(http->client, post_len)) != ESP_OK) {
+            if (reused) {
+                reused = false;
+                esp_http_client_close(http->client);
+                goto redirection;
+            }
             ESP_LOGE(TAG, "Failed to open http stream");
             return ESP_FAIL;
         }
@@ -960,12 +1395,22 @@ redirection:
             return ESP_FAIL;
         }
         info.total_bytes = esp_http_client_fetch_headers(http->client);
+        if (info.total_bytes < 0 && reused && esp_http_client_get_status_code(http->client) <= 0) {
+            reused = false;
+            esp_http_client_close(http->client);
+            goto redirection;
+        }
+        reused = false;
         ESP_LOGI(TAG, "total_bytes=%d", (int)info.total_bytes);
         int status_code = esp_http_client_get_status_code(http->client);
         if (status_code == 301 || status_code == 302) {
             esp_http_client_set_redirection(http->client);
             goto redirection;
         }
+        // Every segment is encrypted on its own, restart the decryption with its IV
+        if (http->hls_key && _prepare_crypt(http) != ESP_OK) {
+            return ESP_FAIL;
+        }
         return ESP_OK;
     }
     return ESP_FAIL;
@@ -974,14 +1419,16 @@ redirection:
 esp_err_t http_stream_fetch_again(audio_element_handle_t el)
 {
     http_stream_t *http = (http_stream_t *)audio_element_getdata(el);
+    http_playlist_lock(http->playlist);
     if (!http->playlist->is_incomplete) {
+        http_playlist_unlock(http->playlist);
         ESP_LOGI(TAG, "Finished playing.");
         return ESP_ERR_NOT_SUPPORTED;
-    } else {
-        ESP_LOGI(TAG, "Fetching again %s %p", http->playlist->host_uri, http->playlist->host_uri);
-        audio_element_set_uri(el, http->playlist->host_uri);
-        http->is_playlist_resolved = false;
     }
+    ESP_LOGI(TAG, "Fetching again %s %p", http->playlist->host_uri, http->playlist->host_uri);
+    audio_element_set_uri(el, http->playlist->host_uri);
+    http_playlist_unlock(http->playlist);
+    http->is_playlist_resolved = false;
     return ESP_OK;
 }
 
@@ -996,5 +1443,21 @@ esp_err_t http_stream_set_server_cert(audio_element_handle_t el, const char *cer
 {
     http_stream_t *http = (http_stream_t *)audio_element_getdata(el);
     http->cert_pem = cert;
+    // The clients are created again with the new certificate on next open
+    if (http->is_open == false) {
+        AUDIO_SAFE_FREE(http->pool, http_conn_pool_destroy);
+        http->client = NULL;
+    }
     return ESP_OK;
 }
+
+esp_err_t http_stream_get_abr_info(audio_element_handle_t el, http_stream_abr_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_ERR_INVALID_ARG);
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(el);
+    if (http->abr == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return http_abr_get_info(http->abr, info, NULL, NULL);
+}
@@ -42,6 +42,8 @@
 #include "esp_alc.h"
 #include "board_pins_config.h"
 #include "audio_idf_version.h"
+#include "i2s_stream_conv.h"
+#include "i2s_stream_asrc.h"
 
 static const char *TAG = "I2S_STREAM";
 
@@ -64,6 +66,13 @@ typedef struct i2s_stream {
     int                 volume;
     bool                uninstall_drv;
     int                 data_bit_width;
+    bool                conv_alc;       /*!< Volume is applied by the sample converter instead of ALC */
+    i2s_stream_conv_handle_t conv;
+    struct {
+        bool                     enable;
+        int                      target_fill;
+        i2s_stream_asrc_handle_t asrc;
+    } drift;
 } i2s_stream_t;
 #ifdef SOC_I2S_SUPPORTS_ADC_DAC
 static esp_err_t i2s_mono_fix(int bits, uint8_t *sbuff, uint32_t len)
@@ -92,35 +101,6 @@ static esp_err_t i2s_mono_fix(int bits, uint8_t *sbuff, uint32_t len)
     }
     return ESP_OK;
 }
-
-/**
- * @brief Scale data to 16bit/32bit for I2S DMA output.
- *        DAC can only output 8bit data value.
- *        I2S DMA will still send 16bit or 32bit data, the highest 8bit contains DAC data.
- */
-static int i2s_dac_data_scale(int bits, uint8_t *sBuff, uint32_t len)
-{
-    if (bits == 16) {
-        short *buf16 = (short *)sBuff;
-        int k = len >> 1;
-        for (int i = 0; i < k; i++) {
-            buf16[i] &= 0xff00;
-            buf16[i] += 0x8000;//turn signed value into unsigned, expand negative value into positive range
-        }
-    } else if (bits == 32) {
-        int *buf32 = (int *)sBuff;
-        int k = len >> 2;
-        for (int i = 0; i < k; i++) {
-            buf32[i] &= 0xff000000;
-            buf32[i] += 0x80000000;//turn signed value into unsigned
-        }
-    } else {
-        ESP_LOGE(TAG, "in %s %dbits is not supported", __func__, bits);
-        return -1;
-    }
-
-    return 0;
-}
 #endif
 
 static inline esp_err_t i2s_stream_check_data_bits(i2s_stream_t *i2s, int bits)
@@ -182,7 +162,9 @@ static esp_err_t _i2s_open(audio_element_handle_t self)
         ESP_LOGI(TAG, "AUDIO_STREAM_WRITER");
     }
     i2s->is_open = true;
-    if (i2s->use_alc) {
+    if (i2s->conv_alc) {
+        i2s_stream_conv_set_volume(i2s->conv, true, i2s->volume);
+    } else if (i2s->use_alc) {
         i2s->volume_handle = alc_volume_setup_open();
         if (i2s->volume_handle == NULL) {
             ESP_LOGE(TAG, "i2s create the handle for setting volume failed, in line(%d)", __LINE__);
@@ -198,6 +180,8 @@ static esp_err_t _i2s_destroy(audio_element_handle_t self)
     if (i2s->uninstall_drv) {
         i2s_driver_uninstall(i2s->config.i2s_port);
     }
+    i2s_stream_conv_destroy(i2s->conv);
+    i2s_stream_asrc_destroy(i2s->drift.asrc);
     audio_free(i2s);
     return ESP_OK;
 }
@@ -214,11 +198,13 @@ static esp_err_t _i2s_close(audio_element_handle_t self)
         audio_element_report_pos(self);
         audio_element_set_byte_pos(self, 0);
     }
-    if (i2s->use_alc) {
+    if (i2s->use_alc && !i2s->conv_alc) {
         if (i2s->volume_handle != NULL) {
             alc_volume_setup_close(i2s->volume_handle);
+            i2s->volume_handle = NULL;
         }
     }
+    i2s_stream_asrc_reset(i2s->drift.asrc);
     return ESP_OK;
 }
 
@@ -243,45 +229,70 @@ static int _i2s_write(audio_element_handle_t self, char *buffer, int len, TickTy
 {
     i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(self);
     size_t bytes_written = 0;
+    if (len <= 0) {
+        return 0;
+    }
     audio_element_info_t info;
     audio_element_getinfo(self, &info);
     int target_bits = info.bits;
-    if (len > 0) {
+    i2s_stream_conv_cfg_t conv_cfg = {
+        .in_bits = info.bits,
+        .out_bits = info.bits,
+        .channels = info.channels,
+    };
 #ifdef CONFIG_IDF_TARGET_ESP32
-        target_bits = I2S_BITS_PER_SAMPLE_32BIT;
-        if (info.channels == 1) {
-            i2s_mono_fix(info.bits, (uint8_t *)buffer, len);
-        }
+    target_bits = I2S_BITS_PER_SAMPLE_32BIT;
+    conv_cfg.swap_pair = (info.channels == 1);
 #endif
 #if SOC_I2S_SUPPORTS_ADC_DAC
-        if ((i2s->config.i2s_config.mode & I2S_MODE_DAC_BUILT_IN) != 0) {
-            i2s_dac_data_scale(info.bits, (uint8_t *)buffer, len);
-        }
+    conv_cfg.dac_scale = ((i2s->config.i2s_config.mode & I2S_MODE_DAC_BUILT_IN) != 0);
 #endif
+    if ((i2s->config.need_expand && (target_bits != i2s->config.expand_src_bits)) || (i2s->data_bit_width == I2S_BITS_PER_SAMPLE_24BIT)) {
+        conv_cfg.in_bits = i2s->config.expand_src_bits;
+        conv_cfg.out_bits = target_bits;
     }
-
-    if (len) {
-        if ((i2s->config.need_expand && (target_bits != i2s->config.expand_src_bits)) || (i2s->data_bit_width == I2S_BITS_PER_SAMPLE_24BIT)) {
-            i2s_write_expand(i2s->config.i2s_port,
-                            buffer,
-                            len,
-                            i2s->config.expand_src_bits,
-                            target_bits,
-                            &bytes_written,
-                            ticks_to_wait);
-        } else {
-            i2s_write(i2s->config.i2s_port, buffer, len, &bytes_written, ticks_to_wait);
-        }
+    // Mono swap, DAC scale, expand and volume are all done by the converter in one pass over the data
+    if (i2s_stream_conv_setup(i2s->conv, &conv_cfg) != ESP_OK) {
+        i2s_write(i2s->config.i2s_port, buffer, len, &bytes_written, ticks_to_wait);
+        return bytes_written;
+    }
+    char *out = NULL;
+    int out_len = i2s_stream_conv_process(i2s->conv, buffer, len, &out);
+    if (out_len <= 0) {
+        return out_len;
+    }
+    i2s_write(i2s->config.i2s_port, out, out_len, &bytes_written, ticks_to_wait);
+    if (out_len != len) {
+        bytes_written = (uint64_t)bytes_written * len / out_len;
     }
-
     return bytes_written;
 }
 
+static char *i2s_stream_drift_input(audio_element_handle_t self, i2s_stream_t *i2s, int len)
+{
+    if (i2s->drift.enable == false) {
+        return NULL;
+    }
+    audio_element_info_t info = { 0 };
+    audio_element_getinfo(self, &info);
+    if (i2s_stream_asrc_set_format(i2s->drift.asrc, info.bits, info.channels) != ESP_OK) {
+        return NULL;
+    }
+    ringbuf_handle_t input_rb = audio_element_get_input_ringbuf(self);
+    if (input_rb) {
+        int target = i2s->drift.target_fill > 0 ? i2s->drift.target_fill : rb_get_size(input_rb) / 2;
+        i2s_stream_asrc_update(i2s->drift.asrc, rb_bytes_filled(input_rb), target);
+    }
+    return i2s_stream_asrc_get_input(i2s->drift.asrc, len);
+}
+
 static int _i2s_process(audio_element_handle_t self, char *in_buffer, int in_len)
 {
-    int r_size = audio_element_input(self, in_buffer, in_len);
-    int w_size = 0;
     i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(self);
+    // With drift compensation the input is read into the resampler directly
+    char *drift_in = i2s_stream_drift_input(self, i2s, in_len);
+    int r_size = audio_element_input(self, drift_in ? drift_in : in_buffer, in_len);
+    int w_size = 0;
     audio_element_info_t i2s_info = {0};
     if (r_size == AEL_IO_TIMEOUT) {
 #if SOC_I2S_SUPPORTS_ADC_DAC
@@ -296,13 +307,27 @@ static int _i2s_process(audio_element_handle_t self, char *in_buffer, int in_len
         audio_element_multi_output(self, in_buffer, r_size, 0);
         w_size = audio_element_output(self, in_buffer, r_size);
     } else if (r_size > 0) {
-        if (i2s->use_alc) {
+        int in_size = r_size;
+        if (drift_in) {
+            r_size = i2s_stream_asrc_process(i2s->drift.asrc, in_size, &in_buffer);
+            if (r_size < 0) {
+                return r_size;
+            }
+            if (r_size == 0) {
+                // Not a whole frame yet, the converter keeps it for the next block
+                audio_element_update_byte_pos(self, in_size);
+                return in_size;
+            }
+        }
+        if (i2s->use_alc && !i2s->conv_alc) {
             audio_element_getinfo(self, &i2s_info);
             alc_volume_setup_process(in_buffer, r_size, i2s_info.channels, i2s->volume_handle, i2s->volume);
         }
         audio_element_multi_output(self, in_buffer, r_size, 0);
         w_size = audio_element_output(self, in_buffer, r_size);
-        audio_element_update_byte_pos(self, w_size);
+        if (w_size > 0) {
+            audio_element_update_byte_pos(self, in_size);
+        }
     } else {
         esp_err_t ret = i2s_stream_clear_dma_buffer(self);
         if (ret != ESP_OK) {
@@ -369,6 +394,7 @@ esp_err_t i2s_stream_set_clk(audio_element_handle_t i2s_stream, int rate, int bi
         ESP_LOGE(TAG, "i2s_set_clk failed, type = %d,port:%d", i2s->config.type, i2s->config.i2s_port);
         err = ESP_FAIL;
     }
+    i2s_stream_asrc_reset(i2s->drift.asrc);
     if (state == AEL_STATE_RUNNING) {
         audio_element_resume(i2s_stream, 0, 0);
     }
@@ -380,6 +406,9 @@ int i2s_alc_volume_set(audio_element_handle_t i2s_stream, int volume)
     i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(i2s_stream);
     if (i2s->use_alc) {
         i2s->volume = volume;
+        if (i2s->conv_alc) {
+            i2s_stream_conv_set_volume(i2s->conv, true, volume);
+        }
         return ESP_OK;
     } else {
         ESP_LOGW(TAG, "The ALC don't be used. It can not be set.");
@@ -434,10 +463,18 @@ audio_element_handle_t i2s_stream_init(i2s_stream_cfg_t *config)
         cfg.read = _i2s_read;
     } else if (config->type == AUDIO_STREAM_WRITER) {
         cfg.write = _i2s_write;
+        i2s->conv = i2s_stream_conv_create();
+        AUDIO_MEM_CHECK(TAG, i2s->conv, {
+            audio_free(i2s);
+            return NULL;
+        });
+        // Multiple outputs must carry the volume adjusted data, so leave the volume to ALC in that case
+        i2s->conv_alc = i2s->use_alc && (config->multi_out_num == 0);
     }
 
     esp_err_t ret = i2s_driver_install(i2s->config.i2s_port, &i2s->config.i2s_config, 0, NULL);
     if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        i2s_stream_conv_destroy(i2s->conv);
         audio_free(i2s);
         return NULL;
     }
@@ -445,6 +482,7 @@ audio_element_handle_t i2s_stream_init(i2s_stream_cfg_t *config)
 
     el = audio_element_init(&cfg);
     AUDIO_MEM_CHECK(TAG, el, {
+        i2s_stream_conv_destroy(i2s->conv);
         audio_free(i2s);
         return NULL;
     });
@@ -542,3 +580,44 @@ esp_err_t i2s_stream_sync_delay(audio_element_handle_t i2s_stream, int delay_ms)
 
     return ESP_OK;
 }
+
+esp_err_t i2s_stream_set_drift_compensation(audio_element_handle_t i2s_stream, bool enable, i2s_stream_drift_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, i2s_stream, return ESP_ERR_INVALID_ARG);
+    i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(i2s_stream);
+    if (i2s->type != AUDIO_STREAM_WRITER) {
+        ESP_LOGE(TAG, "Drift compensation is only supported by the I2S writer");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    int max_ppm = (cfg && cfg->max_ppm > 0) ? cfg->max_ppm : I2S_STREAM_DRIFT_MAX_PPM;
+    if (max_ppm > I2S_STREAM_DRIFT_PPM_LIMIT) {
+        max_ppm = I2S_STREAM_DRIFT_PPM_LIMIT;
+    }
+    if (enable && i2s->drift.asrc == NULL) {
+        i2s->drift.asrc = i2s_stream_asrc_create(max_ppm);
+        AUDIO_MEM_CHECK(TAG, i2s->drift.asrc, return ESP_ERR_NO_MEM);
+    }
+    // The element task uses the converter in _i2s_process, so change it while the task is paused
+    audio_element_state_t state = audio_element_get_state(i2s_stream);
+    if (state == AEL_STATE_RUNNING) {
+        audio_element_pause(i2s_stream);
+    }
+    if (enable) {
+        i2s_stream_asrc_set_max_ppm(i2s->drift.asrc, max_ppm);
+        i2s->drift.target_fill = cfg ? cfg->target_fill : 0;
+        i2s_stream_asrc_reset(i2s->drift.asrc);
+    }
+    i2s->drift.enable = enable;
+    if (state == AEL_STATE_RUNNING) {
+        audio_element_resume(i2s_stream, 0, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_stream_get_drift_ppm(audio_element_handle_t i2s_stream, float *ppm)
+{
+    AUDIO_NULL_CHECK(TAG, i2s_stream && ppm, return ESP_ERR_INVALID_ARG);
+    i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(i2s_stream);
+    *ppm = i2s->drift.enable ? i2s_stream_asrc_get_ppm(i2s->drift.asrc) : 0;
+    return ESP_OK;
+}
@@ -0,0 +1,273 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "i2s_stream_asrc.h"
+
+static const char *TAG = "I2S_STREAM_ASRC";
+
+#define ASRC_HISTORY_FRAMES   (3)          /* Frames kept for the 4 points interpolator */
+#define ASRC_MAX_CHANNELS     (8)
+#define ASRC_HEAD_SIZE        ((ASRC_HISTORY_FRAMES + 1) * ASRC_MAX_CHANNELS * sizeof(int32_t)) /* History and a partial frame */
+#define ASRC_ONE              (1ULL << 32) /* Position unit, Q32.32 in frames */
+#define ASRC_FILL_SMOOTH      (0.05f)      /* Smoothing of the bursty fill level */
+#define ASRC_KP_RATIO         (0.5f)       /* Proportional gain, ppm per unit error relative to max_ppm */
+#define ASRC_KI_RATIO         (0.002f)     /* Integral gain per update, relative to max_ppm */
+
+struct i2s_stream_asrc {
+    int       bytes;          /*!< Bytes per sample */
+    int       channels;
+    int       frame_size;
+    int       max_ppm;
+    uint64_t  pos;            /*!< Read position inside the work buffer, Q32.32 frames */
+    uint64_t  step;           /*!< Position increment per output frame, Q32.32 frames */
+    float     ppm;
+    float     fill_avg;
+    float     integral;
+    bool      fill_valid;
+    int       partial;        /*!< Bytes of an incomplete frame left from the last block */
+    char     *work;           /*!< History frames, the partial frame, then the input block */
+    int       work_size;
+    char     *out;
+    int       out_size;
+};
+
+static inline int64_t asrc_load(const char *p, const int bytes)
+{
+    if (bytes == 2) {
+        return *(const int16_t *)p;
+    }
+    return *(const int32_t *)p;
+}
+
+static inline void asrc_store(char *p, int64_t v, const int bytes)
+{
+    if (bytes == 2) {
+        if (v > INT16_MAX) {
+            v = INT16_MAX;
+        } else if (v < INT16_MIN) {
+            v = INT16_MIN;
+        }
+        *(int16_t *)p = (int16_t)v;
+    } else {
+        if (v > INT32_MAX) {
+            v = INT32_MAX;
+        } else if (v < INT32_MIN) {
+            v = INT32_MIN;
+        }
+        *(int32_t *)p = (int32_t)v;
+    }
+}
+
+/*
+ * 4 points 3rd order Hermite (Catmull-Rom) interpolation between x0 and x1 with the fraction in Q16,
+ * the coefficients are doubled to stay in integers.
+ */
+static inline int64_t asrc_interp(int64_t xm1, int64_t x0, int64_t x1, int64_t x2, int64_t f)
+{
+    int64_t c1 = x1 - xm1;
+    int64_t c2 = 2 * xm1 - 5 * x0 + 4 * x1 - x2;
+    int64_t c3 = (x2 - xm1) + 3 * (x0 - x1);
+    return x0 + (((((((c3 * f) >> 16) + c2) * f) >> 16) + c1) * f >> 17);
+}
+
+static inline __attribute__((always_inline)) int asrc_run(i2s_stream_asrc_handle_t asrc, int in_frames, const int bytes)
+{
+    const int ch = asrc->channels;
+    const int frame_size = asrc->frame_size;
+    const uint64_t end = (uint64_t)in_frames << 32;
+    uint64_t pos = asrc->pos;
+    char *out = asrc->out;
+    int out_frames = 0;
+    while (pos < end) {
+        const char *p = asrc->work + (pos >> 32) * frame_size;
+        int64_t f = (pos >> 16) & 0xffff;
+        for (int c = 0; c < ch; c++) {
+            const char *s = p + c * bytes;
+            int64_t v = asrc_interp(asrc_load(s, bytes), asrc_load(s + frame_size, bytes),
+                                    asrc_load(s + 2 * frame_size, bytes), asrc_load(s + 3 * frame_size, bytes), f);
+            asrc_store(out, v, bytes);
+            out += bytes;
+        }
+        out_frames++;
+        pos += asrc->step;
+    }
+    asrc->pos = pos - end;
+    return out_frames;
+}
+
+i2s_stream_asrc_handle_t i2s_stream_asrc_create(int max_ppm)
+{
+    i2s_stream_asrc_handle_t asrc = audio_calloc(1, sizeof(struct i2s_stream_asrc));
+    AUDIO_MEM_CHECK(TAG, asrc, return NULL);
+    asrc->max_ppm = max_ppm;
+    asrc->step = ASRC_ONE;
+    return asrc;
+}
+
+void i2s_stream_asrc_set_max_ppm(i2s_stream_asrc_handle_t asrc, int max_ppm)
+{
+    if (asrc == NULL) {
+        return;
+    }
+    asrc->max_ppm = max_ppm;
+}
+
+esp_err_t i2s_stream_asrc_set_format(i2s_stream_asrc_handle_t asrc, int bits, int channels)
+{
+    AUDIO_NULL_CHECK(TAG, asrc, return ESP_ERR_INVALID_ARG);
+    if ((bits != 16 && bits != 32) || channels <= 0 || channels > ASRC_MAX_CHANNELS) {
+        ESP_LOGW(TAG, "Drift compensation does not support %d bits %d channels", bits, channels);
+        asrc->bytes = 0;
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (asrc->bytes != (bits >> 3) || asrc->channels != channels) {
+        asrc->bytes = bits >> 3;
+        asrc->channels = channels;
+        asrc->frame_size = asrc->bytes * channels;
+        if (asrc->work) {
+            memset(asrc->work, 0, ASRC_HEAD_SIZE);
+        }
+        asrc->pos = 0;
+        asrc->partial = 0;
+    }
+    return ESP_OK;
+}
+
+void i2s_stream_asrc_update(i2s_stream_asrc_handle_t asrc, int filled, int target)
+{
+    if (asrc == NULL || target <= 0) {
+        return;
+    }
+    if (asrc->fill_valid == false) {
+        asrc->fill_avg = filled;
+        asrc->fill_valid = true;
+    }
+    asrc->fill_avg += (filled - asrc->fill_avg) * ASRC_FILL_SMOOTH;
+    float err = (asrc->fill_avg - target) / target;
+    if (err > 1.0f) {
+        err = 1.0f;
+    } else if (err < -1.0f) {
+        err = -1.0f;
+    }
+    float max_ppm = asrc->max_ppm;
+    asrc->integral += err * ASRC_KI_RATIO * max_ppm;
+    if (asrc->integral > max_ppm) {
+        asrc->integral = max_ppm;
+    } else if (asrc->integral < -max_ppm) {
+        asrc->integral = -max_ppm;
+    }
+    float ppm = err * ASRC_KP_RATIO * max_ppm + asrc->integral;
+    if (ppm > max_ppm) {
+        ppm = max_ppm;
+    } else if (ppm < -max_ppm) {
+        ppm = -max_ppm;
+    }
+    asrc->ppm = ppm;
+    // A fuller buffer means the source runs faster, so read the input faster
+    asrc->step = ASRC_ONE + (int64_t)(ppm * 4294.967296f);
+}
+
+char *i2s_stream_asrc_get_input(i2s_stream_asrc_handle_t asrc, int len)
+{
+    AUDIO_NULL_CHECK(TAG, asrc, return NULL);
+    int head = ASRC_HEAD_SIZE;
+    if (asrc->work == NULL || head + len > asrc->work_size) {
+        char *work = audio_calloc(1, head + len);
+        AUDIO_MEM_CHECK(TAG, work, return NULL);
+        if (asrc->work) {
+            memcpy(work, asrc->work, head);
+            audio_free(asrc->work);
+        }
+        asrc->work = work;
+        asrc->work_size = head + len;
+    }
+    if (asrc->frame_size == 0) {
+        return asrc->work + head;
+    }
+    // The new data goes right after the partial frame left by the last block
+    return asrc->work + ASRC_HISTORY_FRAMES * asrc->frame_size + asrc->partial;
+}
+
+int i2s_stream_asrc_process(i2s_stream_asrc_handle_t asrc, int in_len, char **out)
+{
+    AUDIO_NULL_CHECK(TAG, asrc && asrc->work && asrc->frame_size, return ESP_FAIL);
+    in_len += asrc->partial;
+    int in_frames = in_len / asrc->frame_size;
+    // The step never goes below 1 - max_ppm, so a few spare frames are enough
+    int max_out = (in_frames + in_frames / 512 + 4) * asrc->frame_size;
+    if (asrc->out == NULL || max_out > asrc->out_size) {
+        if (asrc->out) {
+            audio_free(asrc->out);
+        }
+        asrc->out = audio_malloc(max_out);
+        asrc->out_size = asrc->out ? max_out : 0;
+        AUDIO_MEM_CHECK(TAG, asrc->out, return ESP_ERR_NO_MEM);
+    }
+    int out_frames = asrc->bytes == 2 ? asrc_run(asrc, in_frames, 2) : asrc_run(asrc, in_frames, 4);
+    // Keep the last frames as history of the next block, and the incomplete frame in front of it
+    asrc->partial = in_len - in_frames * asrc->frame_size;
+    memmove(asrc->work, asrc->work + in_frames * asrc->frame_size, ASRC_HISTORY_FRAMES * asrc->frame_size + asrc->partial);
+    *out = asrc->out;
+    return out_frames * asrc->frame_size;
+}
+
+float i2s_stream_asrc_get_ppm(i2s_stream_asrc_handle_t asrc)
+{
+    return asrc ? asrc->ppm : 0;
+}
+
+void i2s_stream_asrc_reset(i2s_stream_asrc_handle_t asrc)
+{
+    if (asrc == NULL) {
+        return;
+    }
+    if (asrc->work) {
+        memset(asrc->work, 0, ASRC_HEAD_SIZE);
+    }
+    asrc->pos = 0;
+    asrc->partial = 0;
+    asrc->step = ASRC_ONE;
+    asrc->ppm = 0;
+    asrc->integral = 0;
+    asrc->fill_valid = false;
+}
+
+void i2s_stream_asrc_destroy(i2s_stream_asrc_handle_t asrc)
+{
+    if (asrc == NULL) {
+        return;
+    }
+    if (asrc->work) {
+        audio_free(asrc->work);
+    }
+    if (asrc->out) {
+        audio_free(asrc->out);
+    }
+    audio_free(asrc);
+}
@@ -0,0 +1,138 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _I2S_STREAM_ASRC_H_
+#define _I2S_STREAM_ASRC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Asynchronous sample rate converter handle used by the i2s_stream writer
+ *
+ *         It resamples the input by a ratio close to 1 to follow the clock drift between the data source
+ *         and the local I2S clock. The ratio is driven by a PI controller on the input ringbuffer fill level.
+ */
+typedef struct i2s_stream_asrc *i2s_stream_asrc_handle_t;
+
+/**
+ * @brief      Create the converter
+ *
+ * @param[in]  max_ppm  Maximum correction in ppm
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  Converter handle
+ */
+i2s_stream_asrc_handle_t i2s_stream_asrc_create(int max_ppm);
+
+/**
+ * @brief      Change the maximum correction, the controller keeps its state
+ *
+ * @param[in]  asrc     The converter handle
+ * @param[in]  max_ppm  Maximum correction in ppm
+ */
+void i2s_stream_asrc_set_max_ppm(i2s_stream_asrc_handle_t asrc, int max_ppm);
+
+/**
+ * @brief      Set the sample format, the interpolation history is dropped when the format changes
+ *
+ * @param[in]  asrc      The converter handle
+ * @param[in]  bits      Bits per sample, 16 and 32 are supported
+ * @param[in]  channels  Number of channels
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_NOT_SUPPORTED
+ */
+esp_err_t i2s_stream_asrc_set_format(i2s_stream_asrc_handle_t asrc, int bits, int channels);
+
+/**
+ * @brief      Feed the controller with the current fill level of the buffer in front of the sink
+ *
+ * @param[in]  asrc    The converter handle
+ * @param[in]  filled  Filled bytes
+ * @param[in]  target  Fill level to keep in bytes
+ */
+void i2s_stream_asrc_update(i2s_stream_asrc_handle_t asrc, int filled, int target);
+
+/**
+ * @brief      Get the buffer where the caller places the next input block
+ *
+ * @param[in]  asrc  The converter handle
+ * @param[in]  len   Maximum input length in bytes
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  Input buffer with at least `len` bytes
+ */
+char *i2s_stream_asrc_get_input(i2s_stream_asrc_handle_t asrc, int len);
+
+/**
+ * @brief      Resample the input block previously placed into the input buffer,
+ *             a trailing incomplete frame is kept and completed by the next block
+ *
+ * @param[in]  asrc    The converter handle
+ * @param[in]  in_len  Valid input length in bytes
+ * @param[out] out     Pointer to the resampled data
+ *
+ * @return
+ *     - >= 0  Length of the resampled data in bytes
+ *     - < 0   Failed
+ */
+int i2s_stream_asrc_process(i2s_stream_asrc_handle_t asrc, int in_len, char **out);
+
+/**
+ * @brief      Get the correction currently applied
+ *
+ * @param[in]  asrc  The converter handle
+ *
+ * @return     Correction in ppm, positive when the input is consumed faster than the nominal rate
+ */
+float i2s_stream_asrc_get_ppm(i2s_stream_asrc_handle_t asrc);
+
+/**
+ * @brief      Drop the interpolation history, the kept partial frame and the controller state
+ *
+ * @param[in]  asrc  The converter handle
+ */
+void i2s_stream_asrc_reset(i2s_stream_asrc_handle_t asrc);
+
+/**
+ * @brief      Destroy the converter
+ *
+ * @param[in]  asrc  The converter handle
+ */
+void i2s_stream_asrc_destroy(i2s_stream_asrc_handle_t asrc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _I2S_STREAM_ASRC_H_ */
@@ -0,0 +1,288 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "i2s_stream_conv.h"
+
+static const char *TAG = "I2S_STREAM_CONV";
+
+#define I2S_CONV_GAIN_SHIFT      (16)
+#define I2S_CONV_GAIN_UNITY      (1 << I2S_CONV_GAIN_SHIFT)
+#define I2S_CONV_VOLUME_MIN      (-64)
+#define I2S_CONV_VOLUME_MAX      (63)
+#define I2S_CONV_BYTES_IDX(b)    ((b) - 2)
+
+typedef struct i2s_stream_conv i2s_stream_conv_t;
+
+typedef void (*i2s_conv_kernel_t)(i2s_stream_conv_t *conv, const uint8_t *in, uint8_t *out, int pairs);
+
+struct i2s_stream_conv {
+    i2s_stream_conv_cfg_t  cfg;
+    bool                   configured;
+    int                    in_bytes;
+    int                    out_bytes;
+    i2s_conv_kernel_t      kernel;         /*!< Kernel without volume */
+    i2s_conv_kernel_t      kernel_vol;     /*!< Kernel with volume */
+    bool                   use_volume;
+    int32_t                gain;           /*!< Current gain, Q16 */
+    int32_t                gain_target;    /*!< Gain to reach at the end of the next block, Q16 */
+    int32_t                gain_step;      /*!< Gain increment per sample pair in the current block */
+    char                  *buf;
+    int                    buf_size;
+};
+
+static inline int32_t conv_load(const uint8_t *p, const int bytes)
+{
+    if (bytes == 2) {
+        return (int32_t)((uint32_t)(*(const uint16_t *)p) << 16);
+    } else if (bytes == 3) {
+        return (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+    }
+    return *(const int32_t *)p;
+}
+
+static inline void conv_store(uint8_t *p, int32_t s, const int bytes)
+{
+    if (bytes == 2) {
+        *(int16_t *)p = (int16_t)(s >> 16);
+    } else if (bytes == 3) {
+        p[0] = (uint8_t)(s >> 8);
+        p[1] = (uint8_t)(s >> 16);
+        p[2] = (uint8_t)(s >> 24);
+    } else {
+        *(int32_t *)p = s;
+    }
+}
+
+static inline int32_t conv_apply_gain(int32_t s, int32_t gain)
+{
+    int64_t v = ((int64_t)s * gain) >> I2S_CONV_GAIN_SHIFT;
+    if (v > INT32_MAX) {
+        return INT32_MAX;
+    } else if (v < INT32_MIN) {
+        return INT32_MIN;
+    }
+    return (int32_t)v;
+}
+
+static inline int32_t conv_dac_scale(int32_t s)
+{
+    /* Keep the highest 8 bits and turn signed value into unsigned one */
+    return (int32_t)(((uint32_t)s & 0xff000000) + 0x80000000);
+}
+
+/*
+ * All kernels are instances of this one, the sample sizes and the volume switch are compile time constants
+ * so the compiler drops the unused branches. Samples are handled in pairs, both are loaded before either is
+ * stored, which makes the conversion safe in place whenever the output sample is not larger than the input one.
+ */
+static inline __attribute__((always_inline)) void conv_run(i2s_stream_conv_t *conv, const uint8_t *in, uint8_t *out, int pairs,
+                                                           const int ib, const int ob, const bool vol)
+{
+    const bool swap = conv->cfg.swap_pair;
+    const bool dac = conv->cfg.dac_scale;
+    int32_t gain = conv->gain;
+    const int32_t step = conv->gain_step;
+    for (int i = 0; i < pairs; i++) {
+        int32_t s0 = conv_load(in, ib);
+        int32_t s1 = conv_load(in + ib, ib);
+        in += ib << 1;
+        if (vol) {
+            s0 = conv_apply_gain(s0, gain);
+            s1 = conv_apply_gain(s1, gain);
+            gain += step;
+        }
+        if (dac) {
+            s0 = conv_dac_scale(s0);
+            s1 = conv_dac_scale(s1);
+        }
+        if (swap) {
+            int32_t t = s0;
+            s0 = s1;
+            s1 = t;
+        }
+        conv_store(out, s0, ob);
+        conv_store(out + ob, s1, ob);
+        out += ob << 1;
+    }
+}
+
+#define I2S_CONV_KERNEL(ib, ob)                                                                              \
+    static void conv_##ib##_##ob(i2s_stream_conv_t *c, const uint8_t *in, uint8_t *out, int pairs)         \
+    {                                                                                                        \
+        conv_run(c, in, out, pairs, ib, ob, false);                                                          \
+    }                                                                                                        \
+    static void conv_##ib##_##ob##_vol(i2s_stream_conv_t *c, const uint8_t *in, uint8_t *out, int pairs)   \
+    {                                                                                                        \
+        conv_run(c, in, out, pairs, ib, ob, true);                                                           \
+    }
+
+I2S_CONV_KERNEL(2, 2)
+I2S_CONV_KERNEL(2, 3)
+I2S_CONV_KERNEL(2, 4)
+I2S_CONV_KERNEL(3, 2)
+I2S_CONV_KERNEL(3, 3)
+I2S_CONV_KERNEL(3, 4)
+I2S_CONV_KERNEL(4, 2)
+I2S_CONV_KERNEL(4, 3)
+I2S_CONV_KERNEL(4, 4)
+
+/* Indexed by [input bytes - 2][output bytes - 2][with volume] */
+static const i2s_conv_kernel_t s_conv_kernels[3][3][2] = {
+    { { conv_2_2, conv_2_2_vol }, { conv_2_3, conv_2_3_vol }, { conv_2_4, conv_2_4_vol } },
+    { { conv_3_2, conv_3_2_vol }, { conv_3_3, conv_3_3_vol }, { conv_3_4, conv_3_4_vol } },
+    { { conv_4_2, conv_4_2_vol }, { conv_4_3, conv_4_3_vol }, { conv_4_4, conv_4_4_vol } },
+};
+
+static int32_t conv_volume_to_gain(int volume_db)
+{
+    if (volume_db < I2S_CONV_VOLUME_MIN) {
+        volume_db = I2S_CONV_VOLUME_MIN;
+    } else if (volume_db > I2S_CONV_VOLUME_MAX) {
+        volume_db = I2S_CONV_VOLUME_MAX;
+    }
+    if (volume_db == 0) {
+        return I2S_CONV_GAIN_UNITY;
+    }
+    return (int32_t)(powf(10.0f, volume_db / 20.0f) * I2S_CONV_GAIN_UNITY + 0.5f);
+}
+
+static inline bool conv_need_volume(i2s_stream_conv_t *conv)
+{
+    return conv->use_volume && (conv->gain != I2S_CONV_GAIN_UNITY || conv->gain_target != I2S_CONV_GAIN_UNITY);
+}
+
+i2s_stream_conv_handle_t i2s_stream_conv_create(void)
+{
+    i2s_stream_conv_t *conv = audio_calloc(1, sizeof(i2s_stream_conv_t));
+    AUDIO_MEM_CHECK(TAG, conv, return NULL);
+    conv->gain = I2S_CONV_GAIN_UNITY;
+    conv->gain_target = I2S_CONV_GAIN_UNITY;
+    return conv;
+}
+
+esp_err_t i2s_stream_conv_setup(i2s_stream_conv_handle_t conv, const i2s_stream_conv_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, conv && cfg, return ESP_ERR_INVALID_ARG);
+    if (conv->configured && memcmp(&conv->cfg, cfg, sizeof(i2s_stream_conv_cfg_t)) == 0) {
+        return ESP_OK;
+    }
+    int in_bytes = cfg->in_bits >> 3;
+    int out_bytes = cfg->out_bits >> 3;
+    if (in_bytes < 2 || in_bytes > 4 || out_bytes < 2 || out_bytes > 4 || (cfg->in_bits & 7) || (cfg->out_bits & 7)) {
+        ESP_LOGE(TAG, "Unsupported conversion %d bits to %d bits", cfg->in_bits, cfg->out_bits);
+        conv->configured = false;
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(&conv->cfg, cfg, sizeof(i2s_stream_conv_cfg_t));
+    conv->in_bytes = in_bytes;
+    conv->out_bytes = out_bytes;
+    conv->kernel = s_conv_kernels[I2S_CONV_BYTES_IDX(in_bytes)][I2S_CONV_BYTES_IDX(out_bytes)][0];
+    conv->kernel_vol = s_conv_kernels[I2S_CONV_BYTES_IDX(in_bytes)][I2S_CONV_BYTES_IDX(out_bytes)][1];
+    conv->configured = true;
+    ESP_LOGD(TAG, "Setup %d bits to %d bits, ch:%d, swap:%d, dac:%d", cfg->in_bits, cfg->out_bits, cfg->channels,
+             cfg->swap_pair, cfg->dac_scale);
+    return ESP_OK;
+}
+
+void i2s_stream_conv_set_volume(i2s_stream_conv_handle_t conv, bool enable, int volume_db)
+{
+    if (conv == NULL) {
+        return;
+    }
+    if (enable && !conv->use_volume) {
+        /* Start from the requested gain instead of ramping from unity */
+        conv->gain = conv_volume_to_gain(volume_db);
+    }
+    conv->use_volume = enable;
+    conv->gain_target = enable ? conv_volume_to_gain(volume_db) : I2S_CONV_GAIN_UNITY;
+}
+
+bool i2s_stream_conv_is_bypass(i2s_stream_conv_handle_t conv)
+{
+    if (conv == NULL || conv->configured == false) {
+        return true;
+    }
+    return (conv->in_bytes == conv->out_bytes) && !conv->cfg.swap_pair && !conv->cfg.dac_scale && !conv_need_volume(conv);
+}
+
+int i2s_stream_conv_process(i2s_stream_conv_handle_t conv, char *in, int in_len, char **out)
+{
+    *out = in;
+    if (i2s_stream_conv_is_bypass(conv)) {
+        return in_len;
+    }
+    int samples = in_len / conv->in_bytes;
+    int out_len = samples * conv->out_bytes;
+    char *dst = in;
+    if (conv->out_bytes > conv->in_bytes) {
+        if (conv->buf == NULL || out_len > conv->buf_size) {
+            if (conv->buf) {
+                audio_free(conv->buf);
+            }
+            conv->buf = audio_calloc(1, out_len);
+            conv->buf_size = conv->buf ? out_len : 0;
+            AUDIO_MEM_CHECK(TAG, conv->buf, return ESP_ERR_NO_MEM);
+        }
+        dst = conv->buf;
+    }
+    int pairs = samples >> 1;
+    bool vol = conv_need_volume(conv);
+    if (vol) {
+        conv->gain_step = pairs ? (conv->gain_target - conv->gain) / pairs : 0;
+    }
+    i2s_conv_kernel_t kernel = vol ? conv->kernel_vol : conv->kernel;
+    kernel(conv, (const uint8_t *)in, (uint8_t *)dst, pairs);
+    if (samples & 1) {
+        /* Odd tail has no partner to swap with, convert it alone */
+        int32_t s = conv_load((const uint8_t *)in + (samples - 1) * conv->in_bytes, conv->in_bytes);
+        if (vol) {
+            s = conv_apply_gain(s, conv->gain_target);
+        }
+        if (conv->cfg.dac_scale) {
+            s = conv_dac_scale(s);
+        }
+        conv_store((uint8_t *)dst + (samples - 1) * conv->out_bytes, s, conv->out_bytes);
+    }
+    conv->gain = conv->gain_target;
+    conv->gain_step = 0;
+    *out = dst;
+    return out_len;
+}
+
+void i2s_stream_conv_destroy(i2s_stream_conv_handle_t conv)
+{
+    if (conv == NULL) {
+        return;
+    }
+    if (conv->buf) {
+        audio_free(conv->buf);
+    }
+    audio_free(conv);
+}
@@ -0,0 +1,127 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _I2S_STREAM_CONV_H_
+#define _I2S_STREAM_CONV_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Sample format converter handle for the i2s_stream writer
+ *
+ *         The converter fuses mono slot swap, built-in DAC scaling, bit width expansion and volume
+ *         into a single pass over the PCM data. The kernel is selected once per format change,
+ *         so the per-sample loop carries no format dispatch.
+ */
+typedef struct i2s_stream_conv *i2s_stream_conv_handle_t;
+
+/**
+ * @brief  Sample format converter configuration
+ */
+typedef struct {
+    int   in_bits;    /*!< Bits per sample of the input data (16, 24 or 32) */
+    int   out_bits;   /*!< Bits per sample written to DMA (16, 24 or 32) */
+    int   channels;   /*!< Number of channels of the input data */
+    bool  swap_pair;  /*!< Swap every two adjacent samples, used to fix mono output order on ESP32 */
+    bool  dac_scale;  /*!< Keep the highest 8 bits and turn them into unsigned value for the built-in DAC */
+} i2s_stream_conv_cfg_t;
+
+/**
+ * @brief      Create a sample format converter
+ *
+ * @return
+ *     - NULL    Out of memory
+ *     - Others  Converter handle
+ */
+i2s_stream_conv_handle_t i2s_stream_conv_create(void);
+
+/**
+ * @brief      Select the conversion kernel for the given format
+ *
+ * @note       Calling it with an unchanged configuration is cheap, so it can be done before every write
+ *
+ * @param[in]  conv  The converter handle
+ * @param[in]  cfg   The format configuration
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t i2s_stream_conv_setup(i2s_stream_conv_handle_t conv, const i2s_stream_conv_cfg_t *cfg);
+
+/**
+ * @brief      Enable or disable volume in the converter
+ *
+ * @param[in]  conv       The converter handle
+ * @param[in]  enable     Whether to apply the volume
+ * @param[in]  volume_db  Gain in dB, supported range [-64, 63]
+ */
+void i2s_stream_conv_set_volume(i2s_stream_conv_handle_t conv, bool enable, int volume_db);
+
+/**
+ * @brief      Convert one block of PCM data
+ *
+ *             When the output sample size is not larger than the input one the conversion is done in place,
+ *             otherwise the data is written to the converter's internal buffer.
+ *
+ * @param[in]  conv     The converter handle
+ * @param[in]  in       Input data, may be modified
+ * @param[in]  in_len   Input length in bytes
+ * @param[out] out      Pointer to the converted data
+ *
+ * @return
+ *     - >= 0  Length of the converted data in bytes
+ *     - < 0   Out of memory
+ */
+int i2s_stream_conv_process(i2s_stream_conv_handle_t conv, char *in, int in_len, char **out);
+
+/**
+ * @brief      Check whether the current configuration leaves the data untouched
+ *
+ * @param[in]  conv  The converter handle
+ *
+ * @return
+ *     - true   No conversion is needed
+ *     - false  Conversion is needed
+ */
+bool i2s_stream_conv_is_bypass(i2s_stream_conv_handle_t conv);
+
+/**
+ * @brief      Destroy the converter
+ *
+ * @param[in]  conv  The converter handle
+ */
+void i2s_stream_conv_destroy(i2s_stream_conv_handle_t conv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _I2S_STREAM_CONV_H_ */
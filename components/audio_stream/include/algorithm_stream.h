@@ -41,6 +41,7 @@ extern "C" {
 #define ALGORITHM_STREAM_DEFAULT_SAMPLE_BIT       16
 #define ALGORITHM_STREAM_DEFAULT_MIC_CHANNELS     1
 #define ALGORITHM_STREAM_DEFAULT_AGC_GAIN_DB      5
+#define ALGORITHM_STREAM_DEFAULT_MAX_DELAY_MS     320
 
 /*
 
@@ -132,6 +133,8 @@ typedef struct {
     int            agc_target_level_dbfs;     /*!< AGC target level(dBFS) */
     bool           enable_se;                 /*!< Speech Enhancement, microphone array processing enable*/
     int            multi_in_rb_num;           /*!< The number of input ringbuffer */
+    bool           auto_delay;                /*!< Estimate the playback to recording delay online and align the reference channel before AEC */
+    int            max_delay_ms;              /*!< The largest delay searched when auto_delay is enabled (in ms) */
 } algorithm_stream_cfg_t;
 
 #define ALGORITHM_STREAM_DEFAULT_MASK    (ALGORITHM_STREAM_USE_AEC | ALGORITHM_STREAM_USE_NS)
@@ -154,6 +157,8 @@ typedef struct {
     .agc_target_level_dbfs = -3,                                                                  \
     .enable_se = true,                                                                             \
     .multi_in_rb_num = false,                                                                     \
+    .auto_delay = false,                                                                          \
+    .max_delay_ms = ALGORITHM_STREAM_DEFAULT_MAX_DELAY_MS,                                        \
 }
 
 /**
@@ -186,6 +191,22 @@ audio_element_handle_t algo_stream_init(algorithm_stream_cfg_t *config);
  */
 audio_element_err_t algo_stream_set_delay(audio_element_handle_t el, ringbuf_handle_t ringbuf, int delay_ms);
 
+/**
+ * @brief      Get the playback to recording delay estimated by the stream when `auto_delay` is enabled
+ *
+ * @note       The estimate is taken from the correlation of the recording and reference envelopes while audio is playing,
+ *             and the reference channel is delayed accordingly before AEC. It starts over each time the stream is reopened.
+ *
+ * @param      el           Handle of element
+ * @param      delay_ms     The estimated delay in ms, -1 when there is no stable estimate yet
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_INVALID_STATE  auto_delay is not enabled
+ */
+esp_err_t algo_stream_get_delay(audio_element_handle_t el, int *delay_ms);
+
 /**
  * @brief      Fix I2S mono noise issue
  *
@@ -73,6 +73,8 @@ typedef struct embed_item_info
 /**
  * @brief      Create an Audio Element handle to stream data from flash to another Element, only support AUDIO_STREAM_READER type
  *
+ * @note       The embedded data goes to the output straight from flash, so an output callback gets read-only data
+ *
  * @param      config  The configuration
  *
  * @return     The Audio Element handle
@@ -45,14 +45,44 @@ typedef struct {
     int                     task_prio;      /*!< Task priority (based on freeRTOS priority) */
     bool                    ext_stack;      /*!< Allocate stack on extern ram */
     bool                    write_header;   /*!< Choose to write amrnb/amrwb header in fatfs whether or not (true or false, true means choose to write amrnb header) */
+    int                     write_behind_size;  /*!< Writer only, size of the staging buffers written to the card by a background task, rounded up to
+                                                     whole clusters. 0 writes synchronously with a fsync after each write.
+                                                     After a power loss at most the last `sync_interval_ms` of data are missing, plus the time
+                                                     the card takes for one buffer write, and never more than `write_behind_size + sync_bytes` bytes */
+    int                     sync_interval_ms;   /*!< Write-behind, longest time from staging data to its fsync, FATFS_STREAM_SYNC_INTERVAL_MS if 0 */
+    int                     sync_bytes;         /*!< Write-behind, bytes written between two fsync, FATFS_STREAM_SYNC_BYTES if 0 */
+    int                     prealloc_size;      /*!< Write-behind, file space reserved ahead of the data on open and each time it is used up,
+                                                     the file is cut to its data on close. 0 to let the file grow per write.
+                                                     The space is reserved by writing its last byte, FAT does not clear the clusters
+                                                     in between: after a power loss the file keeps the reserved size, and the part
+                                                     after the synced data holds whatever the card stored there before */
+    int                     read_ahead_size;    /*!< Reader only, size of the two blocks read ahead by a background task, in internal memory,
+                                                     each half rounded up to whole clusters. 0 reads synchronously what the element asks for */
 } fatfs_stream_cfg_t;
 
+/**
+ * @brief   FATFS Stream read statistics, measured by the read-ahead task on each `read()` of the file
+ */
+typedef struct {
+    uint32_t                reads;          /*!< Number of `read()` calls */
+    uint64_t                bytes;          /*!< Bytes read from the file */
+    uint32_t                p50_us;         /*!< Median read latency in microseconds */
+    uint32_t                p90_us;         /*!< 90th percentile read latency in microseconds */
+    uint32_t                p99_us;         /*!< 99th percentile read latency in microseconds */
+    uint32_t                max_us;         /*!< Longest read in microseconds */
+    uint32_t                stalls;         /*!< Times the element had to wait because no data was read ahead */
+} fatfs_stream_read_stats_t;
+
 
 #define FATFS_STREAM_BUF_SIZE            (4096)
 #define FATFS_STREAM_TASK_STACK          (4096)
 #define FATFS_STREAM_TASK_CORE           (0)
 #define FATFS_STREAM_TASK_PRIO           (4)
 #define FATFS_STREAM_RINGBUFFER_SIZE     (8 * 1024)
+#define FATFS_STREAM_WRITE_BEHIND_SIZE   (32 * 1024)
+#define FATFS_STREAM_SYNC_INTERVAL_MS    (1000)
+#define FATFS_STREAM_SYNC_BYTES          (256 * 1024)
+#define FATFS_STREAM_READ_AHEAD_SIZE     (32 * 1024)
 
 #define FATFS_STREAM_CFG_DEFAULT() {             \
     .type = AUDIO_STREAM_NONE,                   \
@@ -76,6 +106,19 @@ typedef struct {
  */
 audio_element_handle_t fatfs_stream_init(fatfs_stream_cfg_t *config);
 
+/**
+ * @brief      Get the read latency statistics of the current file, the statistics are cleared on open
+ *
+ * @param[in]  el     The fatfs_stream element handle
+ * @param[out] stats  The read statistics
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_INVALID_STATE if `read_ahead_size` is not set or the stream is not open
+ */
+esp_err_t fatfs_stream_get_read_stats(audio_element_handle_t el, fatfs_stream_read_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -53,8 +53,21 @@ typedef enum {
     HTTP_STREAM_RESOLVE_ALL_TRACKS,
     HTTP_STREAM_FINISH_TRACK,
     HTTP_STREAM_FINISH_PLAYLIST,
+    HTTP_STREAM_ABR_BANDWIDTH,      /*!< A segment was measured by the adaptive bitrate control, `buffer` points to `http_stream_abr_info_t` */
+    HTTP_STREAM_ABR_SWITCH,         /*!< The adaptive bitrate control switched to another variant, `buffer` points to `http_stream_abr_info_t` */
 } http_stream_event_id_t;
 
+/**
+ * @brief      Adaptive bitrate state of a HLS stream
+ */
+typedef struct {
+    uint32_t    bandwidth;      /*!< Estimated download throughput in bits per second, 0 before the first measure */
+    uint32_t    bitrate;        /*!< Declared bandwidth of the selected variant in bits per second */
+    int         variant;        /*!< Index of the selected variant, variants are sorted by ascending bandwidth */
+    int         variant_num;    /*!< Number of variants */
+    int         buffer_level;   /*!< Buffered data in percent of the buffer size */
+} http_stream_abr_info_t;
+
 /**
  * @brief      Stream event message
  */
@@ -95,12 +108,27 @@ typedef struct {
                                                              Request full range of resource if set to 0
                                                              Range size bigger than request size is recommended */
     const char                  *user_agent;            /*!< The User Agent string to send with HTTP requests */
+    int                         prefetch_size;          /*!< Size of the side buffer used to download the next HLS segments ahead, 0 to disable
+                                                             Works with `enable_playlist_parser` and `auto_connect_next_track`,
+                                                             live playlists are then reloaded in background, clear content only */
+    bool                        enable_abr;             /*!< Switch between the variants of a HLS master playlist on segment boundaries,
+                                                             according to the measured throughput and buffer level. Works with `enable_playlist_parser`, clear content only */
+    int                         range_window;           /*!< Maximum number of `request_range_size` ranges downloaded in parallel ahead of the read position,
+                                                             each on its own connection and task. The number in flight follows the measured latency
+                                                             and bandwidth. A buffer of `request_range_size` is allocated per range, at most 8, 0 or 1 to disable */
+    const char                  *cache_dir;             /*!< Directory on a mounted file system, e.g. "/sdcard/cache", where the fetched bytes of plain
+                                                             (not playlist) resources are kept, so replays and seeks inside them are read locally.
+                                                             NULL to disable, does not work with `request_range_size` */
+    int                         cache_size;             /*!< Size budget of `cache_dir` in bytes, the least recently played resources are removed
+                                                             beyond it. HTTP_STREAM_CACHE_SIZE if set to 0 */
 } http_stream_cfg_t;
 
 #define HTTP_STREAM_TASK_STACK          (6 * 1024)
 #define HTTP_STREAM_TASK_CORE           (0)
 #define HTTP_STREAM_TASK_PRIO           (4)
 #define HTTP_STREAM_RINGBUFFER_SIZE     (20 * 1024)
+#define HTTP_STREAM_PREFETCH_SIZE       (32 * 1024)
+#define HTTP_STREAM_CACHE_SIZE          (64 * 1024 * 1024)
 
 #define HTTP_STREAM_CFG_DEFAULT() {              \
     .type = AUDIO_STREAM_READER,                 \
@@ -170,6 +198,18 @@ esp_err_t http_stream_fetch_again(audio_element_handle_t el);
  */
 esp_err_t http_stream_set_server_cert(audio_element_handle_t el, const char *cert);
 
+/**
+ * @brief       Get the adaptive bitrate state
+ *
+ * @param       el    The http_stream element handle
+ * @param[out]  info  The adaptive bitrate state
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_STATE if `enable_abr` is not set or the stream is not a HLS master playlist
+ */
+esp_err_t http_stream_get_abr_info(audio_element_handle_t el, http_stream_abr_info_t *info);
+
 #ifdef __cplusplus
 }
 #endif
@@ -46,6 +46,8 @@ extern "C" {
 #define I2S_STREAM_TASK_PRIO            (23)
 #define I2S_STREAM_TASK_CORE            (0)
 #define I2S_STREAM_RINGBUFFER_SIZE      (8 * 1024)
+#define I2S_STREAM_DRIFT_MAX_PPM        (500)
+#define I2S_STREAM_DRIFT_PPM_LIMIT      (1000)
 
 typedef enum {
     I2S_CHANNEL_TYPE_RIGHT_LEFT,  /*!< Separated left and right channel */
@@ -55,6 +57,15 @@ typedef enum {
     I2S_CHANNEL_TYPE_ONLY_LEFT,   /*!< Only load data in left channel (mono mode) */
 } i2s_channel_type_t;
 
+/**
+ * @brief      I2S Stream drift compensation configurations
+ *             Default value will be used if any entry is zero
+ */
+typedef struct {
+    int  target_fill;  /*!< Input ringbuffer fill level to keep in bytes, default is half of the input ringbuffer */
+    int  max_ppm;      /*!< Maximum rate correction in ppm, default is I2S_STREAM_DRIFT_MAX_PPM, limited to I2S_STREAM_DRIFT_PPM_LIMIT */
+} i2s_stream_drift_cfg_t;
+
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 2, 0) && ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0))
 
 /**
@@ -456,6 +467,41 @@ esp_err_t i2s_alc_volume_get(audio_element_handle_t i2s_stream, int *volume);
  */
 esp_err_t i2s_stream_sync_delay(audio_element_handle_t i2s_stream, int delay_ms);
 
+/**
+ * @brief      Enable or disable clock drift compensation of the I2S writer
+ *
+ *             Sources with their own clock (A2DP sink, network live streams) drift against the local I2S clock,
+ *             which ends up in periodic underrun or overflow of the input ringbuffer. With compensation enabled
+ *             the writer estimates the drift from the ringbuffer fill level over time and resamples the input
+ *             by a few hundred ppm, keeping the fill level and so the latency constant.
+ *
+ * @note       Only 16 bits and 32 bits samples are resampled, other formats pass through unchanged
+ * @note       A running element is paused while the setting changes, each call applies the whole configuration
+ *
+ * @param[in]  i2s_stream  The i2s element handle
+ * @param[in]  enable      Enable or disable
+ * @param[in]  cfg         Drift compensation configuration, NULL to use the defaults
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_NOT_SUPPORTED  Not an I2S writer
+ *     - ESP_ERR_NO_MEM
+ */
+esp_err_t i2s_stream_set_drift_compensation(audio_element_handle_t i2s_stream, bool enable, i2s_stream_drift_cfg_t *cfg);
+
+/**
+ * @brief      Get the rate correction currently applied by drift compensation
+ *
+ * @param[in]   i2s_stream  The i2s element handle
+ * @param[out]  ppm         Correction in ppm, positive when the input is played faster than nominal
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t i2s_stream_get_drift_ppm(audio_element_handle_t i2s_stream, float *ppm);
+
 #ifdef __cplusplus
 }
 #endif
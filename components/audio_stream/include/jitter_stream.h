@@ -0,0 +1,127 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _JITTER_STREAM_H_
+#define _JITTER_STREAM_H_
+
+#include "audio_error.h"
+#include "audio_element.h"
+#include "audio_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Jitter stream smooths the arrival of live 16-bit PCM before playback,
+ *        e.g. [http]->[decoder]->[jitter]->[i2s], [tcp_client]->[jitter]->[i2s]
+ *
+ *        The stream keeps a delay that follows the measured inter-arrival jitter and the late events.
+ *        When the buffered audio drifts away from the target, frames are slightly shortened or lengthened
+ *        at the most similar waveform position. When nothing arrived in time, the last pitch period is
+ *        repeated with a fade out instead of letting the output underrun, and the audio that arrives late
+ *        is dropped to keep the latency.
+ *
+ *        The format is taken from the element info at open, so a decoder upstream can update it with
+ *        `audio_element_setinfo` before running. Frames are written to the output at the playout pace,
+ *        about two frames ahead of the sink, so the output ringbuffer does not add to the delay.
+ */
+
+/**
+ * @brief Jitter stream statistics
+ */
+typedef struct {
+    int         depth_ms;           /*!< Buffered audio */
+    int         target_ms;          /*!< Delay the stream currently aims at */
+    int         jitter_ms;          /*!< Smoothed inter-arrival jitter */
+    uint32_t    late_frames;        /*!< Frames concealed because no audio arrived in time */
+    uint32_t    lost_frames;        /*!< Frames of audio dropped, because it came after its concealment or beyond `max_delay_ms` */
+    uint32_t    stretched_frames;   /*!< Frames played longer to rebuild the buffer */
+    uint32_t    compressed_frames;  /*!< Frames played shorter to reduce the delay */
+} jitter_stream_info_t;
+
+/**
+ * @brief Jitter stream configurations
+ */
+typedef struct {
+    int     out_rb_size;    /*!< Size of output ringbuffer */
+    int     task_stack;     /*!< Task stack size */
+    int     task_core;      /*!< Task running in core (0 or 1) */
+    int     task_prio;      /*!< Task priority (based on freeRTOS priority) */
+    bool    stack_in_ext;   /*!< Try to allocate stack in external memory */
+    int     sample_rate;    /*!< Sample rate used when the element info has none */
+    int     channels;       /*!< Channels used when the element info has none */
+    int     frame_ms;       /*!< Playout frame duration, the unit of concealment and time scaling */
+    int     min_delay_ms;   /*!< Lowest target delay */
+    int     max_delay_ms;   /*!< Highest target delay, older audio is dropped beyond it */
+} jitter_stream_cfg_t;
+
+#define JITTER_STREAM_TASK_STACK        (3 * 1024)
+#define JITTER_STREAM_TASK_CORE         (0)
+#define JITTER_STREAM_TASK_PRIO         (5)
+#define JITTER_STREAM_RINGBUFFER_SIZE   (4 * 1024)
+#define JITTER_STREAM_FRAME_MS          (20)
+#define JITTER_STREAM_MIN_DELAY_MS      (40)
+#define JITTER_STREAM_MAX_DELAY_MS      (500)
+
+#define JITTER_STREAM_CFG_DEFAULT() {                   \
+    .out_rb_size = JITTER_STREAM_RINGBUFFER_SIZE,       \
+    .task_stack = JITTER_STREAM_TASK_STACK,             \
+    .task_core = JITTER_STREAM_TASK_CORE,               \
+    .task_prio = JITTER_STREAM_TASK_PRIO,               \
+    .stack_in_ext = true,                               \
+    .sample_rate = 48000,                               \
+    .channels = 2,                                      \
+    .frame_ms = JITTER_STREAM_FRAME_MS,                 \
+    .min_delay_ms = JITTER_STREAM_MIN_DELAY_MS,         \
+    .max_delay_ms = JITTER_STREAM_MAX_DELAY_MS,         \
+}
+
+/**
+ * @brief      Initialize the jitter stream
+ *
+ * @param[in]  config  The jitter stream configuration
+ *
+ * @return     The audio element handle, NULL on failure
+ */
+audio_element_handle_t jitter_stream_init(jitter_stream_cfg_t *config);
+
+/**
+ * @brief      Get the buffer depth, delay target and late/lost counts since the stream was opened
+ *
+ * @param[in]  jitter_stream  The jitter stream element handle
+ * @param[out] info           The statistics
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_INVALID_STATE  The stream has not been opened yet
+ */
+esp_err_t jitter_stream_get_info(audio_element_handle_t jitter_stream, jitter_stream_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _JITTER_STREAM_H_ */
@@ -46,7 +46,9 @@ typedef struct
     ledc_channel_t      ledc_channel_right;   /*!< LEDC channel (0 - 7), Corresponding to right channel*/
     ledc_timer_t        ledc_timer_sel;       /*!< Select the timer source of channel (0 - 3) */
     ledc_timer_bit_t    duty_resolution;      /*!< ledc pwm bits */
-    uint32_t            data_len;             /*!< ringbuffer size */
+    uint32_t            data_len;             /*!< ringbuffer size in bytes, each frame takes 4 bytes whatever the bits and channels,
+                                                   so size it as frames * 4 */
+    bool                noise_shaping;        /*!< Requantize to the duty resolution with 2nd order noise shaping */
 
 } audio_pwm_config_t;
 
@@ -73,7 +75,8 @@ typedef struct {
 #define PWM_STREAM_TASK_PRIO            (23)
 #define PWM_STREAM_TASK_CORE            (0)
 #define PWM_STREAM_RINGBUFFER_SIZE      (0)
-#define PWM_CONFIG_RINGBUFFER_SIZE      (1024*8)
+#define PWM_CONFIG_RINGBUFFER_FRAMES    (4096)  /* As many frames as the former 8 KB of 16 bits mono samples */
+#define PWM_CONFIG_RINGBUFFER_SIZE      (PWM_CONFIG_RINGBUFFER_FRAMES * 4)
 
 #define PWM_STREAM_CFG_DEFAULT() {                    \
     .type = AUDIO_STREAM_WRITER,                      \
@@ -87,6 +90,7 @@ typedef struct {
         .ledc_timer_sel = LEDC_TIMER_0,               \
         .duty_resolution = LEDC_TIMER_8_BIT,          \
         .data_len = PWM_CONFIG_RINGBUFFER_SIZE,       \
+        .noise_shaping = false,                       \
     },                                                \
     .out_rb_size = PWM_STREAM_RINGBUFFER_SIZE,        \
     .task_stack = PWM_STREAM_TASK_STACK,              \
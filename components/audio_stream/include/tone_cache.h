@@ -0,0 +1,234 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _TONE_CACHE_H_
+#define _TONE_CACHE_H_
+
+#include "audio_error.h"
+#include "audio_element.h"
+#include "audio_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Tone cache keeps short prompts (key beeps, wake-up chimes, ...) decoded in memory, so playing one
+ *        starts with the first write to the output instead of opening, decoding and buffering the file.
+ *
+ *        A tone is decoded once, by `tone_cache_load`, by the cache task after `tone_cache_preload` or on the
+ *        first `tone_cache_play`, through the configured [reader]->[decoder] pipeline. The PCM is converted to
+ *        16 bits at the output rate and channels and kept in `audio_malloc` memory, which is PSRAM when it is
+ *        enabled. Beyond `mem_budget`, the least recently played tones that are neither pinned nor playing
+ *        are dropped and decoded again at their next use.
+ *
+ *        The playing tone is written by the cache play task to the `write` callback in `frame_ms` blocks,
+ *        e.g. `raw_stream_write` of a [raw]->[i2s] pipeline, or is pulled with `tone_cache_read`, which fits as
+ *        the read callback of an audio mixer slot.
+ */
+
+typedef struct tone_cache *tone_cache_handle_t;
+
+/**
+ * @brief Sink of the playing tone
+ *
+ * @param pcm   16-bit PCM at the cache rate and channels, it stays valid only during the call
+ * @param len   Bytes of PCM
+ * @param ctx   `write_ctx` of the configuration
+ *
+ * @return Bytes written, 0 or negative to stop the tone
+ */
+typedef int (*tone_cache_write_cb_t)(const uint8_t *pcm, int len, void *ctx);
+
+/**
+ * @brief Tone cache statistics
+ */
+typedef struct {
+    int         tones;          /*!< Tones decoded in memory */
+    size_t      mem_used;       /*!< Bytes of PCM kept */
+    uint32_t    hits;           /*!< Plays started from memory */
+    uint32_t    misses;         /*!< Plays that had to wait for the decoding */
+    uint32_t    evictions;      /*!< Tones dropped to stay in `mem_budget` */
+    uint32_t    start_us;       /*!< Time from the last `tone_cache_play` to its first block handed to `write` */
+} tone_cache_info_t;
+
+/**
+ * @brief Tone cache configurations
+ */
+typedef struct {
+    audio_element_handle_t  reader;         /*!< Stream that reads a tone uri, e.g. tone_stream or embed_flash_stream, owned by the cache */
+    audio_element_handle_t  decoder;        /*!< Decoder of the tones, e.g. mp3_decoder, owned by the cache */
+    int                     sample_rate;    /*!< Sample rate of the cached PCM, i.e. of the output */
+    int                     channels;       /*!< Channels of the cached PCM, 1 or 2 */
+    size_t                  mem_budget;     /*!< Bytes of PCM kept at most */
+    tone_cache_write_cb_t   write;          /*!< Sink of the playing tone, NULL when it is pulled with `tone_cache_read` */
+    void                    *write_ctx;     /*!< Context of `write` */
+    int                     frame_ms;       /*!< Duration of a block handed to `write` */
+    int                     task_stack;     /*!< Stack of the task that decodes the tones */
+    int                     task_core;      /*!< Core of the decode and play tasks (0 or 1) */
+    int                     task_prio;      /*!< Priority of the decode task, low to decode in idle time */
+    int                     play_task_prio; /*!< Priority of the play task, only used with `write` */
+    bool                    stack_in_ext;   /*!< Try to allocate the decode task stack in external memory */
+} tone_cache_cfg_t;
+
+#define TONE_CACHE_TASK_STACK       (4 * 1024)
+#define TONE_CACHE_TASK_CORE        (0)
+#define TONE_CACHE_TASK_PRIO        (2)
+#define TONE_CACHE_PLAY_TASK_PRIO   (22)
+#define TONE_CACHE_MEM_BUDGET       (256 * 1024)
+#define TONE_CACHE_FRAME_MS         (10)
+
+#define TONE_CACHE_CFG_DEFAULT() {                      \
+    .reader = NULL,                                     \
+    .decoder = NULL,                                    \
+    .sample_rate = 48000,                               \
+    .channels = 2,                                      \
+    .mem_budget = TONE_CACHE_MEM_BUDGET,                \
+    .write = NULL,                                      \
+    .write_ctx = NULL,                                  \
+    .frame_ms = TONE_CACHE_FRAME_MS,                    \
+    .task_stack = TONE_CACHE_TASK_STACK,                \
+    .task_core = TONE_CACHE_TASK_CORE,                  \
+    .task_prio = TONE_CACHE_TASK_PRIO,                  \
+    .play_task_prio = TONE_CACHE_PLAY_TASK_PRIO,        \
+    .stack_in_ext = true,                               \
+}
+
+/**
+ * @brief      Create a tone cache, the reader and the decoder are linked into its decode pipeline
+ *
+ * @param[in]  config  The tone cache configuration
+ *
+ * @return     The tone cache handle, NULL on failure
+ */
+tone_cache_handle_t tone_cache_create(tone_cache_cfg_t *config);
+
+/**
+ * @brief      Stop the playing tone, free the cached tones and deinitialize the reader and the decoder
+ *
+ * @param[in]  handle  The tone cache handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t tone_cache_destroy(tone_cache_handle_t handle);
+
+/**
+ * @brief      Queue a tone to be decoded by the cache task
+ *
+ * @param[in]  handle  The tone cache handle
+ * @param[in]  uri     The tone uri, e.g. "flash://tone/0_Bt_Reconnect.mp3"
+ * @param[in]  pin     Keep the tone out of the least recently played eviction
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_NO_MEM
+ */
+esp_err_t tone_cache_preload(tone_cache_handle_t handle, const char *uri, bool pin);
+
+/**
+ * @brief      Decode a tone in the calling task, if it is not in memory yet
+ *
+ * @param[in]  handle  The tone cache handle
+ * @param[in]  uri     The tone uri
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_NO_MEM         The tone does not fit in `mem_budget`
+ *     - ESP_FAIL               The tone could not be decoded
+ */
+esp_err_t tone_cache_load(tone_cache_handle_t handle, const char *uri);
+
+/**
+ * @brief      Play a tone, stopping the one playing
+ *
+ * @note       A tone in memory starts at once. Otherwise it is decoded by the cache task first.
+ *             When the tone is pulled by an audio mixer slot, reset the slot with `audio_mixer_reset_slot`
+ *             and call `audio_mixer_data_is_ready` after this, as the slot stops at the end of each tone.
+ *
+ * @param[in]  handle  The tone cache handle
+ * @param[in]  uri     The tone uri
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_NO_MEM
+ */
+esp_err_t tone_cache_play(tone_cache_handle_t handle, const char *uri);
+
+/**
+ * @brief      Stop the playing tone
+ *
+ * @param[in]  handle  The tone cache handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t tone_cache_stop(tone_cache_handle_t handle);
+
+/**
+ * @brief      Read the next PCM of the playing tone, with the signature of `mixer_io_callback_t`
+ *
+ * @param[out] data  Buffer of the PCM
+ * @param[in]  len   Size of the buffer
+ * @param[in]  ctx   The tone cache handle
+ *
+ * @return     Bytes read, 0 when no tone is playing
+ */
+int tone_cache_read(uint8_t *data, int len, void *ctx);
+
+/**
+ * @brief      Change the output format, the cached tones are decoded again in the cache task
+ *
+ * @param[in]  handle       The tone cache handle
+ * @param[in]  sample_rate  The output sample rate
+ * @param[in]  channels     The output channels, 1 or 2
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t tone_cache_set_format(tone_cache_handle_t handle, int sample_rate, int channels);
+
+/**
+ * @brief      Get the memory use and the hit, miss and eviction counts of the cache
+ *
+ * @param[in]  handle  The tone cache handle
+ * @param[out] info    The statistics
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+esp_err_t tone_cache_get_info(tone_cache_handle_t handle, tone_cache_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TONE_CACHE_H_ */
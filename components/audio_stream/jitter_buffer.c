@@ -0,0 +1,447 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "jitter_buffer.h"
+
+static const char *TAG = "JITTER_BUFFER";
+
+#define JITTER_MAX_CHANNELS         (8)
+#define JITTER_TARGET_FACTOR        (3)     /* Target delay in smoothed jitters, beside one frame */
+#define JITTER_ADJUST_INTERVAL      (4)     /* Frames between two time scale steps, bounds the tempo change */
+#define JITTER_PLC_FADE_FRAMES      (4)     /* Concealment fades out over these frames */
+#define JITTER_PLC_MAX_FRAMES       (10)    /* Longer gaps fill the buffer up to the target again */
+#define JITTER_CALM_FRAMES          (50)    /* Frames without late event before the late floor decays */
+#define JITTER_SEARCH_RATE          (8000)  /* Sample rate of the similarity search */
+
+struct jitter_buffer {
+    jitter_buffer_cfg_t     cfg;
+    int                     ch;
+    int                     frame;          /* Samples per channel of a frame, as are all the lengths below */
+    int                     overlap;        /* Crossfade length, also the compared window */
+    int                     lag_min;        /* Range of the waveform period search */
+    int                     lag_max;
+    int                     stride;         /* Decimation of the search */
+    int16_t                *fifo;
+    int                     cap;
+    int                     head;
+    int                     count;
+    int16_t                *work;           /* A frame and the longest period */
+    int16_t                *hist;           /* Last played frame, the source of the concealment */
+    uint8_t                 partial[JITTER_MAX_CHANNELS * sizeof(int16_t)];
+    int                     partial_len;
+    bool                    playing;
+    int                     plc_frames;     /* Frames concealed in a row */
+    int                     plc_period;
+    int                     plc_pos;
+    int                     owed;           /* Concealed length the next arrivals may be dropped for */
+    int                     adjust_wait;
+    int64_t                 received;
+    int64_t                 last_transit;
+    bool                    has_transit;
+    int64_t                 jitter_us;
+    int                     floor_ms;       /* Raised on late events */
+    int                     calm_frames;
+    int                     target;
+    int64_t                 lost;
+    jitter_stream_info_t    info;
+};
+
+static void jitter_fifo_peek(struct jitter_buffer *jb, int16_t *dst, int n)
+{
+    int first = jb->cap - jb->head;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(dst, jb->fifo + jb->head * jb->ch, first * jb->ch * sizeof(int16_t));
+    memcpy(dst + first * jb->ch, jb->fifo, (n - first) * jb->ch * sizeof(int16_t));
+}
+
+static void jitter_fifo_skip(struct jitter_buffer *jb, int n)
+{
+    jb->head = (jb->head + n) % jb->cap;
+    jb->count -= n;
+}
+
+static void jitter_fifo_write(struct jitter_buffer *jb, const uint8_t *src, int n)
+{
+    int sample_size = jb->ch * sizeof(int16_t);
+    if (n > jb->cap) {
+        jb->lost += n - jb->cap;
+        src += (n - jb->cap) * sample_size;
+        n = jb->cap;
+    }
+    if (jb->count + n > jb->cap) {
+        int drop = jb->count + n - jb->cap;
+        jb->lost += drop;
+        jitter_fifo_skip(jb, drop);
+    }
+    int tail = (jb->head + jb->count) % jb->cap;
+    int first = jb->cap - tail;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(jb->fifo + tail * jb->ch, src, first * sample_size);
+    memcpy(jb->fifo, src + first * sample_size, (n - first) * sample_size);
+    jb->count += n;
+}
+
+/*
+ * Find the lag, in `lag_min` to `lag_max`, where the waveform best matches the window at `ref`,
+ * after it when `dir` is 1 and before it when `dir` is -1
+ */
+static int jitter_best_lag(struct jitter_buffer *jb, const int16_t *ref, int dir)
+{
+    float best = -2.0f;
+    int best_lag = jb->lag_min;
+    for (int lag = jb->lag_min; lag <= jb->lag_max; lag++) {
+        const int16_t *x = ref + dir * lag * jb->ch;
+        float xy = 0;
+        float xx = 0;
+        float yy = 0;
+        for (int i = 0; i < jb->overlap; i += jb->stride) {
+            int a = 0;
+            int b = 0;
+            for (int c = 0; c < jb->ch; c++) {
+                a += ref[i * jb->ch + c];
+                b += x[i * jb->ch + c];
+            }
+            xy += (float)a * b;
+            xx += (float)a * a;
+            yy += (float)b * b;
+        }
+        float score = xy / sqrtf(xx * yy + 1.0f);
+        if (score > best) {
+            best = score;
+            best_lag = lag;
+        }
+    }
+    return best_lag;
+}
+
+/*
+ * Crossfade `n` samples from `a` to `b` into `dst`
+ */
+static void jitter_crossfade(struct jitter_buffer *jb, int16_t *dst, const int16_t *a, const int16_t *b, int n)
+{
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < jb->ch; c++) {
+            int k = i * jb->ch + c;
+            dst[k] = (a[k] * (n - i) + b[k] * i) / n;
+        }
+    }
+}
+
+/*
+ * Continue the last played pitch period with the fade of the current concealment position
+ */
+static void jitter_plc_render(struct jitter_buffer *jb, int16_t *dst, int n)
+{
+    const int16_t *period = jb->hist + (jb->frame - jb->plc_period) * jb->ch;
+    int fade = JITTER_PLC_FADE_FRAMES * jb->frame;
+    for (int i = 0; i < n; i++) {
+        int t = jb->plc_frames * jb->frame + i;
+        int gain = t >= fade ? 0 : (int)((int64_t)(fade - t) * 32767 / fade);
+        const int16_t *s = period + ((jb->plc_pos + i) % jb->plc_period) * jb->ch;
+        for (int c = 0; c < jb->ch; c++) {
+            dst[i * jb->ch + c] = (s[c] * gain) >> 15;
+        }
+    }
+}
+
+static void jitter_conceal(struct jitter_buffer *jb, int16_t *dst)
+{
+    if (jb->plc_frames == 0) {
+        // The period that best continues the end of the last frame
+        jb->plc_period = jitter_best_lag(jb, jb->hist + (jb->frame - jb->overlap) * jb->ch, -1);
+        jb->plc_pos = 0;
+    }
+    jitter_plc_render(jb, dst, jb->frame);
+    jb->plc_pos = (jb->plc_pos + jb->frame) % jb->plc_period;
+}
+
+static void jitter_compress(struct jitter_buffer *jb, int16_t *dst)
+{
+    int16_t *x = jb->work;
+    jitter_fifo_peek(jb, x, jb->frame + jb->lag_max);
+    int lag = jitter_best_lag(jb, x, 1);
+    jitter_crossfade(jb, dst, x, x + lag * jb->ch, jb->overlap);
+    memcpy(dst + jb->overlap * jb->ch, x + (jb->overlap + lag) * jb->ch, (jb->frame - jb->overlap) * jb->ch * sizeof(int16_t));
+    jitter_fifo_skip(jb, jb->frame + lag);
+}
+
+static void jitter_stretch(struct jitter_buffer *jb, int16_t *dst)
+{
+    int16_t *x = jb->work;
+    jitter_fifo_peek(jb, x, jb->frame);
+    int lag = jitter_best_lag(jb, x, 1);
+    // Play up to `lag`, then fade back to the start, so the samples from 0 to `lag` play twice
+    memcpy(dst, x, lag * jb->ch * sizeof(int16_t));
+    jitter_crossfade(jb, dst + lag * jb->ch, x + lag * jb->ch, x, jb->overlap);
+    memcpy(dst + (lag + jb->overlap) * jb->ch, x + jb->overlap * jb->ch, (jb->frame - lag - jb->overlap) * jb->ch * sizeof(int16_t));
+    jitter_fifo_skip(jb, jb->frame - lag);
+}
+
+static int jitter_to_ms(struct jitter_buffer *jb, int64_t n)
+{
+    return (int)(n * 1000 / jb->cfg.sample_rate);
+}
+
+static void jitter_update_target(struct jitter_buffer *jb)
+{
+    if (++jb->calm_frames >= JITTER_CALM_FRAMES) {
+        jb->calm_frames = 0;
+        jb->floor_ms -= jb->floor_ms / 8;
+    }
+    int target_ms = JITTER_TARGET_FACTOR * (int)(jb->jitter_us / 1000) + jb->cfg.frame_ms;
+    if (target_ms < jb->floor_ms) {
+        target_ms = jb->floor_ms;
+    }
+    if (target_ms < jb->cfg.min_delay_ms) {
+        target_ms = jb->cfg.min_delay_ms;
+    }
+    if (target_ms > jb->cfg.max_delay_ms) {
+        target_ms = jb->cfg.max_delay_ms;
+    }
+    jb->target = (int64_t)target_ms * jb->cfg.sample_rate / 1000;
+}
+
+jitter_buffer_handle_t jitter_buffer_create(const jitter_buffer_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, cfg, return NULL);
+    AUDIO_CHECK(TAG, cfg->sample_rate > 0 && cfg->channels > 0 && cfg->channels <= JITTER_MAX_CHANNELS,
+                return NULL, "Invalid format");
+    AUDIO_CHECK(TAG, cfg->frame_ms >= 5 && cfg->frame_ms <= 100, return NULL, "Invalid frame duration");
+    struct jitter_buffer *jb = audio_calloc(1, sizeof(struct jitter_buffer));
+    AUDIO_MEM_CHECK(TAG, jb, return NULL);
+    memcpy(&jb->cfg, cfg, sizeof(jitter_buffer_cfg_t));
+    // A target below one frame would underrun on every pull
+    if (jb->cfg.min_delay_ms < cfg->frame_ms) {
+        jb->cfg.min_delay_ms = cfg->frame_ms;
+    }
+    if (jb->cfg.max_delay_ms < jb->cfg.min_delay_ms + 2 * cfg->frame_ms) {
+        jb->cfg.max_delay_ms = jb->cfg.min_delay_ms + 2 * cfg->frame_ms;
+    }
+    jb->ch = cfg->channels;
+    jb->frame = cfg->sample_rate * cfg->frame_ms / 1000;
+    jb->overlap = jb->frame / 4;
+    jb->lag_min = jb->frame / 8;
+    jb->lag_max = jb->frame / 2;
+    jb->stride = cfg->sample_rate > JITTER_SEARCH_RATE ? cfg->sample_rate / JITTER_SEARCH_RATE : 1;
+    jb->cap = (int64_t)jb->cfg.max_delay_ms * 2 * cfg->sample_rate / 1000 + jb->frame;
+    jb->fifo = audio_calloc(jb->cap * jb->ch, sizeof(int16_t));
+    jb->work = audio_calloc((jb->frame + jb->lag_max) * jb->ch, sizeof(int16_t));
+    jb->hist = audio_calloc(jb->frame * jb->ch, sizeof(int16_t));
+    AUDIO_MEM_CHECK(TAG, jb->fifo && jb->work && jb->hist, {
+        jitter_buffer_destroy(jb);
+        return NULL;
+    });
+    jitter_buffer_reset(jb);
+    return jb;
+}
+
+int jitter_buffer_get_frame_size(jitter_buffer_handle_t jb)
+{
+    AUDIO_NULL_CHECK(TAG, jb, return 0);
+    return jb->frame * jb->ch * sizeof(int16_t);
+}
+
+void jitter_buffer_put(jitter_buffer_handle_t jb, const char *data, int len, int64_t now_us)
+{
+    AUDIO_NULL_CHECK(TAG, jb, return);
+    const uint8_t *src = (const uint8_t *)data;
+    int sample_size = jb->ch * sizeof(int16_t);
+    int added = 0;
+    if (jb->partial_len) {
+        int n = sample_size - jb->partial_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(jb->partial + jb->partial_len, src, n);
+        jb->partial_len += n;
+        src += n;
+        len -= n;
+        if (jb->partial_len == sample_size) {
+            jitter_fifo_write(jb, jb->partial, 1);
+            jb->partial_len = 0;
+            added++;
+        }
+    }
+    int n = len / sample_size;
+    if (n > 0) {
+        jitter_fifo_write(jb, src, n);
+        added += n;
+    }
+    jb->partial_len += len - n * sample_size;
+    memcpy(jb->partial, src + n * sample_size, len - n * sample_size);
+    if (added == 0) {
+        return;
+    }
+    // Deviation of the arrival time from the media time of the received audio
+    jb->received += added;
+    int64_t transit = now_us - jb->received * 1000000 / jb->cfg.sample_rate;
+    if (jb->has_transit) {
+        int64_t d = transit - jb->last_transit;
+        jb->jitter_us += ((d < 0 ? -d : d) - jb->jitter_us) / 16;
+    }
+    jb->last_transit = transit;
+    jb->has_transit = true;
+}
+
+bool jitter_buffer_ready(jitter_buffer_handle_t jb)
+{
+    AUDIO_NULL_CHECK(TAG, jb, return false);
+    return jb->playing ? jb->count >= jb->frame : jb->count >= jb->target;
+}
+
+int jitter_buffer_pull(jitter_buffer_handle_t jb, char *out, bool conceal)
+{
+    AUDIO_NULL_CHECK(TAG, jb, return 0);
+    int16_t *dst = (int16_t *)out;
+    jitter_update_target(jb);
+    if (jb->playing == false) {
+        if (jb->count < jb->target) {
+            return 0;
+        }
+        ESP_LOGD(TAG, "Start playout, %d ms buffered", jitter_to_ms(jb, jb->count));
+        jb->playing = true;
+    }
+    if (jb->count < jb->frame) {
+        if (conceal == false) {
+            return 0;
+        }
+        if (jb->plc_frames >= JITTER_PLC_MAX_FRAMES) {
+            // The concealment has faded out, wait for the target delay again
+            jb->playing = false;
+            jb->plc_frames = 0;
+            jb->owed = 0;
+            return 0;
+        }
+        if (jb->plc_frames == 0) {
+            int target_ms = jitter_to_ms(jb, jb->target);
+            jb->floor_ms = target_ms + 2 * jb->cfg.frame_ms;
+            jb->calm_frames = 0;
+            ESP_LOGD(TAG, "Late, %d ms buffered, target %d ms", jitter_to_ms(jb, jb->count), target_ms);
+        }
+        jitter_conceal(jb, dst);
+        jb->plc_frames++;
+        jb->owed += jb->frame;
+        jb->info.late_frames++;
+        return jb->frame * jb->ch * sizeof(int16_t);
+    }
+    // Audio arriving after its concealment is dropped as far as the target allows, to keep the latency
+    int drop = 0;
+    if (jb->owed) {
+        drop = jb->count - jb->target < jb->owed ? jb->count - jb->target : jb->owed;
+        jb->owed = 0;
+    }
+    if (jb->count > (int64_t)jb->cfg.max_delay_ms * jb->cfg.sample_rate / 1000 + jb->frame) {
+        drop = jb->count - jb->target;
+    }
+    if (drop > 0) {
+        jitter_fifo_skip(jb, drop);
+        jb->lost += drop;
+    }
+    if (jb->adjust_wait > 0) {
+        jb->adjust_wait--;
+    } else if (jb->count >= jb->target + jb->frame && jb->count >= jb->frame + jb->lag_max) {
+        jitter_compress(jb, dst);
+        jb->adjust_wait = JITTER_ADJUST_INTERVAL;
+        jb->info.compressed_frames++;
+        goto _played;
+    } else if (jb->count < jb->target - jb->frame) {
+        jitter_stretch(jb, dst);
+        jb->adjust_wait = JITTER_ADJUST_INTERVAL;
+        jb->info.stretched_frames++;
+        goto _played;
+    }
+    jitter_fifo_peek(jb, dst, jb->frame);
+    jitter_fifo_skip(jb, jb->frame);
+_played:
+    if (jb->plc_frames) {
+        // Fade from the concealment into the received audio
+        jitter_plc_render(jb, jb->work, jb->overlap);
+        jitter_crossfade(jb, dst, jb->work, dst, jb->overlap);
+        jb->plc_frames = 0;
+    }
+    memcpy(jb->hist, dst, jb->frame * jb->ch * sizeof(int16_t));
+    return jb->frame * jb->ch * sizeof(int16_t);
+}
+
+int jitter_buffer_drain(jitter_buffer_handle_t jb, char *out)
+{
+    AUDIO_NULL_CHECK(TAG, jb, return 0);
+    int n = jb->count < jb->frame ? jb->count : jb->frame;
+    jitter_fifo_peek(jb, (int16_t *)out, n);
+    jitter_fifo_skip(jb, n);
+    return n * jb->ch * sizeof(int16_t);
+}
+
+void jitter_buffer_get_info(jitter_buffer_handle_t jb, jitter_stream_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, jb, return);
+    AUDIO_NULL_CHECK(TAG, info, return);
+    memcpy(info, &jb->info, sizeof(jitter_stream_info_t));
+    info->depth_ms = jitter_to_ms(jb, jb->count);
+    info->target_ms = jitter_to_ms(jb, jb->target);
+    info->jitter_ms = (int)(jb->jitter_us / 1000);
+    info->lost_frames = jb->lost / jb->frame;
+}
+
+void jitter_buffer_reset(jitter_buffer_handle_t jb)
+{
+    AUDIO_NULL_CHECK(TAG, jb, return);
+    jb->head = 0;
+    jb->count = 0;
+    jb->partial_len = 0;
+    jb->playing = false;
+    jb->plc_frames = 0;
+    jb->owed = 0;
+    jb->adjust_wait = 0;
+    jb->received = 0;
+    jb->has_transit = false;
+    jb->jitter_us = 0;
+    jb->floor_ms = 0;
+    jb->calm_frames = 0;
+    jb->lost = 0;
+    memset(&jb->info, 0, sizeof(jitter_stream_info_t));
+    memset(jb->hist, 0, jb->frame * jb->ch * sizeof(int16_t));
+    jitter_update_target(jb);
+}
+
+void jitter_buffer_destroy(jitter_buffer_handle_t jb)
+{
+    if (jb == NULL) {
+        return;
+    }
+    audio_free(jb->fifo);
+    audio_free(jb->work);
+    audio_free(jb->hist);
+    audio_free(jb);
+}
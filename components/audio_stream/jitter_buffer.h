@@ -0,0 +1,149 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _JITTER_BUFFER_H_
+#define _JITTER_BUFFER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "jitter_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Playout buffer used by the jitter stream
+ *
+ *         Arrivals are compared with the media time they carry, their smoothed deviation (RFC 3550 jitter)
+ *         and a floor raised on every late event and decaying while the playout is calm set the target delay.
+ *         Frames are pulled at the playout pace. Above the target a frame absorbs one waveform period
+ *         found by normalized cross-correlation, below it one period is repeated, both with a crossfade.
+ *         A missing frame is concealed by repeating the last pitch period with a fade out.
+ *
+ * @note   The functions are not thread safe, the jitter stream calls them under its lock
+ */
+typedef struct jitter_buffer *jitter_buffer_handle_t;
+
+/**
+ * @brief  Buffer configuration
+ */
+typedef struct {
+    int sample_rate;    /*!< Sample rate in Hz */
+    int channels;       /*!< Interleaved channels of 16-bit samples */
+    int frame_ms;       /*!< Frame duration */
+    int min_delay_ms;   /*!< Lowest target delay */
+    int max_delay_ms;   /*!< Highest target delay, the buffer holds twice this */
+} jitter_buffer_cfg_t;
+
+/**
+ * @brief      Create a buffer
+ *
+ * @param[in]  cfg  The configuration
+ *
+ * @return
+ *     - NULL    Out of memory or invalid configuration
+ *     - Others  Buffer handle
+ */
+jitter_buffer_handle_t jitter_buffer_create(const jitter_buffer_cfg_t *cfg);
+
+/**
+ * @brief      Get the size of a frame
+ *
+ * @param[in]  jb  The buffer handle
+ *
+ * @return     Bytes of one frame
+ */
+int jitter_buffer_get_frame_size(jitter_buffer_handle_t jb);
+
+/**
+ * @brief      Add received audio, the oldest audio is dropped when the buffer is full
+ *
+ * @param[in]  jb      The buffer handle
+ * @param[in]  data    Interleaved samples, a partial sample is kept for the next call
+ * @param[in]  len     Data length in bytes
+ * @param[in]  now_us  Arrival time in microseconds
+ */
+void jitter_buffer_put(jitter_buffer_handle_t jb, const char *data, int len, int64_t now_us);
+
+/**
+ * @brief      Check whether a frame of audio is ready to be pulled
+ *
+ * @param[in]  jb  The buffer handle
+ *
+ * @return     true if `jitter_buffer_pull` returns a frame without concealment
+ */
+bool jitter_buffer_ready(jitter_buffer_handle_t jb);
+
+/**
+ * @brief      Pull the next frame to play
+ *
+ * @param[in]  jb       The buffer handle
+ * @param[out] out      Output, one frame
+ * @param[in]  conceal  The output is about to underrun, a frame is concealed if no audio is ready
+ *
+ * @return
+ *     - > 0  Bytes of the frame
+ *     - 0    Nothing to play yet, the buffer is filling up to the target
+ */
+int jitter_buffer_pull(jitter_buffer_handle_t jb, char *out, bool conceal);
+
+/**
+ * @brief      Pull the remaining audio as is, at the end of the stream
+ *
+ * @param[in]  jb   The buffer handle
+ * @param[out] out  Output, up to one frame
+ *
+ * @return     Bytes pulled, 0 when empty
+ */
+int jitter_buffer_drain(jitter_buffer_handle_t jb, char *out);
+
+/**
+ * @brief      Get the statistics
+ *
+ * @param[in]  jb    The buffer handle
+ * @param[out] info  The statistics
+ */
+void jitter_buffer_get_info(jitter_buffer_handle_t jb, jitter_stream_info_t *info);
+
+/**
+ * @brief      Drop the buffered audio, the estimates and the statistics
+ *
+ * @param[in]  jb  The buffer handle
+ */
+void jitter_buffer_reset(jitter_buffer_handle_t jb);
+
+/**
+ * @brief      Destroy a buffer
+ *
+ * @param[in]  jb  The buffer handle
+ */
+void jitter_buffer_destroy(jitter_buffer_handle_t jb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _JITTER_BUFFER_H_ */
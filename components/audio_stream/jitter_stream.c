@@ -0,0 +1,228 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_mem.h"
+#include "audio_mutex.h"
+#include "audio_element.h"
+#include "ringbuf.h"
+#include "jitter_stream.h"
+#include "jitter_buffer.h"
+
+static const char *TAG = "JITTER_STREAM";
+
+#define JITTER_STREAM_MAX_READS     (8)     /* Input reads per process call, the rest waits for the next frame */
+#define JITTER_STREAM_OUT_FRAMES    (2)     /* Frames ahead of the sink in the output, the delay is held in the buffer */
+
+typedef struct jitter_stream {
+    jitter_stream_cfg_t     cfg;
+    jitter_buffer_handle_t  jb;
+    void                   *lock;           /* Guards every access to `jb`, `jitter_stream_get_info` runs on other tasks */
+    char                   *frame;
+    int                     frame_size;
+    int                     sample_rate;
+    int                     channels;
+    TickType_t              wait_ticks;     /* Input wait when nothing can be played */
+    bool                    is_done;        /* The input finished, the buffer is drained */
+} jitter_stream_t;
+
+static esp_err_t _jitter_open(audio_element_handle_t self)
+{
+    jitter_stream_t *jitter = (jitter_stream_t *)audio_element_getdata(self);
+    audio_element_info_t info = {0};
+    audio_element_getinfo(self, &info);
+    if (info.bits != 16) {
+        ESP_LOGE(TAG, "Only 16-bit PCM is supported, got %d bits", info.bits);
+        return ESP_FAIL;
+    }
+    jitter->is_done = false;
+    if (jitter->jb && info.sample_rates == jitter->sample_rate && info.channels == jitter->channels) {
+        mutex_lock(jitter->lock);
+        jitter_buffer_reset(jitter->jb);
+        mutex_unlock(jitter->lock);
+        return ESP_OK;
+    }
+    jitter_buffer_cfg_t jb_cfg = {
+        .sample_rate = info.sample_rates,
+        .channels = info.channels,
+        .frame_ms = jitter->cfg.frame_ms,
+        .min_delay_ms = jitter->cfg.min_delay_ms,
+        .max_delay_ms = jitter->cfg.max_delay_ms,
+    };
+    jitter_buffer_handle_t jb = jitter_buffer_create(&jb_cfg);
+    AUDIO_NULL_CHECK(TAG, jb, return ESP_FAIL);
+    int frame_size = jitter_buffer_get_frame_size(jb);
+    char *frame = audio_calloc(1, frame_size);
+    AUDIO_MEM_CHECK(TAG, frame, {
+        jitter_buffer_destroy(jb);
+        return ESP_ERR_NO_MEM;
+    });
+    mutex_lock(jitter->lock);
+    jitter_buffer_destroy(jitter->jb);
+    jitter->jb = jb;
+    mutex_unlock(jitter->lock);
+    audio_free(jitter->frame);
+    jitter->frame = frame;
+    jitter->frame_size = frame_size;
+    jitter->sample_rate = info.sample_rates;
+    jitter->channels = info.channels;
+    jitter->wait_ticks = jitter->cfg.frame_ms / 2 / portTICK_PERIOD_MS;
+    if (jitter->wait_ticks == 0) {
+        jitter->wait_ticks = 1;
+    }
+    ESP_LOGI(TAG, "Open, %d Hz, %d channels, %d ms frames", info.sample_rates, info.channels, jitter->cfg.frame_ms);
+    return ESP_OK;
+}
+
+static esp_err_t _jitter_close(audio_element_handle_t self)
+{
+    // The buffer is kept, so the statistics can be read after the stream ended
+    return ESP_OK;
+}
+
+static int _jitter_process(audio_element_handle_t self, char *in_buffer, int in_len)
+{
+    jitter_stream_t *jitter = (jitter_stream_t *)audio_element_getdata(self);
+    int len = 0;
+    ringbuf_handle_t rb = audio_element_get_output_ringbuf(self);
+    int filled = rb ? rb_bytes_filled(rb) : 0;
+    // Frames are pulled at the playout pace, so the output does not take the audio out of the buffer
+    bool paced = (rb != NULL) && (filled >= JITTER_STREAM_OUT_FRAMES * jitter->frame_size);
+    if (jitter->is_done == false) {
+        // Wait for audio only when nothing can be played, then take everything that arrived
+        mutex_lock(jitter->lock);
+        bool ready = jitter_buffer_ready(jitter->jb);
+        mutex_unlock(jitter->lock);
+        TickType_t wait = (ready && paced == false) ? 0 : jitter->wait_ticks;
+        bool arrived = false;
+        for (int i = 0; i < JITTER_STREAM_MAX_READS; i++) {
+            audio_element_set_input_timeout(self, wait);
+            int r_size = audio_element_input(self, in_buffer, in_len);
+            if (r_size > 0) {
+                mutex_lock(jitter->lock);
+                jitter_buffer_put(jitter->jb, in_buffer, r_size, esp_timer_get_time());
+                mutex_unlock(jitter->lock);
+                arrived = true;
+                wait = 0;
+                continue;
+            }
+            if (r_size == AEL_IO_TIMEOUT) {
+                break;
+            }
+            if (r_size == AEL_IO_DONE || r_size == AEL_IO_OK) {
+                jitter->is_done = true;
+                break;
+            }
+            return r_size;
+        }
+        if (jitter->is_done == false) {
+            if (paced) {
+                return AEL_IO_TIMEOUT;
+            }
+            // Conceal only when nothing arrived and the output is about to run dry
+            bool starving = (arrived == false) && (rb == NULL || filled < jitter->frame_size);
+            mutex_lock(jitter->lock);
+            len = jitter_buffer_pull(jitter->jb, jitter->frame, starving);
+            mutex_unlock(jitter->lock);
+            if (len == 0) {
+                return AEL_IO_TIMEOUT;
+            }
+        }
+    }
+    if (jitter->is_done) {
+        mutex_lock(jitter->lock);
+        len = jitter_buffer_drain(jitter->jb, jitter->frame);
+        mutex_unlock(jitter->lock);
+        if (len == 0) {
+            return AEL_IO_DONE;
+        }
+    }
+    return audio_element_output(self, jitter->frame, len);
+}
+
+static esp_err_t _jitter_destroy(audio_element_handle_t self)
+{
+    jitter_stream_t *jitter = (jitter_stream_t *)audio_element_getdata(self);
+    jitter_buffer_destroy(jitter->jb);
+    audio_free(jitter->frame);
+    mutex_destroy(jitter->lock);
+    audio_free(jitter);
+    return ESP_OK;
+}
+
+audio_element_handle_t jitter_stream_init(jitter_stream_cfg_t *config)
+{
+    AUDIO_NULL_CHECK(TAG, config, return NULL);
+    jitter_stream_t *jitter = audio_calloc(1, sizeof(jitter_stream_t));
+    AUDIO_MEM_CHECK(TAG, jitter, return NULL);
+    memcpy(&jitter->cfg, config, sizeof(jitter_stream_cfg_t));
+    jitter->lock = mutex_create();
+    AUDIO_MEM_CHECK(TAG, jitter->lock, {
+        audio_free(jitter);
+        return NULL;
+    });
+
+    audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+    cfg.open = _jitter_open;
+    cfg.close = _jitter_close;
+    cfg.process = _jitter_process;
+    cfg.destroy = _jitter_destroy;
+    cfg.task_stack = config->task_stack;
+    cfg.task_prio = config->task_prio;
+    cfg.task_core = config->task_core;
+    cfg.stack_in_ext = config->stack_in_ext;
+    cfg.out_rb_size = config->out_rb_size;
+    cfg.tag = "jitter";
+    audio_element_handle_t el = audio_element_init(&cfg);
+    AUDIO_MEM_CHECK(TAG, el, {
+        mutex_destroy(jitter->lock);
+        audio_free(jitter);
+        return NULL;
+    });
+    audio_element_setdata(el, jitter);
+    audio_element_set_music_info(el, config->sample_rate, config->channels, 16);
+    ESP_LOGD(TAG, "stream init,el:%p", el);
+    return el;
+}
+
+esp_err_t jitter_stream_get_info(audio_element_handle_t jitter_stream, jitter_stream_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, jitter_stream, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_ERR_INVALID_ARG);
+    jitter_stream_t *jitter = (jitter_stream_t *)audio_element_getdata(jitter_stream);
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    mutex_lock(jitter->lock);
+    if (jitter->jb) {
+        jitter_buffer_get_info(jitter->jb, info);
+        ret = ESP_OK;
+    }
+    mutex_unlock(jitter->lock);
+    return ret;
+}
@@ -27,7 +27,7 @@
 
 #define TAG "HLS_PARSER"
 
-#define MEM_SAME(a, b) (memcmp(a, b, sizeof(b)-1) == 0)
+#define MEM_SAME(a, b) (strncmp((char*)a, b, sizeof(b)-1) == 0)
 #define STR_SAME(a, b) (strcmp((char*)a, b) == 0)
 
 static hls_playlist_type_t hls_get_playlist_type(char* attr)
@@ -146,15 +146,19 @@ static int hls_fill_media_attr(hls_media_t* m, hls_tag_info_t* tag_info)
                 m->type = (hls_type_t)tag_info->v[i].v;
                 break;
             case HLS_ATTR_GROUP_ID:
+                HLS_FREE(m->group_id);
                 m->group_id = audio_strdup(tag_info->v[i].s);
                 break;
             case HLS_ATTR_NAME:
+                HLS_FREE(m->name);
                 m->name = audio_strdup(tag_info->v[i].s);
                 break;
             case HLS_ATTR_LANGUAGE:
+                HLS_FREE(m->lang);
                 m->lang = audio_strdup(tag_info->v[i].s);
                 break;
             case HLS_ATTR_URI:
+                HLS_FREE(m->uri);
                 m->uri = audio_strdup(tag_info->v[i].s);
                 break;
             default:
@@ -175,18 +179,23 @@ static int hls_fill_stream_attr(hls_stream_t* s, hls_tag_info_t* tag_info)
                 s->bandwidth = (uint32_t)tag_info->v[i].v;
                 break;
             case HLS_ATTR_CODECS:
+                HLS_FREE(s->codec);
                 s->codec = audio_strdup(tag_info->v[i].s);
                 break;
             case HLS_ATTR_AUDIO:
+                HLS_FREE(s->audio);
                 s->audio = audio_strdup(tag_info->v[i].s);
                 break;
             case HLS_ATTR_SUBTITLES:
+                HLS_FREE(s->subtitle);
                 s->subtitle = audio_strdup(tag_info->v[i].s);
                 break;
             case HLS_ATTR_RESOLUTION:
+                HLS_FREE(s->resolution);
                 s->resolution = audio_strdup(tag_info->v[i].s);
                 break;
             case HLS_ATTR_URI:
+                HLS_FREE(s->uri);
                 s->uri = audio_strdup(tag_info->v[i].s);
                 break;
             default:
@@ -313,7 +322,11 @@ static int hls_media_tag_cb(hls_tag_info_t* tag_info, void* ctx)
                             if (strncasecmp(v, "0x", 2) == 0) {
                                 v += 2;
                             }
-                            hls_hex_to_bin(media->key[0].iv, v, strlen(v));
+                            int len = strlen(v);
+                            if (len > 2 * sizeof(media->key[0].iv)) {
+                                len = 2 * sizeof(media->key[0].iv);
+                            }
+                            hls_hex_to_bin(media->key[0].iv, v, len);
                             break;
                         }
                         case HLS_ATTR_URI:
@@ -380,7 +393,7 @@ static hls_media_t* hls_filter_media(hls_master_playlist_t* main, char* group_id
     }
     for (int i = 0; i < main->media_num; i++) {
         hls_media_t* m = &main->media[i];
-        if (m->uri && strcmp(m->group_id, group_id) == 0 && m->type == type) {
+        if (m->uri && m->group_id && strcmp(m->group_id, group_id) == 0 && m->type == type) {
             if (sel == NULL) {
                 sel = m;
             }
@@ -463,14 +476,8 @@ bool hls_playlist_is_media_end(hls_handle_t h)
     return false;
 }
 
-char* hls_playlist_get_prefer_url(hls_handle_t h, hls_stream_type_t type)
+static char* hls_get_stream_url(hls_master_playlist_t* master_playlist, hls_stream_t* stream, hls_stream_type_t type)
 {
-    hls_t* hls = (hls_t*) h;
-    if (hls == NULL || hls->master_playlist == NULL) {
-        return NULL;
-    }
-    hls_master_playlist_t* master_playlist = hls->master_playlist;
-    hls_stream_t* stream = hls_filter_stream(master_playlist, hls->cfg.prefer_bitrate);
     if (stream == NULL || stream->uri == NULL) {
         return NULL;
     }
@@ -495,7 +502,39 @@ char* hls_playlist_get_prefer_url(hls_handle_t h, hls_stream_type_t type)
         default:
             return NULL;
     }
-    return uri ? join_url(hls->master_playlist->uri, uri) : NULL;
+    return uri ? join_url(master_playlist->uri, uri) : NULL;
+}
+
+char* hls_playlist_get_prefer_url(hls_handle_t h, hls_stream_type_t type)
+{
+    hls_t* hls = (hls_t*) h;
+    if (hls == NULL || hls->master_playlist == NULL) {
+        return NULL;
+    }
+    hls_stream_t* stream = hls_filter_stream(hls->master_playlist, hls->cfg.prefer_bitrate);
+    return hls_get_stream_url(hls->master_playlist, stream, type);
+}
+
+int hls_playlist_get_variant_num(hls_handle_t h)
+{
+    hls_t* hls = (hls_t*) h;
+    if (hls == NULL || hls->master_playlist == NULL) {
+        return 0;
+    }
+    return hls->master_playlist->stream_num;
+}
+
+char* hls_playlist_get_variant_url(hls_handle_t h, int index, hls_stream_type_t type, uint32_t* bandwidth)
+{
+    hls_t* hls = (hls_t*) h;
+    if (hls == NULL || hls->master_playlist == NULL || index < 0 || index >= hls->master_playlist->stream_num) {
+        return NULL;
+    }
+    hls_stream_t* stream = &hls->master_playlist->stream[index];
+    if (bandwidth) {
+        *bandwidth = stream->bandwidth;
+    }
+    return hls_get_stream_url(hls->master_playlist, stream, type);
 }
 
 int hls_playlist_parse_data(hls_handle_t h, uint8_t* buffer, int size, bool eos)
@@ -600,6 +639,15 @@ uint64_t hls_playlist_get_sequence_no(hls_handle_t h)
     return media->media_sequence;
 }
 
+uint32_t hls_playlist_get_target_duration(hls_handle_t h)
+{
+    hls_t* hls = (hls_t*)h;
+    if (hls == NULL || hls->media_playlist == NULL) {
+        return 0;
+    }
+    return hls->media_playlist->target_duration;
+}
+
 int hls_playlist_get_key(hls_handle_t h, uint64_t sequence_no, hls_stream_key_t* key)
 {
     hls_t* hls = (hls_t*)h;
@@ -102,6 +102,26 @@ bool hls_playlist_is_media_end(hls_handle_t h);
  */
 char* hls_playlist_get_prefer_url(hls_handle_t h, hls_stream_type_t type);
 
+/**
+ * @brief         Get number of variant streams in master playlist
+ *
+ * @param         h: HLS handle
+ * @return        Variant stream number, 0 if not a master playlist
+ */
+int hls_playlist_get_variant_num(hls_handle_t h);
+
+/**
+ * @brief         Get url of one variant stream in master playlist
+ *
+ * @param         h: HLS handle
+ * @param         index: Variant index in playlist order
+ * @param         type: HLS stream type
+ * @param         bandwidth[out]: Declared bandwidth of the variant in bits per second, can be NULL
+ * @return        -NULL: Variant not existed
+ *                -Others: Url of the variant, need freed by caller
+ */
+char* hls_playlist_get_variant_url(hls_handle_t h, int index, hls_stream_type_t type, uint32_t* bandwidth);
+
 /**
  * @brief           Parse data of HLS playlist
  *
@@ -137,6 +157,13 @@ const char *hls_playlist_get_key_uri(hls_handle_t h);
  */
 uint64_t hls_playlist_get_sequence_no(hls_handle_t h);
 
+/**
+ * @brief         Get target duration
+ * @param         h: HLS handle
+ * @return        Maximum segment duration in seconds, 0 if not a media playlist
+ */
+uint32_t hls_playlist_get_target_duration(hls_handle_t h);
+
 /**
  * @brief         Get AES key information
  * @param         h: HLS handle
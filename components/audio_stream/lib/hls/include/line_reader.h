@@ -40,7 +40,7 @@ typedef struct {
     int      size;             /*!< Input data size */
     int      rp;               /*!< Read pointer of cache buffer */
     bool     eos;              /*!< Input data end of stream */
-    uint8_t* line_buffer;      /*!< Cache buffers for input data */
+    uint8_t* line_buffer;      /*!< Cache buffer for lines spanning two input buffers */
     uint16_t line_size;        /*!< Buffer size of cache buffer */
     uint16_t line_fill;        /*!< Cached size */
 } line_reader_t;
@@ -67,10 +67,13 @@ void line_reader_add_buffer(line_reader_t* reader, uint8_t* buffer, int size, bo
 /**
  * @brief      Get one line data from line reader
  *
+ * @note       Lines held entirely in the added buffer are returned in place, their line terminator
+ *             is overwritten by the string end. Only lines spanning two buffers are copied,
+ *             so the returned line is valid until the next call or until the buffer is reused.
+ *             Either way lines are cut to `line_size - 1` characters
+ *
  * @param      reader: Line reader instance
- * @param      buffer: Buffer to be parsed
- * @param      size: Buffer size
- * @return     Line data
+ * @return     Line data, NULL when more data is needed
  */
 char* line_reader_get_line(line_reader_t* reader);
 
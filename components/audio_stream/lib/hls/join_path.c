@@ -54,14 +54,14 @@ static char* get_slash(char* s, int len, int dir)
 
 char* join_url(char* base, char* ext)
 {
-    if (memcmp(ext, "http", 4) == 0) {
+    if (strncmp(ext, "http", 4) == 0) {
         return audio_strdup(ext);
     }
     int base_len = strlen(base);
     int ext_len  = strlen(ext);
     int ext_skip = 0;
     char* s;
-    if (memcmp(base, "http", 4)) {
+    if (strncmp(base, "http", 4)) {
         // local path
         char* ask = strchr(ext, '?');
         if (ask > ext) {
@@ -89,7 +89,7 @@ char* join_url(char* base, char* ext)
         } else if (*(ext+1) == '/') {
            ext_skip = 2;
         } else {
-            while (memcmp(ext + ext_skip, "../", 3) == 0) {
+            while (strncmp(ext + ext_skip, "../", 3) == 0) {
                 ext_skip += 3;
                 s = get_slash(base, base_len, 1);
                 if (s == NULL) {
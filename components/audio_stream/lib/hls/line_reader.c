@@ -31,13 +31,59 @@
 
 #define TAG "LINE_READER"
 
-static inline void line_reader_add_char(line_reader_t* b, uint8_t c)
+#define LINE_READER_ONES            (0x01010101u)
+#define LINE_READER_HIGHS           (0x80808080u)
+#define LINE_READER_HAS_ZERO(v)     (((v) - LINE_READER_ONES) & ~(v) & LINE_READER_HIGHS)
+#define LINE_READER_HAS_EOL(v)      (LINE_READER_HAS_ZERO((v) ^ (LINE_READER_ONES * '\n')) || \
+                                     LINE_READER_HAS_ZERO((v) ^ (LINE_READER_ONES * '\r')))
+
+static inline bool line_reader_is_eol(uint8_t c)
+{
+    return c == '\r' || c == '\n';
+}
+
+static uint8_t* line_reader_find_eol(uint8_t* p, uint8_t* end)
+{
+    // Bytes up to a word boundary, then a word at a time until one holds CR or LF
+    while (p < end && ((uintptr_t)p & 3)) {
+        if (line_reader_is_eol(*p)) {
+            return p;
+        }
+        p++;
+    }
+    while (end - p >= 4) {
+        uint32_t w;
+        memcpy(&w, p, sizeof(w));
+        if (LINE_READER_HAS_EOL(w)) {
+            break;
+        }
+        p += 4;
+    }
+    while (p < end) {
+        if (line_reader_is_eol(*p)) {
+            return p;
+        }
+        p++;
+    }
+    return end;
+}
+
+static inline void line_reader_append(line_reader_t* b, const uint8_t* data, int len)
 {
-    if (b->line_fill < b->line_size) {
-        b->line_buffer[b->line_fill++] = c;
-    } else {
+    int room = b->line_size - 1 - b->line_fill;
+    if (len > room) {
         ESP_LOGE(TAG, "Line too long try to init large than %d", b->line_size);
+        len = room;
     }
+    memcpy(b->line_buffer + b->line_fill, data, len);
+    b->line_fill += len;
+}
+
+static inline char* line_reader_take_line(line_reader_t* b)
+{
+    b->line_buffer[b->line_fill] = 0;
+    b->line_fill = 0;
+    return (char*)b->line_buffer;
 }
 
 line_reader_t* line_reader_init(int line_size)
@@ -70,24 +116,33 @@ char* line_reader_get_line(line_reader_t* b)
         return NULL;
     }
     while (b->rp < b->size) {
-        uint8_t c = b->buffer[b->rp];
-        if (c == '\r' || c == '\n') {
-            b->rp++;
-            if (b->line_fill) {
-                line_reader_add_char(b, 0);
-                b->line_fill = 0;
-                return (char*)b->line_buffer;
+        uint8_t* start = b->buffer + b->rp;
+        uint8_t* end = b->buffer + b->size;
+        uint8_t* eol = line_reader_find_eol(start, end);
+        int len = eol - start;
+        if (eol == end) {
+            // The line continues in the next buffer, keep its head
+            line_reader_append(b, start, len);
+            b->rp = b->size;
+            break;
+        }
+        b->rp += len + 1;
+        if (b->line_fill) {
+            line_reader_append(b, start, len);
+            return line_reader_take_line(b);
+        }
+        if (len) {
+            // Terminate in place, lines inside the buffer are handed out without a copy
+            if (len > b->line_size - 1) {
+                ESP_LOGE(TAG, "Line too long try to init large than %d", b->line_size);
+                len = b->line_size - 1;
             }
-            continue;
-        } else {
-            line_reader_add_char(b, c);
+            start[len] = 0;
+            return (char*)start;
         }
-        b->rp++;
     }
     if (b->eos && b->line_fill) {
-        line_reader_add_char(b, 0);
-        b->line_fill = 0;
-        return (char*)b->line_buffer;
+        return line_reader_take_line(b);
     }
     b->rp = 0; // auto reset
     b->size = 0;
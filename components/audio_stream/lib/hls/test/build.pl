@@ -1,7 +1,27 @@
 #!/usr/bin/perl
+#
+# Host build of the playlist library, its tests, benchmarks and fuzz harnesses
+#
+#   perl build.pl           build ./test, ./line_reader_bench and ./hls_bench
+#   perl build.pl fuzz      also build ./fuzz_hls_playlist and ./fuzz_join_url, with libFuzzer when
+#                           clang is found, else with the standalone driver in fuzz_driver.c
+#
 my @f = <../*.c>;
+my $fuzz = grep { $_ eq 'fuzz' } @ARGV;
 gen_fake_header();
 `gcc @f test.c -I../include -I../ -g -o ./test`;
+`gcc ../line_reader.c line_reader_bench.c -I../include -I../ -O2 -o ./line_reader_bench`;
+`gcc @f hls_bench.c -I../include -I../ -O2 -DHLS_COUNT_ALLOC -o ./hls_bench`;
+if ($fuzz) {
+    my $clang = `which clang 2>/dev/null`;
+    foreach my $h ('fuzz_hls_playlist', 'fuzz_join_url') {
+        if ($clang) {
+            `clang @f $h.c -I../include -I../ -g -O1 -fsanitize=fuzzer,address,undefined -o ./$h`;
+        } else {
+            `gcc @f $h.c fuzz_driver.c -I../include -I../ -g -O1 -fsanitize=address,undefined -fno-sanitize-recover=all -o ./$h`;
+        }
+    }
+}
 clear_up();
 
 sub clear_up {
@@ -14,11 +34,19 @@ sub gen_fake_header {
     my $audio_mem =<< 'MEM_H';
 #include <string.h>
 #include <stdlib.h>
+#ifdef HLS_COUNT_ALLOC
+extern int hls_alloc_count;
+#define audio_malloc(s)     (hls_alloc_count++, malloc(s))
+#define audio_strdup(s)     (hls_alloc_count++, strdup(s))
+#define audio_calloc(n, s)  (hls_alloc_count++, calloc(n, s))
+#define audio_realloc(p, s) (hls_alloc_count++, realloc(p, s))
+#else
 #define audio_malloc  malloc
-#define audio_free    free
 #define audio_strdup  strdup
 #define audio_calloc  calloc
 #define audio_realloc realloc
+#endif
+#define audio_free    free
 MEM_H
 
     my $audio_error =<< 'ERROR_H';
@@ -32,7 +60,11 @@ ERROR_H
 
    my $esp_log = << 'ESP_LOG_H';
 #include <stdarg.h>
+#ifdef HLS_QUIET_LOG
+#define LOGOUT(tag, format, ...)
+#else
 #define LOGOUT(tag, format, ...) printf("%s: "format, tag, ##__VA_ARGS__);
+#endif
 #define ESP_LOGI LOGOUT
 #define ESP_LOGE LOGOUT
 #define ESP_LOGD LOGOUT
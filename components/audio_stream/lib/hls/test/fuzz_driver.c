@@ -0,0 +1,155 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * Standalone driver for the fuzz harnesses when libFuzzer is not available
+ *
+ *   ./fuzz_xxx file...       run the given inputs, e.g. from AFL with `@@`
+ *   ./fuzz_xxx -r N [seed]   run N inputs mutated from the files in seed directory or built-in seeds
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#define FUZZ_MAX_SEEDS  (64)
+#define FUZZ_MAX_SIZE   (16 * 1024)
+
+static const char* builtin_seeds[] = {
+    "\x10#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:6\n#EXT-X-MEDIA-SEQUENCE:7\n"
+    "#EXT-X-KEY:METHOD=AES-128,URI=\"key.bin\",IV=0x000102030405060708090a0b0c0d0e0f\n"
+    "#EXTINF:6.0,\nseg7.aac\n#EXTINF:6.0,\n../b/seg8.aac\n#EXTINF:6.0,\n/abs/seg9.aac\n#EXT-X-ENDLIST\n",
+    "\x07#EXTM3U\r\n#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"aac\",NAME=\"en\",LANGUAGE=\"en\",DEFAULT=YES,URI=\"a/en.m3u8\"\r\n"
+    "#EXT-X-STREAM-INF:BANDWIDTH=64000,CODECS=\"mp4a.40.5\",AUDIO=\"aac\"\r\nlow/index.m3u8\r\n"
+    "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=128000,RESOLUTION=1x1\r\nhttp://cdn/high/index.m3u8\r\n",
+    "http://host/dir/index.m3u8?x=1\n../../seg.ts",
+    "/sdcard/list/a.m3u8\n./b.mp3?q",
+    "http://host\n//other/x",
+};
+
+static size_t read_file(const char* name, uint8_t* buf, size_t cap)
+{
+    FILE* fp = fopen(name, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+    size_t n = fread(buf, 1, cap, fp);
+    fclose(fp);
+    return n;
+}
+
+static void mutate(uint8_t* buf, size_t* size)
+{
+    static const char* tokens[] = {"\n", "\r", ",", "=", "\"", ":", "#EXT-X-KEY:", "#EXTINF:", "#EXT-X-STREAM-INF:",
+                                   "IV=0x", "URI=", "../", "//", "?", "0000000000000000000000000000000000000000"};
+    int steps = 1 + rand() % 8;
+    while (steps--) {
+        size_t pos = *size ? rand() % *size : 0;
+        switch (rand() % 4) {
+            case 0:
+                if (*size) {
+                    buf[pos] = rand();
+                }
+                break;
+            case 1:
+                if (*size) {
+                    size_t n = 1 + rand() % 16;
+                    n = n > *size - pos ? *size - pos : n;
+                    memmove(buf + pos, buf + pos + n, *size - pos - n);
+                    *size -= n;
+                }
+                break;
+            case 2: {
+                const char* t = tokens[rand() % (sizeof(tokens) / sizeof(tokens[0]))];
+                size_t n = strlen(t);
+                if (*size + n <= FUZZ_MAX_SIZE) {
+                    memmove(buf + pos + n, buf + pos, *size - pos);
+                    memcpy(buf + pos, t, n);
+                    *size += n;
+                }
+                break;
+            }
+            default:
+                if (*size && *size * 2 <= FUZZ_MAX_SIZE) {
+                    size_t n = rand() % (*size - pos + 1);
+                    memmove(buf + pos + n, buf + pos, *size - pos);
+                    *size += n;
+                }
+                break;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static uint8_t buf[FUZZ_MAX_SIZE];
+    if (argc >= 3 && strcmp(argv[1], "-r") == 0) {
+        static uint8_t seeds[FUZZ_MAX_SEEDS][FUZZ_MAX_SIZE];
+        size_t seed_size[FUZZ_MAX_SEEDS];
+        int seed_num = 0;
+        DIR* dir = argc >= 4 ? opendir(argv[3]) : NULL;
+        struct dirent* ent;
+        while (dir && (ent = readdir(dir)) != NULL && seed_num < FUZZ_MAX_SEEDS) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", argv[3], ent->d_name);
+            if (ent->d_name[0] != '.' && (seed_size[seed_num] = read_file(path, seeds[seed_num], FUZZ_MAX_SIZE)) > 0) {
+                seed_num++;
+            }
+        }
+        if (dir) {
+            closedir(dir);
+        }
+        for (int i = 0; seed_num == 0 && i < sizeof(builtin_seeds) / sizeof(builtin_seeds[0]); i++) {
+            seed_size[i] = strlen(builtin_seeds[i]);
+            memcpy(seeds[i], builtin_seeds[i], seed_size[i]);
+        }
+        if (seed_num == 0) {
+            seed_num = sizeof(builtin_seeds) / sizeof(builtin_seeds[0]);
+        }
+        long runs = atol(argv[2]);
+        srand(1);
+        for (long r = 0; r < runs; r++) {
+            int s = rand() % seed_num;
+            size_t size = seed_size[s];
+            memcpy(buf, seeds[s], size);
+            mutate(buf, &size);
+            LLVMFuzzerTestOneInput(buf, size);
+        }
+        printf("%ld runs done\n", runs);
+        return 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        size_t size = read_file(argv[i], buf, FUZZ_MAX_SIZE);
+        LLVMFuzzerTestOneInput(buf, size);
+    }
+    if (argc == 1) {
+        size_t size = fread(buf, 1, FUZZ_MAX_SIZE, stdin);
+        LLVMFuzzerTestOneInput(buf, size);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * libFuzzer / AFL harness for the playlist parser
+ *
+ * The first input byte selects the chunk size the playlist is fed with, so lines and tags
+ * are cut at every position, the rest is the playlist itself.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hls_playlist.h"
+
+static int fuzz_uri_cb(char* uri, void* ctx)
+{
+    // Touch the whole string, so a missing terminator is reported by the sanitizer
+    *(size_t*)ctx += strlen(uri);
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size < 1) {
+        return 0;
+    }
+    int chunk = data[0] + 1;
+    data++;
+    size--;
+    size_t uri_len = 0;
+    hls_playlist_cfg_t cfg = {
+        .prefer_bitrate = 128 * 1024,
+        .cb = fuzz_uri_cb,
+        .ctx = &uri_len,
+        .uri = "http://fuzz.example.com/live/index.m3u8?token=1",
+    };
+    hls_handle_t hls = hls_playlist_open(&cfg);
+    if (hls == NULL) {
+        return 0;
+    }
+    // The parser works on a writable buffer filled by each read
+    uint8_t* buf = malloc(chunk);
+    size_t pos = 0;
+    do {
+        int s = size - pos < (size_t)chunk ? (int)(size - pos) : chunk;
+        memcpy(buf, data + pos, s);
+        pos += s;
+        if (hls_playlist_parse_data(hls, buf, s, s < chunk) != 0) {
+            break;
+        }
+        if (s < chunk) {
+            break;
+        }
+    } while (1);
+    free(buf);
+
+    if (hls_playlist_is_master(hls)) {
+        int num = hls_playlist_get_variant_num(hls);
+        for (int i = 0; i < num; i++) {
+            uint32_t bandwidth = 0;
+            free(hls_playlist_get_variant_url(hls, i, HLS_STREAM_TYPE_AUDIO, &bandwidth));
+        }
+        free(hls_playlist_get_prefer_url(hls, HLS_STREAM_TYPE_AUDIO));
+    } else {
+        hls_playlist_is_media_end(hls);
+        hls_playlist_get_target_duration(hls);
+        if (hls_playlist_is_encrypt(hls)) {
+            uint8_t key[16] = {0};
+            hls_stream_key_t stream_key;
+            hls_playlist_get_key_uri(hls);
+            hls_playlist_parse_key(hls, key, sizeof(key));
+            hls_playlist_get_key(hls, hls_playlist_get_sequence_no(hls), &stream_key);
+        }
+    }
+    hls_playlist_close(hls);
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * libFuzzer / AFL harness for join_url
+ *
+ * The input is the base and the relative URI separated by a new line.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "join_path.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const uint8_t* sep = memchr(data, '\n', size);
+    if (sep == NULL) {
+        return 0;
+    }
+    size_t base_len = sep - data;
+    size_t ext_len = size - base_len - 1;
+    // Exact sized copies, so reads past the strings are reported by the sanitizer
+    char* base = malloc(base_len + 1);
+    char* ext = malloc(ext_len + 1);
+    memcpy(base, data, base_len);
+    base[base_len] = 0;
+    memcpy(ext, sep + 1, ext_len);
+    ext[ext_len] = 0;
+    if (strlen(base) == base_len && strlen(ext) == ext_len) {
+        char* url = join_url(base, ext);
+        if (url) {
+            // The result never holds more than both inputs
+            if (strlen(url) > base_len + ext_len) {
+                abort();
+            }
+            free(url);
+        }
+    }
+    free(base);
+    free(ext);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * Throughput benchmark of the playlist parser on synthetic master and media playlists
+ *
+ * Built with HLS_COUNT_ALLOC, so the fake audio_mem.h counts the allocations of the parser.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hls_playlist.h"
+
+#define BENCH_CHUNK_SIZE    (512)   /* Same as MAX_PLAYLIST_LINE_SIZE in http_stream */
+#define BENCH_MIN_MS        (200)
+
+int hls_alloc_count;
+
+static char* gen_media(int segments, int* size)
+{
+    int cap = 512 + segments * 128;
+    char* p = malloc(cap);
+    int n = snprintf(p, cap, "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:6\n#EXT-X-MEDIA-SEQUENCE:1000\n"
+                             "#EXT-X-KEY:METHOD=AES-128,URI=\"https://keys.example.com/k1\",IV=0x00000000000000000000000000000001\n");
+    for (int i = 0; i < segments; i++) {
+        if (i % 2) {
+            n += snprintf(p + n, cap - n, "#EXTINF:5.%03d,\nseg_%08d.aac\n", i % 1000, i);
+        } else {
+            n += snprintf(p + n, cap - n, "#EXTINF:5.%03d,\nhttps://cdn.example.com/live/aac_128k/seg_%08d.aac\n", i % 1000, i);
+        }
+    }
+    n += snprintf(p + n, cap - n, "#EXT-X-ENDLIST\n");
+    *size = n;
+    return p;
+}
+
+static char* gen_master(int variants, int* size)
+{
+    int cap = 512 + variants * 256;
+    char* p = malloc(cap);
+    int n = snprintf(p, cap, "#EXTM3U\n#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"aac\",NAME=\"English\",LANGUAGE=\"en\",DEFAULT=YES,URI=\"en/index.m3u8\"\n");
+    for (int i = 0; i < variants; i++) {
+        n += snprintf(p + n, cap - n, "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=%d,CODECS=\"mp4a.40.2\",AUDIO=\"aac\"\n"
+                      "variant_%d/index.m3u8\n", 32000 + i * 1000, i);
+    }
+    *size = n;
+    return p;
+}
+
+static int bench_uri_cb(char* uri, void* ctx)
+{
+    (*(int*)ctx)++;
+    return 0;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* Parse once like http_stream does, reading the playlist into a reused buffer */
+static int parse_once(const char* data, int size, bool master)
+{
+    static uint8_t buf[BENCH_CHUNK_SIZE];
+    int uris = 0;
+    hls_playlist_cfg_t cfg = {
+        .prefer_bitrate = 64000,
+        .cb = bench_uri_cb,
+        .ctx = &uris,
+        .uri = "https://cdn.example.com/live/aac_128k/index.m3u8",
+    };
+    hls_handle_t hls = hls_playlist_open(&cfg);
+    for (int pos = 0; pos <= size; pos += BENCH_CHUNK_SIZE) {
+        int s = size - pos < BENCH_CHUNK_SIZE ? size - pos : BENCH_CHUNK_SIZE;
+        memcpy(buf, data + pos, s);
+        hls_playlist_parse_data(hls, buf, s, s < BENCH_CHUNK_SIZE);
+        if (s < BENCH_CHUNK_SIZE) {
+            break;
+        }
+    }
+    if (master) {
+        uris = hls_playlist_get_variant_num(hls);
+        free(hls_playlist_get_prefer_url(hls, HLS_STREAM_TYPE_AUDIO));
+    }
+    hls_playlist_close(hls);
+    return uris;
+}
+
+static void bench(int entries, bool master)
+{
+    int size;
+    char* data = master ? gen_master(entries, &size) : gen_media(entries, &size);
+    hls_alloc_count = 0;
+    int uris = parse_once(data, size, master);
+    int allocs = hls_alloc_count;
+    int rounds = 0;
+    double start = now_ms(), elapsed;
+    do {
+        parse_once(data, size, master);
+        rounds++;
+        elapsed = now_ms() - start;
+    } while (elapsed < BENCH_MIN_MS);
+    double mb_s = (double)size * rounds / (elapsed / 1000.0) / (1024 * 1024);
+    printf("%-6s %6d entries %9d bytes: %7.1f MB/s, %8.3f ms per parse, %6.2f allocations per entry%s\n",
+           master ? "master" : "media", entries, size, mb_s, elapsed / rounds,
+           (double)allocs / entries, uris == entries ? "" : " (entries missed)");
+    free(data);
+}
+
+int main(int argc, char** argv)
+{
+    int entries[] = {10, 100, 1000, 10000};
+    for (int i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+        bench(entries[i], false);
+    }
+    for (int i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+        bench(entries[i], true);
+    }
+    return 0;
+}
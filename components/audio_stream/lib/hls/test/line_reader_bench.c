@@ -0,0 +1,228 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "line_reader.h"
+
+#define BENCH_CHUNK_SIZE    (512)   /* Same as MAX_PLAYLIST_LINE_SIZE in http_stream */
+#define BENCH_LINE_SIZE     (1024)
+#define BENCH_ROUNDS        (50)
+
+/* Byte by byte reference, the reader used before the word scan */
+static int ref_split(const uint8_t* data, int size, char** lines)
+{
+    static char line[BENCH_LINE_SIZE];
+    int fill = 0, n = 0;
+    for (int i = 0; i <= size; i++) {
+        if (i == size || data[i] == '\r' || data[i] == '\n') {
+            if (fill) {
+                line[fill] = 0;
+                lines[n++] = strdup(line);
+                fill = 0;
+            }
+            continue;
+        }
+        if (fill < BENCH_LINE_SIZE - 1) {
+            line[fill++] = data[i];
+        }
+    }
+    return n;
+}
+
+static uint8_t* gen_playlist(int segments, bool crlf, int* size)
+{
+    const char* eol = crlf ? "\r\n" : "\n";
+    int cap = 256 + segments * 160;
+    char* p = malloc(cap);
+    int n = snprintf(p, cap, "#EXTM3U%s#EXT-X-VERSION:3%s#EXT-X-TARGETDURATION:6%s#EXT-X-MEDIA-SEQUENCE:1000%s",
+                     eol, eol, eol, eol);
+    for (int i = 0; i < segments; i++) {
+        n += snprintf(p + n, cap - n, "#EXTINF:5.%03d,%s%shttps://cdn.example.com/live/audio/aac_128k/seg_%08d.aac%s",
+                      i % 1000, eol, (i % 17) ? "" : eol, 1000 + i, eol);
+    }
+    *size = n;
+    return (uint8_t*)p;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* Feed like http_stream does: copy each chunk into a reused buffer, then split */
+static int reader_split(line_reader_t* reader, const uint8_t* data, int size, int chunk, char** lines, bool keep)
+{
+    static uint8_t buf[BENCH_CHUNK_SIZE];
+    int n = 0;
+    for (int pos = 0; pos < size || pos == 0; pos += chunk) {
+        int s = size - pos < chunk ? size - pos : chunk;
+        memcpy(buf, data + pos, s);
+        line_reader_add_buffer(reader, buf, s, s < chunk);
+        char* line;
+        while ((line = line_reader_get_line(reader)) != NULL) {
+            if (keep) {
+                lines[n] = strdup(line);
+            }
+            n++;
+        }
+        if (s < chunk) {
+            break;
+        }
+    }
+    return n;
+}
+
+static int bench(int segments, bool crlf)
+{
+    int size;
+    uint8_t* data = gen_playlist(segments, crlf, &size);
+    char** expect = calloc(segments * 3 + 8, sizeof(char*));
+    char** got = calloc(segments * 3 + 8, sizeof(char*));
+    int expect_num = ref_split(data, size, expect);
+    int ret = 0;
+
+    // Every chunk size, so lines are cut at every offset
+    line_reader_t* reader = line_reader_init(BENCH_LINE_SIZE);
+    for (int chunk = 1; chunk <= BENCH_CHUNK_SIZE && ret == 0; chunk += (chunk < 16 ? 1 : 37)) {
+        int n = reader_split(reader, data, size, chunk, got, true);
+        if (n != expect_num) {
+            printf("chunk %d: %d lines, expect %d\n", chunk, n, expect_num);
+            ret = -1;
+        }
+        for (int i = 0; i < n; i++) {
+            if (ret == 0 && i < expect_num && strcmp(got[i], expect[i])) {
+                printf("chunk %d line %d: '%s' != '%s'\n", chunk, i, got[i], expect[i]);
+                ret = -1;
+            }
+            free(got[i]);
+        }
+    }
+
+    // The reference copies into a line buffer like the old reader, without the strdup of the check
+    double t = now_ms();
+    int lines = 0;
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        static char line[BENCH_LINE_SIZE];
+        int fill = 0;
+        for (int i = 0; i < size; i++) {
+            uint8_t c = data[i];
+            if (c == '\r' || c == '\n') {
+                if (fill) {
+                    line[fill] = 0;
+                    lines += line[0];
+                    fill = 0;
+                }
+                continue;
+            }
+            if (fill < BENCH_LINE_SIZE - 1) {
+                line[fill++] = c;
+            }
+        }
+    }
+    double ref_ms = now_ms() - t;
+    t = now_ms();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        lines += reader_split(reader, data, size, BENCH_CHUNK_SIZE, NULL, false);
+    }
+    double new_ms = now_ms() - t;
+    printf("%6d segments %s %8d bytes: byte loop %.3f ms, line_reader %.3f ms per parse (%d)\n",
+           segments, crlf ? "CRLF" : "LF  ", size, ref_ms / BENCH_ROUNDS, new_ms / BENCH_ROUNDS, lines & 1);
+
+    line_reader_deinit(reader);
+    for (int i = 0; i < expect_num; i++) {
+        free(expect[i]);
+    }
+    free(expect);
+    free(got);
+    free(data);
+    return ret;
+}
+
+/* Lines longer than the line size are cut to it, whether they are returned in place or copied */
+static int check_long_lines(void)
+{
+    int size = 0;
+    int cap = 4 * BENCH_LINE_SIZE + 64;
+    char* p = malloc(cap);
+    size += snprintf(p + size, cap - size, "#EXTM3U\n#EXTINF:5,\n");
+    for (int i = 0; i < 3 * BENCH_LINE_SIZE; i++) {
+        p[size++] = 'a' + i % 26;
+    }
+    size += snprintf(p + size, cap - size, "\nseg.aac\n");
+    char* expect[8];
+    char* got[8];
+    int expect_num = ref_split((uint8_t*)p, size, expect);
+    int ret = 0;
+    line_reader_t* reader = line_reader_init(BENCH_LINE_SIZE);
+    for (int chunk = 1; chunk <= BENCH_CHUNK_SIZE && ret == 0; chunk++) {
+        // Chunks larger than the line size hold the long line, see the in place path
+        int big = chunk * 8 + BENCH_LINE_SIZE;
+        int c = chunk < 64 ? chunk : (big < 4 * BENCH_LINE_SIZE ? big : chunk);
+        static uint8_t buf[4 * BENCH_LINE_SIZE + 64];
+        int n = 0;
+        for (int pos = 0; pos < size; pos += c) {
+            int s = size - pos < c ? size - pos : c;
+            memcpy(buf, p + pos, s);
+            line_reader_add_buffer(reader, buf, s, pos + s == size);
+            char* line;
+            while ((line = line_reader_get_line(reader)) != NULL && n < 8) {
+                got[n++] = strdup(line);
+            }
+        }
+        if (n != expect_num) {
+            printf("long line chunk %d: %d lines, expect %d\n", c, n, expect_num);
+            ret = -1;
+        }
+        for (int i = 0; i < n; i++) {
+            if (ret == 0 && strcmp(got[i], expect[i])) {
+                printf("long line chunk %d line %d: %d chars, expect %d\n", c, i, (int)strlen(got[i]), (int)strlen(expect[i]));
+                ret = -1;
+            }
+            free(got[i]);
+        }
+    }
+    line_reader_deinit(reader);
+    for (int i = 0; i < expect_num; i++) {
+        free(expect[i]);
+    }
+    free(p);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int ret = check_long_lines();
+    int segments[] = {10, 500, 5000, 50000};
+    for (int i = 0; i < sizeof(segments) / sizeof(segments[0]); i++) {
+        ret |= bench(segments[i], false);
+        ret |= bench(segments[i], true);
+    }
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
@@ -50,12 +50,19 @@ static const char *TAG = "PWM_STREAM";
 #define CHANNEL_LEFT_MASK   (0x01)
 #define CHANNEL_RIGHT_MASK  (0x02)
 #define AUDIO_PWM_CH_MAX (2)
+#define DUTY_WAKE_WORDS  (BUFFER_MIN_SIZE >> 2)   /**< Free duty words in ringbuffer to wake up the writer */
+#define DUTY_FRAC_BITS   (4)                      /**< Fractional bits of LEDC duty register */
+#define DUTY_RIGHT_SHIFT (16)
 
+/**
+ * The ringbuffer holds one precomputed 32bit duty word per frame, the low half word is the left channel
+ * duty register value and the high half word the right one. So the ISR only does one aligned load per sample.
+ */
 typedef struct {
-    char *buf;                         /**< Original pointer */
+    uint32_t *buf;                     /**< Original pointer */
     uint32_t volatile head;            /**< ending pointer */
     uint32_t volatile tail;            /**< Read pointer */
-    uint32_t size;                     /**< Buffer size */
+    uint32_t size;                     /**< Buffer size in duty words */
     uint32_t is_give;                  /**< semaphore give flag */
     SemaphoreHandle_t semaphore;       /**< Semaphore for data */
 } data_list_t;
@@ -77,6 +84,7 @@ typedef struct {
     uint32_t              channel_set_num;                 /**< channel audio set number */
     int32_t               framerate;                       /*!< frame rates in Hz */
     int32_t               bits_per_sample;                 /*!< bits per sample (16, 32) */
+    int32_t               shaping_err[AUDIO_PWM_CH_MAX][2];/*!< noise shaping error history per channel */
     audio_pwm_status_t    status;
 } audio_pwm_t;
 typedef audio_pwm_t *audio_pwm_handle_t;
@@ -122,7 +130,7 @@ static pwm_data_handle_t pwm_data_list_create(int size)
     pwm_data_handle_t data = heap_caps_calloc(1, sizeof(data_list_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
     AUDIO_NULL_CHECK(TAG, data, goto data_error);
 
-    data->buf = heap_caps_calloc(1, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    data->buf = heap_caps_calloc(1, size & ~3, MALLOC_CAP_INTERNAL | MALLOC_CAP_32BIT);
     AUDIO_NULL_CHECK(TAG, data->buf, goto data_error);
 
     data->semaphore = xSemaphoreCreateBinary();
@@ -130,7 +138,7 @@ static pwm_data_handle_t pwm_data_list_create(int size)
 
     data->is_give = 0;
     data->head = data->tail = 0;
-    data->size = size;
+    data->size = size >> 2;
     return data;
 
 data_error:
@@ -169,34 +177,19 @@ static esp_err_t pwm_data_list_flush(pwm_data_handle_t data)
     return ESP_OK;
 }
 
-static esp_err_t IRAM_ATTR pwm_data_list_read_byte(pwm_data_handle_t data, uint8_t *outdata)
+static inline bool IRAM_ATTR pwm_data_list_read_word(pwm_data_handle_t data, uint32_t *outdata)
 {
     uint32_t tail = data->tail;
-    if ((tail == data->head) || (tail == (data->head + 1))) {
-        return ESP_FAIL;
+    if (tail == data->head) {
+        return false;
     }
     *outdata = data->buf[tail];
     tail++;
     if (tail == data->size) {
         tail = 0;
     }
-
     data->tail = tail;
-    return ESP_OK;
-}
-
-static esp_err_t pwm_data_list_write_byte(pwm_data_handle_t data, const uint8_t indata)
-{
-    uint32_t next_head = data->head + 1;
-    if (next_head == data->size) {
-        next_head = 0;
-    }
-    if (next_head == data->tail) {
-        return ESP_FAIL;
-    }
-    data->buf[data->head] = indata;
-    data->head = next_head;
-    return ESP_OK;
+    return true;
 }
 
 static esp_err_t pwm_data_list_wait_semaphore(pwm_data_handle_t data, TickType_t ticks_to_wait)
@@ -217,16 +210,16 @@ static esp_err_t pwm_data_list_wait_flushed(pwm_data_handle_t data, TickType_t t
     return ESP_FAIL;
 }
 
-static inline void ledc_set_left_duty_fast(uint32_t duty_val)
+static inline void ledc_set_left_duty_fast(uint32_t duty_reg)
 {
-    *g_ledc_left_duty_val = (duty_val) << 4;
+    *g_ledc_left_duty_val = duty_reg;
     *g_ledc_left_conf0_val |= 0x00000014;
     *g_ledc_left_conf1_val |= 0x80000000;
 }
 
-static inline void ledc_set_right_duty_fast(uint32_t duty_val)
+static inline void ledc_set_right_duty_fast(uint32_t duty_reg)
 {
-    *g_ledc_right_duty_val = (duty_val) << 4;
+    *g_ledc_right_duty_val = duty_reg;
     *g_ledc_right_conf0_val |= 0x00000014;
     *g_ledc_right_conf1_val |= 0x80000000;
 }
@@ -267,56 +260,17 @@ static void IRAM_ATTR timer_group_isr(void *para)
     handle->timg_dev->hw_timer[handle->config.timer_num].config.tn_alarm_en = TIMER_ALARM_EN;
 #endif
 
-    static uint8_t wave_h, wave_l;
-    static uint16_t value;
-
-    if (handle->channel_mask & CHANNEL_LEFT_MASK) {
-        if (handle->config.duty_resolution > 8) {
-            pwm_data_list_read_byte(handle->data, &wave_l);
-            if (ESP_OK == pwm_data_list_read_byte(handle->data, &wave_h)) {
-                value = ((wave_h << 8) | wave_l);
-                ledc_set_left_duty_fast(value);
-            }
-        } else {
-            if (ESP_OK == pwm_data_list_read_byte(handle->data, &wave_h)) {
-                ledc_set_left_duty_fast(wave_h);
-            }
-        }
-    }
-
-    if (handle->channel_mask & CHANNEL_RIGHT_MASK) {
-        if (handle->channel_set_num == 1) {
-            if (handle->config.duty_resolution > 8) {
-                ledc_set_right_duty_fast(value);
-            } else {
-                ledc_set_right_duty_fast(wave_h);
-            }
-        } else {
-            if (handle->config.duty_resolution > 8) {
-                pwm_data_list_read_byte(handle->data, &wave_l);
-                if (ESP_OK == pwm_data_list_read_byte(handle->data, &wave_h)) {
-                    value = ((wave_h << 8) | wave_l);
-                    ledc_set_right_duty_fast(value);
-                }
-            } else {
-                if (ESP_OK == pwm_data_list_read_byte(handle->data, &wave_h)) {
-                    ledc_set_right_duty_fast(wave_h);
-                }
-            }
+    uint32_t duty;
+    if (pwm_data_list_read_word(handle->data, &duty)) {
+        if (handle->channel_mask & CHANNEL_LEFT_MASK) {
+            ledc_set_left_duty_fast(duty & 0xffff);
         }
-    } else {
-        if (handle->channel_set_num == 2) {
-            if (handle->config.duty_resolution > 8) {
-                pwm_data_list_read_byte(handle->data, &wave_h);
-                pwm_data_list_read_byte(handle->data, &wave_h);
-            } else {
-                pwm_data_list_read_byte(handle->data, &wave_h);
-            }
-            pwm_data_list_read_byte(handle->data, &wave_l);
+        if (handle->channel_mask & CHANNEL_RIGHT_MASK) {
+            ledc_set_right_duty_fast(duty >> DUTY_RIGHT_SHIFT);
         }
     }
 
-    if ((0 == handle->data->is_give && pwm_data_list_get_free(handle->data) > BUFFER_MIN_SIZE) ||
+    if ((0 == handle->data->is_give && pwm_data_list_get_free(handle->data) > DUTY_WAKE_WORDS) ||
         (2 == handle->data->is_give && pwm_data_list_get_count(handle->data) == 0)) {
         handle->data->is_give = 1;
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
@@ -491,69 +445,107 @@ esp_err_t audio_pwm_set_sample_rate(int rate)
     return res;
 }
 
-static esp_err_t pwm_data_convert(pwm_data_handle_t data, uint8_t *inbuf, int32_t bits_per, int32_t duty, uint32_t bytes)
+/**
+ * Requantize one 16bit sample to the duty resolution and return the duty register value.
+ * With noise shaping the quantization error is fed back through a 2nd order error filter,
+ * which moves the requantization noise out of the low frequencies where it is most audible.
+ */
+static inline uint32_t pwm_duty_quantize(audio_pwm_handle_t handle, int ch, int32_t sample, const bool shaping)
 {
-    int8_t shift = bits_per - duty;
-    uint32_t len = bytes;
+    int32_t shift = 16 - handle->config.duty_resolution;
+    int32_t max = (1 << handle->config.duty_resolution) - 1;
+    int32_t value = sample + 0x8000;
+    if (shaping) {
+        int32_t *err = handle->shaping_err[ch];
+        value += 2 * err[0] - err[1];
+        if (value < 0) {
+            value = 0;
+        } else if (value > 0xffff) {
+            value = 0xffff;
+        }
+        int32_t q = (value + (1 << (shift - 1))) >> shift;
+        if (q > max) {
+            q = max;
+        }
+        err[1] = err[0];
+        err[0] = value - (q << shift);
+        value = q;
+    } else {
+        value >>= shift;
+    }
+    return (uint32_t)value << DUTY_FRAC_BITS;
+}
 
+static inline int32_t pwm_load_sample(const uint8_t *inbuf, const int32_t bits_per)
+{
     if (bits_per == 16) {
-        len >>= 1;
-        uint16_t *buf_16b = (uint16_t *)inbuf;
-        uint16_t value;
-        int16_t temp;
-        if (duty > 8) {
-            for (size_t i = 0; i < len; i++) {
-                temp = buf_16b[i];
-                value = temp + 0x7fff;
-                value >>= shift;
-                pwm_data_list_write_byte(data, value);
-                pwm_data_list_write_byte(data, value >> 8);
-            }
+        return *(const int16_t *)inbuf;
+    }
+    return *(const int32_t *)inbuf >> 16;
+}
+
+static inline __attribute__((always_inline)) uint32_t pwm_data_convert_run(audio_pwm_handle_t handle, const uint8_t *inbuf, uint32_t frames,
+                                                                           const int32_t bits_per, const bool stereo, const bool shaping)
+{
+    pwm_data_handle_t data = handle->data;
+    const int sample_bytes = bits_per >> 3;
+    uint32_t head = data->head;
+    for (uint32_t i = 0; i < frames; i++) {
+        int32_t left = pwm_load_sample(inbuf, bits_per);
+        int32_t right = left;
+        inbuf += sample_bytes;
+        if (stereo) {
+            right = pwm_load_sample(inbuf, bits_per);
+            inbuf += sample_bytes;
+        }
+        data->buf[head] = pwm_duty_quantize(handle, CHANNEL_LEFT_INDEX, left, shaping)
+                          | (pwm_duty_quantize(handle, CHANNEL_RIGHT_INDEX, right, shaping) << DUTY_RIGHT_SHIFT);
+        head++;
+        if (head == data->size) {
+            head = 0;
+        }
+    }
+    return head;
+}
+
+/**
+ * Convert `frames` frames to duty words directly into the ringbuffer, the caller makes sure there is enough space.
+ * The head is published once for the whole block.
+ */
+static esp_err_t pwm_data_convert(audio_pwm_handle_t handle, const uint8_t *inbuf, uint32_t frames)
+{
+    pwm_data_handle_t data = handle->data;
+    bool stereo = handle->channel_set_num == 2;
+    bool shaping = handle->config.noise_shaping;
+    uint32_t head;
+    if (handle->bits_per_sample == 16) {
+        if (stereo) {
+            head = shaping ? pwm_data_convert_run(handle, inbuf, frames, 16, true, true) : pwm_data_convert_run(handle, inbuf, frames, 16, true, false);
         } else {
-            for (size_t i = 0; i < len; i++) {
-                temp = buf_16b[i];
-                value = temp + 0x7fff;
-                value >>= shift;
-                pwm_data_list_write_byte(data, value);
-            }
+            head = shaping ? pwm_data_convert_run(handle, inbuf, frames, 16, false, true) : pwm_data_convert_run(handle, inbuf, frames, 16, false, false);
         }
-    } else if (bits_per == 32) {
-        len >>= 2;
-        uint32_t *buf_32b = (uint32_t *)inbuf;
-        uint32_t value;
-        int32_t temp;
-        if (duty > 8) {
-            for (size_t i = 0; i < len; i++) {
-                temp = buf_32b[i];
-                value = temp + 0x7fffffff;
-                value >>= shift;
-                pwm_data_list_write_byte(data, value);
-                pwm_data_list_write_byte(data, value >> 8);
-            }
+    } else if (handle->bits_per_sample == 32) {
+        if (stereo) {
+            head = shaping ? pwm_data_convert_run(handle, inbuf, frames, 32, true, true) : pwm_data_convert_run(handle, inbuf, frames, 32, true, false);
         } else {
-            for (size_t i = 0; i < len; i++) {
-                temp = buf_32b[i];
-                value = temp + 0x7fffffff;
-                value >>= shift;
-                pwm_data_list_write_byte(data, value);
-            }
+            head = shaping ? pwm_data_convert_run(handle, inbuf, frames, 32, false, true) : pwm_data_convert_run(handle, inbuf, frames, 32, false, false);
         }
     } else {
-        ESP_LOGE(TAG, "Only support bits (16 or 32), now bits_per is %"PRId32, bits_per);
+        ESP_LOGE(TAG, "Only support bits (16 or 32), now bits_per is %"PRId32, handle->bits_per_sample);
+        return ESP_FAIL;
     }
+    data->head = head;
     return ESP_OK;
 }
 
 static uint32_t pwm_get_data_duration(uint32_t data_size)
 {
     audio_pwm_handle_t handle = g_audio_pwm_handle;
-    uint32_t sample_bytes = (handle->config.duty_resolution) > 8 ? 2: 1;
-    uint32_t byte_rate = sample_bytes * handle->channel_set_num * handle->framerate;
-    if (byte_rate == 0) {
+    if (handle->framerate == 0) {
         return 0;
     }
-    // Add extra 20ms
-    return (data_size * 1000 / byte_rate) + 20;
+    // One duty word per frame, add extra 20ms
+    return (data_size * 1000 / handle->framerate) + 20;
 }
 
 static void pwm_wait_flush(void)
@@ -573,22 +565,24 @@ esp_err_t audio_pwm_write(uint8_t *inbuf, size_t inbuf_len, size_t *bytes_writte
 
     *bytes_written = 0;
     pwm_data_handle_t data = handle->data;
+    uint32_t frame_bytes = (handle->bits_per_sample >> 3) * handle->channel_set_num;
+    AUDIO_CHECK(TAG, frame_bytes > 0, return ESP_FAIL, "AUDIO PWM PARAM IS NOT SET");
     while (inbuf_len) {
-        if (ESP_OK == pwm_data_list_wait_semaphore(data, ticks_to_wait)) {
+        // Only sleep when the ringbuffer is almost full, the ISR wakes us up once enough duty words are played
+        if (pwm_data_list_get_free(data) > DUTY_WAKE_WORDS || ESP_OK == pwm_data_list_wait_semaphore(data, ticks_to_wait)) {
             uint32_t free = pwm_data_list_get_free(data);
-            uint32_t bytes_can_write = inbuf_len;
-            if (inbuf_len > free) {
-                bytes_can_write = free;
+            uint32_t frames = inbuf_len / frame_bytes;
+            if (frames > free) {
+                frames = free;
             }
-            bytes_can_write &= 0xfffffffc;
-            if (0 == bytes_can_write) {
+            if (0 == frames) {
                 *bytes_written += inbuf_len;
                 return ESP_OK;
             }
-            pwm_data_convert(data, inbuf, handle->bits_per_sample, handle->config.duty_resolution, bytes_can_write);
-            inbuf += bytes_can_write;
-            inbuf_len -= bytes_can_write;
-            *bytes_written += bytes_can_write;
+            pwm_data_convert(handle, inbuf, frames);
+            inbuf += frames * frame_bytes;
+            inbuf_len -= frames * frame_bytes;
+            *bytes_written += frames * frame_bytes;
         } else {
             res = ESP_FAIL;
         }
@@ -617,6 +611,7 @@ static esp_err_t audio_pwm_stop(void)
     timer_pause(handle->config.tg_num, handle->config.timer_num);
     timer_disable_intr(handle->config.tg_num, handle->config.timer_num);
     pwm_data_list_flush(handle->data);
+    memset(handle->shaping_err, 0, sizeof(handle->shaping_err));
     handle->status = AUDIO_PWM_STATUS_IDLE;
     return ESP_OK;
 }
@@ -24,6 +24,8 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <string.h>
+#include <unistd.h>
 
 #include "unity.h"
 #include "esp_err.h"
@@ -32,6 +34,7 @@
 #include "audio_pipeline.h"
 #include "audio_mem.h"
 #include "fatfs_stream.h"
+#include "raw_stream.h"
 
 #include "esp_peripherals.h"
 #include "board.h"
@@ -40,6 +43,16 @@ static const char *TAG = "FATFS_STREAM_TEST";
 
 #define TEST_FATFS_READER  "/sdcard/test.mp3"
 #define TEST_FATFS_WRITER  "/sdcard/WRITER.MP3"
+#define TEST_FATFS_WB      "/sdcard/WB_TEST.WAV"
+
+#define TEST_WB_CHUNK      (1000)
+#define TEST_WB_CHUNKS     (200)
+#define TEST_WB_SYNC_MS    (200)
+#define TEST_WB_HEADER     (44)
+
+#define TEST_FATFS_RA      "/sdcard/RA_TEST.BIN"
+#define TEST_RA_SIZE       (256 * 1024)
+#define TEST_RA_BLOCK      (FATFS_STREAM_READ_AHEAD_SIZE / 2)
 
 
 static uint64_t get_file_size(const char *name)
@@ -84,6 +97,22 @@ TEST_CASE("fatfs stream init memory", "[esp-adf-stream]")
     AUDIO_MEM_SHOW("AFTER FATFS_STREAM_INIT MEMORY TEST");
 }
 
+TEST_CASE("fatfs stream write-behind init memory", "[esp-adf-stream]")
+{
+    audio_element_handle_t fatfs_stream_writer;
+    fatfs_stream_cfg_t fatfs_cfg = FATFS_STREAM_CFG_DEFAULT();
+    fatfs_cfg.type = AUDIO_STREAM_WRITER;
+    fatfs_cfg.write_behind_size = FATFS_STREAM_WRITE_BEHIND_SIZE;
+    int cnt = 500;
+    AUDIO_MEM_SHOW("BEFORE FATFS_STREAM_INIT WRITE-BEHIND MEMORY TEST");
+    while (cnt--) {
+        fatfs_stream_writer = fatfs_stream_init(&fatfs_cfg);
+        TEST_ASSERT_NOT_NULL(fatfs_stream_writer);
+        audio_element_deinit(fatfs_stream_writer);
+    }
+    AUDIO_MEM_SHOW("AFTER FATFS_STREAM_INIT WRITE-BEHIND MEMORY TEST");
+}
+
 TEST_CASE("fatfs stream read write loop", "[esp-adf-stream]")
 {
     audio_pipeline_handle_t pipeline;
@@ -159,3 +188,234 @@ TEST_CASE("fatfs stream read write loop", "[esp-adf-stream]")
 
 
 }
+
+static inline uint8_t wb_test_byte(int pos)
+{
+    return (uint8_t)(pos * 7 + (pos >> 8));
+}
+
+static int wb_test_check(FILE *f, int64_t offset, int len)
+{
+    uint8_t buf[256];
+    int pos = 0;
+    if (fseek(f, offset, SEEK_SET) != 0) {
+        return -1;
+    }
+    while (pos < len) {
+        int want = len - pos < sizeof(buf) ? len - pos : sizeof(buf);
+        if (fread(buf, 1, want, f) != want) {
+            return -1;
+        }
+        for (int i = 0; i < want; i++) {
+            if (buf[i] != wb_test_byte(pos + i)) {
+                ESP_LOGE(TAG, "Data mismatch at %d", pos + i);
+                return -1;
+            }
+        }
+        pos += want;
+    }
+    return 0;
+}
+
+TEST_CASE("fatfs stream write-behind readback", "[esp-adf-stream]")
+{
+    esp_periph_config_t periph_cfg = DEFAULT_ESP_PERIPH_SET_CONFIG();
+    esp_periph_set_handle_t set = esp_periph_set_init(&periph_cfg);
+    TEST_ASSERT_NOT_NULL(set);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_board_sdcard_init(set, SD_MODE_1_LINE));
+
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    audio_pipeline_handle_t pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(pipeline);
+
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_WRITER;
+    audio_element_handle_t raw_writer = raw_stream_init(&raw_cfg);
+    TEST_ASSERT_NOT_NULL(raw_writer);
+
+    fatfs_stream_cfg_t fatfs_cfg = FATFS_STREAM_CFG_DEFAULT();
+    fatfs_cfg.type = AUDIO_STREAM_WRITER;
+    fatfs_cfg.write_behind_size = FATFS_STREAM_WRITE_BEHIND_SIZE;
+    fatfs_cfg.sync_interval_ms = TEST_WB_SYNC_MS;
+    fatfs_cfg.prealloc_size = 256 * 1024;
+    audio_element_handle_t fatfs_writer = fatfs_stream_init(&fatfs_cfg);
+    TEST_ASSERT_NOT_NULL(fatfs_writer);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, raw_writer, "src"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, fatfs_writer, "file_writer"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(pipeline, (const char *[]) {"src", "file_writer"}, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_set_uri(fatfs_writer, TEST_FATFS_WB));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_set_music_info(fatfs_writer, 16000, 1, 16));
+
+    audio_event_iface_cfg_t evt_cfg = AUDIO_EVENT_IFACE_DEFAULT_CFG();
+    audio_event_iface_handle_t evt = audio_event_iface_init(&evt_cfg);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_set_listener(pipeline, evt));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(pipeline));
+
+    uint8_t *chunk = audio_malloc(TEST_WB_CHUNK);
+    TEST_ASSERT_NOT_NULL(chunk);
+    int total = 0;
+    for (int n = 0; n < TEST_WB_CHUNKS; n++) {
+        for (int i = 0; i < TEST_WB_CHUNK; i++) {
+            chunk[i] = wb_test_byte(total + i);
+        }
+        TEST_ASSERT_EQUAL(TEST_WB_CHUNK, raw_stream_write(raw_writer, (char *)chunk, TEST_WB_CHUNK));
+        total += TEST_WB_CHUNK;
+        if (n == TEST_WB_CHUNKS / 2) {
+            // With the input idle, staged data reaches the card within a sync interval while the file stays open
+            vTaskDelay(4 * TEST_WB_SYNC_MS / portTICK_PERIOD_MS);
+            FILE *f = fopen(TEST_FATFS_WB, "rb");
+            TEST_ASSERT_NOT_NULL(f);
+            TEST_ASSERT_EQUAL(0, wb_test_check(f, TEST_WB_HEADER, total));
+            fclose(f);
+        }
+    }
+    audio_free(chunk);
+    audio_element_set_ringbuf_done(raw_writer);
+
+    while (1) {
+        audio_event_iface_msg_t msg;
+        if (audio_event_iface_listen(evt, &msg, portMAX_DELAY) != ESP_OK) {
+            continue;
+        }
+        if (msg.source_type == AUDIO_ELEMENT_TYPE_ELEMENT && msg.source == (void *) fatfs_writer
+            && msg.cmd == AEL_MSG_CMD_REPORT_STATUS
+            && (((int)msg.data == AEL_STATUS_STATE_STOPPED) || ((int)msg.data == AEL_STATUS_STATE_FINISHED))) {
+            break;
+        }
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(pipeline));
+
+    // Closed file: cut to the data, header rewritten in place with the data size
+    TEST_ASSERT_EQUAL(TEST_WB_HEADER + total, get_file_size(TEST_FATFS_WB));
+    FILE *f = fopen(TEST_FATFS_WB, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    uint8_t head[TEST_WB_HEADER];
+    TEST_ASSERT_EQUAL(TEST_WB_HEADER, fread(head, 1, TEST_WB_HEADER, f));
+    TEST_ASSERT_EQUAL(0, memcmp(head, "RIFF", 4));
+    TEST_ASSERT_EQUAL(total, head[40] | (head[41] << 8) | (head[42] << 16) | (head[43] << 24));
+    TEST_ASSERT_EQUAL(0, wb_test_check(f, TEST_WB_HEADER, total));
+    fclose(f);
+    unlink(TEST_FATFS_WB);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, raw_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, fatfs_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_remove_listener(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_event_iface_destroy(evt));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(raw_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(fatfs_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_periph_set_stop_all(set));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_periph_set_destroy(set));
+}
+
+static void ra_test_write_file(void)
+{
+    FILE *f = fopen(TEST_FATFS_RA, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    uint32_t words[256];
+    for (uint32_t pos = 0; pos < TEST_RA_SIZE; pos += sizeof(words)) {
+        for (int i = 0; i < 256; i++) {
+            words[i] = pos + i * 4;
+        }
+        TEST_ASSERT_EQUAL(sizeof(words), fwrite(words, 1, sizeof(words), f));
+    }
+    fclose(f);
+}
+
+TEST_CASE("fatfs stream read-ahead seek and stats", "[esp-adf-stream]")
+{
+    esp_periph_config_t periph_cfg = DEFAULT_ESP_PERIPH_SET_CONFIG();
+    esp_periph_set_handle_t set = esp_periph_set_init(&periph_cfg);
+    TEST_ASSERT_NOT_NULL(set);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_board_sdcard_init(set, SD_MODE_1_LINE));
+    // Every word holds its own file offset, so the data checks itself wherever a seek lands
+    ra_test_write_file();
+
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    audio_pipeline_handle_t pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(pipeline);
+
+    fatfs_stream_cfg_t fatfs_cfg = FATFS_STREAM_CFG_DEFAULT();
+    fatfs_cfg.type = AUDIO_STREAM_READER;
+    fatfs_cfg.read_ahead_size = FATFS_STREAM_READ_AHEAD_SIZE;
+    audio_element_handle_t fatfs_reader = fatfs_stream_init(&fatfs_cfg);
+    TEST_ASSERT_NOT_NULL(fatfs_reader);
+
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_READER;
+    audio_element_handle_t raw_reader = raw_stream_init(&raw_cfg);
+    TEST_ASSERT_NOT_NULL(raw_reader);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, fatfs_reader, "file_reader"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, raw_reader, "sink"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(pipeline, (const char *[]) {"file_reader", "sink"}, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_set_uri(fatfs_reader, TEST_FATFS_RA));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(pipeline));
+
+    uint8_t buf[1024];
+    uint32_t word = 0;
+    int word_fill = 0;
+    int consumed = 0;
+    int words = 0;
+    int seeks = 0;
+    uint32_t last = 0;
+    fatfs_stream_read_stats_t stats = { 0 };
+    while (1) {
+        int ret = raw_stream_read(raw_reader, (char *)buf, sizeof(buf));
+        if (ret <= 0) {
+            break;
+        }
+        for (int i = 0; i < ret; i++) {
+            word |= (uint32_t)buf[i] << (8 * word_fill);
+            if (++word_fill < 4) {
+                continue;
+            }
+            // Word aligned and in the file, seeks may land anywhere between two words
+            TEST_ASSERT_EQUAL(0, word % 4);
+            TEST_ASSERT_TRUE(word < TEST_RA_SIZE);
+            last = word;
+            words++;
+            word = 0;
+            word_fill = 0;
+        }
+        consumed += ret;
+        if ((seeks == 0 && consumed >= 8 * 1024) || (seeks == 2 && consumed >= 64 * 1024)) {
+            // Forward into the next block, which is most likely read already
+            audio_element_info_t info;
+            audio_element_getinfo(fatfs_reader, &info);
+            int64_t pos = (info.byte_pos / TEST_RA_BLOCK + 1) * TEST_RA_BLOCK + 64;
+            TEST_ASSERT_EQUAL(ESP_OK, audio_element_set_byte_pos(fatfs_reader, pos < TEST_RA_SIZE ? pos : 0));
+            seeks++;
+        } else if (seeks == 1 && consumed >= 32 * 1024) {
+            // Backward, outside every block
+            TEST_ASSERT_EQUAL(ESP_OK, audio_element_set_byte_pos(fatfs_reader, 4096 + 8));
+            seeks++;
+        } else if (seeks == 3 && consumed >= 96 * 1024) {
+            TEST_ASSERT_EQUAL(ESP_OK, fatfs_stream_get_read_stats(fatfs_reader, &stats));
+            seeks++;
+        }
+    }
+    ESP_LOGI(TAG, "Read %d bytes, %u reads, p50 %u us, p90 %u us, p99 %u us, max %u us, %u stalls",
+             consumed, (unsigned)stats.reads, (unsigned)stats.p50_us, (unsigned)stats.p90_us,
+             (unsigned)stats.p99_us, (unsigned)stats.max_us, (unsigned)stats.stalls);
+    TEST_ASSERT_EQUAL(4, seeks);
+    TEST_ASSERT_EQUAL(0, word_fill);
+    TEST_ASSERT_EQUAL(TEST_RA_SIZE - 4, last);
+    TEST_ASSERT_EQUAL(consumed / 4, words);
+    TEST_ASSERT_TRUE(stats.reads > 0);
+    TEST_ASSERT_TRUE(stats.bytes >= 96 * 1024);
+    TEST_ASSERT_TRUE(stats.p50_us <= stats.p90_us);
+    TEST_ASSERT_TRUE(stats.p90_us <= stats.p99_us);
+    TEST_ASSERT_TRUE(stats.p99_us <= stats.max_us);
+    unlink(TEST_FATFS_RA);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, fatfs_reader));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, raw_reader));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(fatfs_reader));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(raw_reader));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_periph_set_stop_all(set));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_periph_set_destroy(set));
+}
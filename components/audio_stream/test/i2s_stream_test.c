@@ -252,4 +252,28 @@ TEST_CASE("i2s_stream_clk", "[esp-adf-stream]")
         ESP_LOGI(TAG, "rate is %d, bits is %d, ch is %d", unitest_i2s_clk[i].rate, unitest_i2s_clk[i].bits, unitest_i2s_clk[i].ch);
         TEST_ASSERT_EQUAL(ESP_OK, i2s_stream_set_clk(i2s_stream_reader, unitest_i2s_clk[i].rate, unitest_i2s_clk[i].bits, unitest_i2s_clk[i].ch));
     }
-}
\ No newline at end of file
+}
+TEST_CASE("i2s_stream drift compensation", "[esp-adf-stream]")
+{
+    float ppm = 1.0;
+    i2s_stream_cfg_t i2s_cfg = I2S_STREAM_CFG_DEFAULT();
+    i2s_cfg.type = AUDIO_STREAM_WRITER;
+    audio_element_handle_t i2s_stream_writer = i2s_stream_init(&i2s_cfg);
+    TEST_ASSERT_NOT_NULL(i2s_stream_writer);
+
+    i2s_stream_drift_cfg_t drift_cfg = {
+        .target_fill = 4096,
+        .max_ppm = 300,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_stream_set_drift_compensation(i2s_stream_writer, true, &drift_cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_stream_get_drift_ppm(i2s_stream_writer, &ppm));
+    TEST_ASSERT_EQUAL(0, ppm);
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_stream_set_drift_compensation(i2s_stream_writer, false, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(i2s_stream_writer));
+
+    i2s_cfg.type = AUDIO_STREAM_READER;
+    audio_element_handle_t i2s_stream_reader = i2s_stream_init(&i2s_cfg);
+    TEST_ASSERT_NOT_NULL(i2s_stream_reader);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, i2s_stream_set_drift_compensation(i2s_stream_reader, true, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(i2s_stream_reader));
+}
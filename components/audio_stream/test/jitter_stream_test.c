@@ -0,0 +1,135 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "unity.h"
+#include "esp_log.h"
+
+#include "audio_pipeline.h"
+#include "audio_mem.h"
+#include "audio_element.h"
+#include "raw_stream.h"
+#include "jitter_stream.h"
+
+static const char *TAG = "JITTER_STREAM_TEST";
+
+#define TEST_SAMPLE_RATE    (16000)
+#define TEST_PACKET_MS      (10)
+#define TEST_PACKET_SAMPLES (TEST_SAMPLE_RATE * TEST_PACKET_MS / 1000)
+
+static volatile bool reader_run;
+
+static void jitter_test_reader_task(void *param)
+{
+    audio_element_handle_t raw_reader = (audio_element_handle_t)param;
+    char *buf = audio_calloc(1, TEST_PACKET_SAMPLES * 2 * 2);
+    while (reader_run && buf) {
+        // Play out like a codec clocked at the nominal rate
+        if (raw_stream_read(raw_reader, buf, TEST_PACKET_SAMPLES * 2 * 2) < 0) {
+            break;
+        }
+        vTaskDelay(2 * TEST_PACKET_MS / portTICK_PERIOD_MS);
+    }
+    audio_free(buf);
+    reader_run = false;
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("jitter stream init memory", "[esp-adf-stream]")
+{
+    jitter_stream_cfg_t jitter_cfg = JITTER_STREAM_CFG_DEFAULT();
+    int cnt = 2000;
+    AUDIO_MEM_SHOW("BEFORE JITTER_STREAM_INIT MEMORY TEST");
+    while (cnt--) {
+        audio_element_handle_t jitter = jitter_stream_init(&jitter_cfg);
+        TEST_ASSERT_NOT_NULL(jitter);
+        audio_element_deinit(jitter);
+    }
+    AUDIO_MEM_SHOW("AFTER JITTER_STREAM_INIT MEMORY TEST");
+}
+
+TEST_CASE("jitter stream conceals a stalled source", "[esp-adf-stream]")
+{
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_WRITER;
+    audio_element_handle_t raw_writer = raw_stream_init(&raw_cfg);
+    raw_cfg.type = AUDIO_STREAM_READER;
+    audio_element_handle_t raw_reader = raw_stream_init(&raw_cfg);
+    jitter_stream_cfg_t jitter_cfg = JITTER_STREAM_CFG_DEFAULT();
+    jitter_cfg.sample_rate = TEST_SAMPLE_RATE;
+    jitter_cfg.channels = 1;
+    audio_element_handle_t jitter = jitter_stream_init(&jitter_cfg);
+    TEST_ASSERT_NOT_NULL(raw_writer);
+    TEST_ASSERT_NOT_NULL(raw_reader);
+    TEST_ASSERT_NOT_NULL(jitter);
+
+    jitter_stream_info_t info;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, jitter_stream_get_info(jitter, &info));
+
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    audio_pipeline_handle_t pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(pipeline);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, raw_writer, "src"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, jitter, "jitter"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, raw_reader, "sink"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(pipeline, (const char *[]) {"src", "jitter", "sink"}, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(pipeline));
+
+    reader_run = true;
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(jitter_test_reader_task, "jitter_reader", 3 * 1024, raw_reader, 5, NULL));
+
+    int16_t packet[TEST_PACKET_SAMPLES];
+    int phase = 0;
+    for (int i = 0; i < 300; i++) {
+        // A 200 ms network stall in the middle of the stream
+        vTaskDelay((i == 150 ? 200 + TEST_PACKET_MS : TEST_PACKET_MS) / portTICK_PERIOD_MS);
+        for (int n = 0; n < TEST_PACKET_SAMPLES; n++, phase++) {
+            packet[n] = (int16_t)(8000 * sinf(2 * M_PI * 440 * phase / TEST_SAMPLE_RATE));
+        }
+        TEST_ASSERT_EQUAL(sizeof(packet), raw_stream_write(raw_writer, (char *)packet, sizeof(packet)));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, jitter_stream_get_info(jitter, &info));
+    ESP_LOGI(TAG, "depth %d ms, target %d ms, jitter %d ms, late %d, lost %d, stretched %d, compressed %d",
+             info.depth_ms, info.target_ms, info.jitter_ms, (int)info.late_frames, (int)info.lost_frames,
+             (int)info.stretched_frames, (int)info.compressed_frames);
+    TEST_ASSERT_GREATER_THAN(0, info.late_frames);
+    TEST_ASSERT_GREATER_OR_EQUAL(jitter_cfg.min_delay_ms, info.target_ms);
+    TEST_ASSERT_LESS_OR_EQUAL(jitter_cfg.max_delay_ms, info.target_ms);
+
+    reader_run = false;
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_wait_for_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, raw_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, jitter));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, raw_reader));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(raw_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(jitter));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(raw_reader));
+}
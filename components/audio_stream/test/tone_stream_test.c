@@ -37,6 +37,10 @@
 #include "audio_event_iface.h"
 #include "tone_stream.h"
 #include "fatfs_stream.h"
+#include "raw_stream.h"
+#include "mp3_decoder.h"
+#include "tone_cache.h"
+#include "esp_timer.h"
 
 #include "esp_peripherals.h"
 #include "board.h"
@@ -143,4 +147,147 @@ TEST_CASE("tone stream read test", "esp-adf-stream")
     TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(pipeline));
     TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(tone_stream_reader));
     TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(fatfs_stream_writer));
-}
\ No newline at end of file
+}
+
+static int64_t tone_time_to_first_sample(bool use_mmap, const char *uri)
+{
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    audio_pipeline_handle_t pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(pipeline);
+
+    tone_stream_cfg_t tone_cfg = TONE_STREAM_CFG_DEFAULT();
+    tone_cfg.type = AUDIO_STREAM_READER;
+    tone_cfg.use_mmap = use_mmap;
+    audio_element_handle_t tone_stream_reader = tone_stream_init(&tone_cfg);
+    TEST_ASSERT_NOT_NULL(tone_stream_reader);
+
+    mp3_decoder_cfg_t mp3_cfg = DEFAULT_MP3_DECODER_CONFIG();
+    audio_element_handle_t mp3_decoder = mp3_decoder_init(&mp3_cfg);
+    TEST_ASSERT_NOT_NULL(mp3_decoder);
+
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_READER;
+    audio_element_handle_t raw_reader = raw_stream_init(&raw_cfg);
+    TEST_ASSERT_NOT_NULL(raw_reader);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, tone_stream_reader, "tone"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, mp3_decoder, "mp3"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, raw_reader, "raw"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(pipeline, (const char *[]) {"tone", "mp3", "raw"}, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_set_uri(tone_stream_reader, uri));
+
+    char pcm[64];
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(pipeline));
+    TEST_ASSERT_TRUE(raw_stream_read(raw_reader, pcm, sizeof(pcm)) > 0);
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_wait_for_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(pipeline));
+    return elapsed;
+}
+
+TEST_CASE("tone stream time to first sample with and without mmap", "esp-adf-stream")
+{
+    for (int i = 0; i < 3; i++) {
+        const char *uri = tone_uri[esp_random() % TONE_URL_MAX];
+        int64_t read_us = tone_time_to_first_sample(false, uri);
+        int64_t mmap_us = tone_time_to_first_sample(true, uri);
+        ESP_LOGI("TONE_STREAM_TEST", "%s first sample: read %lld us, mmap %lld us", uri, read_us, mmap_us);
+    }
+}
+
+static int tone_cache_test_write(const uint8_t *pcm, int len, void *ctx)
+{
+    *(int *)ctx += len;
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+    return len;
+}
+
+TEST_CASE("tone cache starts a preloaded tone within 10 ms", "esp-adf-stream")
+{
+    int written = 0;
+    tone_stream_cfg_t tone_cfg = TONE_STREAM_CFG_DEFAULT();
+    tone_cfg.type = AUDIO_STREAM_READER;
+    tone_cfg.use_mmap = true;
+    mp3_decoder_cfg_t mp3_cfg = DEFAULT_MP3_DECODER_CONFIG();
+    tone_cache_cfg_t cache_cfg = TONE_CACHE_CFG_DEFAULT();
+    cache_cfg.reader = tone_stream_init(&tone_cfg);
+    cache_cfg.decoder = mp3_decoder_init(&mp3_cfg);
+    cache_cfg.write = tone_cache_test_write;
+    cache_cfg.write_ctx = &written;
+    tone_cache_handle_t cache = tone_cache_create(&cache_cfg);
+    TEST_ASSERT_NOT_NULL(cache);
+
+    tone_cache_info_t info = { 0 };
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_preload(cache, tone_uri[0], true));
+    for (int i = 0; i < 100 && info.tones == 0; i++) {
+        vTaskDelay(50 / portTICK_PERIOD_MS);
+        TEST_ASSERT_EQUAL(ESP_OK, tone_cache_get_info(cache, &info));
+    }
+    TEST_ASSERT_EQUAL(1, info.tones);
+
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_play(cache, tone_uri[0]));
+    while ((size_t)written < info.mem_used) {
+        vTaskDelay(50 / portTICK_PERIOD_MS);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_get_info(cache, &info));
+    ESP_LOGI("TONE_STREAM_TEST", "%s from cache: %u us to the first block, %d bytes, first sample through the pipeline %lld us",
+             tone_uri[0], info.start_us, (int)info.mem_used, tone_time_to_first_sample(true, tone_uri[0]));
+    TEST_ASSERT_EQUAL(1, info.hits);
+    TEST_ASSERT_LESS_THAN(10000, info.start_us);
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_destroy(cache));
+}
+
+static tone_cache_handle_t tone_cache_test_create(size_t mem_budget)
+{
+    tone_stream_cfg_t tone_cfg = TONE_STREAM_CFG_DEFAULT();
+    tone_cfg.type = AUDIO_STREAM_READER;
+    mp3_decoder_cfg_t mp3_cfg = DEFAULT_MP3_DECODER_CONFIG();
+    tone_cache_cfg_t cache_cfg = TONE_CACHE_CFG_DEFAULT();
+    cache_cfg.reader = tone_stream_init(&tone_cfg);
+    cache_cfg.decoder = mp3_decoder_init(&mp3_cfg);
+    cache_cfg.sample_rate = 16000;
+    cache_cfg.channels = 1;
+    cache_cfg.mem_budget = mem_budget;
+    tone_cache_handle_t cache = tone_cache_create(&cache_cfg);
+    TEST_ASSERT_NOT_NULL(cache);
+    return cache;
+}
+
+TEST_CASE("tone cache evicts to stay in the memory budget", "esp-adf-stream")
+{
+    tone_cache_info_t info = { 0 };
+    size_t size[2] = { 0 };
+    tone_cache_handle_t cache = tone_cache_test_create(1024 * 1024);
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, tone_cache_load(cache, tone_uri[i]));
+        TEST_ASSERT_EQUAL(ESP_OK, tone_cache_get_info(cache, &info));
+        size[i] = info.mem_used - (i ? size[0] : 0);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_destroy(cache));
+    TEST_ASSERT_NOT_EQUAL(size[0], size[1]);
+
+    // Room for one of the tones, the least recently played one goes
+    cache = tone_cache_test_create(size[0] + size[1] - 1);
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_load(cache, tone_uri[0]));
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_load(cache, tone_uri[1]));
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_get_info(cache, &info));
+    TEST_ASSERT_EQUAL(1, info.tones);
+    TEST_ASSERT_EQUAL(1, info.evictions);
+    TEST_ASSERT_EQUAL(size[1], info.mem_used);
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_destroy(cache));
+
+    // A tone larger than the budget is refused without dropping the cached one
+    int small = size[0] < size[1] ? 0 : 1;
+    cache = tone_cache_test_create(size[!small] - 1);
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_load(cache, tone_uri[small]));
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, tone_cache_load(cache, tone_uri[!small]));
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_get_info(cache, &info));
+    TEST_ASSERT_EQUAL(1, info.tones);
+    TEST_ASSERT_EQUAL(0, info.evictions);
+    TEST_ASSERT_EQUAL(size[small], info.mem_used);
+    TEST_ASSERT_EQUAL(ESP_OK, tone_cache_destroy(cache));
+}
@@ -0,0 +1,709 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include <sys/queue.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_mem.h"
+#include "audio_mutex.h"
+#include "audio_thread.h"
+#include "audio_pipeline.h"
+#include "raw_stream.h"
+#include "tone_cache.h"
+
+static const char *TAG = "TONE_CACHE";
+
+#define TONE_CACHE_READ_SIZE        (4 * 1024)
+#define TONE_CACHE_PLAY_TASK_STACK  (3 * 1024)
+#define TONE_CACHE_RSP_TAPS         (32)        /* Span of the resampling filter in output frames, half of it on each side */
+#define TONE_CACHE_RSP_PHASES       (64)        /* Fractional positions the filter is tabulated for */
+#define TONE_CACHE_RSP_CUTOFF       (0.85f)     /* Pass band, relative to the lower Nyquist frequency */
+
+#define TONE_CACHE_DECODE_BIT       BIT0        /* A tone got queued, or the cache is destroyed */
+#define TONE_CACHE_PLAY_BIT         BIT1        /* A tone started, or the cache is destroyed */
+#define TONE_CACHE_DECODE_EXIT_BIT  BIT2
+#define TONE_CACHE_PLAY_EXIT_BIT    BIT3
+
+typedef enum {
+    TONE_CACHE_QUEUED,
+    TONE_CACHE_DECODING,
+    TONE_CACHE_READY,
+} tone_cache_state_t;
+
+typedef struct tone_cache_entry {
+    TAILQ_ENTRY(tone_cache_entry)   next;
+    char                            *uri;
+    uint32_t                        hash;
+    tone_cache_state_t              state;
+    uint8_t                         *pcm;
+    size_t                          size;
+    int                             refs;       /* Held by the playing tone and by a block being written */
+    bool                            pinned;
+    bool                            orphan;     /* Out of the list after a format change, freed with its last reference */
+} tone_cache_entry_t;
+
+TAILQ_HEAD(tone_cache_entry_list, tone_cache_entry);
+
+struct tone_cache {
+    tone_cache_cfg_t                cfg;
+    audio_pipeline_handle_t         pipeline;
+    audio_element_handle_t          raw;
+    struct tone_cache_entry_list    tones;      /* Most recently played first */
+    void                            *lock;
+    void                            *decode_lock;   /* Held while the pipeline decodes */
+    EventGroupHandle_t              state;
+    int                             sample_rate;
+    int                             channels;
+    uint32_t                        format_gen;
+    tone_cache_entry_t              *voice;
+    size_t                          voice_pos;
+    uint32_t                        voice_gen;
+    tone_cache_entry_t              *pending;   /* Tone to play once it is decoded */
+    int64_t                         play_time;
+    bool                            exit;
+    tone_cache_info_t               info;
+};
+
+static uint32_t tone_cache_hash(const char *uri)
+{
+    uint32_t hash = 2166136261u;
+    while (*uri) {
+        hash = (hash ^ (uint8_t)*uri++) * 16777619u;
+    }
+    return hash;
+}
+
+static tone_cache_entry_t *tone_cache_find(struct tone_cache *cache, const char *uri)
+{
+    uint32_t hash = tone_cache_hash(uri);
+    tone_cache_entry_t *e;
+    TAILQ_FOREACH(e, &cache->tones, next) {
+        if (e->hash == hash && strcmp(e->uri, uri) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static tone_cache_entry_t *tone_cache_entry_new(const char *uri)
+{
+    tone_cache_entry_t *e = audio_calloc(1, sizeof(tone_cache_entry_t));
+    AUDIO_MEM_CHECK(TAG, e, return NULL);
+    e->uri = audio_strdup(uri);
+    AUDIO_MEM_CHECK(TAG, e->uri, {
+        audio_free(e);
+        return NULL;
+    });
+    e->hash = tone_cache_hash(uri);
+    e->state = TONE_CACHE_QUEUED;
+    return e;
+}
+
+static void tone_cache_entry_free(struct tone_cache *cache, tone_cache_entry_t *e)
+{
+    if (e->pcm) {
+        cache->info.mem_used -= e->size;
+        cache->info.tones--;
+        audio_free(e->pcm);
+    }
+    audio_free(e->uri);
+    audio_free(e);
+}
+
+static void tone_cache_remove(struct tone_cache *cache, tone_cache_entry_t *e)
+{
+    TAILQ_REMOVE(&cache->tones, e, next);
+    if (cache->pending == e) {
+        cache->pending = NULL;
+    }
+    tone_cache_entry_free(cache, e);
+}
+
+static void tone_cache_unref(struct tone_cache *cache, tone_cache_entry_t *e)
+{
+    if (--e->refs == 0 && e->orphan) {
+        tone_cache_entry_free(cache, e);
+    }
+}
+
+static void tone_cache_voice_start(struct tone_cache *cache, tone_cache_entry_t *e)
+{
+    e->refs++;
+    cache->voice = e;
+    cache->voice_pos = 0;
+    cache->voice_gen++;
+    if (cache->cfg.write) {
+        xEventGroupSetBits(cache->state, TONE_CACHE_PLAY_BIT);
+    }
+}
+
+static void tone_cache_voice_end(struct tone_cache *cache)
+{
+    if (cache->voice) {
+        tone_cache_unref(cache, cache->voice);
+        cache->voice = NULL;
+        cache->voice_gen++;
+    }
+}
+
+/*
+ * Convert interleaved 16-bit PCM to the cache format. The channels are mixed down first, then every output frame
+ * is interpolated with a Blackman windowed sinc, tabulated for `TONE_CACHE_RSP_PHASES` positions between two input
+ * frames and normalized to unity gain. The filter is widened by the decimation ratio when downsampling.
+ * Mono is duplicated to stereo last. `in` is overwritten.
+ */
+static uint8_t *tone_cache_convert(int16_t *in, size_t frames, int in_rate, int in_ch, int out_rate, int out_ch, size_t *out_size)
+{
+    int ch = in_ch > out_ch ? out_ch : in_ch;
+    if (ch < in_ch) {
+        for (size_t i = 0; i < frames; i++) {
+            in[i] = (int16_t)(((int32_t)in[2 * i] + in[2 * i + 1]) >> 1);
+        }
+    }
+    size_t out_frames = (size_t)((uint64_t)frames * out_rate / in_rate);
+    *out_size = out_frames * out_ch * sizeof(int16_t);
+    int16_t *out = audio_malloc(*out_size ? *out_size : 1);
+    AUDIO_MEM_CHECK(TAG, out, return NULL);
+
+    if (in_rate == out_rate) {
+        memcpy(out, in, out_frames * ch * sizeof(int16_t));
+    } else {
+        float ratio = out_rate < in_rate ? (float)out_rate / in_rate : 1.0f;
+        const int half = (int)ceilf(TONE_CACHE_RSP_TAPS / 2 / ratio);
+        const int taps = 2 * half;
+        float *coef = audio_calloc((TONE_CACHE_RSP_PHASES + 1) * taps, sizeof(float));
+        AUDIO_MEM_CHECK(TAG, coef, {
+            audio_free(out);
+            return NULL;
+        });
+        float fc = TONE_CACHE_RSP_CUTOFF * ratio;
+        for (int p = 0; p <= TONE_CACHE_RSP_PHASES; p++) {
+            float *row = coef + p * taps;
+            float sum = 0;
+            for (int k = 0; k < taps; k++) {
+                /* Distance from input frame `i - half + 1 + k` to the output position `i + p / PHASES` */
+                float t = (float)(half - 1 - k) + (float)p / TONE_CACHE_RSP_PHASES;
+                float x = (float)M_PI * fc * t;
+                float h = (t == 0) ? 1.0f : sinf(x) / x;
+                float a = (float)M_PI * t / half;
+                float w = (fabsf(t) < half) ? 0.42f + 0.5f * cosf(a) + 0.08f * cosf(2 * a) : 0;
+                row[k] = h * w;
+                sum += row[k];
+            }
+            for (int k = 0; k < taps; k++) {
+                row[k] /= sum;
+            }
+        }
+        uint64_t step = ((uint64_t)in_rate << 32) / out_rate;
+        uint64_t pos = 0;
+        for (size_t n = 0; n < out_frames; n++, pos += step) {
+            int64_t i = (int64_t)(pos >> 32);
+            uint32_t p = (uint32_t)((((pos & 0xFFFFFFFFu) * TONE_CACHE_RSP_PHASES) + 0x80000000u) >> 32);
+            const float *row = coef + p * taps;
+            for (int c = 0; c < ch; c++) {
+                float acc = 0;
+                for (int k = 0; k < taps; k++) {
+                    int64_t j = i - half + 1 + k;
+                    if (j >= 0 && j < (int64_t)frames) {
+                        acc += row[k] * in[j * ch + c];
+                    }
+                }
+                int32_t s = (int32_t)lrintf(acc);
+                out[n * ch + c] = (int16_t)(s > INT16_MAX ? INT16_MAX : (s < INT16_MIN ? INT16_MIN : s));
+            }
+        }
+        audio_free(coef);
+    }
+    if (ch < out_ch) {
+        for (size_t n = out_frames; n-- > 0;) {
+            out[2 * n] = out[2 * n + 1] = out[n];
+        }
+    }
+    return (uint8_t *)out;
+}
+
+static esp_err_t tone_cache_decode(struct tone_cache *cache, const char *uri, int out_rate, int out_ch, uint8_t **pcm, size_t *size)
+{
+    uint8_t *buf = NULL;
+    size_t len = 0, cap = 0;
+    esp_err_t err = ESP_OK;
+    int ret = 0;
+
+    audio_pipeline_reset_ringbuffer(cache->pipeline);
+    audio_pipeline_reset_elements(cache->pipeline);
+    audio_element_set_uri(cache->cfg.reader, uri);
+    AUDIO_CHECK(TAG, audio_pipeline_run(cache->pipeline) == ESP_OK, return ESP_FAIL, "Decode pipeline run failed");
+    while (1) {
+        if (len + TONE_CACHE_READ_SIZE > cap) {
+            /* The decoded PCM is at most a few times the budget, even before it is downsampled */
+            if (cap >= 4 * cache->cfg.mem_budget) {
+                ESP_LOGW(TAG, "%s is too long for the cache", uri);
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            size_t grow = cap ? cap * 2 : 8 * TONE_CACHE_READ_SIZE;
+            uint8_t *grown = audio_realloc(buf, grow);
+            AUDIO_MEM_CHECK(TAG, grown, {
+                err = ESP_ERR_NO_MEM;
+                break;
+            });
+            buf = grown;
+            cap = grow;
+        }
+        ret = raw_stream_read(cache->raw, (char *)buf + len, TONE_CACHE_READ_SIZE);
+        if (ret <= 0) {
+            break;
+        }
+        len += ret;
+    }
+    audio_element_info_t info = { 0 };
+    audio_element_getinfo(cache->cfg.decoder, &info);
+    audio_pipeline_stop(cache->pipeline);
+    audio_pipeline_wait_for_stop(cache->pipeline);
+    audio_pipeline_reset_items_state(cache->pipeline);
+
+    if (err == ESP_OK && ret != AEL_IO_DONE && ret != AEL_IO_OK) {
+        ESP_LOGE(TAG, "Decoding %s failed, ret:%d", uri, ret);
+        err = ESP_FAIL;
+    }
+    if (err == ESP_OK && (info.bits != 16 || info.channels < 1 || info.channels > 2 || info.sample_rates <= 0)) {
+        ESP_LOGE(TAG, "%s has an unsupported format, %d Hz, %d bits, %d channels", uri, info.sample_rates, info.bits, info.channels);
+        err = ESP_FAIL;
+    }
+    if (err == ESP_OK) {
+        size_t frames = len / (info.channels * sizeof(int16_t));
+        *pcm = tone_cache_convert((int16_t *)buf, frames, info.sample_rates, info.channels, out_rate, out_ch, size);
+        err = *pcm ? ESP_OK : ESP_ERR_NO_MEM;
+        ESP_LOGI(TAG, "Decoded %s, %d Hz %d ch to %d Hz %d ch, %d bytes", uri, info.sample_rates, info.channels,
+                 out_rate, out_ch, (int)*size);
+    }
+    audio_free(buf);
+    return err;
+}
+
+/*
+ * Put the decoded PCM of `e` in the cache, dropping the least recently played tones to make room. Called locked.
+ */
+static esp_err_t tone_cache_install(struct tone_cache *cache, tone_cache_entry_t *e, uint32_t format_gen, uint8_t *pcm, size_t size)
+{
+    if (format_gen != cache->format_gen) {
+        audio_free(pcm);
+        e->state = TONE_CACHE_QUEUED;
+        xEventGroupSetBits(cache->state, TONE_CACHE_DECODE_BIT);
+        return ESP_OK;
+    }
+    if (size > cache->cfg.mem_budget) {
+        /* Evicting would not make room, keep the cached tones */
+        ESP_LOGW(TAG, "%s does not fit in the cache, %d bytes, budget %d", e->uri, (int)size, (int)cache->cfg.mem_budget);
+        audio_free(pcm);
+        tone_cache_remove(cache, e);
+        return ESP_ERR_NO_MEM;
+    }
+    tone_cache_entry_t *victim = TAILQ_LAST(&cache->tones, tone_cache_entry_list);
+    while (cache->info.mem_used + size > cache->cfg.mem_budget && victim) {
+        tone_cache_entry_t *prev = TAILQ_PREV(victim, tone_cache_entry_list, next);
+        if (victim != e && victim->state == TONE_CACHE_READY && victim->refs == 0 && !victim->pinned) {
+            ESP_LOGD(TAG, "Evict %s", victim->uri);
+            tone_cache_remove(cache, victim);
+            cache->info.evictions++;
+        }
+        victim = prev;
+    }
+    if (cache->info.mem_used + size > cache->cfg.mem_budget) {
+        ESP_LOGW(TAG, "No room for %s, %d bytes, %d of %d used", e->uri, (int)size, (int)cache->info.mem_used, (int)cache->cfg.mem_budget);
+        audio_free(pcm);
+        tone_cache_remove(cache, e);
+        return ESP_ERR_NO_MEM;
+    }
+    e->pcm = pcm;
+    e->size = size;
+    e->state = TONE_CACHE_READY;
+    cache->info.mem_used += size;
+    cache->info.tones++;
+    if (cache->pending == e) {
+        cache->pending = NULL;
+        tone_cache_voice_start(cache, e);
+    }
+    return ESP_OK;
+}
+
+/*
+ * Decode `e`, which the caller switched to the decoding state while holding both locks. Called with the decode lock.
+ */
+static esp_err_t tone_cache_decode_entry(struct tone_cache *cache, tone_cache_entry_t *e)
+{
+    mutex_lock(cache->lock);
+    int rate = cache->sample_rate;
+    int ch = cache->channels;
+    uint32_t format_gen = cache->format_gen;
+    mutex_unlock(cache->lock);
+
+    uint8_t *pcm = NULL;
+    size_t size = 0;
+    esp_err_t err = tone_cache_decode(cache, e->uri, rate, ch, &pcm, &size);
+    mutex_lock(cache->lock);
+    if (err == ESP_OK) {
+        err = tone_cache_install(cache, e, format_gen, pcm, size);
+    } else {
+        tone_cache_remove(cache, e);
+    }
+    mutex_unlock(cache->lock);
+    return err;
+}
+
+static void tone_cache_decode_task(void *pv)
+{
+    struct tone_cache *cache = (struct tone_cache *)pv;
+    while (1) {
+        xEventGroupWaitBits(cache->state, TONE_CACHE_DECODE_BIT, true, false, portMAX_DELAY);
+        while (1) {
+            mutex_lock(cache->decode_lock);
+            mutex_lock(cache->lock);
+            tone_cache_entry_t *e = NULL;
+            if (!cache->exit) {
+                e = cache->pending;
+                if (e && e->state != TONE_CACHE_QUEUED) {
+                    e = NULL;
+                }
+                if (e == NULL) {
+                    TAILQ_FOREACH(e, &cache->tones, next) {
+                        if (e->state == TONE_CACHE_QUEUED) {
+                            break;
+                        }
+                    }
+                }
+            }
+            if (e) {
+                e->state = TONE_CACHE_DECODING;
+            }
+            mutex_unlock(cache->lock);
+            if (e == NULL) {
+                mutex_unlock(cache->decode_lock);
+                break;
+            }
+            tone_cache_decode_entry(cache, e);
+            mutex_unlock(cache->decode_lock);
+        }
+        if (cache->exit) {
+            break;
+        }
+    }
+    xEventGroupSetBits(cache->state, TONE_CACHE_DECODE_EXIT_BIT);
+    vTaskDelete(NULL);
+}
+
+static void tone_cache_play_task(void *pv)
+{
+    struct tone_cache *cache = (struct tone_cache *)pv;
+    while (1) {
+        xEventGroupWaitBits(cache->state, TONE_CACHE_PLAY_BIT, true, false, portMAX_DELAY);
+        mutex_lock(cache->lock);
+        while (cache->voice && !cache->exit) {
+            tone_cache_entry_t *e = cache->voice;
+            uint32_t gen = cache->voice_gen;
+            size_t pos = cache->voice_pos;
+            size_t len = e->size - pos;
+            size_t frame_bytes = (size_t)cache->cfg.frame_ms * cache->sample_rate / 1000 * cache->channels * sizeof(int16_t);
+            if (len > frame_bytes) {
+                len = frame_bytes;
+            }
+            if (pos == 0) {
+                cache->info.start_us = (uint32_t)(esp_timer_get_time() - cache->play_time);
+            }
+            e->refs++;
+            mutex_unlock(cache->lock);
+
+            int ret = len ? cache->cfg.write(e->pcm + pos, len, cache->cfg.write_ctx) : 0;
+
+            mutex_lock(cache->lock);
+            tone_cache_unref(cache, e);
+            if (gen == cache->voice_gen) {
+                cache->voice_pos += ret > 0 ? ret : 0;
+                if (ret <= 0 || cache->voice_pos >= e->size) {
+                    tone_cache_voice_end(cache);
+                }
+            }
+        }
+        bool exit = cache->exit;
+        mutex_unlock(cache->lock);
+        if (exit) {
+            break;
+        }
+    }
+    xEventGroupSetBits(cache->state, TONE_CACHE_PLAY_EXIT_BIT);
+    vTaskDelete(NULL);
+}
+
+int tone_cache_read(uint8_t *data, int len, void *ctx)
+{
+    struct tone_cache *cache = (struct tone_cache *)ctx;
+    AUDIO_NULL_CHECK(TAG, cache, return 0);
+    mutex_lock(cache->lock);
+    tone_cache_entry_t *e = cache->voice;
+    int n = 0;
+    if (e) {
+        if (cache->voice_pos == 0) {
+            cache->info.start_us = (uint32_t)(esp_timer_get_time() - cache->play_time);
+        }
+        n = e->size - cache->voice_pos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(data, e->pcm + cache->voice_pos, n);
+        cache->voice_pos += n;
+        if (cache->voice_pos >= e->size) {
+            tone_cache_voice_end(cache);
+        }
+    }
+    mutex_unlock(cache->lock);
+    return n;
+}
+
+/*
+ * Find the tone of `uri` or add it to the queue. Called locked.
+ */
+static tone_cache_entry_t *tone_cache_get(struct tone_cache *cache, const char *uri, bool played)
+{
+    tone_cache_entry_t *e = tone_cache_find(cache, uri);
+    if (e == NULL) {
+        e = tone_cache_entry_new(uri);
+        if (e == NULL) {
+            return NULL;
+        }
+        if (played) {
+            TAILQ_INSERT_HEAD(&cache->tones, e, next);
+        } else {
+            TAILQ_INSERT_TAIL(&cache->tones, e, next);
+        }
+    } else if (played && e != TAILQ_FIRST(&cache->tones)) {
+        TAILQ_REMOVE(&cache->tones, e, next);
+        TAILQ_INSERT_HEAD(&cache->tones, e, next);
+    }
+    return e;
+}
+
+esp_err_t tone_cache_preload(tone_cache_handle_t cache, const char *uri, bool pin)
+{
+    AUDIO_NULL_CHECK(TAG, cache, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, uri, return ESP_ERR_INVALID_ARG);
+    mutex_lock(cache->lock);
+    tone_cache_entry_t *e = tone_cache_get(cache, uri, false);
+    if (e) {
+        e->pinned = pin;
+        if (e->state == TONE_CACHE_QUEUED) {
+            xEventGroupSetBits(cache->state, TONE_CACHE_DECODE_BIT);
+        }
+    }
+    mutex_unlock(cache->lock);
+    return e ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t tone_cache_load(tone_cache_handle_t cache, const char *uri)
+{
+    AUDIO_NULL_CHECK(TAG, cache, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, uri, return ESP_ERR_INVALID_ARG);
+    esp_err_t err = ESP_OK;
+    mutex_lock(cache->decode_lock);
+    mutex_lock(cache->lock);
+    tone_cache_entry_t *e = tone_cache_get(cache, uri, false);
+    if (e && e->state == TONE_CACHE_QUEUED) {
+        e->state = TONE_CACHE_DECODING;
+    }
+    mutex_unlock(cache->lock);
+    if (e == NULL) {
+        err = ESP_ERR_NO_MEM;
+    } else if (e->state == TONE_CACHE_DECODING) {
+        err = tone_cache_decode_entry(cache, e);
+    }
+    mutex_unlock(cache->decode_lock);
+    return err;
+}
+
+esp_err_t tone_cache_play(tone_cache_handle_t cache, const char *uri)
+{
+    AUDIO_NULL_CHECK(TAG, cache, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, uri, return ESP_ERR_INVALID_ARG);
+    mutex_lock(cache->lock);
+    tone_cache_voice_end(cache);
+    cache->pending = NULL;
+    cache->play_time = esp_timer_get_time();
+    tone_cache_entry_t *e = tone_cache_get(cache, uri, true);
+    if (e && e->state == TONE_CACHE_READY) {
+        cache->info.hits++;
+        tone_cache_voice_start(cache, e);
+    } else if (e) {
+        cache->info.misses++;
+        cache->pending = e;
+        xEventGroupSetBits(cache->state, TONE_CACHE_DECODE_BIT);
+    }
+    mutex_unlock(cache->lock);
+    return e ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t tone_cache_stop(tone_cache_handle_t cache)
+{
+    AUDIO_NULL_CHECK(TAG, cache, return ESP_ERR_INVALID_ARG);
+    mutex_lock(cache->lock);
+    tone_cache_voice_end(cache);
+    cache->pending = NULL;
+    mutex_unlock(cache->lock);
+    return ESP_OK;
+}
+
+esp_err_t tone_cache_set_format(tone_cache_handle_t cache, int sample_rate, int channels)
+{
+    AUDIO_NULL_CHECK(TAG, cache, return ESP_ERR_INVALID_ARG);
+    AUDIO_CHECK(TAG, sample_rate > 0 && (channels == 1 || channels == 2), return ESP_ERR_INVALID_ARG, "Invalid tone cache format");
+    mutex_lock(cache->lock);
+    if (sample_rate != cache->sample_rate || channels != cache->channels) {
+        tone_cache_voice_end(cache);
+        cache->sample_rate = sample_rate;
+        cache->channels = channels;
+        cache->format_gen++;
+        tone_cache_entry_t *e, *tmp;
+        TAILQ_FOREACH_SAFE(e, &cache->tones, next, tmp) {
+            if (e->state != TONE_CACHE_READY) {
+                continue;
+            }
+            if (e->refs) {
+                /* A block of it is being written, queue a new entry and free this one after the write */
+                tone_cache_entry_t *fresh = tone_cache_entry_new(e->uri);
+                if (fresh) {
+                    fresh->pinned = e->pinned;
+                    TAILQ_INSERT_BEFORE(e, fresh, next);
+                }
+                TAILQ_REMOVE(&cache->tones, e, next);
+                e->orphan = true;
+            } else {
+                cache->info.mem_used -= e->size;
+                cache->info.tones--;
+                audio_free(e->pcm);
+                e->pcm = NULL;
+                e->size = 0;
+                e->state = TONE_CACHE_QUEUED;
+            }
+        }
+        xEventGroupSetBits(cache->state, TONE_CACHE_DECODE_BIT);
+    }
+    mutex_unlock(cache->lock);
+    return ESP_OK;
+}
+
+esp_err_t tone_cache_get_info(tone_cache_handle_t cache, tone_cache_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, cache, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_ERR_INVALID_ARG);
+    mutex_lock(cache->lock);
+    memcpy(info, &cache->info, sizeof(tone_cache_info_t));
+    mutex_unlock(cache->lock);
+    return ESP_OK;
+}
+
+esp_err_t tone_cache_destroy(tone_cache_handle_t cache)
+{
+    AUDIO_NULL_CHECK(TAG, cache, return ESP_ERR_INVALID_ARG);
+    if (cache->state && cache->lock) {
+        mutex_lock(cache->lock);
+        cache->exit = true;
+        tone_cache_voice_end(cache);
+        cache->pending = NULL;
+        mutex_unlock(cache->lock);
+        xEventGroupSetBits(cache->state, TONE_CACHE_DECODE_BIT | TONE_CACHE_PLAY_BIT);
+        xEventGroupWaitBits(cache->state, TONE_CACHE_DECODE_EXIT_BIT | TONE_CACHE_PLAY_EXIT_BIT, false, true, portMAX_DELAY);
+    }
+    if (cache->pipeline) {
+        audio_pipeline_deinit(cache->pipeline);
+    }
+    tone_cache_entry_t *e, *tmp;
+    TAILQ_FOREACH_SAFE(e, &cache->tones, next, tmp) {
+        tone_cache_remove(cache, e);
+    }
+    AUDIO_SAFE_FREE(cache->lock, mutex_destroy);
+    AUDIO_SAFE_FREE(cache->decode_lock, mutex_destroy);
+    AUDIO_SAFE_FREE(cache->state, vEventGroupDelete);
+    audio_free(cache);
+    return ESP_OK;
+}
+
+tone_cache_handle_t tone_cache_create(tone_cache_cfg_t *config)
+{
+    AUDIO_NULL_CHECK(TAG, config, return NULL);
+    AUDIO_NULL_CHECK(TAG, config->reader, return NULL);
+    AUDIO_NULL_CHECK(TAG, config->decoder, return NULL);
+    AUDIO_CHECK(TAG, config->sample_rate > 0 && (config->channels == 1 || config->channels == 2) && config->frame_ms > 0,
+                return NULL, "Invalid tone cache configuration");
+    struct tone_cache *cache = audio_calloc(1, sizeof(struct tone_cache));
+    AUDIO_MEM_CHECK(TAG, cache, return NULL);
+    memcpy(&cache->cfg, config, sizeof(tone_cache_cfg_t));
+    cache->sample_rate = config->sample_rate;
+    cache->channels = config->channels;
+    TAILQ_INIT(&cache->tones);
+    cache->lock = mutex_create();
+    cache->decode_lock = mutex_create();
+    cache->state = xEventGroupCreate();
+    AUDIO_MEM_CHECK(TAG, cache->lock && cache->decode_lock && cache->state, goto _failed);
+    xEventGroupSetBits(cache->state, TONE_CACHE_DECODE_EXIT_BIT | TONE_CACHE_PLAY_EXIT_BIT);
+
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    cache->pipeline = audio_pipeline_init(&pipeline_cfg);
+    AUDIO_MEM_CHECK(TAG, cache->pipeline, goto _failed);
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_READER;
+    cache->raw = raw_stream_init(&raw_cfg);
+    AUDIO_MEM_CHECK(TAG, cache->raw, goto _failed);
+    esp_err_t ret = audio_pipeline_register(cache->pipeline, config->reader, "tone_cache_in");
+    ret |= audio_pipeline_register(cache->pipeline, config->decoder, "tone_cache_dec");
+    ret |= audio_pipeline_register(cache->pipeline, cache->raw, "tone_cache_raw");
+    ret |= audio_pipeline_link(cache->pipeline, (const char *[]) {"tone_cache_in", "tone_cache_dec", "tone_cache_raw"}, 3);
+    AUDIO_CHECK(TAG, ret == ESP_OK, goto _failed, "Tone cache pipeline setup failed");
+
+    xEventGroupClearBits(cache->state, TONE_CACHE_DECODE_EXIT_BIT);
+    if (audio_thread_create(NULL, "tone_cache", tone_cache_decode_task, cache, config->task_stack,
+                            config->task_prio, config->stack_in_ext, config->task_core) != ESP_OK) {
+        ESP_LOGE(TAG, "Create the tone cache task failed");
+        xEventGroupSetBits(cache->state, TONE_CACHE_DECODE_EXIT_BIT);
+        goto _failed;
+    }
+    if (config->write) {
+        xEventGroupClearBits(cache->state, TONE_CACHE_PLAY_EXIT_BIT);
+        if (audio_thread_create(NULL, "tone_play", tone_cache_play_task, cache, TONE_CACHE_PLAY_TASK_STACK,
+                                config->play_task_prio, false, config->task_core) != ESP_OK) {
+            ESP_LOGE(TAG, "Create the tone play task failed");
+            xEventGroupSetBits(cache->state, TONE_CACHE_PLAY_EXIT_BIT);
+            goto _failed;
+        }
+    }
+    return cache;
+
+_failed:
+    tone_cache_destroy(cache);
+    return NULL;
+}
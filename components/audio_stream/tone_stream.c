@@ -43,8 +43,10 @@ typedef struct tone_stream {
     audio_stream_type_t type;            /*!< File operation type */
     bool is_open;                        /*!< Tone stream status */
     bool use_delegate;                   /*!< Tone read with delegate*/
+    bool use_mmap;                       /*!< Tone partition mapped once, kept until destroy */
     tone_partition_handle_t tone_handle; /*!< Tone partition's operation handle*/
     tone_file_info_t cur_file;           /*!< Address to read tone file */
+    const uint8_t *cur_data;             /*!< Mapped data of the tone file, NULL if not mapped */
     const char *partition_label;         /*!< Label of tone stored in flash */
 } tone_stream_t;
 
@@ -55,9 +57,14 @@ static esp_err_t _tone_open(audio_element_handle_t self)
         ESP_LOGE(TAG, "already opened");
         return ESP_FAIL;
     }
-    stream->tone_handle = tone_partition_init(stream->partition_label, stream->use_delegate);
     if (stream->tone_handle == NULL) {
-        return ESP_FAIL;
+        stream->tone_handle = tone_partition_init(stream->partition_label, stream->use_delegate);
+        if (stream->tone_handle == NULL) {
+            return ESP_FAIL;
+        }
+        if (stream->use_mmap && tone_partition_mmap(stream->tone_handle) != ESP_OK) {
+            ESP_LOGW(TAG, "Tone partition not mapped, read it instead");
+        }
     }
 
     char *flash_url = audio_element_get_uri(self);
@@ -81,6 +88,10 @@ static esp_err_t _tone_open(audio_element_handle_t self)
         ESP_LOGE(TAG, "Mayebe the flash tone is empty, please ensure the flash's contex");
         return ESP_FAIL;
     }
+    stream->cur_data = NULL;
+    if (stream->use_mmap) {
+        tone_partition_file_data(stream->tone_handle, &stream->cur_file, &stream->cur_data);
+    }
 
     audio_element_info_t info = { 0 };
     info.total_bytes = stream->cur_file.song_len;
@@ -115,8 +126,32 @@ static int _tone_read(audio_element_handle_t self, char *buffer, int len, TickTy
     return len;
 }
 
+static int _tone_output_mapped(audio_element_handle_t self, tone_stream_t *stream, int len)
+{
+    audio_element_info_t info = { 0 };
+    audio_element_getinfo(self, &info);
+
+    if (info.byte_pos + len > info.total_bytes) {
+        len = info.total_bytes - info.byte_pos;
+    }
+    if (len <= 0) {
+        ESP_LOGW(TAG, "No more data,ret:%d ,info.byte_pos:%llu", len, info.byte_pos);
+        return ESP_OK;
+    }
+    int w_size = audio_element_output(self, (char *)stream->cur_data + info.byte_pos, len);
+    if (w_size > 0) {
+        audio_element_update_byte_pos(self, w_size);
+    }
+    return w_size;
+}
+
 static int _tone_process(audio_element_handle_t self, char *in_buffer, int in_len)
 {
+    tone_stream_t *stream = (tone_stream_t *)audio_element_getdata(self);
+    if (stream->cur_data) {
+        // Straight from the mapped partition to the output, the element buffer is not used
+        return _tone_output_mapped(self, stream, in_len);
+    }
     int r_size = audio_element_input(self, in_buffer, in_len);
     int w_size = 0;
     if (r_size > 0) {
@@ -133,8 +168,11 @@ static esp_err_t _tone_close(audio_element_handle_t self)
     if (stream->is_open) {
         stream->is_open = false;
     }
-    tone_partition_deinit(stream->tone_handle);
-    stream->tone_handle = NULL;
+    stream->cur_data = NULL;
+    if (stream->use_mmap == false) {
+        tone_partition_deinit(stream->tone_handle);
+        stream->tone_handle = NULL;
+    }
     if (AEL_STATE_PAUSED != audio_element_get_state(self)) {
         audio_element_set_byte_pos(self, 0);
     }
@@ -144,6 +182,9 @@ static esp_err_t _tone_close(audio_element_handle_t self)
 static esp_err_t _tone_destroy(audio_element_handle_t self)
 {
     tone_stream_t *stream = (tone_stream_t *)audio_element_getdata(self);
+    if (stream->tone_handle) {
+        tone_partition_deinit(stream->tone_handle);
+    }
     audio_free(stream);
     return ESP_OK;
 }
@@ -176,6 +217,7 @@ audio_element_handle_t tone_stream_init(tone_stream_cfg_t *config)
     cfg.tag = "flash";
     stream->type = config->type;
     stream->use_delegate = config->use_delegate;
+    stream->use_mmap = config->use_mmap;
 
     if (config->label == NULL) {
         ESP_LOGE(TAG, "Please set your tone label");
@@ -27,6 +27,10 @@
 
 #include "esp_partition.h"
 #include "esp_action_def.h"
+#include "esp_idf_version.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
+#include "spi_flash_mmap.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -61,6 +65,17 @@ typedef struct partition_write_args_s {
     size_t size;
 } partition_write_args_t;
 
+/**
+ * @brief   The arguments structure of partition mmap action
+ */
+typedef struct partition_mmap_args_s {
+    const esp_partition_t *partition;
+    size_t offset;
+    size_t size;
+    const void **out_ptr;
+    spi_flash_mmap_handle_t *out_handle;
+} partition_mmap_args_t;
+
 /**
  * @brief      Partition find first
  *
@@ -100,6 +115,32 @@ esp_err_t partition_read_action(void *instance, action_arg_t *arg, action_result
  */
 esp_err_t partition_write_action(void *instance, action_arg_t *arg, action_result_t *result);
 
+/**
+ * @brief      Partition mmap, the data of the partition is mapped for reading
+ *
+ * @param instance          The execution instance
+ * @param arg               The arguments of execution function
+ * @param result            The result of execution function
+ *
+ * @return
+ *     - ESP_OK, success
+ *     - Others, error
+ */
+esp_err_t partition_mmap_action(void *instance, action_arg_t *arg, action_result_t *result);
+
+/**
+ * @brief      Partition munmap, `arg->data` is the handle given by the mmap action
+ *
+ * @param instance          The execution instance
+ * @param arg               The arguments of execution function
+ * @param result            The result of execution function
+ *
+ * @return
+ *     - ESP_OK, success
+ *     - Others, error
+ */
+esp_err_t partition_munmap_action(void *instance, action_arg_t *arg, action_result_t *result);
+
 #ifdef __cplusplus
 }
 #endif
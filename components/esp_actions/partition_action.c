@@ -49,3 +49,21 @@ esp_err_t partition_write_action(void *instance, action_arg_t *arg, action_resul
     result->err = esp_partition_write(write_arg->partition, write_arg->dst_offset, write_arg->src, write_arg->size);
     return result->err;
 }
+
+esp_err_t partition_mmap_action(void *instance, action_arg_t *arg, action_result_t *result)
+{
+    partition_mmap_args_t *mmap_arg = (partition_mmap_args_t *)arg->data;
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
+    result->err = esp_partition_mmap(mmap_arg->partition, mmap_arg->offset, mmap_arg->size, ESP_PARTITION_MMAP_DATA, mmap_arg->out_ptr, mmap_arg->out_handle);
+#else
+    result->err = esp_partition_mmap(mmap_arg->partition, mmap_arg->offset, mmap_arg->size, SPI_FLASH_MMAP_DATA, mmap_arg->out_ptr, mmap_arg->out_handle);
+#endif
+    return result->err;
+}
+
+esp_err_t partition_munmap_action(void *instance, action_arg_t *arg, action_result_t *result)
+{
+    spi_flash_munmap(*(spi_flash_mmap_handle_t *)arg->data);
+    result->err = ESP_OK;
+    return result->err;
+}
@@ -2,4 +2,4 @@
 # Main Makefile. This is basically the same as a component makefile.
 
 COMPONENT_ADD_INCLUDEDIRS := include
-COMPONENT_SRCDIRS := . ./playlist_operator ./sdcard_scan
+COMPONENT_SRCDIRS := . ./playlist_operator ./sdcard_scan ./playlist_meta
@@ -45,6 +45,8 @@ esp_err_t dram_list_create(playlist_operator_handle_t *handle);
 /**
  * @brief Save URL to dram playlist
  *
+ * @note  The URL is copied to a string arena shared by the whole list, at most 65534 URLs can be saved
+ *
  * @param handle     Playlist handle
  * @param url        URL to be saved
  *
@@ -128,6 +130,20 @@ esp_err_t dram_list_current(playlist_operator_handle_t handle, char **url_buff);
  */
 esp_err_t dram_list_choose(playlist_operator_handle_t handle, int url_id, char **url_buff);
 
+/**
+ * @brief Copy the url of an id in dram playlist, the current url and its id are not changed
+ *
+ * @param      handle          Playlist handle
+ * @param      url_id          The id of url in dram list
+ * @param[out] url_buff        Buffer of the url
+ * @param      size            Size of `url_buff`, including the terminating zero
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed, invalid id or `url_buff` too small
+ */
+esp_err_t dram_list_get_url(playlist_operator_handle_t handle, int url_id, char *url_buff, int size);
+
 /**
  * @brief Get URLs number in the dram playlist
  *
@@ -164,6 +180,9 @@ esp_err_t dram_list_show(playlist_operator_handle_t handle);
 /**
  * @brief Remove corrsponding url in dram list
  *
+ * @note  All the copies of the url are removed. URL pointers got from the list before may not be valid afterwards,
+ *        since the remaining URLs can be packed together again
+ *
  * @param handle   Playlist handle
  * @param url      The url to be removed
  *
@@ -176,6 +195,8 @@ esp_err_t dram_list_remove_by_url(playlist_operator_handle_t handle, const char
 /**
  * @brief Remove url by id
  *
+ * @note  The ids of the following URLs decrease by one. URL pointers got from the list before may not be valid afterwards
+ *
  * @param handle   Playlist handle
  * @param url_id   The url id to be removed
  *
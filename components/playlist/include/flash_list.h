@@ -139,6 +139,20 @@ esp_err_t flash_list_reset(playlist_operator_handle_t handle);
  */
 esp_err_t flash_list_choose(playlist_operator_handle_t handle, int url_id, char **url_buff);
 
+/**
+ * @brief Copy the url of an id in flash playlist, the current url and its id are not changed
+ *
+ * @param      handle          Playlist handle
+ * @param      url_id          The id of url in flash list
+ * @param[out] url_buff        Buffer of the url
+ * @param      size            Size of `url_buff`, including the terminating zero
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed, invalid id or `url_buff` too small
+ */
+esp_err_t flash_list_get_url(playlist_operator_handle_t handle, int url_id, char *url_buff, int size);
+
 /**
  * @brief Get URLs number in the flash playlist
  *
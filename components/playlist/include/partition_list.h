@@ -32,9 +32,11 @@ extern "C" {
 #endif
 
 /**
- * @brief Create a playlist in flash partition by list id
+ * @brief Create a playlist in flash partition by list id, the URLs saved before are removed
  *
  * @note  Please add 2 partitions to partition table whose subtype are 0x06 and 0x07 first
+ * @note  The URLs are kept in a log in one of the partitions, the other one receives the log when it is compacted,
+ *        so give them the same size. Only the sectors used by the log are erased.
  * 
  * @param[out] handle   The playlist handle from application layer
  *
@@ -44,6 +46,43 @@ extern "C" {
  */
 esp_err_t partition_list_create(playlist_operator_handle_t *handle);
 
+/**
+ * @brief Open the playlist in flash partition with the URLs saved before
+ *
+ * @note  The URL index is rebuilt in RAM by a sequential read of the log, a batch that was not committed is dropped
+ *
+ * @param[out] handle   The playlist handle from application layer
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t partition_list_open(playlist_operator_handle_t *handle);
+
+/**
+ * @brief Start a batch, the following saves and removes are written sector by sector and committed together
+ *
+ * @note  The URLs of the batch can be read before the commit, but they are lost by a power cut before it
+ *
+ * @param handle     Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t partition_list_batch_begin(playlist_operator_handle_t handle);
+
+/**
+ * @brief Write the rest of the batch and commit it, the log may be compacted afterwards
+ *
+ * @param handle     Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t partition_list_batch_commit(playlist_operator_handle_t handle);
+
 /**
  * @brief Save URL to partition playlist
  *
@@ -130,6 +169,46 @@ esp_err_t partition_list_current(playlist_operator_handle_t handle, char **url_b
  */
 esp_err_t partition_list_choose(playlist_operator_handle_t handle, int url_id, char **url_buff);
 
+/**
+ * @brief Copy the url of an id in partition playlist, the current url and its id are not changed
+ *
+ * @param      handle          Playlist handle
+ * @param      url_id          The id of url in partition list
+ * @param[out] url_buff        Buffer of the url
+ * @param      size            Size of `url_buff`, including the terminating zero
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed, invalid id or `url_buff` too small
+ */
+esp_err_t partition_list_get_url(playlist_operator_handle_t handle, int url_id, char *url_buff, int size);
+
+/**
+ * @brief Remove all the copies of a url from partition playlist
+ *
+ * @param handle     Playlist handle
+ * @param url        The url to be removed
+ *
+ * @return
+ *     - ESP_OK              success
+ *     - ESP_ERR_NOT_FOUND   The url is not in the playlist
+ *     - ESP_FAIL            failed
+ */
+esp_err_t partition_list_remove_by_url(playlist_operator_handle_t handle, const char *url);
+
+/**
+ * @brief Remove a url from partition playlist by url id, the ids after it move down by one
+ *
+ * @param handle     Playlist handle
+ * @param url_id     The id of url to be removed
+ *
+ * @return
+ *     - ESP_OK              success
+ *     - ESP_ERR_NOT_FOUND   Invalid url id
+ *     - ESP_FAIL            failed
+ */
+esp_err_t partition_list_remove_by_url_id(playlist_operator_handle_t handle, uint16_t url_id);
+
 /**
  * @brief Get URLs number in the partition playlist
  *
@@ -164,7 +243,9 @@ int partition_list_get_url_id(playlist_operator_handle_t handle);
 esp_err_t partition_list_show(playlist_operator_handle_t handle);
 
 /**
- * @brief Destroy the partition playlist
+ * @brief Destroy the partition playlist, a pending batch is committed
+ *
+ * @note  The URLs stay in the partitions, `partition_list_open` loads them again
  *
  * @param handle     Playlist handle
  *
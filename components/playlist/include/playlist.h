@@ -42,6 +42,15 @@ typedef enum {
     PLAYLIST_PARTITION      /*!< Playlist in partition */
 } playlist_type_t;
 
+/**
+ * @brief Play mode of a playlist, used by `playlist_next` and `playlist_prev`
+ */
+typedef enum {
+    PLAYLIST_MODE_SEQUENTIAL = 0,   /*!< URLs in id order, wrapping around at both ends */
+    PLAYLIST_MODE_SHUFFLE,          /*!< URLs in a seeded random order, every URL once per cycle */
+    PLAYLIST_MODE_REPEAT_ONE,       /*!< The current URL again */
+} playlist_mode_t;
+
 /**
  * @brief All types of Playlists' operation
  */
@@ -60,6 +69,7 @@ typedef struct {
     playlist_type_t      type;                                          /*!< Type of playlist */
     esp_err_t (*remove_by_url)(void *playlist, const char *url);        /*!< Remove the corresponding url */
     esp_err_t (*remove_by_id)(void *playlist, uint16_t url_id);         /*!< Remove url by id */
+    esp_err_t (*get_url)(void *playlist, int url_id, char *url_buff, int size); /*!< Copy the url of an id, the current url is not changed */
 
 } playlist_operation_t;
 
@@ -175,6 +185,34 @@ int playlist_get_current_list_url_num(playlist_handle_t handle);
  */
 int playlist_get_current_list_url_id(playlist_handle_t handle);
 
+/**
+ * @brief Get number of URLs in a playlist by list id
+ *
+ * @param handle       Playlist handle
+ * @param list_id      The list id
+ *
+ * @return
+ *     - Number of URLs in the playlist
+ *     - ESP_FAIL  The list id is not registered
+ */
+int playlist_get_list_url_num(playlist_handle_t handle, uint8_t list_id);
+
+/**
+ * @brief Copy a URL of a playlist by list id and url id, without changing the current URL of the playlist
+ *
+ * @param      handle        Playlist handle
+ * @param      list_id       The list id
+ * @param      url_id        The url id in the list
+ * @param[out] url_buff      Buffer of the URL
+ * @param      size          Size of `url_buff`, including the terminating zero
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_NOT_SUPPORTED  The playlist type can not get a URL by id
+ *     - ESP_FAIL               failed
+ */
+esp_err_t playlist_get_list_url(playlist_handle_t handle, uint8_t list_id, int url_id, char *url_buff, int size);
+
 /**
  * @brief Save a URL to the current playlist
  *
@@ -188,7 +226,7 @@ int playlist_get_current_list_url_id(playlist_handle_t handle);
 esp_err_t playlist_save(playlist_handle_t handle, const char *url);
 
 /**
- * @brief Next URl in current playlist
+ * @brief Next URl in current playlist, in the order of its play mode
  *
  * @param      handle        Playlist handle
  * @param      step          Next steps from current position
@@ -201,7 +239,7 @@ esp_err_t playlist_save(playlist_handle_t handle, const char *url);
 esp_err_t playlist_next(playlist_handle_t handle, int step, char **url_buff);
 
 /**
- * @brief Previous URL in current playlist
+ * @brief Previous URL in current playlist, in the order of its play mode
  *
  * @param      handle        Playlist handle
  * @param      step          Previous steps from current position
@@ -213,6 +251,46 @@ esp_err_t playlist_next(playlist_handle_t handle, int step, char **url_buff);
  */
 esp_err_t playlist_prev(playlist_handle_t handle, int step, char **url_buff);
 
+/**
+ * @brief Set the play mode of the current playlist, each playlist keeps its own mode
+ *
+ * @note  The shuffle order is a permutation computed on the fly from the seed and the url id,
+ *        it takes no memory and a shuffle step costs the same as a sequential one.
+ *        It continues from the current URL, so after `playlist_choose` the cycle goes on from the chosen URL.
+ * @note  The order is recomputed for the number of URLs at each step, saving or removing URLs changes it
+ *
+ * @param handle   Playlist handle
+ * @param mode     The play mode
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t playlist_set_mode(playlist_handle_t handle, playlist_mode_t mode);
+
+/**
+ * @brief Get the play mode of the current playlist
+ *
+ * @param handle   Playlist handle
+ *
+ * @return The play mode, `PLAYLIST_MODE_SEQUENTIAL` if there is no playlist
+ */
+playlist_mode_t playlist_get_mode(playlist_handle_t handle);
+
+/**
+ * @brief Set the shuffle seed of the current playlist, the same seed gives the same order
+ *
+ * @note  Without a seed, a random one is picked the first time the shuffle mode is set
+ *
+ * @param handle   Playlist handle
+ * @param seed     Seed of the shuffle order
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t playlist_set_shuffle_seed(playlist_handle_t handle, uint32_t seed);
+
 /**
  * @brief Choose a url by url id
  *
@@ -0,0 +1,181 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _PLAYLIST_META_H_
+#define _PLAYLIST_META_H_
+
+#include "esp_err.h"
+#include "playlist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLAYLIST_META_TAG_LENGTH        (64)
+
+/**
+ * @brief Audio format found by the metadata indexer
+ */
+typedef enum {
+    PLAYLIST_META_CODEC_UNKNOWN = 0,    /*!< Not probed, not local or not recognized */
+    PLAYLIST_META_CODEC_MP3,            /*!< MPEG audio layer I, II or III */
+    PLAYLIST_META_CODEC_AAC,            /*!< AAC in ADTS */
+    PLAYLIST_META_CODEC_M4A,            /*!< MP4 container */
+    PLAYLIST_META_CODEC_FLAC,           /*!< Native FLAC */
+    PLAYLIST_META_CODEC_VORBIS,         /*!< Vorbis in Ogg */
+    PLAYLIST_META_CODEC_OPUS,           /*!< Opus in Ogg */
+    PLAYLIST_META_CODEC_WAV,            /*!< RIFF WAVE */
+} playlist_meta_codec_t;
+
+/**
+ * @brief Metadata of one URL
+ */
+typedef struct {
+    playlist_meta_codec_t   codec;                              /*!< Audio format */
+    uint32_t                duration_ms;                        /*!< Duration in milliseconds, 0 if unknown */
+    bool                    duration_estimated;                 /*!< The duration comes from the average bitrate of the first frames */
+    uint32_t                bitrate;                            /*!< Average bitrate in bits per second */
+    uint32_t                sample_rate;                        /*!< Sample rate in Hz */
+    uint8_t                 channels;                           /*!< Number of channels */
+    char                    title[PLAYLIST_META_TAG_LENGTH];    /*!< Title tag, UTF-8, empty if none */
+    char                    artist[PLAYLIST_META_TAG_LENGTH];   /*!< Artist tag, UTF-8, empty if none */
+    char                    album[PLAYLIST_META_TAG_LENGTH];    /*!< Album tag, UTF-8, empty if none */
+} playlist_meta_info_t;
+
+/**
+ * @brief Metadata indexer configuration
+ */
+typedef struct {
+    uint8_t         list_id;        /*!< Id of the playlist to index, as registered with `playlist_add` */
+    const char     *index_file;     /*!< File keeping the metadata across boots, e.g. "/sdcard/__playlist/_meta", NULL to keep it in RAM only */
+    int             read_rate;      /*!< Bytes per second the indexer reads at most, so it never competes with playback for the card */
+    int             task_stack;     /*!< Indexer task stack size */
+    int             task_prio;      /*!< Indexer task priority, keep it below the audio elements */
+    int             task_core;      /*!< Indexer task core */
+    bool            stack_in_ext;   /*!< Try to allocate the task stack in external memory */
+} playlist_meta_cfg_t;
+
+typedef struct playlist_meta *playlist_meta_handle_t;
+
+#define PLAYLIST_META_READ_RATE         (64 * 1024)
+#define PLAYLIST_META_TASK_STACK        (4 * 1024)
+#define PLAYLIST_META_TASK_PRIO         (1)
+#define PLAYLIST_META_TASK_CORE         (0)
+
+#define PLAYLIST_META_CFG_DEFAULT() {               \
+    .list_id = 0,                                   \
+    .index_file = NULL,                             \
+    .read_rate = PLAYLIST_META_READ_RATE,           \
+    .task_stack = PLAYLIST_META_TASK_STACK,         \
+    .task_prio = PLAYLIST_META_TASK_PRIO,           \
+    .task_core = PLAYLIST_META_TASK_CORE,           \
+    .stack_in_ext = true,                           \
+}
+
+/**
+ * @brief Start a background task indexing the metadata of the local files of a playlist
+ *
+ * @note  The task reads the headers only (ID3v2/ID3v1, Xing/VBRI, ADTS, RIFF, FLAC STREAMINFO and
+ *        Vorbis comments, Ogg, MP4 atoms), no audio is decoded. URLs added to the playlist later are indexed as well.
+ *        Files found in the index file with the same size and modification time are not read again.
+ * @note  Destroy the indexer before the playlist handle.
+ *
+ * @param handle  Playlist handle
+ * @param cfg     The configuration
+ *
+ * @return
+ *     - NULL    failed
+ *     - Others  Metadata indexer handle
+ */
+playlist_meta_handle_t playlist_meta_create(playlist_handle_t handle, playlist_meta_cfg_t *cfg);
+
+/**
+ * @brief Get the metadata of a URL
+ *
+ * @param      meta    Metadata indexer handle
+ * @param      url_id  The url id in the indexed playlist
+ * @param[out] info    The metadata
+ *
+ * @return
+ *     - ESP_OK               success
+ *     - ESP_ERR_NOT_FOUND    The URL is not indexed yet
+ *     - ESP_ERR_INVALID_ARG  Invalid arguments
+ */
+esp_err_t playlist_meta_get(playlist_meta_handle_t meta, int url_id, playlist_meta_info_t *info);
+
+/**
+ * @brief Get the progress of the indexer and the total duration of the indexed URLs
+ *
+ * @param      meta         Metadata indexer handle
+ * @param[out] indexed      Number of URLs indexed, can be NULL
+ * @param[out] total        Number of URLs in the playlist, can be NULL
+ * @param[out] duration_ms  Total duration of the indexed URLs, can be NULL
+ *
+ * @return
+ *     - ESP_OK               success
+ *     - ESP_ERR_INVALID_ARG  Invalid arguments
+ */
+esp_err_t playlist_meta_get_summary(playlist_meta_handle_t meta, int *indexed, int *total, uint64_t *duration_ms);
+
+/**
+ * @brief Forget which URL each id had, call it after the playlist was reset and filled again
+ *
+ * @note  The metadata of the files is kept, the files are not read again
+ *
+ * @param meta  Metadata indexer handle
+ *
+ * @return
+ *     - ESP_OK               success
+ *     - ESP_ERR_INVALID_ARG  Invalid arguments
+ */
+esp_err_t playlist_meta_refresh(playlist_meta_handle_t meta);
+
+/**
+ * @brief Pause or resume the indexer, e.g. while the card is busy with a recording
+ *
+ * @param meta   Metadata indexer handle
+ * @param pause  true to pause
+ *
+ * @return
+ *     - ESP_OK               success
+ *     - ESP_ERR_INVALID_ARG  Invalid arguments
+ */
+esp_err_t playlist_meta_pause(playlist_meta_handle_t meta, bool pause);
+
+/**
+ * @brief Stop the indexer, save the index file and free the indexer
+ *
+ * @param meta  Metadata indexer handle
+ *
+ * @return
+ *     - ESP_OK               success
+ *     - ESP_ERR_INVALID_ARG  Invalid arguments
+ */
+esp_err_t playlist_meta_destroy(playlist_meta_handle_t meta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PLAYLIST_META_H_ */
@@ -127,6 +127,20 @@ esp_err_t sdcard_list_current(playlist_operator_handle_t handle, char **url_buff
  */
 esp_err_t sdcard_list_choose(playlist_operator_handle_t handle, int url_id, char **url_buff);
 
+/**
+ * @brief Copy the url of an id in sdcard playlist, the current url and its id are not changed
+ *
+ * @param      handle          Playlist handle
+ * @param      url_id          The id of url in sdcard list
+ * @param[out] url_buff        Buffer of the url
+ * @param      size            Size of `url_buff`, including the terminating zero
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed, invalid id or `url_buff` too small
+ */
+esp_err_t sdcard_list_get_url(playlist_operator_handle_t handle, int url_id, char *url_buff, int size);
+
 /**
  * @brief Get URLs number in sdcard playlist
  *
@@ -172,6 +186,31 @@ esp_err_t sdcard_list_destroy(playlist_operator_handle_t handle);
  */
 esp_err_t sdcard_list_save(playlist_operator_handle_t handle, const char *url);
 
+/**
+ * @brief Start a batch, the following saved URLs are staged in RAM and written out in large sequential writes,
+ *        without a sync per URL. Use it around `sdcard_scan` to build a long playlist
+ *
+ * @note  The URLs of the batch can be played at once, but they are only safe on the card after `sdcard_list_batch_commit`
+ *
+ * @param handle     Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_list_batch_begin(playlist_operator_handle_t handle);
+
+/**
+ * @brief Write the URLs saved since `sdcard_list_batch_begin` and their offsets, then sync the files once
+ *
+ * @param handle     Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_list_batch_commit(playlist_operator_handle_t handle);
+
 #ifdef __cplusplus
 }
 #endif
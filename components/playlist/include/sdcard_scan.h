@@ -51,6 +51,33 @@ typedef void (*sdcard_scan_cb_t)(void *user_data, char *url);
  */
 esp_err_t sdcard_scan(sdcard_scan_cb_t cb, const char *path, int depth, const char *file_extension[], int filter_num, void *user_data);
 
+/**
+ * @brief Scan files in SD card like `sdcard_scan`, and keep an index file so that the next scan only reads the changed directories.
+ *
+ * @note  The index records each directory with its modification time, a hash of its names and the entries which
+ *        pass the filter. A directory with the same time and names is replayed from the index, only its names are read
+ *        and its sub-directories looked up, there is no stat of each file. The others are read again, and the index
+ *        file is only written when a directory changed.
+ * @note  FatFs does not update the time of a directory when files are added, removed or renamed in it, the names
+ *        read on each scan catch these changes.
+ *        The index is ignored when `depth` or `file_extension` differ from the scan which wrote it.
+ * @note  Save the urls in a batch, e.g. between `sdcard_list_batch_begin` and `sdcard_list_batch_commit`.
+ *
+ * @param cb              The callback function
+ * @param path            The path to be scanned
+ * @param depth           The depth of file scanning
+ * @param file_extension  File extension of files that are supposed to be saved
+ * @param filter_num      Number of filters
+ * @param index_file      The index file, e.g. "/sdcard/__playlist/_scan_index", directories starting with "__" are not scanned
+ * @param user_data       The data to be used by callback function
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_scan_incremental(sdcard_scan_cb_t cb, const char *path, int depth, const char *file_extension[], int filter_num,
+                                  const char *index_file, void *user_data);
+
 #ifdef __cplusplus
 }
 #endif
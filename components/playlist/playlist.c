@@ -27,8 +27,11 @@
 #include "audio_mem.h"
 #include "audio_error.h"
 #include "audio_mutex.h"
+#include "esp_system.h"
 #include "playlist.h"
 
+#define PLAYLIST_SHUFFLE_ROUNDS     (6)
+
 static const char *TAG = "PLAYLIST";
 
 /**
@@ -37,6 +40,10 @@ static const char *TAG = "PLAYLIST";
 typedef struct playlist_info {
     playlist_operator_handle_t      list_handle;                /*!< Specific playlist's handle */
     uint8_t                         list_id;                    /*!< List id*/
+    playlist_mode_t                 mode;                       /*!< Play mode of the list */
+    uint32_t                        shuffle_seed;               /*!< Seed of the shuffle permutations */
+    uint32_t                        shuffle_cycle;              /*!< Each cycle through the list has its own permutation */
+    uint32_t                        shuffle_base;               /*!< Permutation index of the url the shuffle started from */
     STAILQ_ENTRY(playlist_info)     entries;                    /*!< List node */
 } playlist_info_t;
 
@@ -64,11 +71,121 @@ playlist_handle_t playlist_create(void)
     return handle;
 }
 
-esp_err_t playlist_next(playlist_handle_t handle, int step, char **url_buff)
+static uint32_t playlist_shuffle_mix(uint32_t x)
 {
-    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
-    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+    x ^= x >> 16;
+    x *= 0x7FEB352D;
+    x ^= x >> 15;
+    x *= 0x846CA68B;
+    x ^= x >> 16;
+    return x;
+}
+
+/*
+ * A balanced Feistel network over [0, 4^bits) is a permutation of it, walking the cycle until the
+ * result falls in [0, num) restricts it to the ids. 4^bits < 4 * num, so it takes 4 tries at most on average.
+ */
+static uint32_t playlist_shuffle_permute(const playlist_info_t *list, uint32_t cycle, int num, uint32_t x, bool inverse)
+{
+    int bits = 1;
+    while ((1u << (2 * bits)) < (uint32_t)num) {
+        bits++;
+    }
+    uint32_t mask = (1u << bits) - 1;
+    uint32_t key = playlist_shuffle_mix(list->shuffle_seed ^ playlist_shuffle_mix(cycle + 0x9E3779B9));
+    do {
+        uint32_t l = x >> bits, r = x & mask;
+        for (int i = 0; i < PLAYLIST_SHUFFLE_ROUNDS; i++) {
+            int round = inverse ? PLAYLIST_SHUFFLE_ROUNDS - 1 - i : i;
+            uint32_t t;
+            if (inverse) {
+                t = r;
+                r = l;
+                l = t ^ (playlist_shuffle_mix(r ^ key ^ (round * 0x9E3779B9)) & mask);
+            } else {
+                t = l;
+                l = r;
+                r = t ^ (playlist_shuffle_mix(l ^ key ^ (round * 0x9E3779B9)) & mask);
+            }
+        }
+        x = (l << bits) | r;
+    } while (x >= (uint32_t)num);
+    return x;
+}
+
+/*
+ * Positions count from the url the shuffle started from. Two urls have a single order, so they never play twice in a row.
+ * Longer lists get a new order every cycle, with its first two urls swapped if the first one just ended the previous cycle.
+ */
+static uint32_t playlist_shuffle_order(const playlist_info_t *list, uint32_t cycle, int num, uint32_t pos)
+{
+    return playlist_shuffle_permute(list, num > 2 ? cycle : 0, num, (pos + list->shuffle_base) % num, false);
+}
+
+static bool playlist_shuffle_swapped(const playlist_info_t *list, uint32_t cycle, int num)
+{
+    return num > 2 && cycle != 0
+           && playlist_shuffle_order(list, cycle, num, 0) == playlist_shuffle_order(list, cycle - 1, num, num - 1);
+}
+
+static uint32_t playlist_shuffle_id(const playlist_info_t *list, uint32_t cycle, int num, uint32_t pos)
+{
+    if (pos < 2 && playlist_shuffle_swapped(list, cycle, num)) {
+        pos ^= 1;
+    }
+    return playlist_shuffle_order(list, cycle, num, pos);
+}
+
+static uint32_t playlist_shuffle_index(const playlist_info_t *list, uint32_t cycle, int num, uint32_t id)
+{
+    uint32_t base = list->shuffle_base % num;
+    uint32_t pos = (playlist_shuffle_permute(list, num > 2 ? cycle : 0, num, id, true) + num - base) % num;
+    if (pos < 2 && playlist_shuffle_swapped(list, cycle, num)) {
+        pos ^= 1;
+    }
+    return pos;
+}
 
+/* Move `step` places in the shuffle order from the current url, a new permutation is used for every cycle */
+static esp_err_t playlist_shuffle_step(playlist_info_t *list, playlist_operation_t *operation, int step, char **url_buff)
+{
+    playlist_operator_handle_t cur_handle = list->list_handle;
+    int num = operation->get_url_num(cur_handle);
+    if (num <= 0) {
+        ESP_LOGE(TAG, "No url, please save urls to playlist first");
+        return ESP_FAIL;
+    }
+    int id = operation->get_url_id(cur_handle);
+    if (id < 0 || id >= num) {
+        id = 0;
+    }
+    int64_t pos = (int64_t)playlist_shuffle_index(list, list->shuffle_cycle, num, id) + step;
+    int64_t cycles = pos / num;
+    pos %= num;
+    if (pos < 0) {
+        pos += num;
+        cycles--;
+    }
+    list->shuffle_cycle += (uint32_t)cycles;
+    id = playlist_shuffle_id(list, list->shuffle_cycle, num, pos);
+    return operation->choose(cur_handle, id, url_buff);
+}
+
+static void playlist_shuffle_start(playlist_info_t *list)
+{
+    playlist_operation_t operation = {0};
+    list->list_handle->get_operation(&operation);
+    int num = operation.get_url_num(list->list_handle);
+    int id = operation.get_url_id(list->list_handle);
+    list->shuffle_cycle = 0;
+    list->shuffle_base = 0;
+    if (num > 0 && id >= 0 && id < num) {
+        list->shuffle_base = playlist_shuffle_permute(list, 0, num, id, true);
+    }
+}
+
+static esp_err_t playlist_step(playlist_handle_t handle, int step, char **url_buff)
+{
     esp_err_t ret = ESP_OK;
     mutex_lock(handle->playlist_operate_lock);
 
@@ -77,27 +194,90 @@ esp_err_t playlist_next(playlist_handle_t handle, int step, char **url_buff)
     playlist_operation_t operation = {0};
     cur_handle->get_operation(&operation);
 
-    ret = operation.next(cur_handle, step, url_buff);
+    switch (cur_list->mode) {
+        case PLAYLIST_MODE_SHUFFLE:
+            ret = playlist_shuffle_step(cur_list, &operation, step, url_buff);
+            break;
+        case PLAYLIST_MODE_REPEAT_ONE:
+            ret = operation.current(cur_handle, url_buff);
+            break;
+        default:
+            ret = step >= 0 ? operation.next(cur_handle, step, url_buff) : operation.prev(cur_handle, -step, url_buff);
+            break;
+    }
     mutex_unlock(handle->playlist_operate_lock);
     return ret;
 }
 
-esp_err_t playlist_prev(playlist_handle_t handle, int step, char **url_buff)
+esp_err_t playlist_set_mode(playlist_handle_t handle, playlist_mode_t mode)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+    if (mode < PLAYLIST_MODE_SEQUENTIAL || mode > PLAYLIST_MODE_REPEAT_ONE) {
+        ESP_LOGE(TAG, "Invalid play mode %d", mode);
+        return ESP_FAIL;
+    }
 
-    esp_err_t ret = ESP_OK;
     mutex_lock(handle->playlist_operate_lock);
-
     playlist_info_t *cur_list = handle->cur_playlist;
-    playlist_operator_handle_t cur_handle = cur_list->list_handle;
-    playlist_operation_t operation = {0};
-    cur_handle->get_operation(&operation);
+    if (mode == PLAYLIST_MODE_SHUFFLE && cur_list->mode != PLAYLIST_MODE_SHUFFLE) {
+        if (cur_list->shuffle_seed == 0) {
+            cur_list->shuffle_seed = esp_random();
+        }
+        playlist_shuffle_start(cur_list);
+    }
+    cur_list->mode = mode;
+    mutex_unlock(handle->playlist_operate_lock);
+    return ESP_OK;
+}
+
+playlist_mode_t playlist_get_mode(playlist_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return PLAYLIST_MODE_SEQUENTIAL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return PLAYLIST_MODE_SEQUENTIAL);
 
-    ret = operation.prev(cur_handle, step, url_buff);
+    mutex_lock(handle->playlist_operate_lock);
+    playlist_mode_t mode = handle->cur_playlist->mode;
     mutex_unlock(handle->playlist_operate_lock);
-    return ret;
+    return mode;
+}
+
+esp_err_t playlist_set_shuffle_seed(playlist_handle_t handle, uint32_t seed)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+
+    mutex_lock(handle->playlist_operate_lock);
+    handle->cur_playlist->shuffle_seed = seed;
+    playlist_shuffle_start(handle->cur_playlist);
+    mutex_unlock(handle->playlist_operate_lock);
+    return ESP_OK;
+}
+
+esp_err_t playlist_next(playlist_handle_t handle, int step, char **url_buff)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
+    if (step < 0) {
+        ESP_LOGE(TAG, "Number of steps should be larger than 0");
+        return ESP_FAIL;
+    }
+
+    return playlist_step(handle, step, url_buff);
+}
+
+esp_err_t playlist_prev(playlist_handle_t handle, int step, char **url_buff)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
+    if (step < 0) {
+        ESP_LOGE(TAG, "Number of steps should be larger than 0");
+        return ESP_FAIL;
+    }
+
+    return playlist_step(handle, -step, url_buff);
 }
 
 esp_err_t playlist_choose(playlist_handle_t handle, int url_id, char **url_buff)
@@ -385,6 +565,54 @@ int playlist_get_current_list_url_num(playlist_handle_t handle)
     return ret;
 }
 
+static playlist_info_t *playlist_find(playlist_handle_t handle, uint8_t list_id)
+{
+    playlist_info_t *tmp = NULL;
+    STAILQ_FOREACH(tmp, &handle->playlist_info_list, entries) {
+        if (tmp->list_id == list_id) {
+            return tmp;
+        }
+    }
+    return NULL;
+}
+
+int playlist_get_list_url_num(playlist_handle_t handle, uint8_t list_id)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+
+    int ret = ESP_FAIL;
+    mutex_lock(handle->playlist_operate_lock);
+    playlist_info_t *list = playlist_find(handle, list_id);
+    if (list) {
+        playlist_operation_t operation = {0};
+        list->list_handle->get_operation(&operation);
+        ret = operation.get_url_num(list->list_handle);
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
+esp_err_t playlist_get_list_url(playlist_handle_t handle, uint8_t list_id, int url_id, char *url_buff, int size)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
+
+    esp_err_t ret = ESP_FAIL;
+    mutex_lock(handle->playlist_operate_lock);
+    playlist_info_t *list = playlist_find(handle, list_id);
+    if (list) {
+        playlist_operation_t operation = {0};
+        list->list_handle->get_operation(&operation);
+        if (operation.get_url) {
+            ret = operation.get_url(list->list_handle, url_id, url_buff, size);
+        } else {
+            ret = ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
 int playlist_get_current_list_url_id(playlist_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
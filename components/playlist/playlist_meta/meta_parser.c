@@ -0,0 +1,817 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "meta_parser.h"
+
+#define META_SCRATCH_SIZE       (2048)
+#define META_SYNC_SEARCH        (64 * 1024)
+#define META_ADTS_FRAMES        (64)
+#define META_OGG_TAIL_SEARCH    (64 * 1024)
+#define META_MP4_MAX_DEPTH      (8)
+
+typedef struct {
+    meta_source_t          *src;
+    playlist_meta_info_t   *info;
+    uint8_t                *buf;    /* scratch of META_SCRATCH_SIZE bytes */
+} meta_ctx_t;
+
+static const char *TAG = "PLAYLIST_META";
+
+static bool meta_read(meta_ctx_t *ctx, uint32_t pos, void *buf, int len)
+{
+    if (len <= 0 || pos >= ctx->src->size || ctx->src->size - pos < (uint32_t)len) {
+        return false;
+    }
+    return ctx->src->read(ctx->src->ctx, pos, buf, len) == len;
+}
+
+static inline uint16_t be16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint64_t be64(const uint8_t *p)
+{
+    return ((uint64_t)be32(p) << 32) | be32(p + 4);
+}
+
+static inline uint16_t le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t le64(const uint8_t *p)
+{
+    return le32(p) | ((uint64_t)le32(p + 4) << 32);
+}
+
+static inline uint32_t syncsafe32(const uint8_t *p)
+{
+    return ((p[0] & 0x7F) << 21) | ((p[1] & 0x7F) << 14) | ((p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+static uint32_t ms_of(uint64_t samples, uint32_t sample_rate)
+{
+    if (sample_rate == 0) {
+        return 0;
+    }
+    return (uint32_t)(samples * 1000 / sample_rate);
+}
+
+/* Append one code point to a UTF-8 tag, never splitting a character */
+static int utf8_put(char *dst, int pos, uint32_t cp)
+{
+    char enc[4];
+    int n;
+    if (cp < 0x80) {
+        enc[0] = cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        enc[0] = 0xC0 | (cp >> 6);
+        enc[1] = 0x80 | (cp & 0x3F);
+        n = 2;
+    } else if (cp < 0x10000) {
+        enc[0] = 0xE0 | (cp >> 12);
+        enc[1] = 0x80 | ((cp >> 6) & 0x3F);
+        enc[2] = 0x80 | (cp & 0x3F);
+        n = 3;
+    } else {
+        enc[0] = 0xF0 | (cp >> 18);
+        enc[1] = 0x80 | ((cp >> 12) & 0x3F);
+        enc[2] = 0x80 | ((cp >> 6) & 0x3F);
+        enc[3] = 0x80 | (cp & 0x3F);
+        n = 4;
+    }
+    if (pos + n >= PLAYLIST_META_TAG_LENGTH) {
+        return -1;
+    }
+    memcpy(dst + pos, enc, n);
+    dst[pos + n] = 0;
+    return pos + n;
+}
+
+static void tag_trim(char *dst)
+{
+    int len = strlen(dst);
+    while (len > 0 && (dst[len - 1] == ' ' || dst[len - 1] == '\r' || dst[len - 1] == '\n')) {
+        dst[--len] = 0;
+    }
+}
+
+/* encoding: 0 ISO-8859-1, 1 UTF-16 with BOM, 2 UTF-16BE, 3 UTF-8 */
+static void tag_set(char *dst, const uint8_t *src, int len, int encoding)
+{
+    int pos = 0;
+    dst[0] = 0;
+    if (encoding == 1 || encoding == 2) {
+        bool big = (encoding == 2);
+        if (encoding == 1 && len >= 2) {
+            if (src[0] == 0xFF && src[1] == 0xFE) {
+                src += 2, len -= 2;
+            } else if (src[0] == 0xFE && src[1] == 0xFF) {
+                big = true;
+                src += 2, len -= 2;
+            }
+        }
+        for (int i = 0; i + 1 < len && pos >= 0; i += 2) {
+            uint32_t cp = big ? be16(src + i) : le16(src + i);
+            if (cp == 0) {
+                break;
+            }
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 3 < len) {
+                uint32_t lo = big ? be16(src + i + 2) : le16(src + i + 2);
+                if (lo >= 0xDC00 && lo < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    i += 2;
+                }
+            }
+            pos = utf8_put(dst, pos, cp);
+        }
+    } else if (encoding == 0) {
+        for (int i = 0; i < len && src[i] && pos >= 0; i++) {
+            pos = utf8_put(dst, pos, src[i]);
+        }
+    } else {
+        int n = 0;
+        while (n < len && src[n]) {
+            n++;
+        }
+        if (n >= PLAYLIST_META_TAG_LENGTH) {
+            n = PLAYLIST_META_TAG_LENGTH - 1;
+            /* Do not cut a multi-byte sequence */
+            while (n > 0 && (src[n] & 0xC0) == 0x80) {
+                n--;
+            }
+        }
+        memcpy(dst, src, n);
+        dst[n] = 0;
+    }
+    tag_trim(dst);
+}
+
+/* ---------------------------------------------------------------- ID3 */
+
+static uint32_t id3v2_parse(meta_ctx_t *ctx)
+{
+    uint8_t *h = ctx->buf;
+    if (!meta_read(ctx, 0, h, 10) || memcmp(h, "ID3", 3) || h[3] < 2 || h[3] > 4) {
+        return 0;
+    }
+    int version = h[3];
+    uint8_t flags = h[5];
+    uint32_t end = 10 + syncsafe32(h + 6) + ((flags & 0x10) ? 10 : 0);
+    uint32_t pos = 10;
+    if (flags & 0x80) {
+        /* Unsynchronized tags are rare, keep the audio offset but skip the frames */
+        return end;
+    }
+    if ((flags & 0x40) && version >= 3) {
+        if (!meta_read(ctx, pos, h, 4)) {
+            return end;
+        }
+        pos += (version == 3) ? be32(h) + 4 : syncsafe32(h);
+    }
+    int id_len = (version == 2) ? 3 : 4;
+    int hdr_len = (version == 2) ? 6 : 10;
+    uint32_t tag_end = end - ((flags & 0x10) ? 10 : 0);
+    while (pos + hdr_len <= tag_end) {
+        if (!meta_read(ctx, pos, h, hdr_len) || h[0] == 0) {
+            break;
+        }
+        uint32_t size;
+        if (version == 2) {
+            size = (h[3] << 16) | (h[4] << 8) | h[5];
+        } else if (version == 3) {
+            size = be32(h + 4);
+        } else {
+            size = syncsafe32(h + 4);
+        }
+        char *dst = NULL;
+        if (!memcmp(h, version == 2 ? "TT2" : "TIT2", id_len)) {
+            dst = ctx->info->title;
+        } else if (!memcmp(h, version == 2 ? "TP1" : "TPE1", id_len)) {
+            dst = ctx->info->artist;
+        } else if (!memcmp(h, version == 2 ? "TAL" : "TALB", id_len)) {
+            dst = ctx->info->album;
+        }
+        pos += hdr_len;
+        if (size > tag_end - pos) {
+            break;
+        }
+        /* Compressed or encrypted frames are skipped */
+        bool plain = (version == 2) || (version == 3 && !(h[9] & 0xC0)) || (version == 4 && !(h[9] & 0x0F));
+        if (dst && plain && size > 1) {
+            int len = size > 4 * PLAYLIST_META_TAG_LENGTH ? 4 * PLAYLIST_META_TAG_LENGTH : size;
+            if (meta_read(ctx, pos, ctx->buf, len)) {
+                tag_set(dst, ctx->buf + 1, len - 1, ctx->buf[0]);
+            }
+        }
+        pos += size;
+    }
+    return end;
+}
+
+static void id3v1_parse(meta_ctx_t *ctx)
+{
+    uint8_t *t = ctx->buf;
+    if (ctx->src->size < 128 || !meta_read(ctx, ctx->src->size - 128, t, 128) || memcmp(t, "TAG", 3)) {
+        return;
+    }
+    if (ctx->info->title[0] == 0) {
+        tag_set(ctx->info->title, t + 3, 30, 0);
+    }
+    if (ctx->info->artist[0] == 0) {
+        tag_set(ctx->info->artist, t + 33, 30, 0);
+    }
+    if (ctx->info->album[0] == 0) {
+        tag_set(ctx->info->album, t + 63, 30, 0);
+    }
+}
+
+/* ---------------------------------------------------------------- MPEG audio / ADTS */
+
+typedef struct {
+    uint32_t    sample_rate;
+    uint32_t    bitrate;
+    uint32_t    frame_len;
+    uint32_t    samples;
+    uint8_t     channels;
+    uint8_t     version;        /* 1, 2, or 3 for MPEG-2.5 */
+    uint8_t     layer;
+} mpa_frame_t;
+
+static const uint16_t mpa_bitrates[5][14] = {
+    {32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},   /* V1 L1 */
+    {32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},      /* V1 L2 */
+    {32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},       /* V1 L3 */
+    {32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},      /* V2 L1 */
+    {8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},           /* V2 L2, L3 */
+};
+
+static const uint32_t mpa_rates[3] = {44100, 48000, 32000};
+
+static const uint32_t adts_rates[13] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+static bool mpa_header(const uint8_t *p, mpa_frame_t *f)
+{
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+    int ver = (p[1] >> 3) & 3;
+    int layer = 4 - ((p[1] >> 1) & 3);
+    int br = p[2] >> 4;
+    int sr = (p[2] >> 2) & 3;
+    if (ver == 1 || layer == 4 || br == 0 || br == 15 || sr == 3) {
+        return false;
+    }
+    f->version = (ver == 3) ? 1 : (ver == 2) ? 2 : 3;
+    f->layer = layer;
+    f->sample_rate = mpa_rates[sr] >> (f->version - 1);
+    int table = (f->version == 1) ? layer - 1 : (layer == 1 ? 3 : 4);
+    f->bitrate = mpa_bitrates[table][br - 1] * 1000;
+    f->channels = ((p[3] >> 6) == 3) ? 1 : 2;
+    int pad = (p[2] >> 1) & 1;
+    if (layer == 1) {
+        f->samples = 384;
+        f->frame_len = (12 * f->bitrate / f->sample_rate + pad) * 4;
+    } else {
+        f->samples = (layer == 3 && f->version != 1) ? 576 : 1152;
+        f->frame_len = f->samples / 8 * f->bitrate / f->sample_rate + pad;
+    }
+    return true;
+}
+
+static bool adts_header(const uint8_t *p, mpa_frame_t *f)
+{
+    if (p[0] != 0xFF || (p[1] & 0xF6) != 0xF0) {
+        return false;
+    }
+    int sr = (p[2] >> 2) & 0xF;
+    if (sr >= 13) {
+        return false;
+    }
+    f->sample_rate = adts_rates[sr];
+    f->channels = ((p[2] & 1) << 2) | (p[3] >> 6);
+    f->frame_len = ((p[3] & 3) << 11) | (p[4] << 3) | (p[5] >> 5);
+    f->samples = 1024 * ((p[6] & 3) + 1);
+    f->layer = 0;
+    return f->frame_len > 7;
+}
+
+/* Xing/Info and VBRI headers carry the frame count of VBR files */
+static bool mpa_vbr_frames(meta_ctx_t *ctx, uint32_t pos, const mpa_frame_t *f, uint32_t *frames, uint32_t *bytes)
+{
+    uint8_t *b = ctx->buf;
+    int side = (f->version == 1) ? (f->channels == 1 ? 17 : 32) : (f->channels == 1 ? 9 : 17);
+    if (meta_read(ctx, pos + 4 + side, b, 16) && (!memcmp(b, "Xing", 4) || !memcmp(b, "Info", 4))) {
+        uint32_t flags = be32(b + 4);
+        int off = 8;
+        *frames = 0;
+        *bytes = 0;
+        if (flags & 1) {
+            *frames = be32(b + off);
+            off += 4;
+        }
+        if (flags & 2) {
+            *bytes = be32(b + off);
+        }
+        return *frames != 0;
+    }
+    if (meta_read(ctx, pos + 36, b, 18) && !memcmp(b, "VBRI", 4)) {
+        *bytes = be32(b + 10);
+        *frames = be32(b + 14);
+        return *frames != 0;
+    }
+    return false;
+}
+
+static esp_err_t mpa_parse(meta_ctx_t *ctx, uint32_t start)
+{
+    playlist_meta_info_t *info = ctx->info;
+    uint32_t size = ctx->src->size;
+    uint32_t end = size;
+    uint8_t t[3];
+    if (size >= 128 && meta_read(ctx, size - 128, t, 3) && !memcmp(t, "TAG", 3)) {
+        end = size - 128;
+    }
+    uint32_t limit = (end - start > META_SYNC_SEARCH) ? start + META_SYNC_SEARCH : end;
+    uint32_t pos = start;
+    while (pos + 7 <= limit) {
+        int n = (limit - pos > META_SCRATCH_SIZE) ? META_SCRATCH_SIZE : limit - pos;
+        if (!meta_read(ctx, pos, ctx->buf, n)) {
+            return ESP_FAIL;
+        }
+        for (int i = 0; i + 7 <= n; i++) {
+            mpa_frame_t f, next;
+            uint8_t h[7];
+            uint32_t at = pos + i;
+            bool adts = adts_header(ctx->buf + i, &f);
+            if (!adts && !mpa_header(ctx->buf + i, &f)) {
+                continue;
+            }
+            /* A second header right after the frame tells a real sync from noise */
+            if (at + f.frame_len + 7 <= end) {
+                if (!meta_read(ctx, at + f.frame_len, h, 7)) {
+                    return ESP_FAIL;
+                }
+                bool ok = adts ? adts_header(h, &next) : mpa_header(h, &next);
+                if (!ok || next.sample_rate != f.sample_rate) {
+                    continue;
+                }
+            }
+            info->sample_rate = f.sample_rate;
+            info->channels = f.channels;
+            if (adts) {
+                info->codec = PLAYLIST_META_CODEC_AAC;
+                uint64_t total = 0;
+                uint32_t p = at;
+                int frames = 0;
+                while (frames < META_ADTS_FRAMES && p + 7 <= end && meta_read(ctx, p, h, 7) && adts_header(h, &next)) {
+                    total += next.frame_len;
+                    p += next.frame_len;
+                    frames++;
+                }
+                if (frames) {
+                    uint32_t avg = total / frames;
+                    info->bitrate = (uint64_t)avg * 8 * f.sample_rate / f.samples;
+                    info->duration_ms = ms_of((uint64_t)(end - at) / avg * f.samples, f.sample_rate);
+                    info->duration_estimated = (p < end);
+                }
+                return ESP_OK;
+            }
+            info->codec = PLAYLIST_META_CODEC_MP3;
+            uint32_t frames = 0, bytes = 0;
+            if (f.layer == 3 && mpa_vbr_frames(ctx, at, &f, &frames, &bytes)) {
+                uint64_t samples = (uint64_t)frames * f.samples;
+                info->duration_ms = ms_of(samples, f.sample_rate);
+                if (bytes == 0 || bytes > end - at) {
+                    bytes = end - at;
+                }
+                info->bitrate = info->duration_ms ? (uint64_t)bytes * 8000 / info->duration_ms : f.bitrate;
+            } else {
+                info->bitrate = f.bitrate;
+                info->duration_ms = (uint64_t)(end - at) * 8000 / f.bitrate;
+                info->duration_estimated = true;
+            }
+            return ESP_OK;
+        }
+        if (n < META_SCRATCH_SIZE) {
+            break;
+        }
+        pos += n - 6;
+    }
+    return ESP_FAIL;
+}
+
+/* ---------------------------------------------------------------- Vorbis comments */
+
+static void vorbis_comments(meta_ctx_t *ctx, const uint8_t *p, uint32_t len)
+{
+    if (len < 8) {
+        return;
+    }
+    uint32_t vendor = le32(p);
+    if (vendor > len - 8) {
+        return;
+    }
+    uint32_t off = 4 + vendor;
+    uint32_t count = le32(p + off);
+    off += 4;
+    while (count-- && off + 4 <= len) {
+        uint32_t n = le32(p + off);
+        off += 4;
+        if (n > len - off) {
+            /* The block was cut to the scratch size */
+            break;
+        }
+        const char *c = (const char *)p + off;
+        char *dst = NULL;
+        int key = 0;
+        if (n > 6 && !strncasecmp(c, "TITLE=", 6)) {
+            dst = ctx->info->title, key = 6;
+        } else if (n > 7 && !strncasecmp(c, "ARTIST=", 7)) {
+            dst = ctx->info->artist, key = 7;
+        } else if (n > 6 && !strncasecmp(c, "ALBUM=", 6)) {
+            dst = ctx->info->album, key = 6;
+        }
+        if (dst && dst[0] == 0) {
+            tag_set(dst, p + off + key, n - key, 3);
+        }
+        off += n;
+    }
+}
+
+/* ---------------------------------------------------------------- WAV */
+
+static esp_err_t wav_parse(meta_ctx_t *ctx)
+{
+    playlist_meta_info_t *info = ctx->info;
+    uint8_t *b = ctx->buf;
+    uint32_t pos = 12;
+    uint32_t byte_rate = 0, data_size = 0;
+    bool fmt = false;
+    while (meta_read(ctx, pos, b, 8)) {
+        uint32_t len = le32(b + 4);
+        uint32_t body = pos + 8;
+        if (!memcmp(b, "fmt ", 4) && len >= 16 && meta_read(ctx, body, b, 16)) {
+            info->channels = le16(b + 2);
+            info->sample_rate = le32(b + 4);
+            byte_rate = le32(b + 8);
+            fmt = true;
+        } else if (!memcmp(b, "data", 4)) {
+            /* Streamed recordings leave the size at 0 or 0xFFFFFFFF */
+            data_size = (len == 0 || len > ctx->src->size - body) ? ctx->src->size - body : len;
+        } else if (!memcmp(b, "LIST", 4) && len >= 4 && len <= META_SCRATCH_SIZE && meta_read(ctx, body, b, len)
+                   && !memcmp(b, "INFO", 4)) {
+            for (uint32_t off = 4; off + 8 <= len;) {
+                uint32_t n = le32(b + off + 4);
+                if (n > len - off - 8) {
+                    break;
+                }
+                char *dst = !memcmp(b + off, "INAM", 4) ? info->title : !memcmp(b + off, "IART", 4) ? info->artist
+                            : !memcmp(b + off, "IPRD", 4) ? info->album : NULL;
+                if (dst) {
+                    tag_set(dst, b + off + 8, n, 3);
+                }
+                off += 8 + n + (n & 1);
+            }
+        }
+        if (len > ctx->src->size - body) {
+            break;
+        }
+        pos = body + len + (len & 1);
+    }
+    if (!fmt) {
+        return ESP_FAIL;
+    }
+    info->codec = PLAYLIST_META_CODEC_WAV;
+    info->bitrate = byte_rate * 8;
+    if (byte_rate) {
+        info->duration_ms = (uint64_t)data_size * 1000 / byte_rate;
+    }
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------- FLAC */
+
+static esp_err_t flac_parse(meta_ctx_t *ctx, uint32_t pos)
+{
+    playlist_meta_info_t *info = ctx->info;
+    uint8_t *b = ctx->buf;
+    uint64_t samples = 0;
+    bool streaminfo = false;
+    pos += 4;
+    while (meta_read(ctx, pos, b, 4)) {
+        bool last = b[0] & 0x80;
+        int type = b[0] & 0x7F;
+        uint32_t len = (b[1] << 16) | (b[2] << 8) | b[3];
+        pos += 4;
+        if (type == 0 && len >= 34 && meta_read(ctx, pos, b, 34)) {
+            info->sample_rate = (b[10] << 12) | (b[11] << 4) | (b[12] >> 4);
+            info->channels = ((b[12] >> 1) & 7) + 1;
+            samples = ((uint64_t)(b[13] & 0x0F) << 32) | be32(b + 14);
+            streaminfo = true;
+        } else if (type == 4) {
+            uint32_t n = len > META_SCRATCH_SIZE ? META_SCRATCH_SIZE : len;
+            if (meta_read(ctx, pos, b, n)) {
+                vorbis_comments(ctx, b, n);
+            }
+        }
+        pos += len;
+        if (last) {
+            break;
+        }
+    }
+    if (!streaminfo) {
+        return ESP_FAIL;
+    }
+    info->codec = PLAYLIST_META_CODEC_FLAC;
+    info->duration_ms = ms_of(samples, info->sample_rate);
+    if (info->duration_ms && ctx->src->size > pos) {
+        info->bitrate = (uint64_t)(ctx->src->size - pos) * 8000 / info->duration_ms;
+    }
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------- Ogg */
+
+/* Copy the first two packets of the first logical stream to the scratch, the second one is cut to fit */
+static int ogg_packets(meta_ctx_t *ctx, uint32_t *serial, int *first_len)
+{
+    uint8_t hdr[27 + 255];
+    uint32_t pos = 0;
+    int len = 0, packets = 0;
+    *first_len = 0;
+    while (packets < 2 && meta_read(ctx, pos, hdr, 27) && !memcmp(hdr, "OggS", 4)) {
+        int segs = hdr[26];
+        if (!meta_read(ctx, pos + 27, hdr + 27, segs)) {
+            break;
+        }
+        if (pos == 0) {
+            *serial = le32(hdr + 14);
+        }
+        uint32_t body = pos + 27 + segs;
+        uint32_t page_len = 0;
+        for (int i = 0; i < segs; i++) {
+            page_len += hdr[27 + i];
+        }
+        if (le32(hdr + 14) == *serial) {
+            uint32_t off = body;
+            for (int i = 0; i < segs && packets < 2; i++) {
+                int seg = hdr[27 + i];
+                int n = (seg > META_SCRATCH_SIZE - len) ? META_SCRATCH_SIZE - len : seg;
+                if (n > 0 && !meta_read(ctx, off, ctx->buf + len, n)) {
+                    return -1;
+                }
+                len += n;
+                off += seg;
+                if (seg < 255) {
+                    if (++packets == 1) {
+                        *first_len = len;
+                    }
+                }
+            }
+        }
+        pos = body + page_len;
+    }
+    return packets == 2 ? len : -1;
+}
+
+static bool ogg_last_granule(meta_ctx_t *ctx, uint32_t serial, uint64_t *granule)
+{
+    uint32_t size = ctx->src->size;
+    uint32_t end = size;
+    uint32_t floor = size > META_OGG_TAIL_SEARCH ? size - META_OGG_TAIL_SEARCH : 0;
+    while (end > floor) {
+        uint32_t start = (end - floor > META_SCRATCH_SIZE) ? end - META_SCRATCH_SIZE : floor;
+        int n = end - start;
+        if (!meta_read(ctx, start, ctx->buf, n)) {
+            return false;
+        }
+        for (int i = n - 4; i >= 0; i--) {
+            if (memcmp(ctx->buf + i, "OggS", 4)) {
+                continue;
+            }
+            uint8_t h[27];
+            if (meta_read(ctx, start + i, h, 27) && le32(h + 14) == serial && le64(h + 6) != (uint64_t) -1) {
+                *granule = le64(h + 6);
+                return true;
+            }
+        }
+        if (start == floor) {
+            break;
+        }
+        /* Overlap so a capture pattern across the boundary is not missed */
+        end = start + 3;
+    }
+    return false;
+}
+
+static esp_err_t ogg_parse(meta_ctx_t *ctx)
+{
+    playlist_meta_info_t *info = ctx->info;
+    uint32_t serial = 0;
+    int first = 0;
+    int len = ogg_packets(ctx, &serial, &first);
+    if (len < 0) {
+        return ESP_FAIL;
+    }
+    uint8_t *b = ctx->buf;
+    uint32_t pre_skip = 0;
+    if (first >= 30 && !memcmp(b, "\x01vorbis", 7)) {
+        info->codec = PLAYLIST_META_CODEC_VORBIS;
+        info->channels = b[11];
+        info->sample_rate = le32(b + 12);
+        info->bitrate = le32(b + 20);
+        if (len - first > 7 && !memcmp(b + first, "\x03vorbis", 7)) {
+            vorbis_comments(ctx, b + first + 7, len - first - 7);
+        }
+    } else if (first >= 19 && !memcmp(b, "OpusHead", 8)) {
+        info->codec = PLAYLIST_META_CODEC_OPUS;
+        info->channels = b[9];
+        pre_skip = le16(b + 10);
+        /* Opus always decodes at 48 kHz, the header keeps the input rate for information only */
+        info->sample_rate = 48000;
+        if (len - first > 8 && !memcmp(b + first, "OpusTags", 8)) {
+            vorbis_comments(ctx, b + first + 8, len - first - 8);
+        }
+    } else {
+        return ESP_FAIL;
+    }
+    uint64_t granule = 0;
+    if (ogg_last_granule(ctx, serial, &granule) && granule > pre_skip) {
+        info->duration_ms = ms_of(granule - pre_skip, info->sample_rate);
+        if (info->duration_ms) {
+            info->bitrate = (uint64_t)ctx->src->size * 8000 / info->duration_ms;
+        }
+    }
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------- MP4 */
+
+static void mp4_walk(meta_ctx_t *ctx, uint32_t pos, uint32_t end, int depth, bool *found)
+{
+    playlist_meta_info_t *info = ctx->info;
+    uint8_t h[16];
+    while (pos + 8 <= end && depth < META_MP4_MAX_DEPTH) {
+        if (!meta_read(ctx, pos, h, 8)) {
+            return;
+        }
+        uint64_t len = be32(h);
+        uint32_t hdr = 8;
+        if (len == 1) {
+            if (!meta_read(ctx, pos + 8, h + 8, 8)) {
+                return;
+            }
+            len = be64(h + 8);
+            hdr = 16;
+        } else if (len == 0) {
+            len = end - pos;
+        }
+        if (len < hdr || len > end - pos) {
+            return;
+        }
+        uint32_t body = pos + hdr;
+        uint32_t body_end = pos + (uint32_t)len;
+        const char *type = (const char *)h + 4;
+        if (!memcmp(type, "moov", 4) || !memcmp(type, "trak", 4) || !memcmp(type, "mdia", 4)
+            || !memcmp(type, "minf", 4) || !memcmp(type, "stbl", 4) || !memcmp(type, "udta", 4)
+            || !memcmp(type, "ilst", 4)) {
+            mp4_walk(ctx, body, body_end, depth + 1, found);
+        } else if (!memcmp(type, "meta", 4)) {
+            uint8_t v[8];
+            /* ISO meta is a full box, QuickTime meta is not */
+            uint32_t skip = (meta_read(ctx, body, v, 8) && be32(v) == 0) ? 4 : 0;
+            mp4_walk(ctx, body + skip, body_end, depth + 1, found);
+        } else if (!memcmp(type, "mvhd", 4)) {
+            uint8_t *b = ctx->buf;
+            if (meta_read(ctx, body, b, 32)) {
+                uint32_t scale = b[0] == 1 ? be32(b + 20) : be32(b + 12);
+                uint64_t duration = b[0] == 1 ? be64(b + 24) : be32(b + 16);
+                if (scale) {
+                    info->duration_ms = duration * 1000 / scale;
+                }
+            }
+        } else if (!memcmp(type, "stsd", 4) && !*found) {
+            uint8_t *b = ctx->buf;
+            if (meta_read(ctx, body, b, 8 + 36) && (!memcmp(b + 12, "mp4a", 4) || !memcmp(b + 12, "alac", 4))) {
+                const uint8_t *entry = b + 8;
+                info->channels = be16(entry + 24);
+                info->sample_rate = be16(entry + 32);
+                *found = true;
+            }
+        } else if (type[0] == (char)0xA9) {
+            char *dst = !memcmp(type + 1, "nam", 3) ? info->title : !memcmp(type + 1, "ART", 3) ? info->artist
+                        : !memcmp(type + 1, "alb", 3) ? info->album : NULL;
+            uint8_t *b = ctx->buf;
+            uint32_t n = body_end - body;
+            if (n > 4 * PLAYLIST_META_TAG_LENGTH) {
+                n = 4 * PLAYLIST_META_TAG_LENGTH;
+            }
+            if (dst && n > 16 && meta_read(ctx, body, b, n) && !memcmp(b + 4, "data", 4)) {
+                uint32_t data_len = be32(b);
+                if (data_len > n) {
+                    data_len = n;
+                }
+                if (data_len > 16) {
+                    tag_set(dst, b + 16, data_len - 16, 3);
+                }
+            }
+        }
+        pos = body_end;
+    }
+}
+
+static esp_err_t mp4_parse(meta_ctx_t *ctx)
+{
+    bool found = false;
+    mp4_walk(ctx, 0, ctx->src->size, 0, &found);
+    if (!found) {
+        return ESP_FAIL;
+    }
+    ctx->info->codec = PLAYLIST_META_CODEC_M4A;
+    if (ctx->info->duration_ms) {
+        ctx->info->bitrate = (uint64_t)ctx->src->size * 8000 / ctx->info->duration_ms;
+    }
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------- */
+
+esp_err_t meta_parse(meta_source_t *src, playlist_meta_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, src && src->read, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_ERR_INVALID_ARG);
+    memset(info, 0, sizeof(playlist_meta_info_t));
+    meta_ctx_t ctx = {
+        .src = src,
+        .info = info,
+        .buf = audio_malloc(META_SCRATCH_SIZE),
+    };
+    AUDIO_MEM_CHECK(TAG, ctx.buf, return ESP_ERR_NO_MEM);
+
+    esp_err_t ret = ESP_FAIL;
+    uint8_t magic[12];
+    uint32_t start = id3v2_parse(&ctx);
+    if (meta_read(&ctx, start, magic, 12)) {
+        if (!memcmp(magic, "RIFF", 4) && !memcmp(magic + 8, "WAVE", 4)) {
+            ret = wav_parse(&ctx);
+        } else if (!memcmp(magic, "fLaC", 4)) {
+            ret = flac_parse(&ctx, start);
+        } else if (!memcmp(magic, "OggS", 4)) {
+            ret = ogg_parse(&ctx);
+        } else if (!memcmp(magic + 4, "ftyp", 4)) {
+            ret = mp4_parse(&ctx);
+        } else {
+            ret = mpa_parse(&ctx, start);
+            if (ret == ESP_OK) {
+                id3v1_parse(&ctx);
+            }
+        }
+    }
+    if (ret != ESP_OK) {
+        info->codec = PLAYLIST_META_CODEC_UNKNOWN;
+    }
+    audio_free(ctx.buf);
+    return ret;
+}
@@ -0,0 +1,64 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _PLAYLIST_META_PARSER_H_
+#define _PLAYLIST_META_PARSER_H_
+
+#include "esp_err.h"
+#include "playlist_meta.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Random access to the file being parsed
+ */
+typedef struct {
+    int         (*read)(void *ctx, uint32_t pos, void *buf, int len);   /*!< Read `len` bytes at `pos`, return the number of bytes read */
+    void        *ctx;                                                   /*!< Context of `read` */
+    uint32_t    size;                                                   /*!< File size */
+} meta_source_t;
+
+/**
+ * @brief Probe the format, duration and tags of an audio file from its headers
+ *
+ * @note  Only the container headers, the tags and the first frames are read, the end of the file is read
+ *        for ID3v1 and the last Ogg page. Durations of CBR MP3 without a Xing/Info header and of AAC ADTS
+ *        are estimated from the average frame size and flagged with `duration_estimated`.
+ *
+ * @param      src   The file
+ * @param[out] info  The metadata, cleared first
+ *
+ * @return
+ *     - ESP_OK    The format is recognized
+ *     - ESP_FAIL  Unknown format, `info->codec` is PLAYLIST_META_CODEC_UNKNOWN
+ */
+esp_err_t meta_parse(meta_source_t *src, playlist_meta_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PLAYLIST_META_PARSER_H_ */
@@ -0,0 +1,687 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2025 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "unistd.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "audio_mutex.h"
+#include "audio_thread.h"
+#include "playlist_meta.h"
+#include "meta_parser.h"
+
+#define META_FILE_PREV_NAME         "file:/"
+#define META_URL_MAX_LENGTH         (2048)          /* As long as the urls of the sdcard playlist */
+#define META_BLOCK_SIZE             (4096)
+#define META_SAVE_INTERVAL          (64)            /* New records between two saves of the index */
+#define META_IDLE_POLL_MS           (1000)          /* Check for new URLs this often once everything is indexed */
+#define META_HASH_INIT              (2166136261u)   /* FNV-1a offset basis */
+#define META_INDEX_MAGIC            (0x4D4C5050)    /* "PPLM" */
+#define META_INDEX_VERSION          (2)
+#define META_INDEX_HEAD             (sizeof(uint32_t) * 5)
+
+#define META_ID_NONE                (-1)            /* Not indexed yet */
+#define META_ID_SKIPPED             (-2)            /* Not a local file, or the file is gone */
+
+#define META_RUN_BIT                BIT0
+#define META_WAKE_BIT               BIT1
+#define META_STOP_BIT               BIT2
+#define META_EXIT_BIT               BIT3
+
+/* One probed file, the key is the path hash, size and mtime tell whether the file changed */
+typedef struct {
+    uint32_t    key;
+    uint32_t    size;
+    uint32_t    mtime;
+    uint32_t    duration_ms;
+    uint32_t    bitrate;
+    uint32_t    sample_rate;
+    uint32_t    str_off;        /* Path, title, artist and album back to back in the string arena */
+    uint8_t     tag_len[3];
+    uint8_t     codec;
+    uint8_t     channels;
+    uint8_t     estimated;
+    uint16_t    path_len;       /* The path tells records of the same key apart */
+} meta_record_t;
+
+/* Block cache in front of the file, throttled to `rate` bytes per second */
+typedef struct {
+    int         fd;
+    uint8_t    *block;
+    uint32_t    block_pos;
+    int         block_len;
+    int         rate;
+    int64_t     window_start;
+    uint32_t    window_bytes;
+} meta_reader_t;
+
+typedef struct playlist_meta {
+    playlist_handle_t       handle;
+    playlist_meta_cfg_t     cfg;
+    char                   *index_file;
+    void                   *lock;
+    EventGroupHandle_t      state;
+    meta_record_t          *records;
+    int                     record_num;
+    int                     record_cap;
+    char                   *strings;
+    uint32_t                string_len;
+    uint32_t                string_cap;
+    uint32_t                string_garbage; /* Bytes of the arena left by changed files */
+    uint32_t               *slots;          /* Open addressing on the key, record index + 1 */
+    int                     slot_num;
+    int32_t                *id_map;         /* url id -> record index, META_ID_NONE or META_ID_SKIPPED */
+    int                     id_cap;
+    int                     total;
+    int                     indexed;
+    uint64_t                duration_ms;
+    int                     cursor;
+    uint32_t                generation;
+    int                     unsaved;
+    meta_reader_t           reader;
+    char                    url[META_URL_MAX_LENGTH];
+} playlist_meta_t;
+
+static const char *TAG = "PLAYLIST_META";
+
+static uint32_t meta_hash(const void *data, int len, uint32_t hash)
+{
+    const uint8_t *p = data;
+    for (int i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void meta_throttle(meta_reader_t *r, int bytes)
+{
+    int64_t now = esp_timer_get_time();
+    if (now - r->window_start > 2000000) {
+        r->window_start = now;
+        r->window_bytes = 0;
+    }
+    r->window_bytes += bytes;
+    int64_t due = r->window_start + (int64_t)r->window_bytes * 1000000 / r->rate;
+    if (due > now) {
+        vTaskDelay((due - now) / 1000 / portTICK_PERIOD_MS + 1);
+    }
+}
+
+static int meta_reader_read(void *ctx, uint32_t pos, void *buf, int len)
+{
+    meta_reader_t *r = (meta_reader_t *)ctx;
+    int done = 0;
+    while (done < len) {
+        if (pos < r->block_pos || pos >= r->block_pos + r->block_len) {
+            // Whole aligned blocks, the card reads them in one go
+            r->block_pos = pos & ~(META_BLOCK_SIZE - 1);
+            r->block_len = 0;
+            if (lseek(r->fd, r->block_pos, SEEK_SET) < 0) {
+                break;
+            }
+            int rlen = read(r->fd, r->block, META_BLOCK_SIZE);
+            if (rlen <= 0) {
+                break;
+            }
+            r->block_len = rlen;
+            meta_throttle(r, rlen);
+            if (pos >= r->block_pos + r->block_len) {
+                break;
+            }
+        }
+        int n = r->block_pos + r->block_len - pos;
+        if (n > len - done) {
+            n = len - done;
+        }
+        memcpy((uint8_t *)buf + done, r->block + (pos - r->block_pos), n);
+        done += n;
+        pos += n;
+    }
+    return done;
+}
+
+static const char *meta_local_path(const char *url)
+{
+    if (strncmp(url, META_FILE_PREV_NAME, strlen(META_FILE_PREV_NAME)) == 0) {
+        url += strlen(META_FILE_PREV_NAME);
+    }
+    return url[0] == '/' ? url : NULL;
+}
+
+static esp_err_t meta_slots_rebuild(playlist_meta_t *meta, int slot_num)
+{
+    uint32_t *slots = audio_calloc(slot_num, sizeof(uint32_t));
+    AUDIO_MEM_CHECK(TAG, slots, return ESP_ERR_NO_MEM);
+    for (int i = 0; i < meta->record_num; i++) {
+        uint32_t slot = meta->records[i].key & (slot_num - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (slot_num - 1);
+        }
+        slots[slot] = i + 1;
+    }
+    audio_free(meta->slots);
+    meta->slots = slots;
+    meta->slot_num = slot_num;
+    return ESP_OK;
+}
+
+static inline uint32_t meta_record_str_len(const meta_record_t *rec)
+{
+    return rec->path_len + rec->tag_len[0] + rec->tag_len[1] + rec->tag_len[2];
+}
+
+static int meta_record_find(playlist_meta_t *meta, uint32_t key, const char *path, int path_len)
+{
+    if (meta->slots == NULL) {
+        return -1;
+    }
+    uint32_t slot = key & (meta->slot_num - 1);
+    while (meta->slots[slot]) {
+        meta_record_t *rec = &meta->records[meta->slots[slot] - 1];
+        if (rec->key == key && rec->path_len == path_len && memcmp(meta->strings + rec->str_off, path, path_len) == 0) {
+            return meta->slots[slot] - 1;
+        }
+        slot = (slot + 1) & (meta->slot_num - 1);
+    }
+    return -1;
+}
+
+/* Drop the strings of changed files from the arena, called with the lock held */
+static void meta_strings_compact(playlist_meta_t *meta)
+{
+    uint32_t cap = meta->string_len - meta->string_garbage;
+    char *strings = audio_malloc(cap ? cap : 1);
+    if (strings == NULL) {
+        return;
+    }
+    uint32_t len = 0;
+    for (int i = 0; i < meta->record_num; i++) {
+        meta_record_t *rec = &meta->records[i];
+        memcpy(strings + len, meta->strings + rec->str_off, meta_record_str_len(rec));
+        rec->str_off = len;
+        len += meta_record_str_len(rec);
+    }
+    audio_free(meta->strings);
+    meta->strings = strings;
+    meta->string_len = len;
+    meta->string_cap = cap ? cap : 1;
+    meta->string_garbage = 0;
+}
+
+/* Called with the lock held */
+static int meta_record_store(playlist_meta_t *meta, int idx, meta_record_t *rec, const char *path, const playlist_meta_info_t *info)
+{
+    const char *strs[4] = { path, info->title, info->artist, info->album };
+    uint32_t lens[4] = { rec->path_len };
+    uint32_t need = rec->path_len;
+    for (int i = 0; i < 3; i++) {
+        rec->tag_len[i] = strlen(strs[i + 1]);
+        lens[i + 1] = rec->tag_len[i];
+        need += rec->tag_len[i];
+    }
+    if (meta->string_len + need > meta->string_cap && meta->string_garbage > meta->string_len / 2) {
+        meta_strings_compact(meta);
+    }
+    if (meta->string_len + need > meta->string_cap) {
+        uint32_t cap = meta->string_cap ? meta->string_cap : 1024;
+        while (cap < meta->string_len + need) {
+            cap *= 2;
+        }
+        char *strings = audio_realloc(meta->strings, cap);
+        AUDIO_MEM_CHECK(TAG, strings, return -1);
+        meta->strings = strings;
+        meta->string_cap = cap;
+    }
+    rec->str_off = meta->string_len;
+    for (int i = 0; i < 4; i++) {
+        memcpy(meta->strings + meta->string_len, strs[i], lens[i]);
+        meta->string_len += lens[i];
+    }
+    if (idx >= 0) {
+        // The file changed, its old strings are dropped when the arena is compacted
+        meta->string_garbage += meta_record_str_len(&meta->records[idx]);
+        meta->records[idx] = *rec;
+        return idx;
+    }
+    if (meta->record_num == meta->record_cap) {
+        int cap = meta->record_cap ? meta->record_cap * 2 : 64;
+        meta_record_t *records = audio_realloc(meta->records, cap * sizeof(meta_record_t));
+        AUDIO_MEM_CHECK(TAG, records, {
+            meta->string_garbage += need;
+            return -1;
+        });
+        meta->records = records;
+        meta->record_cap = cap;
+    }
+    idx = meta->record_num++;
+    meta->records[idx] = *rec;
+    if (meta->record_num * 2 > meta->slot_num) {
+        if (meta_slots_rebuild(meta, meta->slot_num ? meta->slot_num * 2 : 128) != ESP_OK) {
+            meta->record_num--;
+            meta->string_garbage += need;
+            return -1;
+        }
+    } else {
+        uint32_t slot = rec->key & (meta->slot_num - 1);
+        while (meta->slots[slot]) {
+            slot = (slot + 1) & (meta->slot_num - 1);
+        }
+        meta->slots[slot] = idx + 1;
+    }
+    return idx;
+}
+
+static esp_err_t meta_index_load(playlist_meta_t *meta)
+{
+    FILE *f = fopen(meta->index_file, "rb");
+    if (f == NULL) {
+        ESP_LOGI(TAG, "No metadata index at %s", meta->index_file);
+        return ESP_FAIL;
+    }
+    uint32_t head[5] = { 0 };
+    bool ok = (fread(head, 1, sizeof(head), f) == sizeof(head) && head[0] == META_INDEX_MAGIC && head[1] == META_INDEX_VERSION);
+    if (ok && head[2]) {
+        meta->records = audio_malloc(head[2] * sizeof(meta_record_t));
+        meta->strings = audio_malloc(head[3] ? head[3] : 1);
+        ok = (meta->records && meta->strings
+              && fread(meta->records, 1, head[2] * sizeof(meta_record_t), f) == head[2] * sizeof(meta_record_t)
+              && fread(meta->strings, 1, head[3], f) == head[3]);
+        ok = ok && meta_hash(meta->strings, head[3], meta_hash(meta->records, head[2] * sizeof(meta_record_t), META_HASH_INIT)) == head[4];
+        // The tags are copied to fixed size fields, a record from a damaged or edited file must not overflow them
+        for (uint32_t i = 0; ok && i < head[2]; i++) {
+            meta_record_t *rec = &meta->records[i];
+            ok = (rec->str_off <= head[3] && meta_record_str_len(rec) <= head[3] - rec->str_off && rec->path_len < META_URL_MAX_LENGTH);
+            for (int t = 0; ok && t < 3; t++) {
+                ok = (rec->tag_len[t] < PLAYLIST_META_TAG_LENGTH);
+            }
+        }
+    }
+    fclose(f);
+    if (ok == false) {
+        ESP_LOGW(TAG, "Metadata index at %s is corrupted, index everything", meta->index_file);
+        AUDIO_SAFE_FREE(meta->records, audio_free);
+        AUDIO_SAFE_FREE(meta->strings, audio_free);
+        return ESP_FAIL;
+    }
+    meta->record_num = meta->record_cap = head[2];
+    meta->string_len = meta->string_cap = head[3];
+    int slot_num = 128;
+    while (slot_num < meta->record_num * 2) {
+        slot_num <<= 1;
+    }
+    if (meta->record_num && meta_slots_rebuild(meta, slot_num) != ESP_OK) {
+        meta->record_num = 0;
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Loaded %d metadata records from %s", meta->record_num, meta->index_file);
+    return ESP_OK;
+}
+
+/* Runs in the indexer task, or after it exited, the only writer of the records */
+static esp_err_t meta_index_save(playlist_meta_t *meta)
+{
+    if (meta->index_file == NULL) {
+        return ESP_OK;
+    }
+    // Once every URL was seen, records of files no longer in the playlist are dropped
+    uint8_t *keep = NULL;
+    if (meta->total > 0 && meta->cursor >= meta->total) {
+        keep = audio_calloc(1, meta->record_num ? meta->record_num : 1);
+        AUDIO_MEM_CHECK(TAG, keep, return ESP_ERR_NO_MEM);
+        for (int i = 0; i < meta->total; i++) {
+            if (meta->id_map[i] >= 0) {
+                keep[meta->id_map[i]] = 1;
+            }
+        }
+    }
+    char *tmp_name = audio_calloc(1, strlen(meta->index_file) + 5);
+    AUDIO_MEM_CHECK(TAG, tmp_name, {
+        audio_free(keep);
+        return ESP_ERR_NO_MEM;
+    });
+    sprintf(tmp_name, "%s.new", meta->index_file);
+    FILE *f = fopen(tmp_name, "wb");
+    if (f == NULL) {
+        ESP_LOGW(TAG, "Failed to create %s, the metadata index is not saved", tmp_name);
+        audio_free(keep);
+        audio_free(tmp_name);
+        return ESP_FAIL;
+    }
+    uint32_t head[5] = { META_INDEX_MAGIC, META_INDEX_VERSION, 0, 0, META_HASH_INIT };
+    bool ok = (fwrite(head, 1, sizeof(head), f) == sizeof(head));
+    // Records first, with the string offsets of the compacted arena
+    for (int i = 0; ok && i < meta->record_num; i++) {
+        if (keep && keep[i] == 0) {
+            continue;
+        }
+        meta_record_t rec = meta->records[i];
+        rec.str_off = head[3];
+        head[3] += meta_record_str_len(&rec);
+        head[2]++;
+        head[4] = meta_hash(&rec, sizeof(rec), head[4]);
+        ok = (fwrite(&rec, 1, sizeof(rec), f) == sizeof(rec));
+    }
+    for (int i = 0; ok && i < meta->record_num; i++) {
+        if (keep && keep[i] == 0) {
+            continue;
+        }
+        meta_record_t *rec = &meta->records[i];
+        int len = meta_record_str_len(rec);
+        head[4] = meta_hash(meta->strings + rec->str_off, len, head[4]);
+        ok = (fwrite(meta->strings + rec->str_off, 1, len, f) == (size_t)len);
+    }
+    ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(head, 1, sizeof(head), f) == sizeof(head);
+    ok &= (fclose(f) == 0);
+    remove(meta->index_file);
+    if (ok == false || rename(tmp_name, meta->index_file) != 0) {
+        ESP_LOGE(TAG, "Failed to save the metadata index %s", meta->index_file);
+        remove(tmp_name);
+    } else {
+        ESP_LOGD(TAG, "Saved %d metadata records to %s", head[2], meta->index_file);
+        meta->unsaved = 0;
+    }
+    audio_free(keep);
+    audio_free(tmp_name);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+/* Called with the lock held */
+static void meta_forget(playlist_meta_t *meta)
+{
+    for (int i = 0; i < meta->id_cap; i++) {
+        meta->id_map[i] = META_ID_NONE;
+    }
+    meta->indexed = 0;
+    meta->duration_ms = 0;
+    meta->cursor = 0;
+    meta->generation++;
+}
+
+static int meta_probe(playlist_meta_t *meta, const char *path, struct stat *st)
+{
+    int path_len = strlen(path);
+    meta_record_t rec = {
+        .key = meta_hash(path, path_len, META_HASH_INIT),
+        .size = st->st_size,
+        .mtime = st->st_mtime,
+        .path_len = path_len,
+    };
+    int idx = meta_record_find(meta, rec.key, path, path_len);
+    if (idx >= 0 && meta->records[idx].size == rec.size && meta->records[idx].mtime == rec.mtime) {
+        return idx;
+    }
+    playlist_meta_info_t info = { 0 };
+    meta->reader.fd = open(path, O_RDONLY);
+    if (meta->reader.fd < 0) {
+        ESP_LOGW(TAG, "Failed to open %s", path);
+        return META_ID_SKIPPED;
+    }
+    meta->reader.block_pos = 0;
+    meta->reader.block_len = 0;
+    meta_source_t src = {
+        .read = meta_reader_read,
+        .ctx = &meta->reader,
+        .size = rec.size,
+    };
+    // An unknown format is stored too, so the file is not read again
+    if (meta_parse(&src, &info) != ESP_OK) {
+        ESP_LOGD(TAG, "Unknown format %s", path);
+    }
+    close(meta->reader.fd);
+    meta->reader.fd = -1;
+    rec.codec = info.codec;
+    rec.duration_ms = info.duration_ms;
+    rec.bitrate = info.bitrate;
+    rec.sample_rate = info.sample_rate;
+    rec.channels = info.channels;
+    rec.estimated = info.duration_estimated;
+
+    mutex_lock(meta->lock);
+    idx = meta_record_store(meta, idx, &rec, path, &info);
+    mutex_unlock(meta->lock);
+    meta->unsaved++;
+    return idx < 0 ? META_ID_SKIPPED : idx;
+}
+
+/* Index the next URL, return false when there is nothing left to do */
+static bool meta_index_next(playlist_meta_t *meta)
+{
+    int total = playlist_get_list_url_num(meta->handle, meta->cfg.list_id);
+    if (total < 0) {
+        return false;
+    }
+    mutex_lock(meta->lock);
+    if (total < meta->total) {
+        // URLs were removed or the list was reset, the ids no longer match
+        meta_forget(meta);
+    }
+    if (total > meta->id_cap) {
+        int32_t *id_map = audio_realloc(meta->id_map, total * sizeof(int32_t));
+        AUDIO_MEM_CHECK(TAG, id_map, {
+            mutex_unlock(meta->lock);
+            return false;
+        });
+        for (int i = meta->id_cap; i < total; i++) {
+            id_map[i] = META_ID_NONE;
+        }
+        meta->id_map = id_map;
+        meta->id_cap = total;
+    }
+    meta->total = total;
+    while (meta->cursor < total && meta->id_map[meta->cursor] != META_ID_NONE) {
+        meta->cursor++;
+    }
+    int url_id = meta->cursor;
+    uint32_t generation = meta->generation;
+    mutex_unlock(meta->lock);
+    if (url_id >= total) {
+        return false;
+    }
+
+    int idx = META_ID_SKIPPED;
+    struct stat st;
+    if (playlist_get_list_url(meta->handle, meta->cfg.list_id, url_id, meta->url, sizeof(meta->url)) == ESP_OK) {
+        const char *path = meta_local_path(meta->url);
+        if (path && stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            idx = meta_probe(meta, path, &st);
+        }
+    } else {
+        ESP_LOGW(TAG, "Failed to get url %d, or it is longer than %d bytes, skip it", url_id, META_URL_MAX_LENGTH - 1);
+    }
+
+    mutex_lock(meta->lock);
+    if (generation == meta->generation && url_id < meta->total) {
+        meta->id_map[url_id] = idx;
+        meta->indexed++;
+        if (idx >= 0) {
+            meta->duration_ms += meta->records[idx].duration_ms;
+        }
+    }
+    mutex_unlock(meta->lock);
+    if (meta->unsaved >= META_SAVE_INTERVAL) {
+        meta_index_save(meta);
+    }
+    return true;
+}
+
+static void meta_task(void *pv)
+{
+    playlist_meta_t *meta = (playlist_meta_t *)pv;
+    ESP_LOGI(TAG, "Metadata indexer started on list %d", meta->cfg.list_id);
+    while (1) {
+        EventBits_t bits = xEventGroupWaitBits(meta->state, META_RUN_BIT | META_STOP_BIT, false, false, portMAX_DELAY);
+        if (bits & META_STOP_BIT) {
+            break;
+        }
+        if (meta_index_next(meta)) {
+            continue;
+        }
+        if (meta->unsaved) {
+            meta_index_save(meta);
+        }
+        xEventGroupWaitBits(meta->state, META_WAKE_BIT | META_STOP_BIT, false, false, META_IDLE_POLL_MS / portTICK_PERIOD_MS);
+        xEventGroupClearBits(meta->state, META_WAKE_BIT);
+    }
+    xEventGroupSetBits(meta->state, META_EXIT_BIT);
+    vTaskDelete(NULL);
+}
+
+playlist_meta_handle_t playlist_meta_create(playlist_handle_t handle, playlist_meta_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return NULL);
+    AUDIO_NULL_CHECK(TAG, cfg, return NULL);
+    AUDIO_CHECK(TAG, cfg->read_rate > 0, return NULL, "The read rate must be positive");
+    playlist_meta_t *meta = audio_calloc(1, sizeof(playlist_meta_t));
+    AUDIO_MEM_CHECK(TAG, meta, return NULL);
+    meta->handle = handle;
+    meta->cfg = *cfg;
+    meta->cfg.index_file = NULL;
+    meta->reader.fd = -1;
+    meta->reader.rate = cfg->read_rate;
+    meta->reader.block = audio_malloc(META_BLOCK_SIZE);
+    meta->lock = mutex_create();
+    meta->state = xEventGroupCreate();
+    if (cfg->index_file) {
+        meta->index_file = audio_strdup(cfg->index_file);
+    }
+    AUDIO_MEM_CHECK(TAG, meta->reader.block && meta->lock && meta->state && (cfg->index_file == NULL || meta->index_file), goto _meta_failed);
+    if (meta->index_file) {
+        meta_index_load(meta);
+    }
+    xEventGroupSetBits(meta->state, META_RUN_BIT);
+    if (audio_thread_create(NULL, "playlist_meta", meta_task, meta, cfg->task_stack,
+                            cfg->task_prio, cfg->stack_in_ext, cfg->task_core) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create the metadata indexer task");
+        goto _meta_failed;
+    }
+    return meta;
+
+_meta_failed:
+    audio_free(meta->reader.block);
+    audio_free(meta->index_file);
+    audio_free(meta->records);
+    audio_free(meta->strings);
+    audio_free(meta->slots);
+    AUDIO_SAFE_FREE(meta->lock, mutex_destroy);
+    AUDIO_SAFE_FREE(meta->state, vEventGroupDelete);
+    audio_free(meta);
+    return NULL;
+}
+
+esp_err_t playlist_meta_get(playlist_meta_handle_t meta, int url_id, playlist_meta_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, meta, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_ERR_INVALID_ARG);
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    mutex_lock(meta->lock);
+    if (url_id >= 0 && url_id < meta->total && meta->id_map[url_id] >= 0) {
+        meta_record_t *rec = &meta->records[meta->id_map[url_id]];
+        char *tags[3] = { info->title, info->artist, info->album };
+        uint32_t off = rec->str_off + rec->path_len;
+        memset(info, 0, sizeof(playlist_meta_info_t));
+        info->codec = rec->codec;
+        info->duration_ms = rec->duration_ms;
+        info->duration_estimated = rec->estimated;
+        info->bitrate = rec->bitrate;
+        info->sample_rate = rec->sample_rate;
+        info->channels = rec->channels;
+        for (int i = 0; i < 3; i++) {
+            memcpy(tags[i], meta->strings + off, rec->tag_len[i]);
+            off += rec->tag_len[i];
+        }
+        ret = ESP_OK;
+    }
+    mutex_unlock(meta->lock);
+    return ret;
+}
+
+esp_err_t playlist_meta_get_summary(playlist_meta_handle_t meta, int *indexed, int *total, uint64_t *duration_ms)
+{
+    AUDIO_NULL_CHECK(TAG, meta, return ESP_ERR_INVALID_ARG);
+    mutex_lock(meta->lock);
+    if (indexed) {
+        *indexed = meta->indexed;
+    }
+    if (total) {
+        *total = meta->total;
+    }
+    if (duration_ms) {
+        *duration_ms = meta->duration_ms;
+    }
+    mutex_unlock(meta->lock);
+    return ESP_OK;
+}
+
+esp_err_t playlist_meta_refresh(playlist_meta_handle_t meta)
+{
+    AUDIO_NULL_CHECK(TAG, meta, return ESP_ERR_INVALID_ARG);
+    mutex_lock(meta->lock);
+    meta_forget(meta);
+    meta->total = 0;
+    mutex_unlock(meta->lock);
+    xEventGroupSetBits(meta->state, META_WAKE_BIT);
+    return ESP_OK;
+}
+
+esp_err_t playlist_meta_pause(playlist_meta_handle_t meta, bool pause)
+{
+    AUDIO_NULL_CHECK(TAG, meta, return ESP_ERR_INVALID_ARG);
+    if (pause) {
+        xEventGroupClearBits(meta->state, META_RUN_BIT);
+    } else {
+        xEventGroupSetBits(meta->state, META_RUN_BIT | META_WAKE_BIT);
+    }
+    return ESP_OK;
+}
+
+esp_err_t playlist_meta_destroy(playlist_meta_handle_t meta)
+{
+    AUDIO_NULL_CHECK(TAG, meta, return ESP_ERR_INVALID_ARG);
+    xEventGroupSetBits(meta->state, META_STOP_BIT);
+    xEventGroupWaitBits(meta->state, META_EXIT_BIT, false, true, portMAX_DELAY);
+    if (meta->unsaved) {
+        meta_index_save(meta);
+    }
+    ESP_LOGI(TAG, "Metadata indexer stopped, %d of %d URLs indexed", meta->indexed, meta->total);
+    audio_free(meta->reader.block);
+    audio_free(meta->index_file);
+    audio_free(meta->records);
+    audio_free(meta->strings);
+    audio_free(meta->slots);
+    audio_free(meta->id_map);
+    mutex_destroy(meta->lock);
+    vEventGroupDelete(meta->state);
+    audio_free(meta);
+    return ESP_OK;
+}
@@ -23,33 +23,186 @@
  */
 
 #include <string.h>
-#include "sys/queue.h"
 #include "audio_error.h"
 #include "audio_mem.h"
 #include "dram_list.h"
 
+#define DRAM_LIST_CHUNK_MIN         (256)
+#define DRAM_LIST_CHUNK_MAX         (4096)
+#define DRAM_LIST_INDEX_MIN         (16)
+#define DRAM_LIST_URL_MAX_NUM       (UINT16_MAX - 1)
+#define DRAM_LIST_HASH_INIT         (2166136261u)   /* FNV-1a offset basis */
+
 static const char *TAG = "DRAM_LIST";
 
 /**
- * @brief List node save URL
+ * @brief Block of the string arena, URLs are packed back to back and never move until a compaction
  */
-typedef struct url_info {
-    char *url_name;                /*!< URL string */
-    int   url_id;
-    TAILQ_ENTRY(url_info) entries; /*!< list node */
-} url_info_t;
+typedef struct dram_list_chunk {
+    struct dram_list_chunk *next;   /*!< Older chunk */
+    uint32_t                size;   /*!< Capacity of `data` */
+    uint32_t                used;   /*!< Bytes used in `data` */
+    char                    data[]; /*!< URLs with their terminating zero */
+} dram_list_chunk_t;
 
 /**
  * @brief Dram list management unit
  */
 typedef struct dram_list {
-    uint16_t url_num;                         /*!< Number of URLs in dram playlist */
-    url_info_t *cur_node;                     /*!< Current node of URL on dram list */
-    TAILQ_HEAD(info, url_info) url_info_list; /*!< List of URL nodes */
+    uint16_t            url_num;    /*!< Number of URLs in dram playlist */
+    int                 cur_id;     /*!< Id of the current URL */
+    char              **urls;       /*!< URLs by id, pointing into the chunks */
+    int                 url_cap;    /*!< Capacity of `urls` */
+    uint16_t           *slots;      /*!< Open addressing hash of the URLs, url id + 1, 0 is empty */
+    int                 slot_num;   /*!< Number of slots, a power of two */
+    dram_list_chunk_t  *chunks;     /*!< Newest chunk first, new URLs are appended to it */
+    uint32_t            live_bytes; /*!< Bytes of the URLs in the list */
+    uint32_t            dead_bytes; /*!< Bytes of removed URLs still in the chunks */
 } dram_list_t;
 
 esp_err_t dram_list_get_operation(playlist_operation_t *operation);
 
+static uint32_t dram_list_hash(const char *url)
+{
+    uint32_t hash = DRAM_LIST_HASH_INIT;
+    while (*url) {
+        hash = (hash ^ (uint8_t)*url++) * 16777619u;
+    }
+    return hash;
+}
+
+static void dram_list_free_chunks(dram_list_t *playlist)
+{
+    while (playlist->chunks) {
+        dram_list_chunk_t *next = playlist->chunks->next;
+        audio_free(playlist->chunks);
+        playlist->chunks = next;
+    }
+    playlist->live_bytes = 0;
+    playlist->dead_bytes = 0;
+}
+
+static char *dram_list_alloc_string(dram_list_t *playlist, size_t len)
+{
+    dram_list_chunk_t *chunk = playlist->chunks;
+    if (chunk == NULL || chunk->size - chunk->used < len) {
+        // Chunks grow with the list, so short lists stay small and long ones need few allocations
+        uint32_t size = chunk ? chunk->size * 2 : DRAM_LIST_CHUNK_MIN;
+        if (size > DRAM_LIST_CHUNK_MAX) {
+            size = DRAM_LIST_CHUNK_MAX;
+        }
+        if (size < len) {
+            size = len;
+        }
+        chunk = (dram_list_chunk_t *)audio_malloc(sizeof(dram_list_chunk_t) + size);
+        AUDIO_MEM_CHECK(TAG, chunk, return NULL);
+        chunk->size = size;
+        chunk->used = 0;
+        chunk->next = playlist->chunks;
+        playlist->chunks = chunk;
+    }
+    char *str = chunk->data + chunk->used;
+    chunk->used += len;
+    playlist->live_bytes += len;
+    return str;
+}
+
+static void dram_list_hash_insert(dram_list_t *playlist, int url_id)
+{
+    uint32_t slot = dram_list_hash(playlist->urls[url_id]) & (playlist->slot_num - 1);
+    while (playlist->slots[slot]) {
+        slot = (slot + 1) & (playlist->slot_num - 1);
+    }
+    playlist->slots[slot] = url_id + 1;
+}
+
+static esp_err_t dram_list_hash_rebuild(dram_list_t *playlist, int slot_num)
+{
+    if (slot_num != playlist->slot_num) {
+        uint16_t *slots = (uint16_t *)audio_calloc(slot_num, sizeof(uint16_t));
+        AUDIO_MEM_CHECK(TAG, slots, return ESP_FAIL);
+        audio_free(playlist->slots);
+        playlist->slots = slots;
+        playlist->slot_num = slot_num;
+    } else {
+        memset(playlist->slots, 0, slot_num * sizeof(uint16_t));
+    }
+    for (int i = 0; i < playlist->url_num; i++) {
+        dram_list_hash_insert(playlist, i);
+    }
+    return ESP_OK;
+}
+
+static int dram_list_find(dram_list_t *playlist, const char *url)
+{
+    if (playlist->slots == NULL) {
+        return -1;
+    }
+    uint32_t slot = dram_list_hash(url) & (playlist->slot_num - 1);
+    while (playlist->slots[slot]) {
+        int url_id = playlist->slots[slot] - 1;
+        if (strcmp(playlist->urls[url_id], url) == 0) {
+            return url_id;
+        }
+        slot = (slot + 1) & (playlist->slot_num - 1);
+    }
+    return -1;
+}
+
+/* Copy the remaining URLs to one fresh chunk once removals wasted more than they keep */
+static void dram_list_compact(dram_list_t *playlist)
+{
+    if (playlist->dead_bytes <= playlist->live_bytes) {
+        return;
+    }
+    dram_list_chunk_t *old = playlist->chunks;
+    uint32_t live = playlist->live_bytes;
+    playlist->chunks = NULL;
+    playlist->live_bytes = 0;
+    playlist->dead_bytes = 0;
+    if (live) {
+        dram_list_chunk_t *chunk = (dram_list_chunk_t *)audio_malloc(sizeof(dram_list_chunk_t) + live);
+        if (chunk == NULL) {
+            ESP_LOGW(TAG, "No memory to compact the list, keep the old chunks");
+            playlist->chunks = old;
+            playlist->live_bytes = live;
+            return;
+        }
+        chunk->size = live;
+        chunk->used = 0;
+        chunk->next = NULL;
+        for (int i = 0; i < playlist->url_num; i++) {
+            size_t len = strlen(playlist->urls[i]) + 1;
+            memcpy(chunk->data + chunk->used, playlist->urls[i], len);
+            playlist->urls[i] = chunk->data + chunk->used;
+            chunk->used += len;
+        }
+        playlist->chunks = chunk;
+        playlist->live_bytes = live;
+    }
+    while (old) {
+        dram_list_chunk_t *next = old->next;
+        audio_free(old);
+        old = next;
+    }
+}
+
+static esp_err_t dram_list_remove(dram_list_t *playlist, int url_id)
+{
+    playlist->live_bytes -= strlen(playlist->urls[url_id]) + 1;
+    playlist->dead_bytes += strlen(playlist->urls[url_id]) + 1;
+    memmove(&playlist->urls[url_id], &playlist->urls[url_id + 1], (playlist->url_num - url_id - 1) * sizeof(char *));
+    playlist->url_num--;
+    // The current URL keeps its place, or moves to the one that follows the removed one
+    if (playlist->cur_id > url_id) {
+        playlist->cur_id--;
+    }
+    if (playlist->cur_id >= playlist->url_num) {
+        playlist->cur_id = 0;
+    }
+    return ESP_OK;
+}
+
 esp_err_t dram_list_create(playlist_operator_handle_t *handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
@@ -65,7 +218,6 @@ esp_err_t dram_list_create(playlist_operator_handle_t *handle)
     dram_handle->playlist = dram_list;
     dram_handle->get_operation = dram_list_get_operation;
 
-    TAILQ_INIT(&dram_list->url_info_list);
     *handle = dram_handle;
     return ESP_OK;
 }
@@ -78,27 +230,31 @@ esp_err_t dram_list_save(playlist_operator_handle_t handle, const char *url)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *list_node = (url_info_t *)audio_calloc(1, sizeof(url_info_t));
-    AUDIO_NULL_CHECK(TAG, list_node, return ESP_FAIL);
-    list_node->url_name = (char *)audio_calloc(1, url_len + 1);
-    list_node->url_id = playlist->url_num;
-    AUDIO_NULL_CHECK(TAG, list_node->url_name, {
-        audio_free(list_node);
-        list_node = NULL;
+    if (playlist->url_num >= DRAM_LIST_URL_MAX_NUM) {
+        ESP_LOGE(TAG, "The dram playlist is full");
         return ESP_FAIL;
-    });
-#if defined(__GNUC__) && (__GNUC__ >= 6)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstringop-truncation"
-    strncpy(list_node->url_name, url, url_len); // causes compilation warning although the extra byte is accounted for in the calloc
-#pragma GCC diagnostic pop
-#endif
-    TAILQ_INSERT_TAIL(&playlist->url_info_list, list_node, entries);
-
-    if (NULL == playlist->cur_node) {
+    }
+    if (playlist->url_num == playlist->url_cap) {
+        int cap = playlist->url_cap ? playlist->url_cap * 2 : DRAM_LIST_INDEX_MIN;
+        char **urls = (char **)audio_realloc(playlist->urls, cap * sizeof(char *));
+        AUDIO_MEM_CHECK(TAG, urls, return ESP_FAIL);
+        playlist->urls = urls;
+        playlist->url_cap = cap;
+    }
+    if ((playlist->url_num + 1) * 2 > playlist->slot_num) {
+        int slot_num = playlist->slot_num ? playlist->slot_num * 2 : DRAM_LIST_INDEX_MIN * 2;
+        AUDIO_CHECK(TAG, dram_list_hash_rebuild(playlist, slot_num) == ESP_OK, return ESP_FAIL, "No memory for the url hash");
+    }
+    char *str = dram_list_alloc_string(playlist, url_len + 1);
+    AUDIO_NULL_CHECK(TAG, str, return ESP_FAIL);
+    memcpy(str, url, url_len + 1);
+
+    if (playlist->url_num == 0) {
         ESP_LOGD(TAG, "Set the first url as the default url");
-        playlist->cur_node = list_node;
+        playlist->cur_id = 0;
     }
+    playlist->urls[playlist->url_num] = str;
+    dram_list_hash_insert(playlist, playlist->url_num);
     playlist->url_num ++;
     return ESP_OK;
 }
@@ -119,16 +275,8 @@ esp_err_t dram_list_next(playlist_operator_handle_t handle, int step, char **url
         return ESP_FAIL;
     }
 
-    url_info_t *tmp = playlist->cur_node;
-    for (int i = 0; i < step; i++) {
-        tmp = TAILQ_NEXT(playlist->cur_node, entries);
-        if (tmp == NULL) {
-            ESP_LOGD(TAG, "Already the last url of the playlist");
-            tmp = TAILQ_FIRST(&playlist->url_info_list);
-        }
-        playlist->cur_node = tmp;
-    }
-    *url_buff = tmp->url_name;
+    playlist->cur_id = (playlist->cur_id + step) % playlist->url_num;
+    *url_buff = playlist->urls[playlist->cur_id];
 
     return ESP_OK;
 }
@@ -149,16 +297,9 @@ esp_err_t dram_list_prev(playlist_operator_handle_t handle, int step, char **url
         return ESP_FAIL;
     }
 
-    url_info_t *tmp = playlist->cur_node;
-    for (int i = 0; i < step; i++) {
-        tmp = TAILQ_PREV(playlist->cur_node, info, entries);
-        if (tmp == NULL) {
-            ESP_LOGD(TAG, "Already the first url of the playlist");
-            tmp = TAILQ_LAST(&playlist->url_info_list, info);
-        }
-        playlist->cur_node = tmp;
-    }
-    *url_buff = tmp->url_name;
+    step %= playlist->url_num;
+    playlist->cur_id = (playlist->cur_id + playlist->url_num - step) % playlist->url_num;
+    *url_buff = playlist->urls[playlist->cur_id];
 
     return ESP_OK;
 }
@@ -175,8 +316,7 @@ esp_err_t dram_list_current(playlist_operator_handle_t handle, char **url_buff)
         return ESP_FAIL;
     }
 
-    url_info_t *cur_node = playlist->cur_node;
-    *url_buff = cur_node->url_name;
+    *url_buff = playlist->urls[playlist->cur_id];
     return ESP_OK;
 }
 
@@ -195,9 +335,27 @@ esp_err_t dram_list_choose(playlist_operator_handle_t handle, int url_id, char *
         ESP_LOGE(TAG, "Invalid url id to be choosen");
         return ESP_FAIL;
     }
-    // rewind pointer
-    playlist->cur_node = TAILQ_FIRST(&playlist->url_info_list);
-    return dram_list_next(handle, url_id, url_buff);
+    playlist->cur_id = url_id;
+    *url_buff = playlist->urls[url_id];
+    return ESP_OK;
+}
+
+esp_err_t dram_list_get_url(playlist_operator_handle_t handle, int url_id, char *url_buff, int size)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
+    dram_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    if ((url_id < 0) || (url_id >= playlist->url_num)) {
+        ESP_LOGE(TAG, "Invalid url id to be choosen");
+        return ESP_FAIL;
+    }
+    if (strlen(playlist->urls[url_id]) >= size) {
+        return ESP_FAIL;
+    }
+    strcpy(url_buff, playlist->urls[url_id]);
+    return ESP_OK;
 }
 
 esp_err_t dram_list_show(playlist_operator_handle_t handle)
@@ -206,9 +364,8 @@ esp_err_t dram_list_show(playlist_operator_handle_t handle)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        ESP_LOGI(TAG, "URL: %s", item->url_name);
+    for (int i = 0; i < playlist->url_num; i++) {
+        ESP_LOGI(TAG, "URL: %s", playlist->urls[i]);
     }
     return ESP_OK;
 }
@@ -216,19 +373,11 @@ esp_err_t dram_list_show(playlist_operator_handle_t handle)
 bool dram_list_exist(playlist_operator_handle_t handle, const char *url)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url, return false);
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        if (strlen(url) != strlen(item->url_name)) {
-            continue;
-        }
-        if (strcmp(item->url_name, url) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return dram_list_find(playlist, url) >= 0;
 }
 
 esp_err_t dram_list_reset(playlist_operator_handle_t handle)
@@ -237,15 +386,12 @@ esp_err_t dram_list_reset(playlist_operator_handle_t handle)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        audio_free(item->url_name);
-        item->url_name = NULL;
-        TAILQ_REMOVE(&playlist->url_info_list, item, entries);
-        audio_free(item);
-        item = NULL;
+    dram_list_free_chunks(playlist);
+    if (playlist->slots) {
+        memset(playlist->slots, 0, playlist->slot_num * sizeof(uint16_t));
     }
     playlist->url_num = 0;
+    playlist->cur_id = 0;
     return ESP_OK;
 }
 
@@ -269,42 +415,29 @@ int dram_list_get_url_id(playlist_operator_handle_t handle)
         return ESP_FAIL;
     }
 
-    url_info_t *cur_node = playlist->cur_node;
-    return cur_node->url_id;
+    return playlist->cur_id;
 }
 
 esp_err_t dram_list_remove_by_url(playlist_operator_handle_t handle, const char *url)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
-    bool _find_flag = false;
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        if (strlen(url) != strlen(item->url_name)) {
-            continue;
-        }
-        if (strcmp(url, item->url_name) == 0) {
-            audio_free(item->url_name);
-            item->url_name = NULL;
-            TAILQ_REMOVE(&playlist->url_info_list, item, entries);
-            audio_free(item);
-            item = NULL;
-            playlist->url_num--;
-            _find_flag = true;
-            continue;
-        }
-        if (_find_flag) {
-            item->url_id--;
-        }
-    }
-    if (_find_flag) {
-        return ESP_OK;
-    } else {
+    int url_id = dram_list_find(playlist, url);
+    if (url_id < 0) {
         ESP_LOGE(TAG, "Cannot find the url, fail to remove");
         return ESP_ERR_NOT_FOUND;
     }
+    // Every copy of the url is removed
+    for (int i = playlist->url_num - 1; i >= url_id; i--) {
+        if (strcmp(playlist->urls[i], url) == 0) {
+            dram_list_remove(playlist, i);
+        }
+    }
+    dram_list_compact(playlist);
+    return dram_list_hash_rebuild(playlist, playlist->slot_num);
 }
 
 esp_err_t dram_list_remove_by_url_id(playlist_operator_handle_t handle, uint16_t url_id)
@@ -312,30 +445,14 @@ esp_err_t dram_list_remove_by_url_id(playlist_operator_handle_t handle, uint16_t
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
-    bool _find_flag = false;
-
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        if (item->url_id == url_id) {
-            audio_free(item->url_name);
-            item->url_name = NULL;
-            TAILQ_REMOVE(&playlist->url_info_list, item, entries);
-            audio_free(item);
-            item = NULL;
-            playlist->url_num--;
-            _find_flag = true;
-            continue;
-        }
-        if (_find_flag) {
-            item->url_id--;
-        }
-    }
-    if (_find_flag) {
-        return ESP_OK;
-    } else {
+
+    if (url_id >= playlist->url_num) {
         ESP_LOGE(TAG, "Cannot find the url id, fail to remove");
         return ESP_ERR_NOT_FOUND;
     }
+    dram_list_remove(playlist, url_id);
+    dram_list_compact(playlist);
+    return dram_list_hash_rebuild(playlist, playlist->slot_num);
 }
 
 esp_err_t dram_list_destroy(playlist_operator_handle_t handle)
@@ -344,14 +461,9 @@ esp_err_t dram_list_destroy(playlist_operator_handle_t handle)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        audio_free(item->url_name);
-        item->url_name = NULL;
-        TAILQ_REMOVE(&playlist->url_info_list, item, entries);
-        audio_free(item);
-        item = NULL;
-    }
+    dram_list_free_chunks(playlist);
+    audio_free(playlist->urls);
+    audio_free(playlist->slots);
     audio_free(playlist);
     handle->playlist = NULL;
     audio_free(handle);
@@ -372,6 +484,7 @@ esp_err_t dram_list_get_operation(playlist_operation_t *operation)
     operation->choose  = (void *)dram_list_choose;
     operation->get_url_num = (void *)dram_list_get_url_num;
     operation->get_url_id  = (void *)dram_list_get_url_id;
+    operation->get_url     = (void *)dram_list_get_url;
     operation->remove_by_url = (void *)dram_list_remove_by_url;
     operation->remove_by_id  = (void *)dram_list_remove_by_url_id;
     operation->type = PLAYLIST_DRAM;
@@ -251,6 +251,25 @@ esp_err_t flash_list_choose(playlist_operator_handle_t handle, int url_id, char
     return flash_list_choose_id(playlist, url_id, url_buff);
 }
 
+esp_err_t flash_list_get_url(playlist_operator_handle_t handle, int url_id, char *url_buff, int size)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
+    flash_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    if ((url_id < 0) || (url_id >= playlist->url_num)) {
+        ESP_LOGE(TAG, "Invalid url id to be choosen");
+        return ESP_FAIL;
+    }
+    size_t len = size;
+    if (nvs_get_str(playlist->url_nvs_handle, (const char *)&url_id, url_buff, &len) != ESP_OK) {
+        ESP_LOGE(TAG, "Flash list get url id failed");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 esp_err_t flash_list_reset(playlist_operator_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
@@ -344,6 +363,7 @@ esp_err_t flash_list_get_operation(playlist_operation_t *operation)
     operation->destroy = (void *)flash_list_destroy;
     operation->get_url_num = (void *)flash_list_get_url_num;
     operation->get_url_id  = (void *)flash_list_get_url_id;
+    operation->get_url     = (void *)flash_list_get_url;
     operation->type = PLAYLIST_FLASH;
     return ESP_OK;
 }
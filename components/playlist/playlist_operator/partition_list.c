@@ -22,6 +22,7 @@
  *
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include "esp_partition.h"
 #include "audio_mem.h"
@@ -33,48 +34,633 @@
 #define DEFAULT_PARTITION_OFFSET_SUB_TYPE    0x07
 
 #define PARTITION_LIST_URL_MAX_LENGTH        2048
+#define PARTITION_LIST_URL_MAX_NUM           (UINT16_MAX)
+#define PARTITION_LIST_SECTOR_SIZE           (4096)
+#define PARTITION_LIST_COMPACT_MIN           (4 * PARTITION_LIST_SECTOR_SIZE)
+#define PARTITION_LIST_HASH_INIT             (2166136261u)   /* FNV-1a offset basis */
+
+/*
+ * Both partitions hold a log, only the one with the valid header of the highest sequence is in use,
+ * the other one receives the live records when the log is compacted.
+ *
+ * Header:  magic, version, sequence, check                                    16 bytes
+ * Record:  type u8, reserved u8, payload length u16, check u32, payload padded to 4 bytes
+ *
+ * The check of a record is seeded with the sequence, so records left from an older log never match.
+ * URL and DELETE records take effect at the next COMMIT, an ABORT drops the ones since the last COMMIT.
+ */
+#define PARTITION_LIST_LOG_MAGIC             (0x474F4C50)    /* "PLOG" */
+#define PARTITION_LIST_LOG_VERSION           (1)
+#define PARTITION_LIST_LOG_HEAD              (16)
+#define PARTITION_LIST_RECORD_HEAD           (8)
+#define PARTITION_LIST_RECORD_SIZE(len)      (PARTITION_LIST_RECORD_HEAD + (((len) + 3) & ~3))
+#define PARTITION_LIST_RECORD_URL            (0x01)    /* Payload: the URL */
+#define PARTITION_LIST_RECORD_DELETE         (0x02)    /* Payload: offset of the deleted URL record */
+#define PARTITION_LIST_RECORD_COMMIT         (0x03)    /* Payload: number of URLs */
+#define PARTITION_LIST_RECORD_ABORT          (0x04)    /* Payload: 0 */
 
 static const char *TAG = "PARTITION_LIST";
 
+/**
+ * @brief Position of a URL in the log
+ */
+typedef struct {
+    uint32_t pos;                       /*!< Offset of the URL record */
+    uint32_t hash;                      /*!< Hash of the URL, so exist() reads the flash on a match only */
+    uint16_t len;                       /*!< Length of the URL */
+} partition_list_entry_t;
+
+/**
+ * @brief The log in use
+ */
+typedef struct {
+    const esp_partition_t *part;        /*!< Partition of the log */
+    uint32_t seq;                       /*!< Sequence of the log */
+    uint32_t tail;                      /*!< End of the records written to the flash */
+    uint32_t erased_end;                /*!< The flash from `tail` to here is erased */
+    uint32_t commit_end;                /*!< End of the last COMMIT or ABORT, the records after it belong to the open batch */
+} partition_list_log_t;
+
 /**
  * @brief Partition list management unit
  */
 typedef struct partition_list {
     const esp_partition_t *url_part;    /*!< URL partition handle */
     const esp_partition_t *offset_part; /*!< offset partition handle */
+    partition_list_log_t log;           /*!< The log in use, in one of the two partitions */
+    partition_list_entry_t *entries;    /*!< URLs by id */
+    int      entry_cap;                 /*!< Capacity of `entries` */
     uint16_t url_num;                   /*!< number of URLs */
     uint16_t cur_url_id;                /*!< current URL id */
-    uint32_t total_size_offset_part;    /*!< size of partition to save URLs */
-    uint32_t total_size_url_part;       /*!< size of partition to save offset */
+    uint32_t live_bytes;                /*!< Size of the URL records in use */
+    partition_list_entry_t *removed;    /*!< Committed URLs removed by the open batch, still live until it commits */
+    int      removed_num;               /*!< Number of `removed` */
+    int      removed_cap;               /*!< Capacity of `removed` */
+    uint32_t removed_bytes;             /*!< Size of the URL records in `removed` */
+    uint8_t  *buf;                      /*!< Records staged for the flash, they start at `log.tail` */
+    int      buf_len;                   /*!< Bytes staged */
+    bool     batch;                     /*!< Records are committed by `partition_list_batch_commit` */
+    bool     compact_due;               /*!< A failed write left records after the last commit, compact before the next record */
     char     *cur_url;                  /*!< point to current URL */
 } partition_list_t;
 
 esp_err_t partition_list_get_operation(playlist_operation_t *operation);
 
-static esp_err_t partition_list_choose_id(partition_list_t *playlist, int id, char **url_buff)
+static uint32_t partition_list_hash(const void *data, int len, uint32_t hash)
+{
+    const uint8_t *p = data;
+    for (int i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t partition_list_record_check(uint32_t seq, const uint8_t *head, const void *payload, int len)
+{
+    uint32_t hash = partition_list_hash(&seq, sizeof(seq), PARTITION_LIST_HASH_INIT);
+    hash = partition_list_hash(head, 4, hash);
+    return partition_list_hash(payload, len, hash);
+}
+
+static inline uint32_t partition_list_tail(partition_list_t *playlist)
+{
+    return playlist->log.tail + playlist->buf_len;
+}
+
+static inline uint32_t partition_list_garbage(partition_list_t *playlist)
+{
+    return partition_list_tail(playlist) - PARTITION_LIST_LOG_HEAD - playlist->live_bytes - playlist->removed_bytes;
+}
+
+static const esp_partition_t *partition_list_other(partition_list_t *playlist, const esp_partition_t *part)
+{
+    return part == playlist->url_part ? playlist->offset_part : playlist->url_part;
+}
+
+/* Erase sectors so that the flash is erased up to `end`, and past it unless the partition ends there */
+static esp_err_t partition_list_erase_to(partition_list_log_t *log, uint32_t end)
+{
+    while (log->erased_end < end || (log->erased_end == end && end < log->part->size)) {
+        if (log->erased_end + PARTITION_LIST_SECTOR_SIZE > log->part->size) {
+            return ESP_FAIL;
+        }
+        esp_err_t ret = esp_partition_erase_range(log->part, log->erased_end, PARTITION_LIST_SECTOR_SIZE);
+        AUDIO_CHECK(TAG, ret == ESP_OK, return ret, "Failed to erase the partition playlist");
+        log->erased_end += PARTITION_LIST_SECTOR_SIZE;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t partition_list_flush(partition_list_t *playlist)
+{
+    if (playlist->buf_len == 0) {
+        return ESP_OK;
+    }
+    partition_list_log_t *log = &playlist->log;
+    esp_err_t ret = partition_list_erase_to(log, log->tail + playlist->buf_len);
+    ret |= esp_partition_write(log->part, log->tail, playlist->buf, playlist->buf_len);
+    AUDIO_CHECK(TAG, ret == ESP_OK, return ESP_FAIL, "Failed to write the partition playlist");
+    log->tail += playlist->buf_len;
+    playlist->buf_len = 0;
+    return ESP_OK;
+}
+
+static esp_err_t partition_list_stage_bytes(partition_list_t *playlist, const void *data, int len)
+{
+    const uint8_t *p = data;
+    while (len > 0) {
+        if (playlist->buf_len == PARTITION_LIST_SECTOR_SIZE && partition_list_flush(playlist) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        int n = PARTITION_LIST_SECTOR_SIZE - playlist->buf_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(playlist->buf + playlist->buf_len, p, n);
+        playlist->buf_len += n;
+        p += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+/* Append a record to the staging buffer, it reaches the flash sector by sector or at the next commit */
+static esp_err_t partition_list_stage(partition_list_t *playlist, uint8_t type, const void *payload, uint16_t len, uint32_t *pos)
+{
+    uint32_t size = PARTITION_LIST_RECORD_SIZE(len);
+    // A URL or DELETE keeps room for the COMMIT or ABORT that closes it
+    uint32_t reserve = (type == PARTITION_LIST_RECORD_URL || type == PARTITION_LIST_RECORD_DELETE) ? PARTITION_LIST_RECORD_SIZE(sizeof(uint32_t)) : 0;
+    if (partition_list_tail(playlist) + size + reserve > playlist->log.part->size) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint8_t head[PARTITION_LIST_RECORD_HEAD] = { type, 0, len & 0xFF, len >> 8 };
+    uint32_t check = partition_list_record_check(playlist->log.seq, head, payload, len);
+    memcpy(head + 4, &check, sizeof(check));
+    if (pos) {
+        *pos = partition_list_tail(playlist);
+    }
+    uint32_t pad = 0;
+    esp_err_t ret = partition_list_stage_bytes(playlist, head, sizeof(head));
+    ret |= partition_list_stage_bytes(playlist, payload, len);
+    ret |= partition_list_stage_bytes(playlist, &pad, size - PARTITION_LIST_RECORD_HEAD - len);
+    return ret;
+}
+
+/* Read from the flash, or from the staging buffer for the records not flushed yet */
+static esp_err_t partition_list_read(partition_list_t *playlist, uint32_t pos, void *dst, int len)
 {
     esp_err_t ret = ESP_OK;
-    uint32_t pos = 0;
-    uint16_t  size = 0;
-    int offset = id * (sizeof(uint32_t) + sizeof(uint16_t));
+    uint8_t *p = dst;
+    if (pos < playlist->log.tail) {
+        int n = playlist->log.tail - pos;
+        if (n > len) {
+            n = len;
+        }
+        ret = esp_partition_read(playlist->log.part, pos, p, n);
+        pos += n;
+        p += n;
+        len -= n;
+    }
+    if (len > 0) {
+        memcpy(p, playlist->buf + (pos - playlist->log.tail), len);
+    }
+    return ret;
+}
+
+static esp_err_t partition_list_write_head(partition_list_log_t *log)
+{
+    uint32_t head[4] = { PARTITION_LIST_LOG_MAGIC, PARTITION_LIST_LOG_VERSION, log->seq, 0 };
+    head[3] = partition_list_hash(head, sizeof(uint32_t) * 3, PARTITION_LIST_HASH_INIT);
+    return esp_partition_write(log->part, 0, head, sizeof(head));
+}
+
+static bool partition_list_read_head(const esp_partition_t *part, uint32_t *seq)
+{
+    uint32_t head[4];
+    if (esp_partition_read(part, 0, head, sizeof(head)) != ESP_OK || head[0] != PARTITION_LIST_LOG_MAGIC
+        || head[1] != PARTITION_LIST_LOG_VERSION || head[3] != partition_list_hash(head, sizeof(uint32_t) * 3, PARTITION_LIST_HASH_INIT)) {
+        return false;
+    }
+    *seq = head[2];
+    return true;
+}
+
+/* Start an empty log, the header goes last so a log is never valid half done */
+static esp_err_t partition_list_format(partition_list_log_t *log, const esp_partition_t *part, uint32_t seq, uint32_t erase_size)
+{
+    log->part = part;
+    log->seq = seq;
+    log->tail = PARTITION_LIST_LOG_HEAD;
+    log->commit_end = PARTITION_LIST_LOG_HEAD;
+    log->erased_end = 0;
+    if (erase_size < PARTITION_LIST_SECTOR_SIZE) {
+        erase_size = PARTITION_LIST_SECTOR_SIZE;
+    }
+    esp_err_t ret = esp_partition_erase_range(part, 0, erase_size);
+    AUDIO_CHECK(TAG, ret == ESP_OK, return ret, "Failed to erase the partition playlist");
+    log->erased_end = erase_size;
+    return partition_list_write_head(log);
+}
+
+static esp_err_t partition_list_entry_reserve(partition_list_t *playlist, int num)
+{
+    if (num <= playlist->entry_cap) {
+        return ESP_OK;
+    }
+    int cap = playlist->entry_cap ? playlist->entry_cap : 64;
+    while (cap < num) {
+        cap *= 2;
+    }
+    partition_list_entry_t *entries = audio_realloc(playlist->entries, cap * sizeof(partition_list_entry_t));
+    AUDIO_MEM_CHECK(TAG, entries, return ESP_ERR_NO_MEM);
+    playlist->entries = entries;
+    playlist->entry_cap = cap;
+    return ESP_OK;
+}
+
+static void partition_list_entry_remove(partition_list_t *playlist, int id)
+{
+    playlist->live_bytes -= PARTITION_LIST_RECORD_SIZE(playlist->entries[id].len);
+    memmove(&playlist->entries[id], &playlist->entries[id + 1], (playlist->url_num - id - 1) * sizeof(partition_list_entry_t));
+    playlist->url_num--;
+    if (playlist->cur_url_id > id) {
+        playlist->cur_url_id--;
+    }
+    if (playlist->cur_url_id >= playlist->url_num) {
+        playlist->cur_url_id = 0;
+    }
+}
+
+static int partition_list_entry_find(partition_list_t *playlist, uint32_t pos)
+{
+    int lo = 0, hi = playlist->url_num - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (playlist->entries[mid].pos == pos) {
+            return mid;
+        } else if (playlist->entries[mid].pos < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+static int partition_list_pos_cmp(const void *a, const void *b)
+{
+    uint32_t pa = ((const partition_list_entry_t *)a)->pos;
+    uint32_t pb = ((const partition_list_entry_t *)b)->pos;
+    return pa < pb ? -1 : pa > pb;
+}
+
+static esp_err_t partition_list_copy(partition_list_t *playlist, const partition_list_log_t *old, const partition_list_entry_t *entry,
+                                     char *url, uint32_t *pos)
+{
+    esp_err_t ret = esp_partition_read(old->part, entry->pos + PARTITION_LIST_RECORD_HEAD, url, entry->len);
+    ret |= partition_list_stage(playlist, PARTITION_LIST_RECORD_URL, url, entry->len, pos);
+    return ret;
+}
+
+/*
+ * Copy the committed URLs to the other partition and commit them, then stage the open batch again and switch to it.
+ * The committed URLs are the ones before the last commit, with those the batch removed, so the batch stays atomic.
+ */
+static esp_err_t partition_list_compact(partition_list_t *playlist)
+{
+    partition_list_log_t old = playlist->log;
+    partition_list_log_t next;
+    const esp_partition_t *part = partition_list_other(playlist, old.part);
+    int committed = 0;
+    uint32_t batch_bytes = playlist->removed_num * PARTITION_LIST_RECORD_SIZE(sizeof(uint32_t));
+    for (int i = 0; i < playlist->url_num; i++) {
+        if (playlist->entries[i].pos < old.commit_end) {
+            committed = i + 1;
+        } else {
+            batch_bytes += PARTITION_LIST_RECORD_SIZE(playlist->entries[i].len);
+        }
+    }
+    uint32_t need = PARTITION_LIST_LOG_HEAD + playlist->live_bytes + playlist->removed_bytes + playlist->removed_num * PARTITION_LIST_RECORD_SIZE(sizeof(uint32_t))
+                    + 2 * PARTITION_LIST_RECORD_SIZE(sizeof(uint32_t));
+    if (need > part->size) {
+        ESP_LOGW(TAG, "The %d bytes of urls do not fit in the other partition", playlist->live_bytes + playlist->removed_bytes);
+        return ESP_ERR_NO_MEM;
+    }
+    if (partition_list_flush(playlist) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    uint32_t *new_pos = audio_malloc((playlist->url_num + playlist->removed_num + 1) * sizeof(uint32_t));
+    char *url = audio_malloc(PARTITION_LIST_URL_MAX_LENGTH);
+    AUDIO_MEM_CHECK(TAG, new_pos && url, {
+        audio_free(new_pos);
+        audio_free(url);
+        return ESP_ERR_NO_MEM;
+    });
+    uint32_t *removed_pos = new_pos + playlist->url_num;
+    bool compact_due = playlist->compact_due;
+    playlist->compact_due = false;
+    if (playlist->removed_num > 1) {
+        qsort(playlist->removed, playlist->removed_num, sizeof(partition_list_entry_t), partition_list_pos_cmp);
+    }
+    // The header is written once the records are in, the header sector is erased here and the rest on the go
+    memset(&next, 0, sizeof(next));
+    next.part = part;
+    next.seq = old.seq + 1;
+    next.tail = PARTITION_LIST_LOG_HEAD;
+    esp_err_t ret = esp_partition_erase_range(part, 0, PARTITION_LIST_SECTOR_SIZE);
+    next.erased_end = PARTITION_LIST_SECTOR_SIZE;
+    playlist->log = next;
+    // The committed urls in log order, the ones the batch removed are merged back in
+    int i = 0, j = 0;
+    while ((i < committed || j < playlist->removed_num) && ret == ESP_OK) {
+        if (j == playlist->removed_num || (i < committed && playlist->entries[i].pos < playlist->removed[j].pos)) {
+            ret = partition_list_copy(playlist, &old, &playlist->entries[i], url, &new_pos[i]);
+            i++;
+        } else {
+            ret = partition_list_copy(playlist, &old, &playlist->removed[j], url, &removed_pos[j]);
+            j++;
+        }
+    }
+    uint32_t num = committed + playlist->removed_num;
+    ret |= partition_list_stage(playlist, PARTITION_LIST_RECORD_COMMIT, &num, sizeof(num), NULL);
+    uint32_t commit_end = partition_list_tail(playlist);
+    // The open batch, without a COMMIT
+    for (i = committed; i < playlist->url_num && ret == ESP_OK; i++) {
+        ret = partition_list_copy(playlist, &old, &playlist->entries[i], url, &new_pos[i]);
+    }
+    for (j = 0; j < playlist->removed_num && ret == ESP_OK; j++) {
+        ret = partition_list_stage(playlist, PARTITION_LIST_RECORD_DELETE, &removed_pos[j], sizeof(uint32_t), NULL);
+    }
+    ret |= partition_list_flush(playlist);
+    ret |= partition_list_write_head(&playlist->log);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to compact the partition playlist");
+        playlist->log = old;
+        playlist->buf_len = 0;
+        playlist->compact_due = compact_due;
+    } else {
+        for (i = 0; i < playlist->url_num; i++) {
+            playlist->entries[i].pos = new_pos[i];
+        }
+        for (j = 0; j < playlist->removed_num; j++) {
+            playlist->removed[j].pos = removed_pos[j];
+        }
+        playlist->log.commit_end = commit_end;
+        esp_partition_erase_range(old.part, 0, PARTITION_LIST_SECTOR_SIZE);
+        ESP_LOGI(TAG, "Compacted %d urls to %d bytes, %d bytes of them in the open batch", playlist->url_num, playlist->log.tail, batch_bytes);
+    }
+    audio_free(new_pos);
+    audio_free(url);
+    return ret == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/* Drop the urls of the open batch from the index and bring back the committed urls it removed */
+static void partition_list_rollback(partition_list_t *playlist)
+{
+    int num = 0;
+    for (int i = 0; i < playlist->url_num; i++) {
+        if (playlist->entries[i].pos < playlist->log.commit_end) {
+            playlist->entries[num++] = playlist->entries[i];
+        } else {
+            playlist->live_bytes -= PARTITION_LIST_RECORD_SIZE(playlist->entries[i].len);
+        }
+    }
+    if (playlist->removed_num > 0) {
+        // They were in the table before, it has room for them
+        memcpy(&playlist->entries[num], playlist->removed, playlist->removed_num * sizeof(partition_list_entry_t));
+        num += playlist->removed_num;
+        qsort(playlist->entries, num, sizeof(partition_list_entry_t), partition_list_pos_cmp);
+    }
+    playlist->url_num = num;
+    playlist->live_bytes += playlist->removed_bytes;
+    playlist->removed_num = 0;
+    playlist->removed_bytes = 0;
+    if (playlist->cur_url_id >= playlist->url_num) {
+        playlist->cur_url_id = 0;
+    }
+}
+
+static esp_err_t partition_list_commit(partition_list_t *playlist)
+{
+    uint32_t num = playlist->url_num;
+    esp_err_t ret = partition_list_stage(playlist, PARTITION_LIST_RECORD_COMMIT, &num, sizeof(num), NULL);
+    if (ret == ESP_ERR_NO_MEM && partition_list_compact(playlist) == ESP_OK) {
+        ret = partition_list_stage(playlist, PARTITION_LIST_RECORD_COMMIT, &num, sizeof(num), NULL);
+    }
+    if (ret == ESP_OK) {
+        ret = partition_list_flush(playlist);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to commit the partition playlist, drop the changes since the last commit");
+        partition_list_rollback(playlist);
+        // What is on the flash after the last commit is left behind by a compaction
+        playlist->buf_len = 0;
+        playlist->compact_due = true;
+        return ESP_FAIL;
+    }
+    playlist->log.commit_end = playlist->log.tail;
+    playlist->removed_num = 0;
+    playlist->removed_bytes = 0;
+    uint32_t garbage = partition_list_garbage(playlist);
+    if (garbage > playlist->live_bytes && garbage >= PARTITION_LIST_COMPACT_MIN) {
+        partition_list_compact(playlist);
+    }
+    return ESP_OK;
+}
+
+/* Stage a record, compacting the log once if it is full */
+static esp_err_t partition_list_append(partition_list_t *playlist, uint8_t type, const void *payload, uint16_t len, uint32_t *pos)
+{
+    if (playlist->compact_due && partition_list_compact(playlist) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    esp_err_t ret = partition_list_stage(playlist, type, payload, len, pos);
+    if (ret == ESP_ERR_NO_MEM && partition_list_garbage(playlist) >= PARTITION_LIST_RECORD_SIZE(len)
+        && partition_list_compact(playlist) == ESP_OK) {
+        ret = partition_list_stage(playlist, type, payload, len, pos);
+    }
+    if (ret == ESP_ERR_NO_MEM) {
+        ESP_LOGE(TAG, "The partition playlist is full");
+    }
+    return ret;
+}
 
-    ret |= esp_partition_read(playlist->offset_part, offset, &pos, sizeof(uint32_t));
-    ret |= esp_partition_read(playlist->offset_part, offset + sizeof(uint32_t), &size, sizeof(uint16_t));
+/* Rebuild the url index with one sequential pass over the log */
+static esp_err_t partition_list_scan(partition_list_t *playlist, bool *clean)
+{
+    partition_list_log_t *log = &playlist->log;
+    uint8_t *payload = audio_malloc(PARTITION_LIST_URL_MAX_LENGTH);
+    uint32_t *deletes = NULL;
+    int delete_num = 0, delete_cap = 0;
+    AUDIO_MEM_CHECK(TAG, payload, return ESP_ERR_NO_MEM);
+
+    uint32_t pos = PARTITION_LIST_LOG_HEAD, committed_end = pos;
+    uint32_t block_pos = 0;
+    int block_len = 0, committed_num = 0;
+    esp_err_t ret = ESP_OK;
+    *clean = false;
+    playlist->url_num = 0;
+    playlist->live_bytes = 0;
+    while (ret == ESP_OK) {
+        uint8_t head[PARTITION_LIST_RECORD_HEAD];
+        if (pos + PARTITION_LIST_RECORD_HEAD > log->part->size) {
+            *clean = true;
+            break;
+        }
+        // Reads go through the staging buffer, one sector at a time
+        if (pos < block_pos || pos + PARTITION_LIST_RECORD_HEAD > block_pos + block_len) {
+            block_pos = pos;
+            block_len = log->part->size - pos < PARTITION_LIST_SECTOR_SIZE ? log->part->size - pos : PARTITION_LIST_SECTOR_SIZE;
+            if (esp_partition_read(log->part, block_pos, playlist->buf, block_len) != ESP_OK) {
+                break;
+            }
+        }
+        memcpy(head, playlist->buf + pos - block_pos, sizeof(head));
+        uint16_t len = head[2] | (head[3] << 8);
+        uint32_t size = PARTITION_LIST_RECORD_SIZE(len);
+        uint8_t type = head[0];
+        if (type == 0xFF && head[1] == 0xFF && len == 0xFFFF) {
+            *clean = true;
+            break;
+        }
+        bool valid = (pos + size <= log->part->size)
+                     && ((type == PARTITION_LIST_RECORD_URL && len > 0 && len < PARTITION_LIST_URL_MAX_LENGTH)
+                         || (type >= PARTITION_LIST_RECORD_DELETE && type <= PARTITION_LIST_RECORD_ABORT && len == sizeof(uint32_t)));
+        if (valid) {
+            if (pos + size <= block_pos + block_len) {
+                memcpy(payload, playlist->buf + pos - block_pos + PARTITION_LIST_RECORD_HEAD, len);
+            } else if (esp_partition_read(log->part, pos + PARTITION_LIST_RECORD_HEAD, payload, len) != ESP_OK) {
+                break;
+            }
+            uint32_t check;
+            memcpy(&check, head + 4, sizeof(check));
+            valid = (check == partition_list_record_check(log->seq, head, payload, len));
+        }
+        if (valid == false) {
+            // At a sector start this is a sector not erased yet, the log ends here
+            *clean = (pos % PARTITION_LIST_SECTOR_SIZE) == 0;
+            break;
+        }
+        uint32_t value;
+        memcpy(&value, payload, sizeof(value));
+        if (type == PARTITION_LIST_RECORD_URL) {
+            if (playlist->url_num == PARTITION_LIST_URL_MAX_NUM || partition_list_entry_reserve(playlist, playlist->url_num + 1) != ESP_OK) {
+                ret = ESP_FAIL;
+                break;
+            }
+            partition_list_entry_t *entry = &playlist->entries[playlist->url_num++];
+            entry->pos = pos;
+            entry->len = len;
+            entry->hash = partition_list_hash(payload, len, PARTITION_LIST_HASH_INIT);
+            playlist->live_bytes += size;
+        } else if (type == PARTITION_LIST_RECORD_DELETE) {
+            if (delete_num == delete_cap) {
+                delete_cap = delete_cap ? delete_cap * 2 : 16;
+                uint32_t *tmp = audio_realloc(deletes, delete_cap * sizeof(uint32_t));
+                AUDIO_MEM_CHECK(TAG, tmp, {
+                    ret = ESP_ERR_NO_MEM;
+                    break;
+                });
+                deletes = tmp;
+            }
+            deletes[delete_num++] = value;
+        } else if (type == PARTITION_LIST_RECORD_COMMIT) {
+            for (int i = 0; i < delete_num; i++) {
+                int id = partition_list_entry_find(playlist, deletes[i]);
+                if (id >= 0) {
+                    partition_list_entry_remove(playlist, id);
+                }
+            }
+            delete_num = 0;
+            committed_num = playlist->url_num;
+            committed_end = pos + size;
+        } else {
+            for (int i = committed_num; i < playlist->url_num; i++) {
+                playlist->live_bytes -= PARTITION_LIST_RECORD_SIZE(playlist->entries[i].len);
+            }
+            playlist->url_num = committed_num;
+            delete_num = 0;
+            committed_end = pos + size;
+        }
+        pos += size;
+    }
+    // Records after the last commit belong to a batch that never completed
+    for (int i = committed_num; i < playlist->url_num; i++) {
+        playlist->live_bytes -= PARTITION_LIST_RECORD_SIZE(playlist->entries[i].len);
+    }
+    playlist->url_num = committed_num;
+    log->tail = pos;
+    log->erased_end = (pos % PARTITION_LIST_SECTOR_SIZE) ? (pos + PARTITION_LIST_SECTOR_SIZE - 1) / PARTITION_LIST_SECTOR_SIZE * PARTITION_LIST_SECTOR_SIZE : pos;
+    if (ret == ESP_OK && *clean && pos != committed_end) {
+        uint32_t zero = 0;
+        esp_err_t err = partition_list_stage(playlist, PARTITION_LIST_RECORD_ABORT, &zero, sizeof(zero), NULL);
+        if (err == ESP_OK) {
+            err = partition_list_flush(playlist);
+        }
+        if (err != ESP_OK) {
+            // The committed urls are loaded, a compaction leaves the rest behind
+            ESP_LOGW(TAG, "Failed to close the unfinished batch of the partition playlist");
+            playlist->buf_len = 0;
+            *clean = false;
+        }
+    }
+    log->commit_end = partition_list_tail(playlist);
+    audio_free(deletes);
+    audio_free(payload);
+    return ret;
+}
+
+static esp_err_t partition_list_mount(partition_list_t *playlist)
+{
+    uint32_t seq_url = 0, seq_offset = 0;
+    bool url_valid = partition_list_read_head(playlist->url_part, &seq_url);
+    bool offset_valid = partition_list_read_head(playlist->offset_part, &seq_offset);
+    if (url_valid == false && offset_valid == false) {
+        ESP_LOGI(TAG, "No partition playlist found, start a new one");
+        return partition_list_format(&playlist->log, playlist->url_part, 1, PARTITION_LIST_SECTOR_SIZE);
+    }
+    if (url_valid && (offset_valid == false || (int32_t)(seq_url - seq_offset) > 0)) {
+        playlist->log.part = playlist->url_part;
+        playlist->log.seq = seq_url;
+    } else {
+        playlist->log.part = playlist->offset_part;
+        playlist->log.seq = seq_offset;
+    }
+    bool clean = false;
+    esp_err_t ret = partition_list_scan(playlist, &clean);
+    if (ret == ESP_OK && clean == false) {
+        ESP_LOGW(TAG, "The partition playlist has a damaged record at %d, compact it", playlist->log.tail);
+        if (partition_list_compact(playlist) != ESP_OK) {
+            // Keep the loaded urls, the next record tries the compaction again
+            playlist->compact_due = true;
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to load the partition playlist, start a new one");
+        playlist->url_num = 0;
+        playlist->live_bytes = 0;
+        playlist->buf_len = 0;
+        return partition_list_format(&playlist->log, playlist->log.part, playlist->log.seq + 1, playlist->log.part->size);
+    }
+    ESP_LOGI(TAG, "Loaded %d urls, log %d bytes", playlist->url_num, playlist->log.tail);
+    return ESP_OK;
+}
+
+static esp_err_t partition_list_choose_id(partition_list_t *playlist, int id, char **url_buff)
+{
+    partition_list_entry_t *entry = &playlist->entries[id];
 
     if (playlist->cur_url) {
         audio_free(playlist->cur_url);
     }
 
-    playlist->cur_url = (char *)audio_calloc(1, size + 1);
+    playlist->cur_url = (char *)audio_calloc(1, entry->len + 1);
     AUDIO_NULL_CHECK(TAG, playlist->cur_url, {
         ESP_LOGE(TAG, "Fail to allocate memory for url");
         return ESP_FAIL;
     });
 
-    ret |= esp_partition_read(playlist->url_part, pos, playlist->cur_url, size);
-    playlist->cur_url[size] = 0;
-
-    if (ret != ESP_OK) {
+    if (partition_list_read(playlist, entry->pos + PARTITION_LIST_RECORD_HEAD, playlist->cur_url, entry->len) != ESP_OK) {
         ESP_LOGE(TAG, "There is a mistake when choose id in partition playlist!");
         return ESP_FAIL;
     }
@@ -84,7 +670,7 @@ static esp_err_t partition_list_choose_id(partition_list_t *playlist, int id, ch
     return ESP_OK;
 }
 
-esp_err_t partition_list_create(playlist_operator_handle_t *handle)
+esp_err_t partition_list_open(playlist_operator_handle_t *handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
 
@@ -94,55 +680,88 @@ esp_err_t partition_list_create(playlist_operator_handle_t *handle)
     partition_list_t *partition_list = audio_calloc(1, sizeof(partition_list_t));
     AUDIO_NULL_CHECK(TAG, partition_list, {
         audio_free(partition_handle);
+        return ESP_FAIL;
     });
 
     partition_handle->playlist = partition_list;
     partition_handle->get_operation = partition_list_get_operation;
 
-    esp_err_t ret = ESP_OK;
     partition_list->url_part = esp_partition_find_first(DEFAULT_PARTITION_TYPE, DEFAULT_PARTITION_URL_SUB_TYPE, NULL);
     partition_list->offset_part = esp_partition_find_first(DEFAULT_PARTITION_TYPE, DEFAULT_PARTITION_OFFSET_SUB_TYPE, NULL);
-    if (NULL == partition_list->url_part || NULL == partition_list->offset_part) {
+    partition_list->buf = audio_malloc(PARTITION_LIST_SECTOR_SIZE);
+    if (NULL == partition_list->url_part || NULL == partition_list->offset_part || NULL == partition_list->buf) {
         ESP_LOGE(TAG, "Can not find the offset partition or url partition, please check the partition table");
+        audio_free(partition_list->buf);
         audio_free(partition_handle);
         audio_free(partition_list);
         return ESP_FAIL;
     }
-    const esp_partition_t *url_part = partition_list->url_part;
-    const esp_partition_t *offset_part = partition_list->offset_part;
-    ret |= esp_partition_erase_range(url_part, 0, url_part->size);
-    ret |= esp_partition_erase_range(offset_part, 0, url_part->size);
+    esp_err_t ret = partition_list_mount(partition_list);
 
     *handle = partition_handle;
     return ret;
 }
 
-esp_err_t partition_list_save(playlist_operator_handle_t handle, const char *url)
+esp_err_t partition_list_create(playlist_operator_handle_t *handle)
+{
+    esp_err_t ret = partition_list_open(handle);
+    if (ret == ESP_OK) {
+        ret = partition_list_reset(*handle);
+    }
+    return ret;
+}
+
+esp_err_t partition_list_batch_begin(playlist_operator_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
-    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    esp_err_t ret = ESP_OK;
-    uint16_t len = strlen(url);
+    playlist->batch = true;
+    return ESP_OK;
+}
 
-    ret |= esp_partition_write(playlist->offset_part, playlist->total_size_offset_part, &playlist->total_size_url_part, sizeof(uint32_t));
-    playlist->total_size_offset_part += sizeof(uint32_t);
-    ret |= esp_partition_write(playlist->offset_part, playlist->total_size_offset_part, &len, sizeof(uint16_t));
-    playlist->total_size_offset_part += sizeof(uint16_t);
-    ret |= esp_partition_write(playlist->url_part, playlist->total_size_url_part, url, len);
-    playlist->total_size_url_part += len;
+esp_err_t partition_list_batch_commit(playlist_operator_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    partition_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (ret != ESP_OK) {
-        playlist->total_size_offset_part -= (sizeof(uint32_t) + sizeof(uint16_t));
-        playlist->total_size_url_part -= len;
+    if (playlist->batch == false) {
+        return ESP_OK;
+    }
+    playlist->batch = false;
+    return partition_list_commit(playlist);
+}
+
+esp_err_t partition_list_save(playlist_operator_handle_t handle, const char *url)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
+    partition_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    size_t len = strlen(url);
+    if (len == 0 || len >= PARTITION_LIST_URL_MAX_LENGTH) {
+        ESP_LOGE(TAG, "The url length must be between 1 and %d", PARTITION_LIST_URL_MAX_LENGTH - 1);
+        return ESP_FAIL;
+    }
+    if (playlist->url_num == PARTITION_LIST_URL_MAX_NUM || partition_list_entry_reserve(playlist, playlist->url_num + 1) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save URL to partition list ");
+        return ESP_FAIL;
+    }
+    uint32_t pos = 0;
+    if (partition_list_append(playlist, PARTITION_LIST_RECORD_URL, url, len, &pos) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to save URL to partition list ");
         return ESP_FAIL;
     }
-    playlist->url_num++;
+    partition_list_entry_t *entry = &playlist->entries[playlist->url_num++];
+    entry->pos = pos;
+    entry->len = len;
+    entry->hash = partition_list_hash(url, len, PARTITION_LIST_HASH_INIT);
+    playlist->live_bytes += PARTITION_LIST_RECORD_SIZE(len);
 
-    return ESP_OK;
+    return playlist->batch ? ESP_OK : partition_list_commit(playlist);
 }
 
 esp_err_t partition_list_next(playlist_operator_handle_t handle, int step, char **url_buff)
@@ -235,6 +854,26 @@ esp_err_t partition_list_choose(playlist_operator_handle_t handle, int url_id, c
     return partition_list_choose_id(playlist, url_id, url_buff);
 }
 
+esp_err_t partition_list_get_url(playlist_operator_handle_t handle, int url_id, char *url_buff, int size)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
+    partition_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    if ((url_id < 0) || (url_id >= playlist->url_num)) {
+        ESP_LOGE(TAG, "Invalid url id to be choosen");
+        return ESP_FAIL;
+    }
+    partition_list_entry_t *entry = &playlist->entries[url_id];
+    if (entry->len >= size) {
+        return ESP_FAIL;
+    }
+    esp_err_t ret = partition_list_read(playlist, entry->pos + PARTITION_LIST_RECORD_HEAD, url_buff, entry->len);
+    url_buff[entry->len] = 0;
+    return ret;
+}
+
 esp_err_t partition_list_show(playlist_operator_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
@@ -242,18 +881,12 @@ esp_err_t partition_list_show(playlist_operator_handle_t handle)
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
     esp_err_t ret = ESP_OK;
-    uint32_t pos = 0, offset = 0;
-    uint16_t  size = 0;
     char *url = audio_calloc(1, PARTITION_LIST_URL_MAX_LENGTH);
+    AUDIO_MEM_CHECK(TAG, url, return ESP_FAIL);
 
     ESP_LOGI(TAG, "ID   URL");
     for (int i = 0; i < playlist->url_num; i++) {
-        memset(url, 0, PARTITION_LIST_URL_MAX_LENGTH);
-        ret |= esp_partition_read(playlist->offset_part, offset, &pos, sizeof(uint32_t));
-        offset += sizeof(uint32_t);
-        ret |= esp_partition_read(playlist->offset_part, offset, &size, sizeof(uint16_t));
-        offset += sizeof(uint16_t);
-        ret |= esp_partition_read(playlist->url_part, pos, url, size);
+        ret |= partition_list_get_url(handle, i, url, PARTITION_LIST_URL_MAX_LENGTH);
         ESP_LOGI(TAG, "%d   %s", i, url);
     }
 
@@ -261,35 +894,128 @@ esp_err_t partition_list_show(playlist_operator_handle_t handle)
     return ret;
 }
 
+/* Id of the first url equal to `url` from `start`, -1 if none */
+static int partition_list_find(partition_list_t *playlist, const char *url, int start, char *url_buff)
+{
+    size_t len = strlen(url);
+    uint32_t hash = partition_list_hash(url, len, PARTITION_LIST_HASH_INIT);
+    for (int i = start; i < playlist->url_num; i++) {
+        partition_list_entry_t *entry = &playlist->entries[i];
+        if (entry->hash != hash || entry->len != len) {
+            continue;
+        }
+        if (partition_list_read(playlist, entry->pos + PARTITION_LIST_RECORD_HEAD, url_buff, len) == ESP_OK
+            && memcmp(url, url_buff, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 bool partition_list_exist(playlist_operator_handle_t handle, const char *url)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url, return false);
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    esp_err_t ret = ESP_OK;
-    uint32_t pos = 0, offset = 0;
-    uint16_t  size = 0;
-    char *url_buff = audio_calloc(1, PARTITION_LIST_URL_MAX_LENGTH);
+    if (strlen(url) >= PARTITION_LIST_URL_MAX_LENGTH) {
+        return false;
+    }
+    char *url_buff = audio_malloc(PARTITION_LIST_URL_MAX_LENGTH);
+    AUDIO_MEM_CHECK(TAG, url_buff, return false);
+    bool ret = partition_list_find(playlist, url, 0, url_buff) >= 0;
+    audio_free(url_buff);
+    return ret;
+}
 
-    for (int i = 0; i < playlist->url_num; i++) {
-        memset(url_buff, 0, PARTITION_LIST_URL_MAX_LENGTH);
-        ret |= esp_partition_read(playlist->offset_part, offset, &pos, sizeof(uint32_t));
-        offset += sizeof(uint32_t);
-        ret |= esp_partition_read(playlist->offset_part, offset, &size, sizeof(uint16_t));
-        offset += sizeof(uint16_t);
-        ret |= esp_partition_read(playlist->url_part, pos, url_buff, size);
-        if (strlen(url) != strlen(url_buff)) {
-            continue;
-        }
-        if (strcmp(url, url_buff) == 0) {
-            audio_free(url_buff);
-            return true;
+static esp_err_t partition_list_remove(partition_list_t *playlist, int id)
+{
+    if (playlist->compact_due && partition_list_compact(playlist) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    partition_list_entry_t entry = playlist->entries[id];
+    int cur_url_id = playlist->cur_url_id;
+    // A committed url stays live until the removal commits, a compaction in between must keep it
+    bool committed = entry.pos < playlist->log.commit_end;
+    if (committed && playlist->removed_num == playlist->removed_cap) {
+        int cap = playlist->removed_cap ? playlist->removed_cap * 2 : 16;
+        partition_list_entry_t *removed = audio_realloc(playlist->removed, cap * sizeof(partition_list_entry_t));
+        AUDIO_MEM_CHECK(TAG, removed, return ESP_ERR_NO_MEM);
+        playlist->removed = removed;
+        playlist->removed_cap = cap;
+    }
+    partition_list_entry_remove(playlist, id);
+    if (committed) {
+        playlist->removed[playlist->removed_num++] = entry;
+        playlist->removed_bytes += PARTITION_LIST_RECORD_SIZE(entry.len);
+    }
+    esp_err_t ret = partition_list_stage(playlist, PARTITION_LIST_RECORD_DELETE, &entry.pos, sizeof(entry.pos), NULL);
+    if (ret == ESP_ERR_NO_MEM) {
+        // The compacted log has the DELETE staged again, or no copy of the url if it was not committed
+        ret = partition_list_compact(playlist);
+    }
+    if (ret != ESP_OK) {
+        // Nothing of the removal is in the log, put the url back
+        memmove(&playlist->entries[id + 1], &playlist->entries[id], (playlist->url_num - id) * sizeof(partition_list_entry_t));
+        playlist->entries[id] = entry;
+        playlist->url_num++;
+        playlist->live_bytes += PARTITION_LIST_RECORD_SIZE(entry.len);
+        playlist->cur_url_id = cur_url_id;
+        if (committed) {
+            playlist->removed_num--;
+            playlist->removed_bytes -= PARTITION_LIST_RECORD_SIZE(entry.len);
         }
     }
+    return ret;
+}
+
+esp_err_t partition_list_remove_by_url(playlist_operator_handle_t handle, const char *url)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
+    partition_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
+    if (strlen(url) >= PARTITION_LIST_URL_MAX_LENGTH) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    char *url_buff = audio_malloc(PARTITION_LIST_URL_MAX_LENGTH);
+    AUDIO_MEM_CHECK(TAG, url_buff, return ESP_FAIL);
+    esp_err_t ret = ESP_OK;
+    int removed = 0;
+    int id = partition_list_find(playlist, url, 0, url_buff);
+    while (id >= 0 && ret == ESP_OK) {
+        ret = partition_list_remove(playlist, id);
+        removed++;
+        id = partition_list_find(playlist, url, id, url_buff);
+    }
     audio_free(url_buff);
-    return false;
+    if (removed == 0) {
+        ESP_LOGE(TAG, "Cannot find the url, fail to remove");
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (ret == ESP_OK && playlist->batch == false) {
+        ret = partition_list_commit(playlist);
+    }
+    return ret;
+}
+
+esp_err_t partition_list_remove_by_url_id(playlist_operator_handle_t handle, uint16_t url_id)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    partition_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    if (url_id >= playlist->url_num) {
+        ESP_LOGE(TAG, "Cannot find the url id, fail to remove");
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t ret = partition_list_remove(playlist, url_id);
+    if (ret == ESP_OK && playlist->batch == false) {
+        ret = partition_list_commit(playlist);
+    }
+    return ret;
 }
 
 esp_err_t partition_list_reset(playlist_operator_handle_t handle)
@@ -299,10 +1025,15 @@ esp_err_t partition_list_reset(playlist_operator_handle_t handle)
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
     esp_err_t ret = ESP_OK;
-    const esp_partition_t *url_part = playlist->url_part;
-    const esp_partition_t *offset_part = playlist->offset_part;
-    ret |= esp_partition_erase_range(url_part, 0, url_part->size);
-    ret |= esp_partition_erase_range(offset_part, 0, offset_part->size);
+    uint32_t seq = 0;
+    const esp_partition_t *other = partition_list_other(playlist, playlist->log.part);
+    // A stale log left by an interrupted compaction must not come back
+    if (partition_list_read_head(other, &seq)) {
+        ret |= esp_partition_erase_range(other, 0, PARTITION_LIST_SECTOR_SIZE);
+    }
+    // Only the sectors the log used are erased
+    playlist->buf_len = 0;
+    ret |= partition_list_format(&playlist->log, playlist->log.part, playlist->log.seq + 1, playlist->log.erased_end);
     if (playlist->cur_url) {
         audio_free(playlist->cur_url);
         playlist->cur_url = NULL;
@@ -310,8 +1041,10 @@ esp_err_t partition_list_reset(playlist_operator_handle_t handle)
 
     playlist->url_num = 0;
     playlist->cur_url_id = 0;
-    playlist->total_size_offset_part = 0;
-    playlist->total_size_url_part = 0;
+    playlist->live_bytes = 0;
+    playlist->removed_num = 0;
+    playlist->removed_bytes = 0;
+    playlist->compact_due = false;
     return ret;
 }
 
@@ -339,15 +1072,15 @@ esp_err_t partition_list_destroy(playlist_operator_handle_t handle)
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    esp_err_t ret = ESP_OK;
-    const esp_partition_t *url_part = playlist->url_part;
-    const esp_partition_t *offset_part = playlist->offset_part;
-    ret |= esp_partition_erase_range(url_part, 0, url_part->size);
-    ret |= esp_partition_erase_range(offset_part, 0, offset_part->size);
+    // The urls stay in the partitions for `partition_list_open`
+    esp_err_t ret = partition_list_batch_commit(handle);
     if (playlist->cur_url) {
         audio_free(playlist->cur_url);
         playlist->cur_url = NULL;
     }
+    audio_free(playlist->entries);
+    audio_free(playlist->removed);
+    audio_free(playlist->buf);
     audio_free(playlist);
     handle->playlist = NULL;
     audio_free(handle);
@@ -368,6 +1101,9 @@ esp_err_t partition_list_get_operation(playlist_operation_t *operation)
     operation->destroy = (void *)partition_list_destroy;
     operation->get_url_num = (void *)partition_list_get_url_num;
     operation->get_url_id  = (void *)partition_list_get_url_id;
+    operation->get_url     = (void *)partition_list_get_url;
+    operation->remove_by_url = (void *)partition_list_remove_by_url;
+    operation->remove_by_id  = (void *)partition_list_remove_by_url_id;
     operation->type = PLAYLIST_PARTITION;
     return ESP_OK;
 }
@@ -30,6 +30,7 @@
 
 #include "audio_error.h"
 #include "audio_mem.h"
+#include "audio_mutex.h"
 #include "sdcard_list.h"
 
 #define SDCARD_DEFAULT_DIR_NAME         "/sdcard/__playlist"
@@ -40,6 +41,9 @@
 #define SDCARD_OFFSET_FILE_NAME_LENGTH  (strlen(SDCARD_DEFAULT_OFFSET_FILE_NAME) + 10)
 
 #define SDCARD_LIST_URL_MAX_LENGTH      (1024 * 2)
+#define SDCARD_LIST_PAGE_ENTRIES        (256)           /* Offset entries per page of the in-RAM table */
+#define SDCARD_LIST_BATCH_SIZE          (4 * 1024)      /* URL bytes staged before a batch writes them out */
+#define SDCARD_LIST_OFFSET_RECORD_SIZE  (sizeof(uint32_t) + sizeof(uint16_t))
 
 #define CHECK_ERROR(TAG, para, action)  {\
     if ((para) == false) {\
@@ -50,6 +54,14 @@
 
 static const char *TAG = "PLAYLIST_SDCARD";
 
+/**
+ * @brief Position of one URL in the file of URLs
+ */
+typedef struct {
+    uint32_t pos;                        /*!< Offset of the URL */
+    uint16_t len;                        /*!< Length of the URL */
+} sdcard_list_entry_t;
+
 /**
  * @brief Sdcard list management unit
  */
@@ -61,12 +73,92 @@ typedef struct sdcard_list {
     char *cur_url;                       /*!< Point to current URL */
     uint16_t url_num;                    /*!< Number of URLs */
     uint16_t cur_url_id;                 /*!< Current url ID */
-    uint32_t total_size_save_file;       /*!< Size of file to save URLs */
+    uint32_t total_size_save_file;       /*!< Size of file to save URLs, including the staged URLs */
     uint32_t total_size_offset_file;     /*!< Size of file to save offset */
+    sdcard_list_entry_t **pages;         /*!< Offset table in RAM, `SDCARD_LIST_PAGE_ENTRIES` entries per page */
+    int page_num;                        /*!< Number of allocated pages */
+    bool batch;                          /*!< Saved URLs are staged until `sdcard_list_batch_commit` */
+    char *batch_buf;                     /*!< Staged URLs, they follow the URLs written to the file */
+    int batch_fill;                      /*!< Bytes in `batch_buf` */
+    void *lock;                          /*!< Serializes the file access, a scan callback may save URLs while another task reads them */
 } sdcard_list_t;
 
 esp_err_t sdcard_list_get_operation(playlist_operation_t *operation);
 
+static inline sdcard_list_entry_t *sdcard_list_entry(sdcard_list_t *playlist, int id)
+{
+    return &playlist->pages[id / SDCARD_LIST_PAGE_ENTRIES][id % SDCARD_LIST_PAGE_ENTRIES];
+}
+
+static esp_err_t sdcard_list_add_entry(sdcard_list_t *playlist, uint32_t pos, uint16_t len)
+{
+    if (playlist->url_num == UINT16_MAX) {
+        ESP_LOGE(TAG, "The sdcard list is full");
+        return ESP_FAIL;
+    }
+    int page = playlist->url_num / SDCARD_LIST_PAGE_ENTRIES;
+    if (page == playlist->page_num) {
+        // Pages rather than one array, a long list never needs a large block to be moved
+        sdcard_list_entry_t **pages = audio_realloc(playlist->pages, (page + 1) * sizeof(sdcard_list_entry_t *));
+        AUDIO_NULL_CHECK(TAG, pages, return ESP_ERR_NO_MEM);
+        playlist->pages = pages;
+        pages[page] = audio_calloc(SDCARD_LIST_PAGE_ENTRIES, sizeof(sdcard_list_entry_t));
+        AUDIO_NULL_CHECK(TAG, pages[page], return ESP_ERR_NO_MEM);
+        playlist->page_num++;
+    }
+    sdcard_list_entry_t *entry = sdcard_list_entry(playlist, playlist->url_num);
+    entry->pos = pos;
+    entry->len = len;
+    playlist->url_num++;
+    return ESP_OK;
+}
+
+static void sdcard_list_free_entries(sdcard_list_t *playlist)
+{
+    for (int i = 0; i < playlist->page_num; i++) {
+        audio_free(playlist->pages[i]);
+    }
+    audio_free(playlist->pages);
+    playlist->pages = NULL;
+    playlist->page_num = 0;
+}
+
+/*
+ * Write the staged URLs to the file of URLs, without sync
+ */
+static esp_err_t sdcard_list_flush_urls(sdcard_list_t *playlist)
+{
+    if (playlist->batch_fill == 0) {
+        return ESP_OK;
+    }
+    uint32_t pos = playlist->total_size_save_file - playlist->batch_fill;
+    CHECK_ERROR(TAG, ((fseek(playlist->save_file, pos, SEEK_SET)) == 0), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fwrite(playlist->batch_buf, 1, playlist->batch_fill, playlist->save_file) == playlist->batch_fill), return ESP_FAIL);
+    playlist->batch_fill = 0;
+    return ESP_OK;
+}
+
+/*
+ * Write the offset records not in the offset file yet, in one sequential write per buffer
+ */
+static esp_err_t sdcard_list_flush_offsets(sdcard_list_t *playlist, char *buf, int size)
+{
+    int id = playlist->total_size_offset_file / SDCARD_LIST_OFFSET_RECORD_SIZE;
+    CHECK_ERROR(TAG, ((fseek(playlist->offset_file, playlist->total_size_offset_file, SEEK_SET)) == 0), return ESP_FAIL);
+    while (id < playlist->url_num) {
+        int fill = 0;
+        for (; id < playlist->url_num && fill + SDCARD_LIST_OFFSET_RECORD_SIZE <= size; id++) {
+            sdcard_list_entry_t *entry = sdcard_list_entry(playlist, id);
+            memcpy(buf + fill, &entry->pos, sizeof(uint32_t));
+            memcpy(buf + fill + sizeof(uint32_t), &entry->len, sizeof(uint16_t));
+            fill += SDCARD_LIST_OFFSET_RECORD_SIZE;
+        }
+        CHECK_ERROR(TAG, (fwrite(buf, 1, fill, playlist->offset_file) == fill), return ESP_FAIL);
+        playlist->total_size_offset_file += fill;
+    }
+    return ESP_OK;
+}
+
 static esp_err_t save_url_to_sdcard(sdcard_list_t *playlist, const char *path)
 {
     if (playlist->save_file == NULL || playlist->offset_file == NULL) {
@@ -74,16 +166,28 @@ static esp_err_t save_url_to_sdcard(sdcard_list_t *playlist, const char *path)
         return ESP_FAIL;
     }
     uint16_t len = strlen(path);
+    if (playlist->batch) {
+        if (playlist->batch_fill + len > SDCARD_LIST_BATCH_SIZE) {
+            CHECK_ERROR(TAG, (sdcard_list_flush_urls(playlist) == ESP_OK), return ESP_FAIL);
+        }
+        CHECK_ERROR(TAG, (sdcard_list_add_entry(playlist, playlist->total_size_save_file, len) == ESP_OK), return ESP_FAIL);
+        memcpy(playlist->batch_buf + playlist->batch_fill, path, len);
+        playlist->batch_fill += len;
+        playlist->total_size_save_file += len;
+        return ESP_OK;
+    }
+    char record[SDCARD_LIST_OFFSET_RECORD_SIZE];
     CHECK_ERROR(TAG, ((fseek(playlist->offset_file, playlist->total_size_offset_file, SEEK_SET)) == 0), return ESP_FAIL);
     CHECK_ERROR(TAG, ((fseek(playlist->save_file, playlist->total_size_save_file, SEEK_SET)) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fwrite(path, 1, len, playlist->save_file) == len), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fwrite(&playlist->total_size_save_file, 1, sizeof(uint32_t), playlist->offset_file) == sizeof(uint32_t)), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fwrite(&len, 1, sizeof(uint16_t), playlist->offset_file)) == sizeof(uint16_t), return ESP_FAIL);
+    CHECK_ERROR(TAG, (sdcard_list_add_entry(playlist, playlist->total_size_save_file, len) == ESP_OK), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fwrite(path, 1, len, playlist->save_file) == len), {
+        playlist->url_num--;
+        return ESP_FAIL;
+    });
+    playlist->total_size_save_file += len;
+    CHECK_ERROR(TAG, (sdcard_list_flush_offsets(playlist, record, sizeof(record)) == ESP_OK), return ESP_FAIL);
     CHECK_ERROR(TAG, (fsync(fileno(playlist->save_file)) == 0), return ESP_FAIL);
     CHECK_ERROR(TAG, (fsync(fileno(playlist->offset_file)) == 0), return ESP_FAIL);
-    playlist->total_size_save_file += len;
-    playlist->total_size_offset_file += (sizeof(uint16_t) + sizeof(uint32_t));
-    playlist->url_num++;
 
     return ESP_OK;
 }
@@ -130,15 +234,10 @@ static esp_err_t sdcard_list_close(sdcard_list_t *playlist)
     return ESP_OK;
 }
 
-static esp_err_t sdcard_list_choose_id(sdcard_list_t *playlist, int id, char **url_buff)
+static esp_err_t sdcard_list_read_id(sdcard_list_t *playlist, int id, char **url_buff)
 {
-    uint32_t pos = 0;
-    uint16_t  size = 0;
-    int offset = id * (sizeof(uint32_t) + sizeof(uint16_t));
-
-    CHECK_ERROR(TAG, ((fseek(playlist->offset_file, offset, SEEK_SET)) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, ((fread(&pos, 1, sizeof(uint32_t), playlist->offset_file)) == sizeof(uint32_t)), return ESP_FAIL);
-    CHECK_ERROR(TAG, ((fread(&size, 1, sizeof(uint16_t), playlist->offset_file)) == sizeof(uint16_t)), return ESP_FAIL);
+    uint32_t pos = sdcard_list_entry(playlist, id)->pos;
+    uint16_t size = sdcard_list_entry(playlist, id)->len;
 
     if (playlist->cur_url) {
         audio_free(playlist->cur_url);
@@ -151,8 +250,13 @@ static esp_err_t sdcard_list_choose_id(sdcard_list_t *playlist, int id, char **u
         return ESP_FAIL;
     });
 
-    CHECK_ERROR(TAG, ((fseek(playlist->save_file, pos, SEEK_SET)) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, ((fread(playlist->cur_url, 1, size, playlist->save_file)) == size), return ESP_FAIL);
+    uint32_t staged = playlist->total_size_save_file - playlist->batch_fill;
+    if (pos >= staged) {
+        memcpy(playlist->cur_url, playlist->batch_buf + (pos - staged), size);
+    } else {
+        CHECK_ERROR(TAG, ((fseek(playlist->save_file, pos, SEEK_SET)) == 0), return ESP_FAIL);
+        CHECK_ERROR(TAG, ((fread(playlist->cur_url, 1, size, playlist->save_file)) == size), return ESP_FAIL);
+    }
 
     playlist->cur_url[size] = 0;
     playlist->cur_url_id = id;
@@ -161,6 +265,14 @@ static esp_err_t sdcard_list_choose_id(sdcard_list_t *playlist, int id, char **u
     return ESP_OK;
 }
 
+static esp_err_t sdcard_list_choose_id(sdcard_list_t *playlist, int id, char **url_buff)
+{
+    mutex_lock(playlist->lock);
+    esp_err_t ret = sdcard_list_read_id(playlist, id, url_buff);
+    mutex_unlock(playlist->lock);
+    return ret;
+}
+
 esp_err_t sdcard_list_create(playlist_operator_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
@@ -178,9 +290,17 @@ esp_err_t sdcard_list_create(playlist_operator_handle_t *handle)
     sdcard_handle->playlist = sdcard_list;
     sdcard_handle->get_operation = sdcard_list_get_operation;
 
+    sdcard_list->lock = mutex_create();
+    AUDIO_NULL_CHECK(TAG, sdcard_list->lock, {
+        audio_free(sdcard_handle);
+        audio_free(sdcard_list);
+        return ESP_FAIL;
+    });
+
     static int list_id;
     ret |= sdcard_list_open(sdcard_list, list_id++);
     if (ret != ESP_OK) {
+        mutex_destroy(sdcard_list->lock);
         audio_free(sdcard_handle);
         audio_free(sdcard_list);
         return ESP_FAIL;
@@ -190,31 +310,36 @@ esp_err_t sdcard_list_create(playlist_operator_handle_t *handle)
     return ESP_OK;
 }
 
-esp_err_t sdcard_list_show(playlist_operator_handle_t handle)
+static esp_err_t sdcard_list_print(sdcard_list_t *playlist, char *url)
 {
-    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
-    sdcard_list_t *playlist = handle->playlist;
-    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
-
-    uint32_t pos = 0;
-    uint16_t  size = 0;
-    char *url = audio_calloc(1, SDCARD_LIST_URL_MAX_LENGTH);
-
+    CHECK_ERROR(TAG, (sdcard_list_flush_urls(playlist) == ESP_OK), return ESP_FAIL);
     CHECK_ERROR(TAG, (fseek(playlist->save_file, 0, SEEK_SET) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fseek(playlist->offset_file, 0, SEEK_SET) == 0), return ESP_FAIL);
 
     ESP_LOGI(TAG, "ID   URL");
     for (int i = 0; i < playlist->url_num; i++) {
-        memset(url, 0, SDCARD_LIST_URL_MAX_LENGTH);
-        CHECK_ERROR(TAG, (fread(&pos, 1, sizeof(uint32_t), playlist->offset_file) == sizeof(uint32_t)), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fread(&size, 1, sizeof(uint16_t), playlist->offset_file) == sizeof(uint16_t)), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fseek(playlist->save_file, pos, SEEK_SET) == 0), return ESP_FAIL);
+        // The URLs are stored back to back, read them in order
+        uint16_t size = sdcard_list_entry(playlist, i)->len;
         CHECK_ERROR(TAG, (fread(url, 1, size, playlist->save_file) == size), return ESP_FAIL);
+        url[size] = 0;
         ESP_LOGI(TAG, "%d   %s", i, url);
     }
+    return ESP_OK;
+}
 
+esp_err_t sdcard_list_show(playlist_operator_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    char *url = audio_calloc(1, SDCARD_LIST_URL_MAX_LENGTH);
+    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
+
+    mutex_lock(playlist->lock);
+    esp_err_t ret = sdcard_list_print(playlist, url);
+    mutex_unlock(playlist->lock);
     audio_free(url);
-    return ESP_OK;
+    return ret;
 }
 
 esp_err_t sdcard_list_next(playlist_operator_handle_t handle, int step, char **url_buff)
@@ -308,6 +433,40 @@ esp_err_t sdcard_list_choose(playlist_operator_handle_t handle, int url_id, char
     return sdcard_list_choose_id(playlist, url_id, url_buff);
 }
 
+static esp_err_t sdcard_list_read_url(sdcard_list_t *playlist, int url_id, char *url_buff, int size)
+{
+    if ((url_id < 0) || (url_id >= playlist->url_num)) {
+        ESP_LOGE(TAG, "Invalid url id to be choosen");
+        return ESP_FAIL;
+    }
+    sdcard_list_entry_t *entry = sdcard_list_entry(playlist, url_id);
+    if (entry->len >= size) {
+        return ESP_FAIL;
+    }
+    uint32_t staged = playlist->total_size_save_file - playlist->batch_fill;
+    if (entry->pos >= staged) {
+        memcpy(url_buff, playlist->batch_buf + (entry->pos - staged), entry->len);
+    } else {
+        CHECK_ERROR(TAG, ((fseek(playlist->save_file, entry->pos, SEEK_SET)) == 0), return ESP_FAIL);
+        CHECK_ERROR(TAG, ((fread(url_buff, 1, entry->len, playlist->save_file)) == entry->len), return ESP_FAIL);
+    }
+    url_buff[entry->len] = 0;
+    return ESP_OK;
+}
+
+esp_err_t sdcard_list_get_url(playlist_operator_handle_t handle, int url_id, char *url_buff, int size)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    mutex_lock(playlist->lock);
+    esp_err_t ret = sdcard_list_read_url(playlist, url_id, url_buff, size);
+    mutex_unlock(playlist->lock);
+    return ret;
+}
+
 esp_err_t sdcard_list_save(playlist_operator_handle_t handle, const char *url)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
@@ -321,40 +480,94 @@ esp_err_t sdcard_list_save(playlist_operator_handle_t handle, const char *url)
         ESP_LOGE(TAG, "The url length is greater than MAX LENTGTH, you should change the SDCARD_LIST_URL_MAX_LENGTH value");
         return ESP_FAIL;
     }
+    mutex_lock(playlist->lock);
     ret = save_url_to_sdcard(playlist, url);
+    mutex_unlock(playlist->lock);
     return ret;
 }
 
-bool sdcard_list_exist(playlist_operator_handle_t handle, const char *url)
+esp_err_t sdcard_list_batch_begin(playlist_operator_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    uint32_t pos = 0;
-    uint16_t  size = 0;
-    char *url_buff = audio_calloc(1, SDCARD_LIST_URL_MAX_LENGTH);
+    mutex_lock(playlist->lock);
+    if (playlist->batch_buf == NULL) {
+        playlist->batch_buf = audio_malloc(SDCARD_LIST_BATCH_SIZE);
+        AUDIO_NULL_CHECK(TAG, playlist->batch_buf, {
+            mutex_unlock(playlist->lock);
+            return ESP_FAIL;
+        });
+    }
+    playlist->batch = true;
+    mutex_unlock(playlist->lock);
+    return ESP_OK;
+}
 
-    CHECK_ERROR(TAG, (fseek(playlist->save_file, 0, SEEK_SET) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fseek(playlist->offset_file, 0, SEEK_SET) == 0), return ESP_FAIL);
+static esp_err_t sdcard_list_commit(sdcard_list_t *playlist)
+{
+    if (playlist->batch == false) {
+        return ESP_OK;
+    }
+    CHECK_ERROR(TAG, (sdcard_list_flush_urls(playlist) == ESP_OK), return ESP_FAIL);
+    // The staging buffer is empty now, the offset records are packed into it
+    CHECK_ERROR(TAG, (sdcard_list_flush_offsets(playlist, playlist->batch_buf, SDCARD_LIST_BATCH_SIZE) == ESP_OK), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fsync(fileno(playlist->save_file)) == 0), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fsync(fileno(playlist->offset_file)) == 0), return ESP_FAIL);
+    playlist->batch = false;
+    audio_free(playlist->batch_buf);
+    playlist->batch_buf = NULL;
+    ESP_LOGI(TAG, "Committed %d urls", playlist->url_num);
+    return ESP_OK;
+}
+
+esp_err_t sdcard_list_batch_commit(playlist_operator_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    mutex_lock(playlist->lock);
+    esp_err_t ret = sdcard_list_commit(playlist);
+    mutex_unlock(playlist->lock);
+    return ret;
+}
+
+static bool sdcard_list_find(sdcard_list_t *playlist, const char *url, char *url_buff)
+{
+    size_t len = strlen(url);
+    CHECK_ERROR(TAG, (sdcard_list_flush_urls(playlist) == ESP_OK), return false);
 
     for (int i = 0; i < playlist->url_num; i++) {
-        memset(url_buff, 0, SDCARD_LIST_URL_MAX_LENGTH);
-        CHECK_ERROR(TAG, (fread(&pos, 1, sizeof(uint32_t), playlist->offset_file) == sizeof(uint32_t)), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fread(&size, 1, sizeof(uint16_t), playlist->offset_file) == sizeof(uint16_t)), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fseek(playlist->save_file, pos, SEEK_SET) == 0), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fread(url_buff, 1, size, playlist->save_file) == size), return ESP_FAIL);
-        if (strlen(url_buff) != strlen(url)) {
+        // Only the URLs of the same length are read from the card
+        sdcard_list_entry_t *entry = sdcard_list_entry(playlist, i);
+        if (entry->len != len) {
             continue;
         }
-        if (strcmp(url, url_buff) == 0) {
-            audio_free(url_buff);
+        CHECK_ERROR(TAG, (fseek(playlist->save_file, entry->pos, SEEK_SET) == 0), return false);
+        CHECK_ERROR(TAG, (fread(url_buff, 1, entry->len, playlist->save_file) == entry->len), return false);
+        if (memcmp(url, url_buff, len) == 0) {
             return true;
         }
     }
+    return false;
+}
+
+bool sdcard_list_exist(playlist_operator_handle_t handle, const char *url)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    char *url_buff = audio_calloc(1, SDCARD_LIST_URL_MAX_LENGTH);
+    AUDIO_NULL_CHECK(TAG, url_buff, return false);
 
+    mutex_lock(playlist->lock);
+    bool found = sdcard_list_find(playlist, url, url_buff);
+    mutex_unlock(playlist->lock);
     audio_free(url_buff);
-    return false;
+    return found;
 }
 
 esp_err_t sdcard_list_reset(playlist_operator_handle_t handle)
@@ -371,6 +584,7 @@ esp_err_t sdcard_list_reset(playlist_operator_handle_t handle)
        CHECK_ERROR(TAG, (fseek(playlist->save_file, 0, SEEK_SET) == 0), return ESP_FAIL);
        CHECK_ERROR(TAG, (fseek(playlist->offset_file, 0, SEEK_SET) == 0), return ESP_FAIL);
     */
+    mutex_lock(playlist->lock);
     if (playlist->cur_url) {
         audio_free(playlist->cur_url);
         playlist->cur_url = NULL;
@@ -380,6 +594,8 @@ esp_err_t sdcard_list_reset(playlist_operator_handle_t handle)
     playlist->cur_url_id = 0;
     playlist->total_size_offset_file = 0;
     playlist->total_size_save_file = 0;
+    playlist->batch_fill = 0;
+    mutex_unlock(playlist->lock);
     return ESP_OK;
 }
 
@@ -389,7 +605,10 @@ int sdcard_list_get_url_num(playlist_operator_handle_t handle)
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    return playlist->url_num;
+    mutex_lock(playlist->lock);
+    int num = playlist->url_num;
+    mutex_unlock(playlist->lock);
+    return num;
 }
 
 int sdcard_list_get_url_id(playlist_operator_handle_t handle)
@@ -398,7 +617,10 @@ int sdcard_list_get_url_id(playlist_operator_handle_t handle)
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    return playlist->cur_url_id;
+    mutex_lock(playlist->lock);
+    int id = playlist->cur_url_id;
+    mutex_unlock(playlist->lock);
+    return id;
 }
 
 esp_err_t sdcard_list_destroy(playlist_operator_handle_t handle)
@@ -408,6 +630,8 @@ esp_err_t sdcard_list_destroy(playlist_operator_handle_t handle)
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
     sdcard_list_close(playlist);
+    sdcard_list_free_entries(playlist);
+    audio_free(playlist->batch_buf);
     remove(playlist->save_file_name);
     remove(playlist->offset_file_name);
     audio_free(playlist->save_file_name);
@@ -416,6 +640,7 @@ esp_err_t sdcard_list_destroy(playlist_operator_handle_t handle)
         audio_free(playlist->cur_url);
         playlist->cur_url = NULL;
     }
+    AUDIO_SAFE_FREE(playlist->lock, mutex_destroy);
     audio_free(playlist);
     handle->playlist = NULL;
     audio_free(handle);
@@ -436,6 +661,7 @@ esp_err_t sdcard_list_get_operation(playlist_operation_t *operation)
     operation->destroy = (void *)sdcard_list_destroy;
     operation->get_url_num = (void *)sdcard_list_get_url_num;
     operation->get_url_id  = (void *)sdcard_list_get_url_id;
+    operation->get_url     = (void *)sdcard_list_get_url;
     operation->type = PLAYLIST_SDCARD;
     return ESP_OK;
 }
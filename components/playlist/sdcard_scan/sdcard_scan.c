@@ -26,6 +26,7 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <stdio.h>
 #include <string.h>
 #include "esp_log.h"
 #include "audio_error.h"
@@ -35,75 +36,593 @@
 #define SDCARD_FILE_PREV_NAME           "file:/"
 #define SDCARD_SCAN_URL_MAX_LENGTH      (1024 * 2)
 
+#define SDCARD_SCAN_INDEX_MAGIC         (0x58444953)    /* "SIDX" */
+#define SDCARD_SCAN_INDEX_VERSION       (2)
+#define SDCARD_SCAN_INDEX_HEAD          (sizeof(uint32_t) * 5)
+#define SDCARD_SCAN_HASH_INIT           (2166136261u)   /* FNV-1a offset basis */
+#define SDCARD_SCAN_RECORD_HEAD         (sizeof(uint32_t) * 2 + sizeof(int64_t) + sizeof(uint32_t) + sizeof(uint16_t))
+#define SDCARD_SCAN_ENTRY_FILE          (0)
+#define SDCARD_SCAN_ENTRY_DIR           (1)
+
 static const char *TAG = "SDCARD_SCAN";
 
-static void scan_dir(sdcard_scan_cb_t save_url_cb, const char *path, int cur_depth, int depth, const char *file_extension[] , int filter_num, void *user_data)
+/*
+ * Index file layout, little endian as written by the target:
+ *
+ *   magic u32, version u32, filter hash u32, directory count u32, hash of the records u32
+ *   per directory record:
+ *     record size u32, entry count u32, mtime i64, hash of the names read u32, path length u16, path
+ *     per entry: type u8, name length u16, name
+ *
+ * A record lists the sub-directories and the files which pass the filter. A directory with the same modification
+ * time and the same names is replayed without a stat of each file. The names are read again because FatFs does not
+ * update the time of a directory, and the root of a volume has no time at all. Its sub-directories are looked up
+ * before the replay for their own times.
+ */
+
+typedef struct {
+    const char         *rec;
+    bool                built;          /* Allocated by `scan_index_build`, otherwise it points into the loaded index */
+} scan_record_t;
+
+typedef struct {
+    sdcard_scan_cb_t    cb;
+    void               *user_data;
+    const char        **file_extension;
+    int                 filter_num;
+    int                 depth;
+    char               *url;            /* SDCARD_FILE_PREV_NAME followed by the path being walked */
+    char               *old_index;      /* Index file loaded at start */
+    int                 old_size;
+    uint32_t           *slots;          /* Hash of the path to the offset + 1 of its record in `old_index` */
+    int                 slot_num;
+    uint32_t            old_dir_num;
+    scan_record_t      *order;          /* Records of the walked directories, in walk order */
+    uint32_t            dir_num;
+    uint32_t            order_cap;
+    bool                order_failed;   /* A record could not be kept, the index is not updated */
+    bool                changed;        /* The index differs from the one loaded */
+    int                 reused;
+    int                 rescanned;
+    int                 files;
+} sdcard_scan_ctx_t;
+
+static inline uint32_t scan_get_u32(const char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline int64_t scan_get_i64(const char *p)
 {
-    if (cur_depth > depth) {
+    int64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint16_t scan_get_u16(const char *p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t scan_hash(const char *str, int len, uint32_t hash)
+{
+    // FNV-1a
+    for (int i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)str[i]) * 16777619;
+    }
+    return hash;
+}
+
+static uint32_t scan_filter_hash(const char *file_extension[], int filter_num, int depth)
+{
+    uint32_t hash = scan_hash((const char *)&depth, sizeof(depth), SDCARD_SCAN_HASH_INIT);
+    for (int i = 0; i < filter_num; i++) {
+        hash = scan_hash(file_extension[i], strlen(file_extension[i]) + 1, hash);
+    }
+    return hash;
+}
+
+static bool scan_filter(sdcard_scan_ctx_t *ctx, const char *name)
+{
+    if (ctx->file_extension == NULL) {
+        return true;
+    }
+    const char *detect = strrchr(name, '.');
+    if (NULL == detect) {
+        return false;
+    }
+    detect++;
+    for (int i = 0; i < ctx->filter_num; i++) {
+        if (strcasecmp(detect, ctx->file_extension[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Append "/name" to the path in `ctx->url`, return the previous length to restore it
+ */
+static int scan_push(sdcard_scan_ctx_t *ctx, const char *name, int name_len)
+{
+    int len = strlen(ctx->url);
+    if (len + 1 + name_len >= SDCARD_SCAN_URL_MAX_LENGTH) {
+        ESP_LOGE(TAG, "The file name is too long, invalid url");
+        return -1;
+    }
+    ctx->url[len] = '/';
+    memcpy(ctx->url + len + 1, name, name_len);
+    ctx->url[len + 1 + name_len] = 0;
+    return len;
+}
+
+static void scan_dir(sdcard_scan_ctx_t *ctx, int cur_depth)
+{
+    if (cur_depth > ctx->depth) {
         ESP_LOGD(TAG, "scan depth = %d, exit", cur_depth);
         return;
     }
-    char *file_url = audio_calloc(1, SDCARD_SCAN_URL_MAX_LENGTH);
-    AUDIO_NULL_CHECK(TAG, file_url, return);
-
+    char *path = ctx->url + strlen(SDCARD_FILE_PREV_NAME);
     DIR *dir = opendir(path);
     if (dir == NULL) {
         ESP_LOGE(TAG, "Open [%s] directory failed", path);
-        audio_free(file_url);
         return;
     }
 
     struct dirent *file_info = NULL;
     while (NULL != (file_info = readdir(dir))) {
-        if ((strlen(file_info->d_name) + strlen(path)) > (SDCARD_SCAN_URL_MAX_LENGTH - strlen(SDCARD_FILE_PREV_NAME))) {
-            ESP_LOGE(TAG, "The file name is too long, invalid url");
+        if (file_info->d_name[0] == '.') {
             continue;
         }
-        if (file_info->d_name[0] == '.') {
+        if (file_info->d_type == DT_DIR && file_info->d_name[0] == '_' && file_info->d_name[1] == '_') {
+            continue;
+        }
+        if (file_info->d_type != DT_DIR && scan_filter(ctx, file_info->d_name) == false) {
+            continue;
+        }
+        int len = scan_push(ctx, file_info->d_name, strlen(file_info->d_name));
+        if (len < 0) {
             continue;
         }
-
         if (file_info->d_type == DT_DIR) {
-            if (file_info->d_name[0] == '_' && file_info->d_name[1] == '_') {
-                continue;
-            }
-            memset(file_url, 0, SDCARD_SCAN_URL_MAX_LENGTH);
-            sprintf(file_url, "%s/%s", path, file_info->d_name);
-            scan_dir(save_url_cb, file_url, cur_depth + 1, depth, file_extension, filter_num, user_data);
+            scan_dir(ctx, cur_depth + 1);
         } else {
-            memset(file_url, 0, SDCARD_SCAN_URL_MAX_LENGTH);
-            sprintf(file_url, "%s%s/%s", SDCARD_FILE_PREV_NAME, path, file_info->d_name);
-            if (NULL == file_extension) {
-                save_url_cb(user_data, file_url);
-                continue;
+            ctx->cb(ctx->user_data, ctx->url);
+        }
+        ctx->url[len] = 0;
+    }
+    closedir(dir);
+}
+
+esp_err_t sdcard_scan(sdcard_scan_cb_t cb, const char *path, int depth, const char *file_extension[], int filter_num, void *user_data)
+{
+    AUDIO_NULL_CHECK(TAG, cb, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, path, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, file_extension, return ESP_FAIL);
+    if (depth < 0 || filter_num < 0) {
+        ESP_LOGE(TAG, "Invalid parameters, please check");
+        return ESP_FAIL;
+    }
+    if (strlen(path) + strlen(SDCARD_FILE_PREV_NAME) >= SDCARD_SCAN_URL_MAX_LENGTH) {
+        ESP_LOGE(TAG, "The path is too long");
+        return ESP_FAIL;
+    }
+
+    sdcard_scan_ctx_t ctx = {
+        .cb = cb,
+        .user_data = user_data,
+        .file_extension = file_extension,
+        .filter_num = filter_num,
+        .depth = depth,
+    };
+    // One buffer for the whole walk, the path grows and shrinks in place
+    ctx.url = audio_calloc(1, SDCARD_SCAN_URL_MAX_LENGTH);
+    AUDIO_NULL_CHECK(TAG, ctx.url, return ESP_FAIL);
+    sprintf(ctx.url, "%s%s", SDCARD_FILE_PREV_NAME, path);
+    scan_dir(&ctx, 0);
+    audio_free(ctx.url);
+    return ESP_OK;
+}
+
+static esp_err_t scan_index_load(sdcard_scan_ctx_t *ctx, const char *index_file, uint32_t filter_hash)
+{
+    FILE *f = fopen(index_file, "rb");
+    if (f == NULL) {
+        ESP_LOGI(TAG, "No index at %s, scan everything", index_file);
+        return ESP_FAIL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < (long)SDCARD_SCAN_INDEX_HEAD) {
+        fclose(f);
+        return ESP_FAIL;
+    }
+    ctx->old_index = audio_malloc(size);
+    AUDIO_NULL_CHECK(TAG, ctx->old_index, {
+        fclose(f);
+        return ESP_FAIL;
+    });
+    // One sequential read of the whole index
+    size_t rlen = fread(ctx->old_index, 1, size, f);
+    fclose(f);
+    const char *p = ctx->old_index;
+    if (rlen != (size_t)size || scan_get_u32(p) != SDCARD_SCAN_INDEX_MAGIC || scan_get_u32(p + 4) != SDCARD_SCAN_INDEX_VERSION
+        || scan_get_u32(p + 8) != filter_hash) {
+        ESP_LOGI(TAG, "Index at %s is stale, scan everything", index_file);
+        goto _load_fail;
+    }
+    if (scan_hash(p + SDCARD_SCAN_INDEX_HEAD, size - SDCARD_SCAN_INDEX_HEAD, SDCARD_SCAN_HASH_INIT) != scan_get_u32(p + 16)) {
+        goto _load_corrupt;
+    }
+    uint32_t dir_num = scan_get_u32(p + 12);
+    ctx->slot_num = 16;
+    while ((uint32_t)ctx->slot_num < dir_num * 2) {
+        ctx->slot_num <<= 1;
+    }
+    ctx->slots = audio_calloc(ctx->slot_num, sizeof(uint32_t));
+    AUDIO_NULL_CHECK(TAG, ctx->slots, goto _load_fail);
+
+    uint32_t off = SDCARD_SCAN_INDEX_HEAD;
+    for (uint32_t i = 0; i < dir_num; i++) {
+        if (off + SDCARD_SCAN_RECORD_HEAD > (size_t)size) {
+            goto _load_corrupt;
+        }
+        uint32_t rec_size = scan_get_u32(p + off);
+        uint16_t path_len = scan_get_u16(p + off + SDCARD_SCAN_RECORD_HEAD - sizeof(uint16_t));
+        if (rec_size < SDCARD_SCAN_RECORD_HEAD + path_len || rec_size > size - off) {
+            goto _load_corrupt;
+        }
+        uint32_t slot = scan_hash(p + off + SDCARD_SCAN_RECORD_HEAD, path_len, SDCARD_SCAN_HASH_INIT) & (ctx->slot_num - 1);
+        while (ctx->slots[slot]) {
+            slot = (slot + 1) & (ctx->slot_num - 1);
+        }
+        ctx->slots[slot] = off + 1;
+        off += rec_size;
+    }
+    ctx->old_size = size;
+    ctx->old_dir_num = dir_num;
+    return ESP_OK;
+
+_load_corrupt:
+    ESP_LOGW(TAG, "Index at %s is corrupted, scan everything", index_file);
+_load_fail:
+    audio_free(ctx->slots);
+    ctx->slots = NULL;
+    audio_free(ctx->old_index);
+    ctx->old_index = NULL;
+    return ESP_FAIL;
+}
+
+static const char *scan_index_find(sdcard_scan_ctx_t *ctx, const char *path, int path_len)
+{
+    if (ctx->slots == NULL) {
+        return NULL;
+    }
+    uint32_t slot = scan_hash(path, path_len, SDCARD_SCAN_HASH_INIT) & (ctx->slot_num - 1);
+    while (ctx->slots[slot]) {
+        const char *rec = ctx->old_index + ctx->slots[slot] - 1;
+        if (scan_get_u16(rec + SDCARD_SCAN_RECORD_HEAD - sizeof(uint16_t)) == path_len
+            && memcmp(rec + SDCARD_SCAN_RECORD_HEAD, path, path_len) == 0) {
+            return rec;
+        }
+        slot = (slot + 1) & (ctx->slot_num - 1);
+    }
+    return NULL;
+}
+
+/*
+ * Hash the names of a directory, read without filter or stat, to notice a file added, removed or renamed
+ */
+static esp_err_t scan_dir_digest(const char *path, uint32_t *digest)
+{
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return ESP_FAIL;
+    }
+    uint32_t hash = SDCARD_SCAN_HASH_INIT;
+    struct dirent *file_info = NULL;
+    while (NULL != (file_info = readdir(dir))) {
+        hash = scan_hash(file_info->d_name, strlen(file_info->d_name) + 1, hash);
+    }
+    closedir(dir);
+    *digest = hash;
+    return ESP_OK;
+}
+
+/*
+ * Build the record of a changed directory, with its sub-directories and the files which pass the filter
+ */
+static char *scan_index_build(sdcard_scan_ctx_t *ctx, DIR *dir, const char *path, int path_len, int64_t mtime)
+{
+    uint32_t cap = SDCARD_SCAN_RECORD_HEAD + path_len + 512;
+    char *rec = audio_malloc(cap);
+    AUDIO_NULL_CHECK(TAG, rec, return NULL);
+    uint32_t size = SDCARD_SCAN_RECORD_HEAD + path_len;
+    uint32_t entry_num = 0;
+    uint32_t digest = SDCARD_SCAN_HASH_INIT;
+    struct dirent *file_info = NULL;
+    while (NULL != (file_info = readdir(dir))) {
+        const char *name = file_info->d_name;
+        digest = scan_hash(name, strlen(name) + 1, digest);
+        if (name[0] == '.') {
+            continue;
+        }
+        bool is_dir = (file_info->d_type == DT_DIR);
+        if ((is_dir && name[0] == '_' && name[1] == '_') || (is_dir == false && scan_filter(ctx, name) == false)) {
+            continue;
+        }
+        uint16_t name_len = strlen(name);
+        if (path_len + 1 + name_len + strlen(SDCARD_FILE_PREV_NAME) >= SDCARD_SCAN_URL_MAX_LENGTH) {
+            ESP_LOGE(TAG, "The file name is too long, invalid url");
+            continue;
+        }
+        if (size + 3 + name_len > cap) {
+            while (size + 3 + name_len > cap) {
+                cap *= 2;
+            }
+            char *grow = audio_realloc(rec, cap);
+            AUDIO_NULL_CHECK(TAG, grow, {
+                audio_free(rec);
+                return NULL;
+            });
+            rec = grow;
+        }
+        rec[size] = is_dir ? SDCARD_SCAN_ENTRY_DIR : SDCARD_SCAN_ENTRY_FILE;
+        memcpy(rec + size + 1, &name_len, sizeof(uint16_t));
+        memcpy(rec + size + 3, name, name_len);
+        size += 3 + name_len;
+        entry_num++;
+    }
+    uint16_t len16 = path_len;
+    memcpy(rec, &size, sizeof(uint32_t));
+    memcpy(rec + 4, &entry_num, sizeof(uint32_t));
+    memcpy(rec + 8, &mtime, sizeof(int64_t));
+    memcpy(rec + 16, &digest, sizeof(uint32_t));
+    memcpy(rec + 20, &len16, sizeof(uint16_t));
+    memcpy(rec + SDCARD_SCAN_RECORD_HEAD, path, path_len);
+    return rec;
+}
+
+static void scan_order_add(sdcard_scan_ctx_t *ctx, const char *rec, bool built)
+{
+    if (ctx->dir_num == ctx->order_cap) {
+        uint32_t cap = ctx->order_cap ? ctx->order_cap * 2 : 64;
+        scan_record_t *grow = audio_realloc(ctx->order, cap * sizeof(scan_record_t));
+        if (grow == NULL) {
+            ESP_LOGE(TAG, "No memory to keep the index, it is not updated");
+            ctx->order_failed = true;
+            if (built) {
+                audio_free((void *)rec);
             }
-            char *detect = strrchr(file_info->d_name, '.');
-            if (NULL == detect) {
-                continue;
+            return;
+        }
+        ctx->order = grow;
+        ctx->order_cap = cap;
+    }
+    ctx->order[ctx->dir_num].rec = rec;
+    ctx->order[ctx->dir_num].built = built;
+    ctx->dir_num++;
+}
+
+/*
+ * Look up the sub-directories listed in a record, fail if one is gone
+ */
+static esp_err_t scan_stat_subdirs(sdcard_scan_ctx_t *ctx, const char *rec, int path_len, int64_t *mtime)
+{
+    uint32_t entry_num = scan_get_u32(rec + 4);
+    const char *p = rec + SDCARD_SCAN_RECORD_HEAD + path_len;
+    int sub = 0;
+    for (uint32_t i = 0; i < entry_num; i++) {
+        uint16_t name_len = scan_get_u16(p + 1);
+        if (p[0] == SDCARD_SCAN_ENTRY_DIR) {
+            struct stat st = { 0 };
+            int len = scan_push(ctx, p + 3, name_len);
+            if (len < 0) {
+                return ESP_FAIL;
+            }
+            int ret = stat(ctx->url + strlen(SDCARD_FILE_PREV_NAME), &st);
+            ctx->url[len] = 0;
+            if (ret != 0 || S_ISDIR(st.st_mode) == false) {
+                return ESP_FAIL;
+            }
+            mtime[sub++] = st.st_mtime;
+        }
+        p += 3 + name_len;
+    }
+    return ESP_OK;
+}
+
+static int scan_count_subdirs(const char *rec, int path_len)
+{
+    uint32_t entry_num = scan_get_u32(rec + 4);
+    const char *p = rec + SDCARD_SCAN_RECORD_HEAD + path_len;
+    int sub = 0;
+    for (uint32_t i = 0; i < entry_num; i++) {
+        sub += (p[0] == SDCARD_SCAN_ENTRY_DIR);
+        p += 3 + scan_get_u16(p + 1);
+    }
+    return sub;
+}
+
+static void scan_dir_indexed(sdcard_scan_ctx_t *ctx, int cur_depth, int64_t mtime)
+{
+    if (cur_depth > ctx->depth) {
+        ESP_LOGD(TAG, "scan depth = %d, exit", cur_depth);
+        return;
+    }
+    char *path = ctx->url + strlen(SDCARD_FILE_PREV_NAME);
+    int path_len = strlen(path);
+    int64_t *sub_mtime = NULL;
+    bool built = false;
+
+    // Same time and names as in the index, trust the record without a stat of each file
+    const char *rec = scan_index_find(ctx, path, path_len);
+    uint32_t digest = 0;
+    if (rec && (scan_get_i64(rec + 8) != mtime || scan_dir_digest(path, &digest) != ESP_OK || digest != scan_get_u32(rec + 16))) {
+        rec = NULL;
+    }
+    if (rec && cur_depth < ctx->depth) {
+        int sub_num = scan_count_subdirs(rec, path_len);
+        if (sub_num > 0) {
+            sub_mtime = audio_calloc(sub_num, sizeof(int64_t));
+            if (sub_mtime == NULL || scan_stat_subdirs(ctx, rec, path_len, sub_mtime) != ESP_OK) {
+                ESP_LOGD(TAG, "A sub-directory of [%s] is gone, read it again", path);
+                audio_free(sub_mtime);
+                sub_mtime = NULL;
+                rec = NULL;
             }
-            detect ++;
-            for (int i = 0; i < filter_num; i++) {
-                if (strcasecmp(detect, file_extension[i]) == 0) {
-                    save_url_cb(user_data, file_url);
-                    break;
+        }
+    }
+    if (rec == NULL) {
+        DIR *dir = opendir(path);
+        if (dir == NULL) {
+            ESP_LOGE(TAG, "Open [%s] directory failed", path);
+            ctx->changed = true;
+            return;
+        }
+        rec = scan_index_build(ctx, dir, path, path_len, mtime);
+        closedir(dir);
+        if (rec == NULL) {
+            ctx->order_failed = true;
+            return;
+        }
+        built = true;
+        ctx->rescanned++;
+        ctx->changed = true;
+    } else {
+        ctx->reused++;
+    }
+    // Kept until the index is written, the walk below only reads it
+    scan_order_add(ctx, rec, built);
+
+    uint32_t entry_num = scan_get_u32(rec + 4);
+    const char *p = rec + SDCARD_SCAN_RECORD_HEAD + path_len;
+    int sub = 0;
+    for (uint32_t i = 0; i < entry_num; i++) {
+        uint16_t name_len = scan_get_u16(p + 1);
+        bool is_dir = (p[0] == SDCARD_SCAN_ENTRY_DIR);
+        int len = (is_dir && cur_depth >= ctx->depth) ? -1 : scan_push(ctx, p + 3, name_len);
+        if (len >= 0) {
+            if (is_dir) {
+                struct stat st = { 0 };
+                if (sub_mtime) {
+                    scan_dir_indexed(ctx, cur_depth + 1, sub_mtime[sub]);
+                } else if (stat(ctx->url + strlen(SDCARD_FILE_PREV_NAME), &st) == 0) {
+                    scan_dir_indexed(ctx, cur_depth + 1, st.st_mtime);
                 }
+            } else {
+                ctx->files++;
+                ctx->cb(ctx->user_data, ctx->url);
             }
+            ctx->url[len] = 0;
         }
+        sub += is_dir;
+        p += 3 + name_len;
     }
-    audio_free(file_url);
-    closedir(dir);
+    audio_free(sub_mtime);
 }
 
-esp_err_t sdcard_scan(sdcard_scan_cb_t cb, const char *path, int depth, const char *file_extension[], int filter_num, void *user_data)
+/*
+ * Write the index aside, then put it in place of the old one
+ */
+static void scan_index_save(sdcard_scan_ctx_t *ctx, const char *index_file, const char *tmp_name, uint32_t filter_hash)
+{
+    uint32_t body_hash = SDCARD_SCAN_HASH_INIT;
+    for (uint32_t i = 0; i < ctx->dir_num; i++) {
+        body_hash = scan_hash(ctx->order[i].rec, scan_get_u32(ctx->order[i].rec), body_hash);
+    }
+    FILE *f = fopen(tmp_name, "wb");
+    if (f == NULL) {
+        ESP_LOGW(TAG, "Failed to create %s, the index is not updated", tmp_name);
+        return;
+    }
+    uint32_t head[5] = { SDCARD_SCAN_INDEX_MAGIC, SDCARD_SCAN_INDEX_VERSION, filter_hash, ctx->dir_num, body_hash };
+    bool ok = (fwrite(head, 1, sizeof(head), f) == sizeof(head));
+    for (uint32_t i = 0; i < ctx->dir_num && ok; i++) {
+        uint32_t rec_size = scan_get_u32(ctx->order[i].rec);
+        ok = (fwrite(ctx->order[i].rec, 1, rec_size, f) == rec_size);
+    }
+    ok &= (fclose(f) == 0);
+    // FAT cannot rename onto an existing file. If power is lost in between, the next scan loads the complete `tmp_name`
+    if (ok) {
+        remove(index_file);
+    }
+    if (ok == false || rename(tmp_name, index_file) != 0) {
+        ESP_LOGE(TAG, "Failed to update the index %s", index_file);
+        remove(tmp_name);
+    }
+}
+
+esp_err_t sdcard_scan_incremental(sdcard_scan_cb_t cb, const char *path, int depth, const char *file_extension[], int filter_num,
+                                  const char *index_file, void *user_data)
 {
     AUDIO_NULL_CHECK(TAG, cb, return ESP_FAIL);
     AUDIO_NULL_CHECK(TAG, path, return ESP_FAIL);
     AUDIO_NULL_CHECK(TAG, file_extension, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, index_file, return ESP_FAIL);
     if (depth < 0 || filter_num < 0) {
         ESP_LOGE(TAG, "Invalid parameters, please check");
         return ESP_FAIL;
     }
+    if (strlen(path) + strlen(SDCARD_FILE_PREV_NAME) >= SDCARD_SCAN_URL_MAX_LENGTH) {
+        ESP_LOGE(TAG, "The path is too long");
+        return ESP_FAIL;
+    }
 
-    scan_dir(cb, path, 0, depth, file_extension, filter_num, user_data);
+    sdcard_scan_ctx_t ctx = {
+        .cb = cb,
+        .user_data = user_data,
+        .file_extension = file_extension,
+        .filter_num = filter_num,
+        .depth = depth,
+    };
+    char *tmp_name = audio_calloc(1, strlen(index_file) + 5);
+    ctx.url = audio_calloc(1, SDCARD_SCAN_URL_MAX_LENGTH);
+    AUDIO_NULL_CHECK(TAG, ctx.url && tmp_name, {
+        audio_free(ctx.url);
+        audio_free(tmp_name);
+        return ESP_FAIL;
+    });
+    sprintf(ctx.url, "%s%s", SDCARD_FILE_PREV_NAME, path);
+    sprintf(tmp_name, "%s.new", index_file);
+
+    uint32_t filter_hash = scan_filter_hash(file_extension, filter_num, depth);
+    if (scan_index_load(&ctx, index_file, filter_hash) != ESP_OK) {
+        // Power lost between removing the old index and renaming the new one
+        if (access(tmp_name, F_OK) == 0 && scan_index_load(&ctx, tmp_name, filter_hash) == ESP_OK) {
+            ESP_LOGW(TAG, "Recovered the index from %s", tmp_name);
+        }
+        ctx.changed = true;
+    }
+
+    struct stat st = { 0 };
+    if (stat(path, &st) == 0) {
+        scan_dir_indexed(&ctx, 0, st.st_mtime);
+    } else {
+        ESP_LOGE(TAG, "Open [%s] directory failed", path);
+    }
+
+    // Every record is either reused or built again, so the same count means the same directories
+    ctx.changed |= (ctx.dir_num != ctx.old_dir_num);
+    if (ctx.changed && ctx.order_failed == false && ctx.dir_num > 0) {
+        scan_index_save(&ctx, index_file, tmp_name, filter_hash);
+    }
+    ESP_LOGI(TAG, "Scanned %s, %d directories reused, %d rescanned, %d files%s", path, ctx.reused, ctx.rescanned, ctx.files,
+             ctx.changed ? "" : ", index unchanged");
+    for (uint32_t i = 0; i < ctx.dir_num; i++) {
+        if (ctx.order[i].built) {
+            audio_free((void *)ctx.order[i].rec);
+        }
+    }
+    audio_free(ctx.order);
+    audio_free(ctx.slots);
+    audio_free(ctx.old_index);
+    audio_free(ctx.url);
+    audio_free(tmp_name);
     return ESP_OK;
 }
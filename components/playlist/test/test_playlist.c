@@ -22,7 +22,16 @@
  *
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
 #include "esp_peripherals.h"
 #include "periph_sdcard.h"
 #include "board.h"
@@ -33,6 +42,7 @@
 #include "partition_list.h"
 #include "unity.h"
 #include "sdcard_scan.h"
+#include "playlist_meta.h"
 
 static const char *TAG = "TEST_PLAYLIST";
 
@@ -520,6 +530,352 @@ TEST_CASE("Create a sdcard playlist and scan sdcard then save the specified url
     TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
 }
 
+#define TEST_SCAN_DIR       "/sdcard/scan_test"
+#define TEST_SCAN_INDEX     "/sdcard/__playlist/_scan_test_index"
+#define TEST_SCAN_URL_MAX   (8)
+
+static char test_scan_urls[TEST_SCAN_URL_MAX][64];
+static int test_scan_url_num;
+
+static void test_scan_cb(void *user_data, char *url)
+{
+    if (test_scan_url_num < TEST_SCAN_URL_MAX) {
+        snprintf(test_scan_urls[test_scan_url_num], sizeof(test_scan_urls[0]), "%s", url);
+    }
+    test_scan_url_num++;
+}
+
+static void test_scan_run(void)
+{
+    test_scan_url_num = 0;
+    TEST_ASSERT_FALSE(sdcard_scan_incremental(test_scan_cb, TEST_SCAN_DIR, 1, (const char *[]) {"mp3"}, 1, TEST_SCAN_INDEX, NULL));
+}
+
+static bool test_scan_found(const char *name)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "file:/%s/%s", TEST_SCAN_DIR, name);
+    for (int i = 0; i < test_scan_url_num && i < TEST_SCAN_URL_MAX; i++) {
+        if (strcmp(test_scan_urls[i], url) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_scan_create(const char *name)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", TEST_SCAN_DIR, name);
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    fclose(f);
+}
+
+static void test_scan_clean(void)
+{
+    const char *names[] = {"1.mp3", "2.mp3", "4.mp3", "5.mp3", "6.mp3", "note.txt", "sub/3.mp3", "sub2/3.mp3", "sub2/7.mp3"};
+    char path[64];
+    for (int i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", TEST_SCAN_DIR, names[i]);
+        remove(path);
+    }
+    rmdir(TEST_SCAN_DIR "/sub");
+    rmdir(TEST_SCAN_DIR "/sub2");
+    rmdir(TEST_SCAN_DIR);
+    remove(TEST_SCAN_INDEX);
+    remove(TEST_SCAN_INDEX ".new");
+}
+
+TEST_CASE("Scan a sdcard incrementally and notice added, renamed and replaced files", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+    test_scan_clean();
+    mkdir("/sdcard/__playlist", 0775);
+    TEST_ASSERT_EQUAL(0, mkdir(TEST_SCAN_DIR, 0775));
+    TEST_ASSERT_EQUAL(0, mkdir(TEST_SCAN_DIR "/sub", 0775));
+    test_scan_create("1.mp3");
+    test_scan_create("2.mp3");
+    test_scan_create("note.txt");
+    test_scan_create("sub/3.mp3");
+    struct stat st;
+
+    // No directory time is set below, FatFs leaves them alone when files change
+    test_scan_run();
+    TEST_ASSERT_EQUAL(3, test_scan_url_num);
+    TEST_ASSERT_TRUE(test_scan_found("1.mp3") && test_scan_found("2.mp3") && test_scan_found("sub/3.mp3"));
+    TEST_ASSERT_EQUAL(0, stat(TEST_SCAN_INDEX, &st));
+
+    // Nothing changed, the index is not written again and the stale temporary file stays
+    FILE *f = fopen(TEST_SCAN_INDEX ".new", "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    fclose(f);
+    test_scan_run();
+    TEST_ASSERT_EQUAL(3, test_scan_url_num);
+    TEST_ASSERT_EQUAL(0, stat(TEST_SCAN_INDEX ".new", &st));
+    TEST_ASSERT_EQUAL(0, remove(TEST_SCAN_INDEX ".new"));
+
+    // Renamed file
+    TEST_ASSERT_EQUAL(0, rename(TEST_SCAN_DIR "/1.mp3", TEST_SCAN_DIR "/4.mp3"));
+    test_scan_run();
+    TEST_ASSERT_EQUAL(3, test_scan_url_num);
+    TEST_ASSERT_TRUE(test_scan_found("4.mp3"));
+    TEST_ASSERT_FALSE(test_scan_found("1.mp3"));
+
+    // Replaced file, the directory keeps its number of entries
+    TEST_ASSERT_EQUAL(0, remove(TEST_SCAN_DIR "/2.mp3"));
+    test_scan_create("5.mp3");
+    test_scan_run();
+    TEST_ASSERT_EQUAL(3, test_scan_url_num);
+    TEST_ASSERT_TRUE(test_scan_found("5.mp3"));
+    TEST_ASSERT_FALSE(test_scan_found("2.mp3"));
+
+    // Added files, in the scanned directory and in a sub-directory
+    test_scan_create("6.mp3");
+    test_scan_create("sub/7.mp3");
+    test_scan_run();
+    TEST_ASSERT_EQUAL(5, test_scan_url_num);
+    TEST_ASSERT_TRUE(test_scan_found("6.mp3") && test_scan_found("sub/7.mp3"));
+
+    // Renamed sub-directory
+    TEST_ASSERT_EQUAL(0, rename(TEST_SCAN_DIR "/sub", TEST_SCAN_DIR "/sub2"));
+    test_scan_run();
+    TEST_ASSERT_EQUAL(5, test_scan_url_num);
+    TEST_ASSERT_TRUE(test_scan_found("sub2/3.mp3") && test_scan_found("sub2/7.mp3"));
+    TEST_ASSERT_FALSE(test_scan_found("sub/3.mp3"));
+
+    test_scan_clean();
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+TEST_CASE("Save urls to a sdcard playlist in a batch and read them back", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    playlist_operator_handle_t sdcard_handle = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+
+    char url_buff[64];
+    char *url = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_batch_begin(sdcard_handle));
+    for (int i = 0; i < 1000; i++) {
+        sprintf(url_buff, "sdcard playlist batch url %d", i);
+        TEST_ASSERT_FALSE(sdcard_list_save(sdcard_handle, url_buff));
+    }
+    TEST_ASSERT_FALSE(sdcard_list_choose(sdcard_handle, 999, &url));
+    TEST_ASSERT_EQUAL_STRING("sdcard playlist batch url 999", url);
+    TEST_ASSERT_FALSE(sdcard_list_batch_commit(sdcard_handle));
+
+    TEST_ASSERT_EQUAL(1000, sdcard_list_get_url_num(sdcard_handle));
+    TEST_ASSERT_FALSE(sdcard_list_choose(sdcard_handle, 500, &url));
+    TEST_ASSERT_EQUAL_STRING("sdcard playlist batch url 500", url);
+    TEST_ASSERT_FALSE(sdcard_list_prev(sdcard_handle, 1, &url));
+    TEST_ASSERT_EQUAL_STRING("sdcard playlist batch url 499", url);
+    TEST_ASSERT_TRUE(sdcard_list_exist(sdcard_handle, "sdcard playlist batch url 7"));
+    TEST_ASSERT_FALSE(sdcard_list_exist(sdcard_handle, "sdcard playlist batch url 1000"));
+
+    TEST_ASSERT_FALSE(sdcard_list_destroy(sdcard_handle));
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+#define TEST_SDCARD_LIST_SINGLE   (200)
+#define TEST_SDCARD_LIST_BATCH    (5000)
+
+TEST_CASE("Benchmark single and batched saves to a sdcard playlist", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    char url_buff[64];
+    playlist_operator_handle_t sdcard_handle = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < TEST_SDCARD_LIST_SINGLE; i++) {
+        sprintf(url_buff, "file://sdcard/music/single/track_%04d.mp3", i);
+        TEST_ASSERT_FALSE(sdcard_list_save(sdcard_handle, url_buff));
+    }
+    int64_t single_us = esp_timer_get_time() - start;
+    TEST_ASSERT_FALSE(sdcard_list_destroy(sdcard_handle));
+
+    sdcard_handle = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+    start = esp_timer_get_time();
+    TEST_ASSERT_FALSE(sdcard_list_batch_begin(sdcard_handle));
+    for (int i = 0; i < TEST_SDCARD_LIST_BATCH; i++) {
+        sprintf(url_buff, "file://sdcard/music/batch/track_%04d.mp3", i);
+        TEST_ASSERT_FALSE(sdcard_list_save(sdcard_handle, url_buff));
+    }
+    TEST_ASSERT_FALSE(sdcard_list_batch_commit(sdcard_handle));
+    int64_t batch_us = esp_timer_get_time() - start;
+    TEST_ASSERT_EQUAL(TEST_SDCARD_LIST_BATCH, sdcard_list_get_url_num(sdcard_handle));
+    TEST_ASSERT_FALSE(sdcard_list_destroy(sdcard_handle));
+
+    ESP_LOGI(TAG, "%d single saves %lld us (%lld us each), %d batched saves %lld us (%lld us each)",
+             TEST_SDCARD_LIST_SINGLE, single_us, single_us / TEST_SDCARD_LIST_SINGLE,
+             TEST_SDCARD_LIST_BATCH, batch_us, batch_us / TEST_SDCARD_LIST_BATCH);
+    TEST_ASSERT_TRUE(batch_us / TEST_SDCARD_LIST_BATCH < single_us / TEST_SDCARD_LIST_SINGLE);
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+TEST_CASE("Save urls to a partition playlist in a batch and open it again", "[playlist]")
+{
+    playlist_operator_handle_t partition_handle = NULL;
+    TEST_ASSERT_FALSE(partition_list_create(&partition_handle));
+
+    char url_buff[64];
+    char *url = NULL;
+    TEST_ASSERT_FALSE(partition_list_batch_begin(partition_handle));
+    for (int i = 0; i < 500; i++) {
+        sprintf(url_buff, "partition playlist batch url %d", i);
+        TEST_ASSERT_FALSE(partition_list_save(partition_handle, url_buff));
+    }
+    TEST_ASSERT_FALSE(partition_list_choose(partition_handle, 499, &url));
+    TEST_ASSERT_EQUAL_STRING("partition playlist batch url 499", url);
+    TEST_ASSERT_FALSE(partition_list_batch_commit(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_remove_by_url(partition_handle, "partition playlist batch url 0"));
+    TEST_ASSERT_FALSE(partition_list_remove_by_url_id(partition_handle, 0));
+    TEST_ASSERT_FALSE(partition_list_destroy(partition_handle));
+
+    TEST_ASSERT_FALSE(partition_list_open(&partition_handle));
+    TEST_ASSERT_EQUAL(498, partition_list_get_url_num(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_choose(partition_handle, 0, &url));
+    TEST_ASSERT_EQUAL_STRING("partition playlist batch url 2", url);
+    TEST_ASSERT_TRUE(partition_list_exist(partition_handle, "partition playlist batch url 250"));
+    TEST_ASSERT_FALSE(partition_list_exist(partition_handle, "partition playlist batch url 1"));
+    TEST_ASSERT_FALSE(partition_list_reset(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_destroy(partition_handle));
+}
+
+/* Size of the url partition, which holds the log of the partition playlist */
+static int partition_list_test_size(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, 0x06, NULL);
+    TEST_ASSERT_NOT_NULL(part);
+    return part->size;
+}
+
+TEST_CASE("Compact a partition playlist in the middle of a batch", "[playlist]")
+{
+    playlist_operator_handle_t partition_handle = NULL;
+    TEST_ASSERT_FALSE(partition_list_create(&partition_handle));
+
+    char url_buff[64];
+    char *url = NULL;
+    TEST_ASSERT_FALSE(partition_list_batch_begin(partition_handle));
+    for (int i = 0; i < 200; i++) {
+        sprintf(url_buff, "partition playlist committed url %d", i);
+        TEST_ASSERT_FALSE(partition_list_save(partition_handle, url_buff));
+    }
+    TEST_ASSERT_FALSE(partition_list_batch_commit(partition_handle));
+
+    // Each url saved and removed takes more than 32 bytes of log, the batch writes twice the partition
+    int urls = 2 * partition_list_test_size() / 32;
+    TEST_ASSERT_FALSE(partition_list_batch_begin(partition_handle));
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_FALSE(partition_list_remove_by_url_id(partition_handle, 0));
+    }
+    for (int i = 0; i < urls; i++) {
+        sprintf(url_buff, "partition playlist batch url %d", i);
+        TEST_ASSERT_FALSE(partition_list_save(partition_handle, url_buff));
+        if (i < urls - 100) {
+            TEST_ASSERT_FALSE(partition_list_remove_by_url(partition_handle, url_buff));
+        }
+    }
+    TEST_ASSERT_EQUAL(200, partition_list_get_url_num(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_batch_commit(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_destroy(partition_handle));
+
+    TEST_ASSERT_FALSE(partition_list_open(&partition_handle));
+    TEST_ASSERT_EQUAL(200, partition_list_get_url_num(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_choose(partition_handle, 0, &url));
+    TEST_ASSERT_EQUAL_STRING("partition playlist committed url 100", url);
+    sprintf(url_buff, "partition playlist batch url %d", urls - 1);
+    TEST_ASSERT_FALSE(partition_list_choose(partition_handle, 199, &url));
+    TEST_ASSERT_EQUAL_STRING(url_buff, url);
+    TEST_ASSERT_FALSE(partition_list_exist(partition_handle, "partition playlist committed url 99"));
+    sprintf(url_buff, "partition playlist batch url %d", urls - 101);
+    TEST_ASSERT_FALSE(partition_list_exist(partition_handle, url_buff));
+    TEST_ASSERT_FALSE(partition_list_reset(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_destroy(partition_handle));
+}
+
+TEST_CASE("Fill a partition playlist to the last bytes and open it again", "[playlist]")
+{
+    playlist_operator_handle_t partition_handle = NULL;
+    TEST_ASSERT_FALSE(partition_list_create(&partition_handle));
+
+    char url_buff[64];
+    TEST_ASSERT_FALSE(partition_list_save(partition_handle, "partition playlist committed url 0"));
+    TEST_ASSERT_FALSE(partition_list_save(partition_handle, "partition playlist committed url 1"));
+    // The lengths vary, so the last url ends anywhere near the end of the log
+    int saved = 0;
+    int max = partition_list_test_size() / 16;
+    TEST_ASSERT_FALSE(partition_list_batch_begin(partition_handle));
+    for (; saved < max; saved++) {
+        sprintf(url_buff, "partition playlist full url %d%.*s", saved, saved % 7, "xxxxxxx");
+        if (partition_list_save(partition_handle, url_buff) != ESP_OK) {
+            break;
+        }
+    }
+    TEST_ASSERT_LESS_THAN(max, saved);
+    TEST_ASSERT_FALSE(partition_list_batch_commit(partition_handle));
+    // A save on the full log fails and is not kept
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, partition_list_save(partition_handle, "partition playlist one url too many"));
+    TEST_ASSERT_EQUAL(2 + saved, partition_list_get_url_num(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_destroy(partition_handle));
+
+    TEST_ASSERT_FALSE(partition_list_open(&partition_handle));
+    TEST_ASSERT_EQUAL(2 + saved, partition_list_get_url_num(partition_handle));
+    TEST_ASSERT_TRUE(partition_list_exist(partition_handle, "partition playlist committed url 1"));
+    TEST_ASSERT_FALSE(partition_list_exist(partition_handle, "partition playlist one url too many"));
+    TEST_ASSERT_FALSE(partition_list_reset(partition_handle));
+    TEST_ASSERT_FALSE(partition_list_destroy(partition_handle));
+}
+
+TEST_CASE("Index the metadata of a sdcard playlist in the background", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    playlist_handle_t handle = playlist_create();
+    TEST_ASSERT_NOT_NULL(handle);
+    playlist_operator_handle_t sdcard_handle = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, sdcard_handle, 0));
+    TEST_ASSERT_FALSE(sdcard_scan(scan_sdcard_cb, "/sdcard", 0, (const char *[]) {"mp3", "wav", "aac", "flac", "m4a", "ogg", "opus"}, 7, handle));
+
+    playlist_meta_cfg_t meta_cfg = PLAYLIST_META_CFG_DEFAULT();
+    meta_cfg.list_id = 0;
+    meta_cfg.index_file = "/sdcard/__playlist/_meta";
+    playlist_meta_handle_t meta = playlist_meta_create(handle, &meta_cfg);
+    TEST_ASSERT_NOT_NULL(meta);
+
+    int indexed = 0, total = 0;
+    uint64_t duration_ms = 0;
+    for (int i = 0; i < 600; i++) {
+        TEST_ASSERT_FALSE(playlist_meta_get_summary(meta, &indexed, &total, &duration_ms));
+        if (total > 0 && indexed == total) {
+            break;
+        }
+        vTaskDelay(100 / portTICK_PERIOD_MS);
+    }
+    ESP_LOGI(TAG, "%d of %d urls indexed, %llu ms in total", indexed, total, duration_ms);
+    TEST_ASSERT_EQUAL(playlist_get_current_list_url_num(handle), total);
+
+    playlist_meta_info_t info;
+    for (int i = 0; i < total; i++) {
+        TEST_ASSERT_FALSE(playlist_meta_get(meta, i, &info));
+        ESP_LOGI(TAG, "%d: codec %d, %u ms, %u bps, [%s] [%s] [%s]", i, info.codec, info.duration_ms, info.bitrate,
+                 info.title, info.artist, info.album);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, playlist_meta_get(meta, total, &info));
+
+    TEST_ASSERT_FALSE(playlist_meta_destroy(meta));
+    TEST_ASSERT_FALSE(playlist_destroy(handle));
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
 
 /**
  * Abnormal operation and stress test
@@ -884,3 +1240,50 @@ TEST_CASE("Remove fuction test in dram list", "[playlist]")
 
     TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
 }
+
+TEST_CASE("Shuffle and repeat one modes of a playlist", "[playlist]")
+{
+    playlist_handle_t handle = playlist_create();
+    TEST_ASSERT_NOT_NULL(handle);
+    playlist_operator_handle_t dram_handle = NULL;
+    TEST_ASSERT_FALSE(dram_list_create(&dram_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, dram_handle, 0));
+
+    char url_buff[32];
+    char *url = NULL;
+    int order[100] = {0};
+    bool played[100] = {0};
+    for (int i = 0; i < 100; i++) {
+        sprintf(url_buff, "%d", i);
+        TEST_ASSERT_FALSE(playlist_save(handle, url_buff));
+    }
+
+    TEST_ASSERT_FALSE(playlist_set_shuffle_seed(handle, 2025));
+    TEST_ASSERT_FALSE(playlist_set_mode(handle, PLAYLIST_MODE_SHUFFLE));
+    TEST_ASSERT_EQUAL(PLAYLIST_MODE_SHUFFLE, playlist_get_mode(handle));
+    TEST_ASSERT_FALSE(playlist_get_current_list_url(handle, &url));
+    order[0] = atoi(url);
+    played[order[0]] = true;
+    for (int i = 1; i < 100; i++) {
+        TEST_ASSERT_FALSE(playlist_next(handle, 1, &url));
+        order[i] = atoi(url);
+        TEST_ASSERT_FALSE(played[order[i]]);
+        played[order[i]] = true;
+    }
+    for (int i = 98; i >= 0; i--) {
+        TEST_ASSERT_FALSE(playlist_prev(handle, 1, &url));
+        TEST_ASSERT_EQUAL(order[i], atoi(url));
+    }
+    TEST_ASSERT_FALSE(playlist_next(handle, 50, &url));
+    TEST_ASSERT_EQUAL(order[50], atoi(url));
+
+    TEST_ASSERT_FALSE(playlist_set_mode(handle, PLAYLIST_MODE_REPEAT_ONE));
+    TEST_ASSERT_FALSE(playlist_next(handle, 1, &url));
+    TEST_ASSERT_EQUAL(order[50], atoi(url));
+
+    TEST_ASSERT_FALSE(playlist_set_mode(handle, PLAYLIST_MODE_SEQUENTIAL));
+    TEST_ASSERT_FALSE(playlist_next(handle, 1, &url));
+    TEST_ASSERT_EQUAL((order[50] + 1) % 100, atoi(url));
+
+    TEST_ASSERT_FALSE(playlist_destroy(handle));
+}
@@ -143,6 +143,35 @@ esp_err_t tone_partition_get_file_info(tone_partition_handle_t handle, uint16_t
  */
 esp_err_t tone_partition_file_read(tone_partition_handle_t handle, tone_file_info_t *file, uint32_t offset, char *dst, int read_len);
 
+/**
+ * @brief      Map the tone partition into the data address space, once for the life of the handle.
+ *             After that the reads are memory copies from the mapping, and `tone_partition_file_data` gives direct pointers.
+ *
+ * @note       The mapping takes MMU pages for the whole partition, it is released by `tone_partition_deinit`.
+ *             With `use_delegate`, the mapping is done by the delegate task like the reads.
+ *
+ * @param[in]  handle   Pointer to 'tone_partition_handle_t' structure
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - others: Failed, the partition is still read with `esp_partition_read`
+ */
+esp_err_t tone_partition_mmap(tone_partition_handle_t handle);
+
+/**
+ * @brief      Get a pointer to the data of a file in the mapped tone partition, the data is read-only.
+ *
+ * @param[in]  handle   Pointer to 'tone_partition_handle_t' structure
+ * @param[in]  file     File information from `tone_partition_get_file_info`
+ * @param[out] data     Start of the file data, valid until `tone_partition_deinit`
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_STATE: The partition is not mapped
+ *      - others: Failed
+ */
+esp_err_t tone_partition_file_data(tone_partition_handle_t handle, tone_file_info_t *file, const uint8_t **data);
+
 #ifdef __cplusplus
 }
 #endif
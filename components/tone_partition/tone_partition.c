@@ -42,6 +42,9 @@ typedef struct tone_partition_s {
     flash_tone_header_t header;
     const esp_partition_t *(*find)(esp_partition_type_t, esp_partition_subtype_t, const char *);
     esp_err_t (*read)(const esp_partition_t *, size_t, void *, size_t);
+    bool use_delegate;
+    const uint8_t *map;
+    spi_flash_mmap_handle_t map_handle;
 } tone_partition_t;
 
 static const char *TAG = "TONE_PARTITION";
@@ -87,6 +90,54 @@ static esp_err_t partition_read_with_dispatcher(const esp_partition_t *partition
     return result.err;
 }
 
+static esp_err_t partition_mmap_with_dispatcher(const esp_partition_t *partition, const void **ptr, spi_flash_mmap_handle_t *handle)
+{
+    esp_dispatcher_handle_t dispatcher = esp_dispatcher_get_delegate_handle();
+    if (!dispatcher) {
+        return ESP_FAIL;
+    }
+    partition_mmap_args_t mmap_arg = {
+        .partition = partition,
+        .offset = 0,
+        .size = partition->size,
+        .out_ptr = ptr,
+        .out_handle = handle,
+    };
+    action_arg_t arg = {
+        .data = &mmap_arg,
+        .len = sizeof(partition_mmap_args_t),
+    };
+    action_result_t result = { 0 };
+    esp_dispatcher_execute_with_func(dispatcher, partition_mmap_action, NULL, &arg, &result);
+    return result.err;
+}
+
+static void partition_munmap_with_dispatcher(spi_flash_mmap_handle_t handle)
+{
+    esp_dispatcher_handle_t dispatcher = esp_dispatcher_get_delegate_handle();
+    if (!dispatcher) {
+        return;
+    }
+    action_arg_t arg = {
+        .data = &handle,
+        .len = sizeof(spi_flash_mmap_handle_t),
+    };
+    action_result_t result = { 0 };
+    esp_dispatcher_execute_with_func(dispatcher, partition_munmap_action, NULL, &arg, &result);
+}
+
+static esp_err_t tone_partition_read(tone_partition_handle_t handle, size_t src_offset, void *dst, size_t size)
+{
+    if (handle->map) {
+        if (src_offset + size > handle->partition->size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(dst, handle->map + src_offset, size);
+        return ESP_OK;
+    }
+    return handle->read(handle->partition, src_offset, dst, size);
+}
+
 esp_err_t tone_partition_get_file_info(tone_partition_handle_t handle, uint16_t index, tone_file_info_t *info)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
@@ -106,7 +157,7 @@ esp_err_t tone_partition_get_file_info(tone_partition_handle_t handle, uint16_t
         ESP_LOGE(TAG, "Tone format not support!");
         return ESP_FAIL;
     }
-    if (ESP_OK == handle->read(handle->partition, start_adr, &info_tmp, sizeof(info_tmp))) {
+    if (ESP_OK == tone_partition_read(handle, start_adr, &info_tmp, sizeof(info_tmp))) {
         //TODO check crc
         if (info_tmp.file_tag == FLASH_TONE_FILE_TAG) {
             memcpy(info, &info_tmp, sizeof(info_tmp));
@@ -123,13 +174,56 @@ esp_err_t tone_partition_file_read(tone_partition_handle_t handle, tone_file_inf
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     AUDIO_NULL_CHECK(TAG, file, return ESP_FAIL);
 
-    esp_err_t err = handle->read(handle->partition, file->song_adr + offset, dst, read_len);
+    esp_err_t err = tone_partition_read(handle, file->song_adr + offset, dst, read_len);
     if (ESP_OK != err) {
         ESP_LOGE(TAG, "Tone file read error[0x%x]", err);
     }
     return err;
 }
 
+esp_err_t tone_partition_file_data(tone_partition_handle_t handle, tone_file_info_t *file, const uint8_t **data)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, file, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, data, return ESP_FAIL);
+
+    if (handle->map == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (file->song_adr > handle->partition->size || file->song_len > handle->partition->size - file->song_adr) {
+        ESP_LOGE(TAG, "Tone file out of the partition, addr %"PRIX32", len %"PRIu32, file->song_adr, file->song_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *data = handle->map + file->song_adr;
+    return ESP_OK;
+}
+
+esp_err_t tone_partition_mmap(tone_partition_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    if (handle->map) {
+        return ESP_OK;
+    }
+    const void *ptr = NULL;
+    esp_err_t err = ESP_OK;
+    if (handle->use_delegate) {
+        err = partition_mmap_with_dispatcher(handle->partition, &ptr, &handle->map_handle);
+    } else {
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
+        err = esp_partition_mmap(handle->partition, 0, handle->partition->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle->map_handle);
+#else
+        err = esp_partition_mmap(handle->partition, 0, handle->partition->size, SPI_FLASH_MMAP_DATA, &ptr, &handle->map_handle);
+#endif
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Map tone partition failed[0x%x]", err);
+        return err;
+    }
+    handle->map = ptr;
+    ESP_LOGI(TAG, "Tone partition mapped at %p, size %"PRIu32, ptr, handle->partition->size);
+    return ESP_OK;
+}
+
 static esp_err_t tone_partition_get_tail(tone_partition_handle_t handle, uint16_t *tail)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
@@ -139,7 +233,7 @@ static esp_err_t tone_partition_get_tail(tone_partition_handle_t handle, uint16_
         tone_partition_get_file_info(handle, handle->header.total_num - 1, &last_file);
         int tail_addr = last_file.song_adr + last_file.song_len + ((4 - last_file.song_len % 4) % 4) + 4;
         ESP_LOGD(TAG, "addr %"PRIX32", len %"PRIX32", tail %X", last_file.song_adr, last_file.song_len, tail_addr);
-        return handle->read(handle->partition, tail_addr, tail, sizeof(uint16_t));
+        return tone_partition_read(handle, tail_addr, tail, sizeof(uint16_t));
     } else {
         *tail = 0;
         ESP_LOGE(TAG, "No tail");
@@ -150,7 +244,7 @@ static esp_err_t tone_partition_get_tail(tone_partition_handle_t handle, uint16_
 esp_err_t tone_partition_get_app_desc(tone_partition_handle_t handle, esp_app_desc_t *desc)
 {
     if (handle != NULL && handle->header.format == TONE_VERSION_1) {
-        if (ESP_OK == handle->read(handle->partition, sizeof(flash_tone_header_t), desc, sizeof(esp_app_desc_t))) {
+        if (ESP_OK == tone_partition_read(handle, sizeof(flash_tone_header_t), desc, sizeof(esp_app_desc_t))) {
             return ESP_OK;
         }
     }
@@ -163,6 +257,7 @@ tone_partition_handle_t tone_partition_init(const char *partition_label, bool us
     AUDIO_NULL_CHECK(TAG, partition_label, return NULL);
     tone_partition_t *tone = audio_calloc(1, sizeof(tone_partition_t));
     AUDIO_NULL_CHECK(TAG, tone, return NULL);
+    tone->use_delegate = use_delegate;
     if (use_delegate) {
         tone->find = partition_find_with_dispatcher;
         tone->read = partition_read_with_dispatcher;
@@ -203,6 +298,14 @@ error:
 esp_err_t tone_partition_deinit(tone_partition_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    if (handle->map) {
+        if (handle->use_delegate) {
+            partition_munmap_with_dispatcher(handle->map_handle);
+        } else {
+            spi_flash_munmap(handle->map_handle);
+        }
+        handle->map = NULL;
+    }
     free(handle);
     return ESP_OK;
 }
@@ -383,8 +383,10 @@ static esp_err_t playlist_sd_scan(esp_periph_handle_t periph, int argc, char *ar
             return ESP_ERR_INVALID_ARG;
         }
         sdcard_list_reset(playlist);
+        sdcard_list_batch_begin(playlist);
         sdcard_scan(sdcard_url_save_cb, argv[0],
         0, (const char *[]) {"mp3", "m4a", "flac", "ogg", "opus", "amr", "ts", "aac", "wav"}, 9, playlist);
+        sdcard_list_batch_commit(playlist);
         sdcard_list_show(playlist);
     } else {
         ESP_LOGE(TAG, "Please enter the can path");
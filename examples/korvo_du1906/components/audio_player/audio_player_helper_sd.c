@@ -46,8 +46,10 @@ static void sdcard_url_save_cb(void *user_data, char *url)
 esp_err_t ap_helper_scan_sdcard(playlist_operator_handle_t list, const char *path)
 {
     sdcard_list_reset(list);
-    sdcard_scan(sdcard_url_save_cb, path,
-    0, (const char *[]) {"mp3", "m4a", "flac", "ogg", "opus", "amr", "ts", "aac", "wav"}, 9, list);
+    sdcard_list_batch_begin(list);
+    sdcard_scan_incremental(sdcard_url_save_cb, path,
+    0, (const char *[]) {"mp3", "m4a", "flac", "ogg", "opus", "amr", "ts", "aac", "wav"}, 9, "/sdcard/__playlist/_scan_index", list);
+    sdcard_list_batch_commit(list);
     sdcard_list_show(list);
 
     return ESP_OK;
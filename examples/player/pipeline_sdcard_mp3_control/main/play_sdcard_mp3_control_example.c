@@ -133,7 +133,9 @@ void app_main(void)
 
     ESP_LOGI(TAG, "[1.2] Set up a sdcard playlist and scan sdcard music save to it");
     sdcard_list_create(&sdcard_list_handle);
-    sdcard_scan(sdcard_url_save_cb, "/sdcard", 0, (const char *[]) {"mp3"}, 1, sdcard_list_handle);
+    sdcard_list_batch_begin(sdcard_list_handle);
+    sdcard_scan_incremental(sdcard_url_save_cb, "/sdcard", 0, (const char *[]) {"mp3"}, 1, "/sdcard/__playlist/_scan_index", sdcard_list_handle);
+    sdcard_list_batch_commit(sdcard_list_handle);
     sdcard_list_show(sdcard_list_handle);
 
     ESP_LOGI(TAG, "[ 2 ] Start codec chip");